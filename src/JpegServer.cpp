@@ -5,27 +5,41 @@
 
 #include "MyGraphicsScene.h"
 #include "glvidtex/VideoSender.h"
+#include "glvidtex/SceneCapture.h"
 
 #include <QPainter>
+#include <QBuffer>
+#include <QImageWriter>
 
 #define FRAME_WIDTH  1024
 #define FRAME_HEIGHT 768
-#define FRAME_FORMAT QImage::Format_ARGB32
-//_Premultiplied
 
 JpegServer::JpegServer(QObject *parent)
 	: QTcpServer(parent)
 	, m_scene(0)
+	, m_capture(0)
+	, m_lastFrameNumber(-1)
 	, m_fps(10)
 	, m_adaptiveWriteEnabled(true)
 	, m_timeAccum(0)
 	, m_frameCount(0)
 	, m_onlyRenderOnSlideChange(false)
 	, m_slideChanged(true)
+	, m_jpegSerial(0)
+	, m_encodedSerial(0)
 	, m_sender(0)
+	, m_port(-1)
+	, m_jpegQuality(JPEG_SERVER_DEFAULT_QUALITY)
+	, m_clientCount(0)
 {
 	connect(&m_timer, SIGNAL(timeout()), this, SLOT(generateNextFrame()));
 	setFps(m_fps);
+	
+	// Frames are encoded once on the encoder thread and the bytes shared with every client thread
+	m_encoder = new JpegServerEncoder();
+	m_encoder->moveToThread(&m_encoderThread);
+	connect(m_encoder, SIGNAL(jpegReady(QByteArray,int)), this, SLOT(jpegEncoded(QByteArray,int)), Qt::QueuedConnection);
+	m_encoderThread.start();
 }
 
 JpegServer::~JpegServer()
@@ -35,6 +49,14 @@ JpegServer::~JpegServer()
 		delete m_sender;
 		m_sender = 0;
 	}
+	
+	m_encoderThread.quit();
+	m_encoderThread.wait();
+	delete m_encoder;
+	m_encoder = 0;
+	
+	if(m_capture)
+		m_capture->release();
 }
 
 void JpegServer::setFps(int fps)
@@ -45,6 +67,16 @@ void JpegServer::setFps(int fps)
 	m_timer.setInterval(1000/fps);
 }
 
+void JpegServer::setJpegQuality(int quality)
+{
+	m_jpegQuality = qBound(0, quality, 100);
+	
+	// Re-encode the current frame so clients pick up the new quality even if the scene doesn't change
+	m_cachedJpeg.clear();
+	if(!m_cachedImage.isNull() && m_clientCount > 0)
+		m_encoder->queueImage(m_cachedImage, m_jpegQuality, ++m_jpegSerial);
+}
+
 void JpegServer::onlyRenderOnSlideChange(bool flag)
 {
 	m_onlyRenderOnSlideChange = flag;
@@ -60,14 +92,28 @@ void JpegServer::setScene(MyGraphicsScene *scene)
 {
 	if(m_scene)
 		disconnect(m_scene, 0, this, 0);
+	
+	if(m_capture)
+	{
+		m_capture->release();
+		m_capture = 0;
+	}
 		
 	m_scene = scene;
+	m_lastFrameNumber = -1;
+	if(!m_scene)
+		return;
+	
 	connect(m_scene, SIGNAL(transitionFinished(Slide*)), this, SLOT(generateNextFrame()));
+	
+	// Shared with any other output capturing the same scene at the same size
+	m_capture = SceneCapture::captureForScene(m_scene, QSize(FRAME_WIDTH, FRAME_HEIGHT));
 }
 
 bool JpegServer::start(int port, bool isVideoSender)
 {
 	m_sender = 0;
+	m_port = port;
 	if(!isVideoSender)
 	{
 		if(!listen(QHostAddress::Any,port))
@@ -105,113 +151,208 @@ void JpegServer::fadeSpeedChanged(int speed)
 void JpegServer::incomingConnection(int socketDescriptor)
 {
 	JpegServerThread *thread = new JpegServerThread(socketDescriptor, m_adaptiveWriteEnabled);
+	connect(thread, SIGNAL(finished()), this, SLOT(clientFinished()));
 	connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
-	connect(this, SIGNAL(frameReady(QImage)), thread, SLOT(imageReady(QImage)), Qt::QueuedConnection);
+	connect(this, SIGNAL(jpegReady(QByteArray)), thread, SLOT(jpegReady(QByteArray)), Qt::QueuedConnection);
 	thread->start();
-	qDebug() << "JpegServer: Client Connected, Socket Descriptor:"<<socketDescriptor;
+	m_clientCount ++;
+	qDebug() << "JpegServer: Client Connected, Socket Descriptor:"<<socketDescriptor<<", clients:"<<m_clientCount;
 	
 	
 	thread->moveToThread(thread);
 	
+	// The scene may not change for a while, don't make the new client wait for it
+	sendCachedJpeg();
+	
 	if(!m_timer.isActive())
 		m_timer.start();
 }
 
-void JpegServer::updateRects()
+void JpegServer::clientFinished()
 {
-	QRect targetFrame(0,0, FRAME_WIDTH, FRAME_HEIGHT);
-	QSize nativeSize = m_sourceRect.size();
-	nativeSize.scale(targetFrame.size(), Qt::KeepAspectRatio);
+	m_clientCount --;
+	qDebug() << "JpegServer: Client Disconnected, clients:"<<m_clientCount;
 	
-	m_targetRect = QRect(0, 0, nativeSize.width(), nativeSize.height());
-	m_targetRect.moveCenter(targetFrame.center());
+	// Nobody watching - stop rendering until the next client connects
+	if(m_clientCount <= 0)
+	{
+		m_clientCount = 0;
+		m_timer.stop();
+	}
 }
 
-void JpegServer::generateNextFrame()
+void JpegServer::jpegEncoded(QByteArray bytes, int serial)
 {
-	if(!m_scene || !MainWindow::mw())
+	m_encodedSerial = serial;
+	if(bytes.isEmpty())
 		return;
-		
-	if(m_onlyRenderOnSlideChange &&
-	   !m_slideChanged &&
-	   !m_cachedImage.isNull())
-	{
-		//qDebug() << "JpegServer::generateNextFrame(): Hit Cache";
-		emit frameReady(m_cachedImage);
-		if(m_sender)
-			m_sender->transmitImage(m_cachedImage);
+	
+	// Only cache the encode of the newest image - an older one can land after m_cachedJpeg was cleared for a new frame
+	if(serial == m_jpegSerial)
+		m_cachedJpeg = bytes;
+	
+	if(m_clientCount > 0)
+		emit jpegReady(bytes);
+}
+
+void JpegServer::sendCachedJpeg()
+{
+	if(m_clientCount <= 0)
+		return;
+	
+	if(!m_cachedJpeg.isEmpty())
+		emit jpegReady(m_cachedJpeg);
+	else
+	// Rendered while only the VideoSender was listening - or still encoding, in which case jpegEncoded() sends it
+	if(!m_cachedImage.isNull() && m_encodedSerial == m_jpegSerial)
+		m_encoder->queueImage(m_cachedImage, m_jpegQuality, ++m_jpegSerial);
+}
+
+void JpegServer::generateNextFrame()
+{
+	if(!m_scene || !m_capture || !MainWindow::mw())
 		return;
-	}
 	
-	if(m_onlyRenderOnSlideChange)
+	// No MJPEG clients and no VideoSender - nobody to render for
+	if(m_clientCount <= 0 && !m_sender)
+		return;
+		
+	if(!m_onlyRenderOnSlideChange ||
+	    m_slideChanged ||
+	    m_cachedImage.isNull())
 	{
-		m_slideChanged = false;
-		//qDebug() << "JpegServer::generateNextFrame(): Cache fallthru ...";
+		if(m_onlyRenderOnSlideChange)
+		{
+			m_slideChanged = false;
+			//qDebug() << "JpegServer::generateNextFrame(): Cache fallthru ...";
+		}
+		
+		//qDebug() << "JpegServer::generateNextFrame(): Rendering scene "<<m_scene<<", slide:"<<m_scene->slide();
+		
+		m_time.start();
+		
+		if(!m_sourceRect.isValid())
+			m_sourceRect = MainWindow::mw()->standardSceneRect();
+		
+		m_capture->setSourceRect(m_sourceRect);
+		
+		// Only re-renders the parts of the scene that changed since the last frame (possibly for another output sharing the capture)
+		QImage image = m_capture->frame();
+		
+		if(m_capture->frameNumber() != m_lastFrameNumber)
+		{
+			m_lastFrameNumber = m_capture->frameNumber();
+			m_cachedImage = image;
+			
+			emit frameReady(image);
+			
+			m_cachedJpeg.clear();
+			if(m_clientCount > 0)
+				m_encoder->queueImage(image, m_jpegQuality, ++m_jpegSerial);
+			
+			if(m_sender)
+			{
+				//qDebug() << "JpegServer::generateNextFrame(): Sending image via VideoSender";
+				// VideoSender doesn't know about premultiplied formats
+				m_sender->transmitImage(image.convertToFormat(QImage::Format_ARGB32));
+			}
+			else
+			{
+				//qDebug() << "JpegServer::generateNextFrame(): No VideoSender created";
+			}
+			
+			m_frameCount ++;
+			m_timeAccum  += m_time.elapsed();
+			
+		// 	if(m_frameCount % (m_fps?m_fps:10) == 0)
+		// 	{
+		// 		QString msPerFrame;
+		// 		msPerFrame.setNum(((double)m_timeAccum) / ((double)m_frameCount), 'f', 2);
+		// 	
+		// 		qDebug() << "JpegServer::generateNextFrame(): Avg MS per Frame:"<<msPerFrame<<", threadId:"<<QThread::currentThreadId();
+		// 	}
+		// 			
+		// 	if(m_frameCount % ((m_fps?m_fps:10) * 10) == 0)
+		// 	{
+		// 		m_timeAccum  = 0;
+		// 		m_frameCount = 0;
+		// 	}
+			
+			//qDebug() << "JpegServer::generateNextFrame(): Done rendering "<<m_scene;
+			return;
+		}
 	}
 	
-	//qDebug() << "JpegServer::generateNextFrame(): Rendering scene "<<m_scene<<", slide:"<<m_scene->slide();
+	//qDebug() << "JpegServer::generateNextFrame(): Hit Cache";
 	
-	m_time.start();
+	// Nothing changed - re-send the bytes we already encoded. VideoSender already has the frame
+	// and re-sends it to new clients itself.
+	emit frameReady(m_cachedImage);
 	
-	QImage image(FRAME_WIDTH,
-	             FRAME_HEIGHT,
-		     FRAME_FORMAT);
-	memset(image.scanLine(0), 0, image.byteCount());
+	sendCachedJpeg();
+}
+
+/** Encoder **/
+
+JpegServerEncoder::JpegServerEncoder(QObject *parent)
+	: QObject(parent)
+	, m_pendingQuality(JPEG_SERVER_DEFAULT_QUALITY)
+	, m_pendingSerial(0)
+	, m_encodeQueued(false)
+{
+}
+
+void JpegServerEncoder::queueImage(const QImage& image, int quality, int serial)
+{
+	QMutexLocker lock(&m_pendingLock);
+	m_pendingImage = image;
+	m_pendingQuality = quality;
+	m_pendingSerial = serial;
 	
-	QPainter painter(&image);
-	painter.fillRect(image.rect(),Qt::transparent);
-	painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
-	painter.setRenderHint(QPainter::Antialiasing, false);
-	painter.setRenderHint(QPainter::TextAntialiasing, false);
+	// If an encode is already queued, it will pick up this image instead of the one it was queued for
+	if(!m_encodeQueued)
+	{
+		m_encodeQueued = true;
+		QMetaObject::invokeMethod(this, "encodePending", Qt::QueuedConnection);
+	}
+}
+
+void JpegServerEncoder::encodePending()
+{
+	QImage image;
+	int quality;
+	int serial;
 	
-	if(!m_sourceRect.isValid())
-		m_sourceRect = MainWindow::mw()->standardSceneRect();
-		
-	if(m_sourceRect != m_targetRect)
-		updateRects();
+	m_pendingLock.lock();
+	image = m_pendingImage;
+	quality = m_pendingQuality;
+	serial = m_pendingSerial;
+	m_pendingImage = QImage();
+	m_encodeQueued = false;
+	m_pendingLock.unlock();
 	
-	m_scene->render(&painter,
-		m_targetRect,
-		m_sourceRect);
+	if(image.isNull())
+		return;
 	
-	painter.end();
+	// JPEG has no alpha channel, so flatten to RGB32 here rather than letting the plugin do it per-pixel
+	if(image.format() != QImage::Format_RGB32)
+		image = image.convertToFormat(QImage::Format_RGB32);
 	
- 	emit frameReady(image);
+	QByteArray bytes;
+	QBuffer buffer(&bytes);
+	buffer.open(QIODevice::WriteOnly);
 	
-	if(m_sender)
+	QImageWriter writer(&buffer, "jpg");
+	writer.setQuality(quality);
+	if(!writer.write(image))
 	{
-		//qDebug() << "JpegServer::generateNextFrame(): Sending image via VideoSender";
-		m_sender->transmitImage(image);
-	}
-	else
-	{
-		//qDebug() << "JpegServer::generateNextFrame(): No VideoSender created";
+		qDebug() << "JpegServerEncoder::encodePending(): ImageWriter reported error:"<<writer.errorString();
+		// Still let JpegServer know this serial is done
+		emit jpegReady(QByteArray(), serial);
+		return;
 	}
 	
-	if(m_onlyRenderOnSlideChange)
-		m_cachedImage = image;
-	
-// 	QImageWriter writer("frame.png", "png");
-// 	writer.write(image);
-
-	m_frameCount ++;
-	m_timeAccum  += m_time.elapsed();
-	
-// 	if(m_frameCount % (m_fps?m_fps:10) == 0)
-// 	{
-// 		QString msPerFrame;
-// 		msPerFrame.setNum(((double)m_timeAccum) / ((double)m_frameCount), 'f', 2);
-// 	
-// 		qDebug() << "JpegServer::generateNextFrame(): Avg MS per Frame:"<<msPerFrame<<", threadId:"<<QThread::currentThreadId();
-// 	}
-// 			
-// 	if(m_frameCount % ((m_fps?m_fps:10) * 10) == 0)
-// 	{
-// 		m_timeAccum  = 0;
-// 		m_frameCount = 0;
-// 	}
-	
-	//qDebug() << "JpegServer::generateNextFrame(): Done rendering "<<m_scene;
+	emit jpegReady(bytes, serial);
 }
 
 /** Thread **/
@@ -222,6 +363,7 @@ void JpegServer::generateNextFrame()
 JpegServerThread::JpegServerThread(int socketDescriptor, bool adaptiveWriteEnabled, QObject *parent)
     : QThread(parent)
     , m_socketDescriptor(socketDescriptor)
+    , m_socket(0)
     , m_adaptiveWriteEnabled(adaptiveWriteEnabled)
 {
 	
@@ -229,8 +371,11 @@ JpegServerThread::JpegServerThread(int socketDescriptor, bool adaptiveWriteEnabl
 
 JpegServerThread::~JpegServerThread()
 {
-	m_socket->abort();
-	delete m_socket;
+	if(m_socket)
+	{
+		m_socket->abort();
+		delete m_socket;
+	}
 }
 
 void JpegServerThread::run()
@@ -243,18 +388,17 @@ void JpegServerThread::run()
 		return;
 	}
 	
+	// Leave the event loop (and let JpegServer know) when the client goes away
+	connect(m_socket, SIGNAL(disconnected()), this, SLOT(quit()), Qt::DirectConnection);
+	
 	writeHeaders();
 	
-	m_writer.setDevice(m_socket);
-	m_writer.setFormat("png");
-	m_writer.setQuality(50);
-
 	m_adaptiveIgnore = 0;
 	
 	// enter event loop
 	exec();
 	
-	// when imageReady() signal arrives, write data with header to socket
+	// when jpegReady() signal arrives, write data with header to socket
 }
 
 void JpegServerThread::writeHeaders()
@@ -266,41 +410,33 @@ void JpegServerThread::writeHeaders()
 	m_socket->write("--" BOUNDARY "\r\n");
 }
 
-void JpegServerThread::imageReady(QImage image)
+void JpegServerThread::jpegReady(QByteArray bytes)
 {
 	static int frameCounter = 0;
  	frameCounter++;
 //  	qDebug() << "JpegServerThread: [START] Writing Frame#:"<<frameCounter;
 	
+	if(m_socket->state() != QAbstractSocket::ConnectedState)
+	{
+		quit();
+		return;
+	}
+	
 	if(m_adaptiveWriteEnabled && m_socket->bytesToWrite() > 0 && m_adaptiveIgnore < 30)
 	{
-		qDebug() << "JpegServerThread::imageReady():"<<m_socket->bytesToWrite()<<"bytes pending write on socket, not sending image"<<frameCounter;
+		qDebug() << "JpegServerThread::jpegReady():"<<m_socket->bytesToWrite()<<"bytes pending write on socket, not sending image"<<frameCounter;
 		m_adaptiveIgnore ++;
 	}
 	else
 	{
-		qDebug() << "JpegServerThread::imageReady(): Sending image"<<frameCounter<<", threadId:"<<QThread::currentThreadId();
+		//qDebug() << "JpegServerThread::jpegReady(): Sending image"<<frameCounter<<", threadId:"<<QThread::currentThreadId();
 		m_adaptiveIgnore = 0;
-		//if(image.format() != QImage::Format_RGB32)
-		//	image = image.convertToFormat(QImage::Format_RGB32);
-		
-		if(m_socket->state() == QAbstractSocket::ConnectedState)
-		{
-			//m_socket->write("Content-type: image/jpeg\r\n\r\n");
-			m_socket->write("Content-type: image/png\r\n\r\n");
-		}
 		
-		//QImageWriter writer(m_socket, "png");
-		//writer.write(image);
-	
-		if(!m_writer.write(image))
-		{
-			qDebug() << "ImageWriter reported error:"<<m_writer.errorString();
-			quit();
-		}
-		
-		m_socket->write("--" BOUNDARY "\r\n");
+		// The bytes are shared with all the other clients, so nothing to encode here - just write them out
+		m_socket->write("Content-Type: image/jpeg\r\n");
+		m_socket->write(QString("Content-Length: %1\r\n\r\n").arg(bytes.size()).toAscii());
+		m_socket->write(bytes);
+		m_socket->write("\r\n--" BOUNDARY "\r\n");
 	}
 
 }
-
@@ -8,9 +8,42 @@
 #include <QGraphicsScene>
 #include <QTimer>
 #include <QTime>
+#include <QMutex>
 
 class VideoSender;
 class MyGraphicsScene;
+class SceneCapture;
+
+/// Default JPEG quality for the MJPEG stream, see JpegServer::setJpegQuality()
+#define JPEG_SERVER_DEFAULT_QUALITY 75
+
+/// \class JpegServerEncoder
+/// Encodes frames for JpegServer to JPEG on its own thread.
+/// Only the latest frame is kept - if a new frame is queued before the previous one was encoded, the older one is dropped.
+class JpegServerEncoder : public QObject
+{
+	Q_OBJECT
+public:
+	JpegServerEncoder(QObject *parent = 0);
+	
+	/// Thread-safe. Queues \a image to be encoded, replacing any frame not yet encoded.
+	/// \a serial is handed back with the encoded bytes.
+	void queueImage(const QImage& image, int quality, int serial);
+
+signals:
+	/// Emitted (on the encoder thread) with the encoded JPEG (empty if it failed) and the serial it was queued with
+	void jpegReady(QByteArray, int);
+
+private slots:
+	void encodePending();
+
+private:
+	QMutex m_pendingLock;
+	QImage m_pendingImage;
+	int m_pendingQuality;
+	int m_pendingSerial;
+	bool m_encodeQueued;
+};
 
 class JpegServer : public QTcpServer
 {
@@ -29,6 +62,13 @@ public:
 	void setFps(int fps);
 	int fps() { return m_fps; }
 	
+	/// Sets the JPEG quality (0-100) used for the MJPEG stream
+	void setJpegQuality(int quality);
+	int jpegQuality() { return m_jpegQuality; }
+	
+	/// Number of MJPEG clients currently connected
+	int clientCount() { return m_clientCount; }
+	
 // 	QString myAddress();
 	void onlyRenderOnSlideChange(bool flag=true);
 	
@@ -42,22 +82,28 @@ public slots:
 
 private slots:
 	void generateNextFrame();
+	void jpegEncoded(QByteArray, int);
+	void clientFinished();
 	
 signals:
 	void frameReady(QImage);
+	/// Encoded frame, shared by all JpegServerThread clients
+	void jpegReady(QByteArray);
 
 protected:
 	void incomingConnection(int socketDescriptor);
 
 private:
-	void updateRects();
+	// Sends m_cachedJpeg to the clients, or queues an encode of m_cachedImage if there isn't one
+	void sendCachedJpeg();
 	
 	MyGraphicsScene *m_scene;
+	SceneCapture *m_capture;
+	int m_lastFrameNumber;
 	int m_fps;
 	QTimer m_timer;
 	bool m_adaptiveWriteEnabled;
 	
-	QRect m_targetRect;
 	QRect m_sourceRect;
 	
 	int m_timeAccum;
@@ -68,9 +114,20 @@ private:
 	bool m_onlyRenderOnSlideChange;
 	bool m_slideChanged;
 	QImage m_cachedImage;
+	QByteArray m_cachedJpeg;
+	// Serial of the last image queued on m_encoder - an encode that finishes after a newer one was
+	// queued is still sent, but doesn't replace m_cachedJpeg
+	int m_jpegSerial;
+	// Serial of the last encode m_encoder finished (or failed), so sendCachedJpeg() doesn't queue the same image twice
+	int m_encodedSerial;
 	
 	VideoSender *m_sender;
 	int m_port;
+	
+	int m_jpegQuality;
+	int m_clientCount;
+	QThread m_encoderThread;
+	JpegServerEncoder *m_encoder;
 
 };
 
@@ -90,7 +147,7 @@ signals:
 	void error(QTcpSocket::SocketError socketError);
 
 public slots:
-	void imageReady(QImage);
+	void jpegReady(QByteArray);
 
 private:
 	void writeHeaders();
@@ -99,7 +156,6 @@ private:
 	QTcpSocket * m_socket;
 	
 	QByteArray m_boundary;
-	QImageWriter m_writer;
 	bool m_adaptiveWriteEnabled;
 	int m_adaptiveIgnore;
 };
@@ -787,6 +787,18 @@ bool MainWindow::openFile(const QString & file)
 
 	d->close();
 	
+	if(m_doc->hasRecoveryFile())
+	{
+		if(QMessageBox::question(this,tr("Recover Changes"),tr("Some changes to %1 were never saved, probably because DViz closed unexpectedly. Do you want to recover them?").arg(fileName),
+			QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+		{
+			if(m_doc->applyRecoveryFile() < 0)
+				QMessageBox::warning(this,tr("Recovery Failed"),tr("The unsaved changes to %1 could not be read. The recovery file next to it was left in place.").arg(fileName));
+		}
+		else
+			m_doc->discardRecoveryFile();
+	}
+	
 	AppSettings::sendCheckin("/main/loadfile",file);
 //	qDebug() << "MainWindow::open(): m_docModel->setDocument() - end";
 
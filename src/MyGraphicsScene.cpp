@@ -134,18 +134,20 @@ public:
 			if(slide)
 			{
 				// Start key with _q to mark as 'private' (e.g. won't be stored in file)
-				QVariant var = slide->property("_q-root-cachedRev");
+				// Keyed on the content hash rather than the revision, so changing and then
+				// undoing a change (or changing something that isn't drawn) still hits
+				QVariant var = slide->property("_q-root-cachedHash");
 				if(var.isValid())
 				{
-					quint32 cr = var.toInt();
-					if(cr == slide->revision())
+					quint64 cr = var.toULongLong();
+					if(cr == slide->contentHash())
 					{
 						var = slide->property("_q-root-cachedImage");
 						if(var.type() == QVariant::Image &&
 						   var.isValid())
 						{
 							m_cache = var.value<QImage>();
-							//qDebug() << "RenderProxyItem::setFrozen("<<flag<<"): "<<scene() <<"->"<< m_name <<"->"<< slide<<": Hit cache at rev "<<cr;
+							//qDebug() << "RenderProxyItem::setFrozen("<<flag<<"): "<<scene() <<"->"<< m_name <<"->"<< slide<<": Hit cache at hash "<<cr;
 							return;
 						}
 					}
@@ -197,9 +199,9 @@ public:
 			if(slide)
 			{
 				// Start key with _q to mark as 'private' (e.g. won't be stored in file)
-				slide->setProperty("_q-root-cachedRev",slide->revision());
+				slide->setProperty("_q-root-cachedHash",slide->contentHash());
 				slide->setProperty("_q-root-cachedImage", m_cache);
-				qDebug() << "RenderProxyItem::setFrozen("<<flag<<"): "<<scene() <<"->"<< m_name <<"->"<< slide<<": Missed cache, rendering for rev "<<slide->revision();
+				qDebug() << "RenderProxyItem::setFrozen("<<flag<<"): "<<scene() <<"->"<< m_name <<"->"<< slide<<": Missed cache, rendering for hash "<<slide->contentHash();
 			}
 			
 			//return;
@@ -224,6 +226,7 @@ MyGraphicsScene::MyGraphicsScene(ContextHint hint, QObject * parent)
     , m_lastElapsed(-1)
     , m_contextHint(hint)
     , m_bg(0)
+    , m_bgReused(false)
     , m_fadeClockStarted(false)
 {
 	m_staticRoot = new RootObject(this);
@@ -283,11 +286,14 @@ void MyGraphicsScene::setContextHint(ContextHint hint)
 	m_contextHint = hint;
 }
 
-void MyGraphicsScene::clear(bool emitTxFinished)
+void MyGraphicsScene::clear(bool emitTxFinished, const QList<AbstractContent*>& keep)
 {
 	//qDebug() << "MyGraphicsScene::clear() "<<this;
 	foreach(AbstractContent *content, m_content)
 	{
+		if(keep.contains(content))
+			continue;
+			
 		m_content.removeAll(content);
 		if(content->parentItem() == m_liveRoot)
 			content->setParentItem(0);
@@ -418,14 +424,34 @@ void MyGraphicsScene::setSlide(Slide *slide, SlideTransition trans, int speed, i
 		qDebug() << "MyGraphicsScene::setSlide(): "<<this<<" trans:"<<trans<<", speed:"<<speed<<", quality:"<<quality;
 	//trans = None;
 	
+	// Content that looks exactly the same on the new slide is kept instead of being disposed of and
+	// created again - most of all, so a background video keeps playing across the slides of a song
+	QHash<AbstractItem*,AbstractContent*> reused;
+	m_bgReused = false;
+	
 	bool crossFading = false;
 	if(trans == None || (speed <= 1 && quality <= 1))
 	{
-		clear(false); // dont emit transitionFinished(0) - we do that later
+		reused = reuseIdenticalContent(slide, false);
+		clear(false, reused.values()); // dont emit transitionFinished(0) - we do that later
 	}
 	else
 	{
 		crossFading = true;
+		
+		if(!m_fadeTimer)
+		{
+			m_fadeTimer = new QTimer(this);
+			connect(m_fadeTimer, SIGNAL(timeout()), this, SLOT(slotTransitionStep()));
+		}
+		
+		// Finish the fade still running before looking for content to keep - otherwise the outgoing slide's
+		// content (still on the fade root) could be matched, then disposed of by endTransition()
+		if(m_fadeTimer->isActive())
+			endTransition(); 
+		
+		// Only the bottom of the stack - see reuseIdenticalContent()
+		reused = reuseIdenticalContent(slide, true);
 // 		//QStringList newSlideKeys;
 // 		QMap<quint32,AbstractItem*> newSlideKeys;
 // 		// have existing content?
@@ -460,22 +486,24 @@ void MyGraphicsScene::setSlide(Slide *slide, SlideTransition trans, int speed, i
 		if(DEBUG_MYGRAPHICSSCENE)
 			qDebug() << "MyGraphicsScene::setSlide(): "<<this<<" [final] speed:"<<speed<<", quality:"<<quality;
 		
-		if(!m_fadeTimer)
-		{
-			m_fadeTimer = new QTimer(this);
-			connect(m_fadeTimer, SIGNAL(timeout()), this, SLOT(slotTransitionStep()));
-		}
-		
 		
-		if(m_fadeTimer->isActive())
-			endTransition(); 
-			
  		//if(DEBUG_MYGRAPHICSSCENE)
  			//qDebug() << "MyGraphicsScene::setSlide(): Reparenting"<<m_content.size()<<"items";
 		m_staticRoot->setZValue(100);
 			
+		QList<AbstractContent*> reusedContent = reused.values();
 		foreach(AbstractContent *x, m_content)
 		{
+			// Identical on both slides (with nothing changing underneath it), so just leave it
+			// showing on the static root instead of fading it out and an identical copy in.
+			// endTransition() moves it to the live root.
+			if(reusedContent.contains(x))
+			{
+				x->setParentItem(m_staticRoot);
+				if(x->modelItem()->itemClass() == BackgroundItem::ItemClass)
+					m_bgReused = true;
+				continue;
+			}
 			
 // 			AbstractItem * model = x->modelItem();
 // 			quint32 key = model->valueKey();
@@ -583,7 +611,17 @@ void MyGraphicsScene::setSlide(Slide *slide, SlideTransition trans, int speed, i
 	{
 		assert(item != NULL);
 		
-		AbstractContent * visual = createVisualDelegate(item);
+		AbstractContent * visual = reused.value(item);
+		if(visual)
+		{
+			if(item->itemClass() == BackgroundItem::ItemClass)
+				m_bg = dynamic_cast<BackgroundItem*>(item);
+		}
+		else
+		{
+			visual = createVisualDelegate(item);
+		}
+		
 		//determine max zvalue for use in rebasing overlay items
 		if(visual && visual->zValue() > baseZValue)
 			baseZValue = visual->zValue();
@@ -607,12 +645,17 @@ void MyGraphicsScene::setSlide(Slide *slide, SlideTransition trans, int speed, i
 			}
 			else
 			{
-				AbstractContent * content = createVisualDelegate(item);
-				applyMasterSlideItemFlags(content);
+				AbstractContent * content = reused.value(item);
+				if(!content)
+				{
+					content = createVisualDelegate(item);
+					applyMasterSlideItemFlags(content);
+				}
 
 				// rebase zvalue so everything in this slide is on top of the original slide
-				if(content && baseZValue!=0)
-					content->setZValue(content->zValue() + baseZValue);
+				// (from the model, since reused content was rebased for the previous slide)
+				if(content)
+					content->setZValue(content->modelItem()->zValue() + baseZValue);
 			}
 				
 			//qDebug() << "MyGraphicsScene::setSlide(): Added Master Item: "<<item->itemName()<<", Z: "<<content->zValue();
@@ -649,6 +692,98 @@ void MyGraphicsScene::setSlide(Slide *slide, SlideTransition trans, int speed, i
 		qDebug() << "MyGraphicsScene::setSlide(): "<<this<<" Setting slide # "<<slide->slideNumber()<<" - DONE.";
 }
 
+static bool MyGraphicsScene_isIdenticalContent(AbstractContent *content, AbstractItem *item)
+{
+	AbstractVisualItem *model = content->modelItem();
+	return model &&
+	       model->metaObject() == item->metaObject() &&
+	       model->contentHash() == item->contentHash();
+}
+
+static bool MyGraphicsScene_itemZLessThan(AbstractItem *a, AbstractItem *b)
+{
+	return dynamic_cast<AbstractVisualItem*>(a)->zValue() < dynamic_cast<AbstractVisualItem*>(b)->zValue();
+}
+
+static bool MyGraphicsScene_contentZLessThan(AbstractContent *a, AbstractContent *b)
+{
+	return a->zValue() < b->zValue();
+}
+
+QHash<AbstractItem*,AbstractContent*> MyGraphicsScene::reuseIdenticalContent(Slide *slide, bool bottomLayersOnly)
+{
+	QHash<AbstractItem*,AbstractContent*> reused;
+	
+	// The editor ties configs and selections to the model items, so always start fresh there
+	if(m_contextHint == Editor || !m_slide || !slide)
+		return reused;
+	
+	// force creation of bg if doesnt exist (setSlide() does the same) so it can be matched below
+	slide->background();
+	
+	QList<AbstractItem*> newItems;
+	foreach(AbstractItem *item, slide->itemList())
+		if(dynamic_cast<AbstractVisualItem*>(item))
+			newItems << item;
+	
+	if(bottomLayersOnly)
+	{
+		// While crossfading, kept content sits on the static root - under everything that's fading.
+		// So only content with nothing but other kept content underneath it can be kept, or it would
+		// show under (rather than over) whatever changed beneath it until the fade finished.
+		QList<AbstractContent*> oldContent = m_content;
+		qSort(newItems.begin(), newItems.end(), MyGraphicsScene_itemZLessThan);
+		qSort(oldContent.begin(), oldContent.end(), MyGraphicsScene_contentZLessThan);
+		
+		for(int i=0; i<newItems.size() && i<oldContent.size(); i++)
+		{
+			AbstractContent *content = oldContent[i];
+			if(content->property("flag_fromMaster").toBool() ||
+			   !MyGraphicsScene_isIdenticalContent(content, newItems[i]))
+				break;
+			
+			reused[newItems[i]] = content;
+		}
+	}
+	else
+	{
+		// Master backgrounds are never shown by setSlide(), so never match them
+		QList<AbstractItem*> masterItems;
+		if(m_masterSlide)
+			foreach(AbstractItem *item, m_masterSlide->itemList())
+				if(dynamic_cast<AbstractVisualItem*>(item) &&
+				   !dynamic_cast<BackgroundItem*>(item))
+					masterItems << item;
+		
+		foreach(AbstractContent *content, m_content)
+		{
+			QList<AbstractItem*> &candidates = content->property("flag_fromMaster").toBool() ? masterItems : newItems;
+			foreach(AbstractItem *item, candidates)
+			{
+				if(MyGraphicsScene_isIdenticalContent(content, item))
+				{
+					reused[item] = content;
+					candidates.removeAll(item);
+					break;
+				}
+			}
+		}
+	}
+	
+	// Point the kept content at the new slide's items now - the old slide may be deleted
+	// as soon as slideDiscarded() is emitted
+	QHashIterator<AbstractItem*,AbstractContent*> it(reused);
+	while(it.hasNext())
+	{
+		it.next();
+		if(DEBUG_MYGRAPHICSSCENE_ITEM_MGMT)
+			qDebug() << "MyGraphicsScene::reuseIdenticalContent(): Keeping "<<it.value()->modelItem()->itemName()<<" for "<<it.key()->itemName();
+		it.value()->setIdenticalModelItem(dynamic_cast<AbstractVisualItem*>(it.key()));
+	}
+	
+	return reused;
+}
+
 QList<AbstractContent *> MyGraphicsScene::abstractContent(bool onlyMasterItems)
 {
 	QList<AbstractContent *> newList;
@@ -828,7 +963,8 @@ void MyGraphicsScene::slotTransitionStep()
 // 		m_fadeTime.start();
 		
 		//double inc = (double)1 / m_fadeSteps;
-		if(!m_bg || m_bg->fillType() == AbstractVisualItem::None)
+		// A reused background is on the static root, not covering the old slide from the live root
+		if(!m_bg || m_bg->fillType() == AbstractVisualItem::None || m_bgReused)
 			m_fadeRoot->setOpacity(1.0 - fadeVal); //m_fadeRoot->opacity() - inc);
 		#if QT46_OPAC_ENAB > 0
 			QGraphicsOpacityEffect * opac = dynamic_cast<QGraphicsOpacityEffect*>(m_liveRoot->graphicsEffect()); 
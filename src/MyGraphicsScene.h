@@ -8,6 +8,7 @@
 #include <QRect>
 #include <QTime>
 #include <QVariant>
+#include <QHash>
 
 
 class AbstractContent;
@@ -62,7 +63,8 @@ class MyGraphicsScene : public QGraphicsScene
 		AbstractVisualItem * newImageItem();
 		AbstractVisualItem * newOutputView();
 		
-		void clear(bool emitTxFinished=true);
+		// Content in keep is left on the scene (e.g. because it's identical on the next slide)
+		void clear(bool emitTxFinished=true, const QList<AbstractContent*>& keep = QList<AbstractContent*>());
 		
 		ContextHint contextHint() { return m_contextHint; }
 		void setContextHint(ContextHint);
@@ -121,6 +123,9 @@ class MyGraphicsScene : public QGraphicsScene
 		
 		void applyMasterSlideItemFlags(AbstractContent *content);
 		
+		// Finds content on the scene now that's identical to items of slide, and points it at those items
+		QHash<AbstractItem*,AbstractContent*> reuseIdenticalContent(Slide *slide, bool bottomLayersOnly);
+		
 		QList<AbstractContent *> m_content;
 		QList<AbstractContent *> m_ownedContent;
 		QList<AbstractContent *> m_prevContent;
@@ -150,6 +155,8 @@ class MyGraphicsScene : public QGraphicsScene
 		RootObject * m_staticRoot;
 		
 		BackgroundItem * m_bg;
+		// true if the background was carried over from the previous slide during a crossfade
+		bool m_bgReused;
 		
 		bool m_fadeClockStarted;
 			
@@ -143,6 +143,45 @@ void OutputInstance::removeMirror(OutputInstance *inst)
 // 	if(inst->output())
 // 		qDebug() << "OutputInstance::removeMirror: ["<<m_output->name()<<"] Removing mirror instance ptr"<<inst<<", mirror inst output name: "<<inst->output()->name();
 	m_mirrors.removeAll(inst);
+	
+	if(m_renderMirrors.removeAll(inst) && inst->m_viewer->renderSource() == m_viewer)
+		inst->m_viewer->setRenderSource(0);
+}
+
+void OutputInstance::addRenderMirror(OutputInstance *inst)
+{
+	if(!inst || inst == this || m_renderMirrors.contains(inst))
+		return;
+	
+	//qDebug() << "OutputInstance::addRenderMirror: ["<<m_output->name()<<"] Adding render mirror instance ptr"<<inst<<", mirror inst output name: "<<inst->output()->name();
+	m_mirrors.removeAll(inst);
+	m_renderMirrors << inst;
+	
+	updateRenderMirrors();
+}
+
+void OutputInstance::updateRenderMirrors()
+{
+	foreach(OutputInstance *m, m_renderMirrors)
+	{
+		if(isLocal() && m->isLocal())
+		{
+			m_mirrors.removeAll(m);
+			m->m_viewer->setRenderSource(m_viewer);
+		}
+		else
+		{
+			m->m_viewer->setRenderSource(0);
+			if(!m_mirrors.contains(m))
+			{
+				m_mirrors << m;
+				
+				// It hasn't been sent anything while it was showing our scene
+				if(m_slideGroup)
+					m->setSlideGroup(m_slideGroup, m_slide);
+			}
+		}
+	}
 }
 
 void OutputInstance::slotGrabPixmap()
@@ -321,6 +360,9 @@ void OutputInstance::applyOutputSettings(bool startHidden)
 		m_outputServer->close();
 		delete m_outputServer;
 	}
+	
+	// We may not be local anymore (or may be local again)
+	updateRenderMirrors();
 }
 
 // proxy methods
@@ -95,6 +95,10 @@ signals:
 
 public slots:
 	virtual void addMirror(OutputInstance *);
+	// Like addMirror(), but the mirror shows our scene (scaled to fit) instead of being sent every
+	// command and rendering it all a second time. Falls back to addMirror() if either of us isn't local.
+	virtual void addRenderMirror(OutputInstance *);
+	// A removed render mirror goes blank, it isn't sent what we're showing
 	virtual void removeMirror(OutputInstance *);
 
 	virtual void addFilter(AbstractItemFilter *);
@@ -154,6 +158,9 @@ protected:
 // 	void updateControlWidget();
 	
 	void executeUserActions(SlideGroup *group, QString event);
+	
+	// Shares our scene with each of m_renderMirrors if we can, otherwise moves it to m_mirrors
+	void updateRenderMirrors();
 
 	Output *m_output;
 	SlideGroupViewer *m_viewer;
@@ -196,6 +203,7 @@ protected:
 	bool m_lockResizeEvent;
 	
 	QList<OutputInstance*> m_mirrors;
+	QList<OutputInstance*> m_renderMirrors;
 	
 	bool m_clearEnabled;
 	bool m_blackEnabled;
@@ -32,6 +32,8 @@ OutputViewer::~OutputViewer()
 {
 	if(m_view)
 	{
+		if(m_inst)
+			m_inst->removeMirror(m_view);
 		delete m_view;
 		m_view = 0;
 	}
@@ -42,5 +44,6 @@ void OutputViewer::setOutputInstance(OutputInstance *inst)
 	if(m_inst)
 		m_inst->removeMirror(m_view);
  	m_inst = inst;
- 	m_inst->addMirror(m_view);
+	// Just shows what the output is showing, no need to render it all again
+ 	m_inst->addRenderMirror(m_view);
 }
@@ -4,116 +4,80 @@
 #include "SharedMemoryImageWriter.h"
 
 #include "MainWindow.h"
+#include "glvidtex/SceneCapture.h"
 #include <QPainter>
 #include <QImage>
 #include <QTime>
 
 #define WRITER_FPS 10
-#define BYTES_PER_PIXEL 4
 
 SharedMemoryImageWriter::SharedMemoryImageWriter(QObject *parent)
 	: QObject(parent)
 	, m_scene(0)
+	, m_capture(0)
+	, m_lastFrameNumber(-1)
 {
 	connect(&m_frameTimer, SIGNAL(timeout()), this, SLOT(generateFrame()));
 	m_frameTimer.setInterval(1000/WRITER_FPS);
 	
-	QImage testImage(FRAME_WIDTH,
-			 FRAME_HEIGHT,
-			 FRAME_FORMAT);
-	m_memorySize = testImage.byteCount();	
-	
 	m_timeAccum = 0;
 	m_frameCount = 0;
 }
 
 SharedMemoryImageWriter::~SharedMemoryImageWriter()
 {
-	if(m_sharedMemory.isAttached())
-		m_sharedMemory.detach();
+	disable();
 }
 	
 void SharedMemoryImageWriter::enable(const QString& key, QGraphicsScene *scene)
 {
-	m_sharedMemory.setKey(key);
-	if(m_sharedMemory.isAttached())
-		m_sharedMemory.detach();
-		
-	if (!m_sharedMemory.attach(QSharedMemory::ReadWrite)) 
+	if(!m_ring.create(key, QSize(FRAME_WIDTH, FRAME_HEIGHT)))
 	{
-		// Shared memory does not exist, create it
-		if (!m_sharedMemory.create(m_memorySize, QSharedMemory::ReadWrite)) 
-		{
-			qDebug() << "SharedMemoryImageWriter::enable("<<key<<"): Error:"<<m_sharedMemory.errorString();
-			return;
-		}
-		else 
-		{
-			m_sharedMemory.lock();
-			memset(m_sharedMemory.data(), 0, m_sharedMemory.size());
-			m_sharedMemory.unlock();
-		}
+		qDebug() << "SharedMemoryImageWriter::enable("<<key<<"): Error:"<<m_ring.errorString();
+		return;
 	}
 	
+	if(m_capture)
+		m_capture->release();
+	
 	m_scene = scene;
+	m_capture = SceneCapture::captureForScene(m_scene, QSize(FRAME_WIDTH, FRAME_HEIGHT));
+	m_lastFrameNumber = -1;
 	m_frameTimer.start();
 }
 
 void SharedMemoryImageWriter::disable()
 {
 	m_frameTimer.stop();
-	if(m_sharedMemory.isAttached())
-		m_sharedMemory.detach();
-}
-
-void SharedMemoryImageWriter::updateRects()
-{
-	QRect targetFrame(0,0, FRAME_WIDTH, FRAME_HEIGHT);
-	QSize nativeSize = m_sourceRect.size();
-	nativeSize.scale(targetFrame.size(), Qt::KeepAspectRatio);
+	m_ring.detach();
 	
-	m_targetRect = QRect(0, 0, nativeSize.width(), nativeSize.height());
-	m_targetRect.moveCenter(targetFrame.center());
+	if(m_capture)
+	{
+		m_capture->release();
+		m_capture = 0;
+	}
 }
 
 void SharedMemoryImageWriter::generateFrame()
 {
-	if(!m_scene || !MainWindow::mw())
+	if(!m_capture || !MainWindow::mw() || !m_ring.isAttached())
 		return;
 	QTime time;
 	time.start();
 	
-	QImage image(FRAME_WIDTH,
-	             FRAME_HEIGHT,
-		     FRAME_FORMAT);
-	memset(image.scanLine(0), 0, image.byteCount());
-	
-	QPainter painter(&image);
-	painter.fillRect(image.rect(),Qt::transparent);
-	painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
-	painter.setRenderHint(QPainter::Antialiasing, false);
-	painter.setRenderHint(QPainter::TextAntialiasing, false);
-	
 	if(!m_sourceRect.isValid())
 		m_sourceRect = MainWindow::mw()->standardSceneRect();
-		
-	if(m_sourceRect != m_targetRect)
-		updateRects();
-	
-	m_scene->render(&painter,
-		m_targetRect,
-		m_sourceRect);
-	
-	painter.end();
-	
- 	int size = image.byteCount();
- 	const uchar *from = image.scanLine(0);
- 	
- 	m_sharedMemory.lock();
- 	uchar *to = (uchar*)m_sharedMemory.data();
- 	memset(to, 0, m_sharedMemory.size());
- 	memcpy(to, from, qMin(m_sharedMemory.size(), size));
- 	m_sharedMemory.unlock();
+	
+	m_capture->setSourceRect(m_sourceRect);
+	
+	// Only re-renders the parts of the scene that changed - and if nothing did, readers still have the last frame in the ring
+	QImage image = m_capture->frame();
+	if(m_capture->frameNumber() == m_lastFrameNumber)
+		return;
+	
+	m_lastFrameNumber = m_capture->frameNumber();
+	
+	m_ring.writeImage(image, QTime::currentTime(), 1000/WRITER_FPS);
 	
 	m_frameCount ++;
 	m_timeAccum  += time.elapsed();
@@ -2,14 +2,15 @@
 #define SharedMemoryImageWriter_H
 
 #include <QObject>
-#include <QSharedMemory>
 #include <QTimer>
 #include <QGraphicsScene>
 
+#include "livemix/SharedMemoryRing.h"
+
 #define FRAME_WIDTH 1024
 #define FRAME_HEIGHT 768
-#define FRAME_FORMAT QImage::Format_ARGB32_Premultiplied
 
+class SceneCapture;
 class SharedMemoryImageWriter : public QObject
 {
 	Q_OBJECT
@@ -23,17 +24,13 @@ public:
 private slots:
 	void generateFrame();
 	
-private:
-	void updateRects();
-	
 private:
 	QTimer m_frameTimer;
-	QSharedMemory m_sharedMemory;
-	int m_memorySize;
+	SharedMemoryRingWriter m_ring;
 	QGraphicsScene *m_scene;
-	QImage m_image;
+	SceneCapture *m_capture;
+	int m_lastFrameNumber;
 	
-	QRect m_targetRect;
 	QRect m_sourceRect;
 	
 	int m_timeAccum;
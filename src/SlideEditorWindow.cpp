@@ -47,6 +47,8 @@
 
 #include <QUndoView>
 #include <QUndoStack>
+#include <QPointer>
+#include <QTime>
 
 #include <QApplication>
 
@@ -56,6 +58,7 @@
 #include "model/Slide.h"
 #include "model/TextItem.h"
 #include "model/BackgroundItem.h"
+#include "model/DocumentJournal.h"
 #include "MainWindow.h"
 #include "AppSettings.h"
 #include "items/TextBoxContent.h"
@@ -1895,12 +1898,19 @@ Slide * SlideEditorWindow::prevSlide()
 
 
 
+ // A change to the same field of the same item within this many ms of the last one is merged into the same
+ // undo step, so dragging an item around is one step instead of one per mouse move
+ #define SLIDEEDITOR_UNDO_MERGE_TIME 750
+
  class UndoSlideItemChanged : public QUndoCommand
  {
  public:
-	UndoSlideItemChanged(SlideEditorWindow *window, AbstractItem *item, QString field, QVariant value, QVariant oldValue)
-		: m_window(window), m_item(item), m_field(field), m_value(value), m_oldValue(oldValue), redoCount(0)
+	UndoSlideItemChanged(SlideEditorWindow *window, Slide *slide, AbstractItem *item, QString field, QVariant value, QVariant oldValue)
+		: m_window(window), m_group(window->slideGroup()), redoCount(0)
 		{
+			// Just ids, not the item itself - undoing a change to an item that's been deleted since does nothing
+			m_delta = DocumentJournal::delta(m_group, slide, item, field, value, oldValue);
+			m_time.start();
 			setText(QString(qApp->translate("SlideEditorWindow","Change %2 of %1")).arg(AbstractItem::guessTitle(item->itemName())).arg(AbstractItem::guessTitle(field)));
 		}
 
@@ -1908,8 +1918,8 @@ Slide * SlideEditorWindow::prevSlide()
 	virtual void undo()
 	{
 		m_window->ignoreUndoChanged(true);
-		//qDebug() << "UndoSlideItemChanged::undo: UNDO cmd for "<<m_item->itemName()<<", field:"<<m_field<<", oldValue:"<<m_oldValue<<", newValue:"<<m_value;
-		m_item->setProperty(m_field.toLocal8Bit().constData(),m_oldValue);
+		//qDebug() << "UndoSlideItemChanged::undo: UNDO cmd for item"<<m_delta.itemId<<", field:"<<DocumentJournal::fieldName(m_delta.field)<<", oldValue:"<<m_delta.oldValue<<", newValue:"<<m_delta.value;
+		DocumentJournal::apply(m_group, m_delta, true);
 		m_window->ignoreUndoChanged(false);
 	}
 	virtual void redo()
@@ -1917,29 +1927,34 @@ Slide * SlideEditorWindow::prevSlide()
 		if(redoCount++ > 0)
 		{
 			m_window->ignoreUndoChanged(true);
-			//qDebug() << "UndoSlideItemChanged::redo: REDO cmd for "<<m_item->itemName()<<", field:"<<m_field<<", oldValue:"<<m_oldValue<<", newValue:"<<m_value;
-			m_item->setProperty(m_field.toLocal8Bit().constData(),m_value);
+			//qDebug() << "UndoSlideItemChanged::redo: REDO cmd for item"<<m_delta.itemId<<", field:"<<DocumentJournal::fieldName(m_delta.field)<<", oldValue:"<<m_delta.oldValue<<", newValue:"<<m_delta.value;
+			DocumentJournal::apply(m_group, m_delta);
 			m_window->ignoreUndoChanged(false);
 		}
 	}
-	virtual bool mergeWidth(const QUndoCommand * other)
+	virtual bool mergeWith(const QUndoCommand * other)
 	{
 		if(other->id() != id())
 			return false;
 		const UndoSlideItemChanged * cmd = static_cast<const UndoSlideItemChanged*>(other);
-		if(cmd->m_field    == m_field &&
-		   cmd->m_value    == m_value &&
-		   cmd->m_oldValue == m_oldValue)
-			return true;
+		if(cmd->m_group          != m_group ||
+		   cmd->m_delta.slideId  != m_delta.slideId ||
+		   cmd->m_delta.itemId   != m_delta.itemId ||
+		   cmd->m_delta.field    != m_delta.field ||
+		   cmd->m_delta.oldValue != m_delta.value ||
+		   m_time.elapsed() > SLIDEEDITOR_UNDO_MERGE_TIME)
+			return false;
 
-		return false;
+		// Keep our old value, take the new one - and keep merging as long as the changes keep coming
+		m_delta.value = cmd->m_delta.value;
+		m_time.start();
+		return true;
 	}
 private:
 	SlideEditorWindow *m_window;
-	AbstractItem *m_item;
-	QString m_field;
-	QVariant m_value;
-	QVariant m_oldValue;
+	QPointer<SlideGroup> m_group;
+	DocumentJournalDelta m_delta;
+	QTime m_time;
 	int redoCount;
 };
 
@@ -2131,7 +2146,7 @@ void SlideEditorWindow::slideChanged(Slide *slide, QString slideOperation, Abstr
 
 void SlideEditorWindow::slideItemChanged(AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant oldValue)
 {
-// 	Slide * slide = dynamic_cast<Slide *>(sender());
+	Slide * slide = dynamic_cast<Slide *>(sender());
 
 	if(operation == "add")
 	{
@@ -2155,13 +2170,13 @@ void SlideEditorWindow::slideItemChanged(AbstractItem *item, QString operation,
 	else
 	if(operation == "change")
 	{
-		if(item)
+		if(item && slide)
 		{
 			if(!m_ignoreUndoPropChanges)
 			{
 				if(value != oldValue)
 				{
-					QUndoCommand * changeCmd = new UndoSlideItemChanged(this,item,fieldName,value,oldValue);
+					QUndoCommand * changeCmd = new UndoSlideItemChanged(this,slide,item,fieldName,value,oldValue);
 					m_undoStack->push(changeCmd);
 					m_curSlideChangeCount ++;
 					m_groupChangeCount ++;
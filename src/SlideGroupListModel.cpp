@@ -350,7 +350,7 @@ void SlideGroupListModel::modelDirtyTimeout()
 	
 	foreach(Slide *slide, m_dirtySlides)
 		if(!m_pixmapOk.contains(slide))
-			QPixmapCache::remove(QString("%1-%2").arg(POINTER_STRING(slide)).arg(m_iconSize.width()));
+			QPixmapCache::remove(pixmapCacheKey(slide));
 	
 	QModelIndex top    = indexForSlide(m_dirtySlides.first()), 
 	            bottom = indexForSlide(m_dirtySlides.last());
@@ -452,7 +452,7 @@ QVariant SlideGroupListModel::data(const QModelIndex &index, int role) const
 	else if(Qt::DecorationRole == role)
 	{
 		Slide *g = m_sortedSlides.at(index.row());
-		QString cacheKey = QString("%1-%2").arg(POINTER_STRING(g)).arg(m_iconSize.width());
+		QString cacheKey = pixmapCacheKey(g);
 		QPixmap icon;
 		
 		//qDebug() << "SlideGroupListModel::data: Decoration for row:"<<index.row();
@@ -521,7 +521,7 @@ void SlideGroupListModel::setSceneRect(QRect r)
 // 		qDebug() << "SlideGroupListModel::setSceneRect: top:"<<top<<", bottom:"<<bottom;
 		
 		foreach(Slide *slide, m_sortedSlides)
-			QPixmapCache::remove(QString("%1-%2").arg(POINTER_STRING(slide)).arg(m_iconSize.width()));
+			QPixmapCache::remove(pixmapCacheKey(slide));
 
 		dataChanged(top,bottom);
 	}
@@ -661,6 +661,19 @@ QPixmap SlideGroupListModel::generatePixmap(Slide *slide)
 	}
 }
 
+QString SlideGroupListModel::pixmapCacheKey(Slide *slide) const
+{
+	// Keyed on what the slide looks like rather than which slide it is, so identical slides
+	// (e.g. a repeated chorus) share one thumbnail, and a changed slide misses the cache on its own
+	Slide *master = m_slideGroup ? m_slideGroup->masterSlide() : 0;
+	return QString("slide-%1-%2-%3x%4-%5")
+		.arg(slide->contentHash(), 16, 16, QChar('0'))
+		.arg(master ? master->contentHash() : 0, 16, 16, QChar('0'))
+		.arg(m_sceneRect.width())
+		.arg(m_sceneRect.height())
+		.arg(m_iconSize.width());
+}
+
 QPixmap SlideGroupListModel::defaultPendingPixmap()
 {
 	if(m_pendingPixmap.isNull() || m_pendingPixmap.size() != m_iconSize)
@@ -737,7 +750,7 @@ void SlideGroupListModel::makePixmaps()
 	
 	Slide *group = m_needPixmaps.takeFirst();
 	
-	QString cacheKey = QString("%1-%2").arg(POINTER_STRING(group)).arg(m_iconSize.width());
+	QString cacheKey = pixmapCacheKey(group);
 	QPixmapCache::remove(cacheKey);
 		
 	QPixmap icon = generatePixmap(group);
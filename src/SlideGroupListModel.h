@@ -83,6 +83,7 @@ protected:
 	virtual QPixmap generatePixmap(Slide*);
 	virtual QPixmap renderScene(MyGraphicsScene*);
 	QPixmap defaultPendingPixmap();
+	QString pixmapCacheKey(Slide*) const;
 	void markSlideDirty(Slide*, bool pixmapDirty=true);
 	
 	void regenerateBlankPixmap();
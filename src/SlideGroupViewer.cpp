@@ -35,6 +35,8 @@
 #include <QApplication>
 
 #define MAX_BYPRODUCT_SIZE 10
+// ms to wait after a slide is shown (or for a transition to finish) before filtering the next slide
+#define PREFILTER_DELAY 250
 #define NATIVE_CHECK_TIMEOUT 500
 
 /** NativeViewer **/
@@ -276,6 +278,7 @@ SlideGroupViewer::SlideGroupViewer(QWidget *parent)
 	    , m_sharedMemoryImageWriterEnabled(false)
 	    , m_jpegServer(0)
 	    , m_ignoreAspectRatio(false)
+	    , m_renderSource(0)
 {
 	QRect sceneRect(0,0,1024,768);
 	m_blackSlideRefCount++;
@@ -313,6 +316,10 @@ SlideGroupViewer::SlideGroupViewer(QWidget *parent)
 	connect(m_scene, SIGNAL(slideDiscarded(Slide*)), this, SLOT(slideDiscarded(Slide*)));
 
 	connect(&m_nativeCheckTimer, SIGNAL(timeout()), this, SLOT(checkCurrentNativeSlide()));
+	
+	m_prefilterTimer.setSingleShot(true);
+	m_prefilterTimer.setInterval(PREFILTER_DELAY);
+	connect(&m_prefilterTimer, SIGNAL(timeout()), this, SLOT(prefilterNextSlide()));
 
 // 	m_view->setBackgroundBrush(Qt::green); 
 
@@ -372,13 +379,23 @@ void SlideGroupViewer::checkCurrentNativeSlide()
 
 void SlideGroupViewer::setOverlaySlide(Slide * newSlide)
 {
+	if(m_overlaySlide)
+		disconnect(m_overlaySlide,0,this,0);
+	
 	m_overlaySlide = newSlide;
+	
+	// Filtered slides hold the overlay's items, so they're no good once the overlay changes
+	if(m_overlaySlide)
+		connect(m_overlaySlide,SIGNAL(slideItemChanged(AbstractItem *, QString, QString, QVariant, QVariant)),this,SLOT(clearSlideFilterCache()));
+	
+	clearSlideFilterCache();
 	applySlideFilters();
 }
 
 void SlideGroupViewer::setOverlayEnabled(bool enable)
 {
 	m_overlayEnabled = enable;
+	clearSlideFilterCache();
 	applySlideFilters();
 }
 
@@ -395,6 +412,7 @@ void SlideGroupViewer::setTextOnlyFilterEnabled(bool enable)
 void SlideGroupViewer::setAutoResizeTextEnabled(bool enable)
 {
 	m_autoResizeText = enable;
+	clearSlideFilterCache();
 	applySlideFilters();
 }
 
@@ -450,7 +468,83 @@ Slide * SlideGroupViewer::applySlideFilters(Slide * sourceSlide)
 		&& !m_autoResizeText
 		&& m_slideFilters.size() <= 0)
 		return sourceSlide;
+	
+	// Outputs like the stage display see the same slides over and over (and every slide is
+	// filtered once ahead of time by prefilterNextSlide()), so keep the filtered slides around.
+	// Changes to a source slide drop it from the cache in slideChanged().
+	QString key = slideFilterKey(sourceSlide);
+	
+	Slide *cached = m_slideFilterCache.value(sourceSlide);
+	if(cached && cached->property("_q_filterKey").toString() == key)
+	{
+		// Move to the end of the byproduct list so it isn't deleted while it's on screen
+		m_slideFilterByproduct.removeAll(cached);
+		m_slideFilterByproduct << cached;
+		
+		//qDebug() << "SlideGroupViewer::applySlideFilters(): Cache hit for "<<key;
+		return cached;
+	}
+	
+	Slide * slide = filterSlide(sourceSlide);
+	
+	// Start key with _q to mark as 'private' (e.g. won't be stored in file)
+	slide->setProperty("_q_filterKey", key);
+	m_slideFilterCache[sourceSlide] = slide;
+	
+	return slide;
+}
+
+QString SlideGroupViewer::slideFilterKey(Slide *sourceSlide)
+{
+	QSizeF size = m_scene->sceneRect().size();
+	return QString("%1-%2-%3x%4")
+		.arg(sourceSlide->contentHash(), 16, 16, QChar('0'))
+		.arg(m_overlaySlide && m_overlayEnabled ? m_overlaySlide->contentHash() : 0, 16, 16, QChar('0'))
+		.arg(size.width())
+		.arg(size.height());
+}
+
+void SlideGroupViewer::clearSlideFilterCache()
+{
+	m_slideFilterCache.clear();
+}
+
+void SlideGroupViewer::prefilterNextSlide()
+{
+	if(!m_slideGroup || m_nativeViewer || m_renderSource)
+		return;
+	
+	// Auto-resize text is expensive enough to make a fade stutter, so wait it out
+	if(isTransitionActive())
+	{
+		m_prefilterTimer.start();
+		return;
+	}
+	
+	int next = m_slideNum + 1;
+	if(next < 0 || next >= m_sortedSlides.size())
+		return;
+	
+	applySlideFilters(m_sortedSlides.at(next));
+}
+
+void SlideGroupViewer::trimSlideFilterByproducts(int maxSize)
+{
+	while(m_slideFilterByproduct.size() > maxSize)
+	{
+		Slide *slide = m_slideFilterByproduct.takeFirst();
+		
+		QMutableHashIterator<Slide*,Slide*> it(m_slideFilterCache);
+		while(it.hasNext())
+			if(it.next().value() == slide)
+				it.remove();
+		
+		delete slide;
+	}
+}
 
+Slide * SlideGroupViewer::filterSlide(Slide * sourceSlide)
+{
 	Slide * slide = new Slide();
 
 	// for deleting this slide after the scene is done with it (in slideDiscarded())
@@ -575,17 +669,22 @@ Slide * SlideGroupViewer::applySlideFilters(Slide * sourceSlide)
 				}
 
 
-				AbstractVisualItem * visual = dynamic_cast<AbstractVisualItem*>(overlayItem);
+				AbstractItem *mutated = applyMutations(overlayItem);
 
-				// rebase zvalue so everything in this slide is on top of the original slide
+				// rebase zvalue so everything in this slide is on top of the original slide -
+				// on a copy, not the overlay's own item, or it would climb higher with every slide
+				// (and change the overlay's contentHash(), which the filter cache is keyed on)
+				AbstractVisualItem * visual = dynamic_cast<AbstractVisualItem*>(overlayItem);
 				if(visual && baseZValue!=0)
 				{
-					visual->setZValue(visual->zValue() + baseZValue);
+					if(mutated == overlayItem)
+						mutated = overlayItem->clone();
+					
+					AbstractVisualItem * newVisual = dynamic_cast<AbstractVisualItem*>(mutated);
+					newVisual->setZValue(visual->zValue() + baseZValue);
 					//qDebug()<<"SlideGroupViewer::applySlideFilters: rebased" << newVisual->itemName() << "to new Z" << newVisual->zValue();
 				}
 
-				AbstractItem *mutated = applyMutations(overlayItem);
-
 				// if mutated != originalItem, that means that the filter returned a clone()'ed item with changes,
 				// therefore, allow the slide to take ownership and delete the mutated item when slide is discared
 				// (in the slideDiscarded() slot)
@@ -711,8 +810,7 @@ SlideGroupViewer::~SlideGroupViewer()
 // 		m_clearSlide = 0;
 // 	}
 
-	while(!m_slideFilterByproduct.isEmpty())
-		delete m_slideFilterByproduct.takeFirst();
+	trimSlideFilterByproducts(0);
 
 	m_blackSlideRefCount --;
 	if(m_blackSlideRefCount <= 0 && m_blackSlide)
@@ -819,6 +917,9 @@ void SlideGroupViewer::slideChanged(Slide *slide, QString slideOperation, Abstra
 {
 	if(!m_slideGroup)
 		return;
+	
+	// The filtered slide may hold the changed (or removed) item
+	m_slideFilterCache.remove(slide);
 
 	if(slideOperation == "add" || slideOperation == "remove")
 	{
@@ -842,7 +943,7 @@ void SlideGroupViewer::slideChanged(Slide *slide, QString slideOperation, Abstra
 			if(!reapplySpecialFrames())
 				if(AppSettings::liveEditMode() == AppSettings::SmoothEdit)
 				{
-					qDebug() << "SlideGroupViewer::slideChanged() [slot]: SmoothEdit selected, re-showing slide due to change on item: "<<item->itemName();
+					qDebug() << "SlideGroupViewer::slideChanged() [slot]: SmoothEdit selected, re-showing slide due to change on item: "<<(item ? item->itemName() : QString());
 					setSlideInternal(applySlideFilters(slide));
 				}
 	}
@@ -894,6 +995,7 @@ void SlideGroupViewer::setSlideGroup(SlideGroup *group, Slide *startSlide)
 
 	if(m_slideGroup && m_slideGroup != group)
 	{
+		clearSlideFilterCache();
 		disconnect(m_slideGroup,0,this,0);
 		//qDebug() << "SlideGroupViewer::setSlideGroup: Releasing video providers due to slide change";
 		releaseVideoProvders();
@@ -1071,6 +1173,8 @@ Slide * SlideGroupViewer::setSlide(Slide *slide, bool takeOwnership)
 		{
 			//qDebug() << "SlideGroupViewer::setSlide(): Special frames returned false, setting slide directly";
 			setSlideInternal(applySlideFilters(slide));
+			
+			m_prefilterTimer.start();
 		}
 		else
 		{
@@ -1137,8 +1241,7 @@ void SlideGroupViewer::slideDiscarded(Slide */*oldSlide*/)
 // // 		delete oldSlide;
 // // 	}
 
-	while(m_slideFilterByproduct.size() > MAX_BYPRODUCT_SIZE)
-		delete m_slideFilterByproduct.takeFirst();
+	trimSlideFilterByproducts(MAX_BYPRODUCT_SIZE);
 }
 
 void SlideGroupViewer::addFilter(AbstractItemFilter * filter)
@@ -1146,6 +1249,9 @@ void SlideGroupViewer::addFilter(AbstractItemFilter * filter)
 	if(!m_slideFilters.contains(filter))
 		m_slideFilters.append(filter);
 // 	qDebug() << "SlideGroupViewer::addFilter: adding filter"<<filter->filterId();
+	// Filter settings are applied by removing and adding the filter again (see OutputControl::setTextOnlyBackground()),
+	// so this is the only place to catch them
+	clearSlideFilterCache();
 	applySlideFilters();
 }
 
@@ -1153,12 +1259,14 @@ void SlideGroupViewer::removeFilter(AbstractItemFilter *filter)
 {
 // 	qDebug() << "SlideGroupViewer::addFilter: removing filter"<<filter->filterId();
 	m_slideFilters.removeAll(filter);
+	clearSlideFilterCache();
 	applySlideFilters();
 }
 
 void SlideGroupViewer::removeAllFilters()
 {
 	m_slideFilters.clear();
+	clearSlideFilterCache();
 	applySlideFilters();
 }
 
@@ -1221,6 +1329,10 @@ Slide * SlideGroupViewer::prevSlide()
 void SlideGroupViewer::setSlideInternal(Slide *slide)
 {
 	//qDebug() << "SlideGroupViewer::setSlideInternal(): Setting slide# "<<slide->slideNumber()<<", group ptr: "<<PTRS(m_slideGroup);
+	// Showing someone else's scene - ours is left empty, see restoreOwnScene()
+	if(m_renderSource)
+		return;
+	
 	if(AppSettings::liveEditMode() == AppSettings::SmoothEdit ||
 	   AppSettings::liveEditMode() == AppSettings::PublishEdit)
 	{
@@ -1473,10 +1585,61 @@ void SlideGroupViewer::setIgnoreAspectRatio(bool flag)
 	adjustViewScaling();
 }
 
+void SlideGroupViewer::setRenderSource(SlideGroupViewer *source)
+{
+	if(source == this)
+		source = 0;
+	if(m_renderSource == source)
+		return;
+	
+	if(m_renderSource)
+		disconnect(m_renderSource, 0, this, 0);
+	
+	if(!source)
+	{
+		restoreOwnScene();
+		return;
+	}
+	
+	//qDebug() << "SlideGroupViewer::setRenderSource(): "<<this<<": showing scene of "<<source;
+	m_renderSource = source;
+	connect(m_renderSource, SIGNAL(destroyed()), this, SLOT(renderSourceDestroyed()));
+	
+	// Nothing in our scene would be seen, so don't keep videos playing, filtered slides queued, etc
+	m_prefilterTimer.stop();
+	releaseVideoProvders();
+	m_scene->clear();
+	
+	m_view->setScene(m_renderSource->m_scene);
+	adjustViewScaling();
+}
+
+void SlideGroupViewer::renderSourceDestroyed()
+{
+	// The source's scene already took itself off of our view when it was deleted
+	restoreOwnScene();
+}
+
+void SlideGroupViewer::restoreOwnScene()
+{
+	m_renderSource = 0;
+	m_view->setScene(m_scene);
+	
+	// Nothing is sent to us while we show the source, so our scene stays empty (rather than re-rendering
+	// and restarting the videos of the slide we had before) until someone sets a group on us again -
+	// see OutputInstance::updateRenderMirrors()
+	adjustViewScaling();
+}
+
 void SlideGroupViewer::adjustViewScaling()
 {
-	float sx = ((float)m_view->width()) / m_scene->width();
-	float sy = ((float)m_view->height()) / m_scene->height();
+	// Not always m_scene - see setRenderSource()
+	QGraphicsScene *shown = m_view->scene();
+	if(!shown)
+		return;
+	
+	float sx = ((float)m_view->width()) / shown->width();
+	float sy = ((float)m_view->height()) / shown->height();
 
 	if(m_ignoreAspectRatio)
 	{
@@ -1498,6 +1661,8 @@ void SlideGroupViewer::adjustViewScaling()
 // This whole business of integrating with the QVideoProvider framework in the SlideGroupViewer itself
 // is desiged to basically initalize the video streams before it "goes live" to create a seamless
 // transition. The vote is still out on whether or not this actually helps - it seems to. We'll see.
+// The providers are opened in the background, so a group full of videos doesn't stall the GUI here, and
+// BackgroundContent gets the same (already loaded, first frame decoded) provider when the slide goes live.
 void SlideGroupViewer::initVideoProviders()
 {
 	if(!m_slideGroup)
@@ -1521,7 +1686,7 @@ void SlideGroupViewer::initVideoProviders()
 				if(visualItem->fillType() == AbstractVisualItem::Video &&
 				  !videoFile.isEmpty())
 				{
-					QVideoProvider * p = QVideoProvider::providerForFile(videoFile);
+					QVideoProvider * p = QVideoProvider::providerForFile(videoFile, true);
 					if(p)
 					{
 						if(m_videoProvidersOpened[p->canonicalFilePath()] ||
@@ -133,6 +133,8 @@ class SlideGroupViewer : public QWidget
 public:
 	SlideGroupViewer(QWidget *parent=0);
 	~SlideGroupViewer();
+	
+	SlideGroupViewer * renderSource() { return m_renderSource; }
 
 	//void setSlideGroup(SlideGroup*, int startSlide = 0);
 	void setSlideGroup(SlideGroup*, Slide *slide = 0);
@@ -240,9 +242,15 @@ public slots:
 	void setMjpegServerEnabled(bool enable, int port=8080, int fps=15);
 	
 	void setIgnoreAspectRatio(bool flag);
+	
+	// Shows the scene of \a source in our view instead of our own, so a mirror doesn't render every slide a second time.
+	// Our own scene is cleared and left alone until this is called with 0 (or \a source is deleted), and stays
+	// empty after that until a slide group is set on us again.
+	void setRenderSource(SlideGroupViewer *source);
 
 private slots:
 	void appSettingsChanged();
+	void renderSourceDestroyed();
 	void aspectRatioChanged(double);
 	
 	void videoStreamStarted();
@@ -251,6 +259,11 @@ private slots:
 	void slideDiscarded(Slide*);
 	
 	void slideChanged(Slide *slide, QString slideOperation, AbstractItem *item, QString operation, QString fieldName, QVariant value);
+	
+	// Filters the slide after the current one ahead of time, so it's cached by the time it's shown
+	void prefilterNextSlide();
+	// Forgets all filtered slides (they're still deleted as byproducts) - for when the filters, overlay, etc change
+	void clearSlideFilterCache();
 
 	void checkCurrentNativeSlide();
 		
@@ -264,13 +277,22 @@ protected:
 private:
 	MyGraphicsScene * scene() { return m_scene; }
 	
+	// Returns the filtered slide for the source slide - from m_slideFilterCache if nothing changed since it was last filtered
 	Slide * applySlideFilters(Slide*);
+	// Actually runs the filters, overlay and auto-resize, always returning a new slide
+	Slide * filterSlide(Slide*);
 	AbstractItem * applyMutations(AbstractItem*);
+	// What the filtered slide depends on besides the filters themselves (changing those clears the cache)
+	QString slideFilterKey(Slide*);
+	// Deletes the oldest byproducts (and drops them from the cache) until there's at most maxSize left
+	void trimSlideFilterByproducts(int maxSize);
 	
 	// internal routine to find the cross fade quality/speed and set the slideon the scene
 	void setSlideInternal(Slide*);
 	// just calls setSlideInternal(applySlideFilters(currentSlide)) and finds the current slide
 	void applySlideFilters();
+	// puts m_scene back in the view after a render source is removed or deleted
+	void restoreOwnScene();
 	// internal routine to apply the background to the slide group
 	void applyBackground(const QFileInfo&, Slide *slide=0);
 	
@@ -318,6 +340,9 @@ private:
 	int m_fadeQuality;
 	
 	QList<Slide*>	m_slideFilterByproduct;
+	// Source slide -> filtered slide, both owned elsewhere (filtered slides by m_slideFilterByproduct)
+	QHash<Slide*,Slide*> m_slideFilterCache;
+	QTimer m_prefilterTimer;
 	
 	AbstractItemFilterList m_slideFilters;
 	
@@ -352,6 +377,8 @@ private:
 	bool m_jpegServerEnabled;
 	
 	bool m_ignoreAspectRatio;
+	
+	QPointer<SlideGroupViewer> m_renderSource;
 };
 
 #endif // SLIDEGROUPVIEWER_H
@@ -166,12 +166,16 @@ SOURCES += \
 
 HEADERS += \
 	glvidtex/VideoSender.h \
-	livemix/VideoFrame.h 
+	glvidtex/SceneCapture.h \
+	livemix/VideoFrame.h \
+	livemix/SharedMemoryRing.h
 	#livemix/VideoSource.h
 	
 SOURCES += \
 	glvidtex/VideoSender.cpp \
-	livemix/VideoFrame.cpp 
+	glvidtex/SceneCapture.cpp \
+	livemix/VideoFrame.cpp \
+	livemix/SharedMemoryRing.cpp
 	#livemix/VideoSource.cpp
 
 
@@ -23,7 +23,7 @@ void FaceDetectFilter::processFrame()
 	QImage image = frameImage();	
 	QImage histo = highlightFaces(image);
 	
-	enqueue(new VideoFrame(histo,m_frame->holdTime()));
+	enqueueImage(histo);
 }
 
 QImage FaceDetectFilter::highlightFaces(QImage img)
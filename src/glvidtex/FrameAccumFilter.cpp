@@ -0,0 +1,47 @@
+#include "FrameAccumFilter.h"
+
+FrameAccumFilter::FrameAccumFilter(QObject *parent)
+	: VideoFilter(parent)
+	, m_accum(FrameAccumulator::ExponentialAverage, 5)
+{
+}
+
+FrameAccumFilter::~FrameAccumFilter() {}
+
+void FrameAccumFilter::setFrameAccumNum(int n)
+{
+	QMutexLocker lock(&m_frameAccessMutex);
+	m_accum.setFrameCount(n);
+}
+
+void FrameAccumFilter::setAccumMode(FrameAccumulator::Mode mode)
+{
+	QMutexLocker lock(&m_frameAccessMutex);
+	m_accum.setMode(mode);
+}
+
+void FrameAccumFilter::resetAccum()
+{
+	QMutexLocker lock(&m_frameAccessMutex);
+	m_accum.reset();
+}
+
+void FrameAccumFilter::processFrame()
+{
+	if(!m_frame)
+		return;
+	
+	QImage average = m_accum.addFrame(frameImage());
+	if(average.isNull())
+		return;
+	
+	enqueueImage(average);
+}
+
+QList<QImage::Format> FrameAccumFilter::acceptedFormats()
+{
+	return QList<QImage::Format>()
+		<< QImage::Format_RGB32
+		<< QImage::Format_ARGB32
+		<< QImage::Format_ARGB32_Premultiplied;
+}
@@ -0,0 +1,35 @@
+#ifndef FrameAccumFilter_H
+#define FrameAccumFilter_H
+
+#include <QtGui>
+#include "VideoFilter.h"
+#include "FrameAccumulator.h"
+
+/// \class FrameAccumFilter
+/// Temporal noise reduction - outputs the average of the last frameAccumNum() frames of its source.
+/// See FrameAccumulator for how the average is kept.
+class FrameAccumFilter : public VideoFilter
+{
+	Q_OBJECT
+public:
+	FrameAccumFilter(QObject *parent=0);
+	~FrameAccumFilter();
+	
+	int frameAccumNum() { return m_accum.frameCount(); }
+	FrameAccumulator::Mode accumMode() { return m_accum.mode(); }
+	
+public slots:
+	void setFrameAccumNum(int);
+	void setAccumMode(FrameAccumulator::Mode);
+	
+	/// Starts the average over, e.g. after a scene cut
+	void resetAccum();
+	
+protected:
+	virtual void processFrame();
+	virtual QList<QImage::Format> acceptedFormats();
+	
+	FrameAccumulator m_accum;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "FrameAccumulator.h"
+
+#include <QDebug>
+#include <string.h>
+
+FrameAccumulator::FrameAccumulator(Mode mode, int frameCount)
+	: m_mode(mode)
+	, m_frameCount(1)
+	, m_accumulated(0)
+	, m_format(QImage::Format_Invalid)
+	, m_bytesPerLine(0)
+	, m_historyPos(0)
+	, m_averageDirty(false)
+{
+	setFrameCount(frameCount);
+}
+
+void FrameAccumulator::setMode(Mode mode)
+{
+	if(m_mode == mode)
+		return;
+
+	m_mode = mode;
+	reset();
+}
+
+void FrameAccumulator::setFrameCount(int count)
+{
+	if(count < 1)
+		count = 1;
+	if(count > FRAMEACCUM_MAX_FRAMES)
+		count = FRAMEACCUM_MAX_FRAMES;
+
+	if(m_frameCount == count)
+		return;
+
+	m_frameCount = count;
+
+	// The exponential average just starts weighting new frames differently,
+	// but the window would have to know which frames to drop - easier to start over.
+	if(m_mode == WindowAverage)
+		reset();
+	else
+	if(m_accumulated > m_frameCount)
+		m_accumulated = m_frameCount;
+}
+
+void FrameAccumulator::reset()
+{
+	m_accumulated = 0;
+	m_historyPos = 0;
+	m_size = QSize();
+	m_format = QImage::Format_Invalid;
+	m_bytesPerLine = 0;
+	m_sum.clear();
+	m_history.clear();
+	m_average = QImage();
+	m_averageDirty = false;
+}
+
+QImage FrameAccumulator::addFrame(const QImage& sourceImage)
+{
+	if(sourceImage.isNull())
+		return average();
+
+	QImage image = sourceImage;
+	if(image.format() != QImage::Format_RGB32 &&
+	   image.format() != QImage::Format_ARGB32 &&
+	   image.format() != QImage::Format_ARGB32_Premultiplied)
+		image = image.convertToFormat(QImage::Format_RGB32);
+
+	if(image.size() != m_size || image.format() != m_format)
+	{
+		//qDebug() << "FrameAccumulator::addFrame(): Frame changed to "<<image.size()<<image.format()<<", starting over";
+		reset();
+		m_size = image.size();
+		m_format = image.format();
+		m_bytesPerLine = m_size.width() * 4;
+
+		int frameBytes = m_bytesPerLine * m_size.height();
+		m_sum.resize(frameBytes);
+		if(m_mode == WindowAverage)
+			m_history.resize(frameBytes * m_frameCount);
+	}
+
+	// scanLine() on a non-const image would detach (deep copy) a frame we're only reading
+	const QImage& frame = image;
+
+	if(m_mode == ExponentialAverage)
+	{
+		if(m_accumulated < m_frameCount)
+			m_accumulated ++;
+
+		for(int y=0; y<m_size.height(); y++)
+			addExponential(frame.scanLine(y), y * m_bytesPerLine);
+	}
+	else
+	{
+		bool windowFull = m_accumulated == m_frameCount;
+		if(!windowFull)
+			m_accumulated ++;
+
+		for(int y=0; y<m_size.height(); y++)
+			addWindow(frame.scanLine(y), y * m_bytesPerLine, windowFull);
+
+		m_historyPos = (m_historyPos + 1) % m_frameCount;
+	}
+
+	m_averageDirty = true;
+	return average();
+}
+
+void FrameAccumulator::addExponential(const uchar *src, int offset)
+{
+	// Weight of the new frame in 1/256ths - during warm-up every frame so far counts equally
+	const int weight = 256 / m_accumulated;
+	quint16 *sum = m_sum.data() + offset;
+
+	for(int i=0; i<m_bytesPerLine; i++)
+	{
+		int acc = sum[i];
+		acc += ((((int)src[i] << 8) - acc) * weight + 128) >> 8;
+		sum[i] = (quint16)acc;
+	}
+}
+
+void FrameAccumulator::addWindow(const uchar *src, int offset, bool windowFull)
+{
+	quint16 *sum = m_sum.data() + offset;
+	uchar *slot = m_history.data() + m_historyPos * m_sum.size() + offset;
+
+	if(windowFull)
+	{
+		for(int i=0; i<m_bytesPerLine; i++)
+			sum[i] = sum[i] - slot[i] + src[i];
+	}
+	else
+	{
+		for(int i=0; i<m_bytesPerLine; i++)
+			sum[i] += src[i];
+	}
+
+	memcpy(slot, src, m_bytesPerLine);
+}
+
+QImage FrameAccumulator::average()
+{
+	if(!m_accumulated)
+		return QImage();
+
+	if(!m_averageDirty)
+		return m_average;
+
+	// New image every time instead of writing into m_average, so callers holding on to the last one don't force a detach
+	QImage image(m_size, m_format);
+	const quint16 *sum = m_sum.constData();
+
+	if(m_mode == ExponentialAverage)
+	{
+		for(int y=0; y<m_size.height(); y++)
+		{
+			uchar *line = image.scanLine(y);
+			for(int i=0; i<m_bytesPerLine; i++)
+				line[i] = (uchar)((sum[i] + 128) >> 8);
+			sum += m_bytesPerLine;
+		}
+	}
+	else
+	{
+		// Multiply by a 16.16 reciprocal instead of dividing every byte
+		const quint32 recip = (65536 + m_accumulated - 1) / m_accumulated;
+		for(int y=0; y<m_size.height(); y++)
+		{
+			uchar *line = image.scanLine(y);
+			for(int i=0; i<m_bytesPerLine; i++)
+				line[i] = (uchar)((sum[i] * recip) >> 16);
+			sum += m_bytesPerLine;
+		}
+	}
+
+	m_average = image;
+	m_averageDirty = false;
+	return m_average;
+}
@@ -0,0 +1,72 @@
+#ifndef FrameAccumulator_H
+#define FrameAccumulator_H
+
+#include <QImage>
+#include <QVector>
+
+/// Largest window FrameAccumulator supports - 256 frames of 8bit channels still fit in a 16bit running sum
+#define FRAMEACCUM_MAX_FRAMES 256
+
+/// \class FrameAccumulator
+/// Temporal average of a stream of same-sized 32bit frames, used by HistogramFilter, VideoDifferenceFilter
+/// and FrameAccumFilter to smooth out sensor noise.
+///
+/// Every channel of every pixel is kept in a 16bit accumulator, so each new frame costs one pass over the
+/// pixels regardless of how many frames are averaged:
+///  - ExponentialAverage keeps a moving average (8.8 fixed point) where each new frame gets a weight of 1/frameCount().
+///    No history is kept. This is what painting the last N frames on top of each other at 1/N opacity used to approximate.
+///  - WindowAverage keeps a running sum of exactly the last frameCount() frames. The oldest frame is subtracted
+///    as the new one is added, so it needs a ring buffer of frameCount() raw frames.
+///
+/// Changing the frame size or format starts the average over.
+class FrameAccumulator
+{
+public:
+	enum Mode { ExponentialAverage, WindowAverage };
+
+	FrameAccumulator(Mode mode = ExponentialAverage, int frameCount = 5);
+
+	Mode mode() { return m_mode; }
+	void setMode(Mode mode);
+
+	/// Number of frames averaged, 1 - FRAMEACCUM_MAX_FRAMES
+	int frameCount() { return m_frameCount; }
+	void setFrameCount(int);
+
+	/// Number of frames currently in the average - less than frameCount() until the accumulator warms up
+	int accumulated() { return m_accumulated; }
+	bool isEmpty() { return m_accumulated == 0; }
+
+	/// Drops all accumulated frames
+	void reset();
+
+	/// Adds \a image to the average and returns the new average. Images that aren't 32bit are converted to RGB32.
+	QImage addFrame(const QImage& image);
+
+	/// Returns the current average, or a null image if nothing was added yet
+	QImage average();
+
+private:
+	void addExponential(const uchar *src, int offset);
+	void addWindow(const uchar *src, int offset, bool windowFull);
+
+	Mode m_mode;
+	int m_frameCount;
+	int m_accumulated;
+
+	QSize m_size;
+	QImage::Format m_format;
+	int m_bytesPerLine;
+
+	/// One entry per byte of the frame. ExponentialAverage: value << 8, WindowAverage: sum of the window.
+	QVector<quint16> m_sum;
+
+	/// WindowAverage only: the last m_frameCount frames, back to back
+	QVector<uchar> m_history;
+	int m_historyPos;
+
+	QImage m_average;
+	bool m_averageDirty;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "GLEditorGraphicsScene.h"
 #include "GLVideoDrawable.h"
 #include "GLSceneGroup.h"
+#include "GLScheduler.h"
 
 #include <QGLFramebufferObject>
 
@@ -1776,16 +1777,20 @@ void GLDrawable::setGLScene(GLScene *scene)
 GLDrawablePlaylist::GLDrawablePlaylist(GLDrawable *drawable)
 	: QAbstractItemModel(drawable)
 	, m_drawable(drawable)
+	, m_isPlaying(false)
 	, m_playTime(0)
 	, m_timerTickLength(1./2.)
 	, m_currentItemIndex(-1)
+	, m_playStartClock(0)
+	, m_tickEventId(-1)
+	, m_lastScheduledDue(-1)
 {
-	connect(&m_tickTimer, SIGNAL(timeout()), this, SLOT(timerTick()));
-	m_tickTimer.setInterval((int)(m_timerTickLength * 1000.));
 }
 
 GLDrawablePlaylist::~GLDrawablePlaylist()
 {
+	GLScheduler::instance()->cancelAll(this);
+	
 	//disconnect(conn, 0, this, 0);
 	m_itemLookup.clear();
 	qDeleteAll(m_items);
@@ -2033,7 +2038,7 @@ void GLDrawablePlaylist::removeItem(GLPlaylistItem *item)
 
 void GLDrawablePlaylist::playlistItemChangedSlot()
 {
-	GLPlaylistItem *item = dynamic_cast<GLPlaylistItem *>(item);
+	GLPlaylistItem *item = dynamic_cast<GLPlaylistItem *>(sender());
 	if(!item)
 		return;
 
@@ -2044,7 +2049,16 @@ void GLDrawablePlaylist::playlistItemChangedSlot()
 	QModelIndex idx = createIndex(row, row);
 	dataChanged(idx, idx);
 
-	/// TODO - rerun calculations for automatic durations/schedules
+	/// TODO - rerun calculations for automatic durations
+
+	// Duration or schedule may have changed - recompute what's due next
+	if(m_isPlaying)
+	{
+		GLScheduler::instance()->cancelAll(this);
+		m_tickEventId = -1;
+		scheduleItems();
+		scheduleNextTick();
+	}
 
 	emit playlistItemChanged();
 }
@@ -2101,13 +2115,37 @@ void GLDrawablePlaylist::setIsPlaying(bool flag)
 }
 void GLDrawablePlaylist::play(bool restart)
 {
+	if(m_isPlaying)
+		m_playTime = playTime();
 	if(restart)
 		m_playTime = 0;
-	m_tickTimer.start();
+
+	GLScheduler *scheduler = GLScheduler::instance();
+	scheduler->cancelAll(this);
+	m_tickEventId = -1;
+
+	m_playStartClock = scheduler->clock() - (qint64)(m_playTime * 1000.);
+	m_isPlaying = true;
+
+	showItemAt(m_playTime);
+	scheduleItems();
+	scheduleNextTick();
 }
 void GLDrawablePlaylist::stop()
 {
-	m_tickTimer.stop();
+	if(m_isPlaying)
+		m_playTime = playTime();
+	m_isPlaying = false;
+
+	GLScheduler::instance()->cancelAll(this);
+	m_tickEventId = -1;
+}
+
+double GLDrawablePlaylist::playTime()
+{
+	if(!m_isPlaying)
+		return m_playTime;
+	return ((double)(GLScheduler::instance()->clock() - m_playStartClock)) / 1000.;
 }
 
 GLPlaylistItem *GLDrawablePlaylist::currentItem()
@@ -2165,9 +2203,25 @@ void GLDrawablePlaylist::playItem(GLPlaylistItem *item)
 }
 
 bool GLDrawablePlaylist::setPlayTime(double time)
+{
+	if(!m_isPlaying)
+		return showItemAt(time);
+
+	// Seeking while playing - re-anchor the clock and recompute when the next item is due
+	m_playStartClock = GLScheduler::instance()->clock() - (qint64)(time * 1000.);
+
+	GLScheduler::instance()->cancel(m_tickEventId);
+	m_tickEventId = -1;
+
+	bool found = showItemAt(time);
+	scheduleNextTick();
+	return found;
+}
+
+bool GLDrawablePlaylist::showItemAt(double time)
 {
 	m_playTime = time;
-	//qDebug() << "GLDrawablePlaylist::setPlayTime: "<<time;
+	//qDebug() << "GLDrawablePlaylist::showItemAt: "<<time;
 
 	emit playerTimeChanged(time);
 
@@ -2189,7 +2243,7 @@ bool GLDrawablePlaylist::setPlayTime(double time)
 	}
 	else
 	{
-		//qDebug() << "GLDrawablePlaylist::setPlayTime: "<<time<<": Could not find item at time "<<time;
+		//qDebug() << "GLDrawablePlaylist::showItemAt: "<<time<<": Could not find item at time "<<time;
 		return false;
 	}
 
@@ -2197,9 +2251,121 @@ bool GLDrawablePlaylist::setPlayTime(double time)
 
 void GLDrawablePlaylist::timerTick()
 {
-	if(!setPlayTime(m_playTime + m_timerTickLength))
-		if(!setPlayTime(0))
-			stop();
+	m_tickEventId = -1;
+	if(!m_isPlaying)
+		return;
+
+	double dur = duration();
+	if(dur <= 0)
+	{
+		stop();
+		return;
+	}
+
+	// Time comes from the clock, not from counting ticks, so a late tick just means we catch up
+	double time = playTime();
+	if(time >= dur)
+	{
+		// Loop - but keep the phase, so a late tick doesn't push the rest of the next loop back
+		int loops = (int)(time / dur);
+		m_playStartClock += (qint64)(loops * dur * 1000.);
+		time -= loops * dur;
+	}
+
+	if(!showItemAt(time))
+	{
+		stop();
+		return;
+	}
+
+	scheduleNextTick();
+}
+
+void GLDrawablePlaylist::scheduleNextTick()
+{
+	if(!m_isPlaying || m_tickEventId >= 0 || m_timerTickLength <= 0)
+		return;
+
+	double time = playTime();
+
+	// Ticks are aligned to the start of play so they don't accumulate error
+	double next = ((int)(time / m_timerTickLength) + 1) * m_timerTickLength;
+
+	// ...but if the current item ends before the next tick, wake up right when it ends
+	GLPlaylistItem *nextItem = 0;
+	GLPlaylistItem *item = currentItem();
+	if(item)
+	{
+		double itemEnd = timeFor(item) + item->duration();
+		if(itemEnd > time && itemEnd <= next)
+		{
+			next = itemEnd;
+			nextItem = at(m_currentItemIndex + 1);
+			if(!nextItem)
+				nextItem = at(0);
+		}
+	}
+
+	// Tagged with the item that's about to be shown (if any) so players can pre-load it, see GLScheduler::upcomingEvents()
+	m_tickEventId = GLScheduler::instance()->schedule(
+		m_playStartClock + (qint64)(next * 1000.),
+		this, "timerTick",
+		nextItem ? qVariantFromValue((QObject*)nextItem) : QVariant());
+}
+
+void GLDrawablePlaylist::scheduleItems()
+{
+	GLScheduler *scheduler = GLScheduler::instance();
+	qint64 now = scheduler->clock();
+
+	foreach(GLPlaylistItem *item, m_items)
+	{
+		if(item->autoSchedule() || !item->scheduledTime().isValid())
+			continue;
+
+		qint64 due = scheduler->clockFor(item->scheduledTime());
+		if(due > now)
+			scheduler->schedule(due, this, "scheduledItemDue", qVariantFromValue((QObject*)item));
+	}
+}
+
+void GLDrawablePlaylist::scheduledItemDue()
+{
+	GLScheduler *scheduler = GLScheduler::instance();
+	qint64 now = scheduler->clock();
+
+	// If several came due while we were busy, the latest one wins
+	GLPlaylistItem *dueItem = 0;
+	qint64 dueClock = -1;
+	foreach(GLPlaylistItem *item, m_items)
+	{
+		if(item->autoSchedule() || !item->scheduledTime().isValid())
+			continue;
+
+		qint64 due = scheduler->clockFor(item->scheduledTime());
+		if(due <= now + GLSCHEDULER_TICK_MS &&
+		   due > m_lastScheduledDue &&
+		   due > dueClock)
+		{
+			dueItem = item;
+			dueClock = due;
+		}
+	}
+
+	if(!dueItem)
+		return;
+
+	m_lastScheduledDue = dueClock;
+
+	// Anchor to when the item was supposed to start, not when we got around to it, and carry on in sequence from there
+	double itemTime = timeFor(dueItem);
+	m_playStartClock = dueClock - (qint64)(itemTime * 1000.);
+
+	scheduler->cancel(m_tickEventId);
+	m_tickEventId = -1;
+
+	showItemAt(playTime());
+	scheduleNextTick();
 }
 
 
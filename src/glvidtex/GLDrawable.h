@@ -529,7 +529,8 @@ public:
 	GLDrawable *drawable() { return m_drawable; }
 
 	bool isPlaying() { return m_isPlaying; }
-	double playTime() { return m_playTime; }
+	/// While playing, computed from GLScheduler::clock() so it doesn't drift if ticks are late
+	double playTime();
 	
 	GLPlaylistItem *currentItem();
 	
@@ -568,18 +569,28 @@ signals:
 private slots:
 	void playlistItemChangedSlot();
 	void timerTick();
+	void scheduledItemDue();
 	
 private:
+	bool showItemAt(double time);
+	void scheduleNextTick();
+	void scheduleItems();
+	
 	QList<GLPlaylistItem *> m_items;
 	QHash<int, GLPlaylistItem *> m_itemLookup; 
 	GLDrawable *m_drawable;
 	
 	bool m_isPlaying;
-	QTimer m_tickTimer;
 	double m_playTime;
 	double m_timerTickLength;
 	int m_currentItemIndex;
 	
+	// GLScheduler::clock() at play time 0 - playTime() is measured from here
+	qint64 m_playStartClock;
+	int m_tickEventId;
+	// Deadline of the last scheduled (non-autoSchedule) item we jumped to
+	qint64 m_lastScheduledDue;
+	
 	QString m_durationProperty;
 	
 
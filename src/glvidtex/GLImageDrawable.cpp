@@ -2,13 +2,21 @@
 #include "GLTextDrawable.h"
 
 #include "GLWidget.h"
+#include "GLProfiler.h"
 
-int GLImageDrawable::m_allocatedMemory = 0;
-int GLImageDrawable::m_activeMemory    = 0;
-
-#define IMAGE_ALLOCATION_CAP_MB 1
+// Default for the global decoded-image budget, see setDecodedImageBudget()
+#define IMAGE_BUDGET_MB 128
 #define MAX_IMAGE_WIDTH  1600
 #define MAX_IMAGE_HEIGHT 1600
+// Cap used instead of MAX_IMAGE_WIDTH/HEIGHT when zoomDetailEnabled() is true
+#define MAX_ZOOMED_IMAGE_SIZE 4096
+// Only reload at a higher resolution if the drawable is at least this much larger than the decoded image
+#define DECODE_SIZE_SLACK 1.25
+
+int GLImageDrawable::m_allocatedMemory = 0;
+int GLImageDrawable::m_activeMemory    = 0;
+int GLImageDrawable::m_decodedImageBudget = IMAGE_BUDGET_MB * 1024 * 1024;
+QList<GLImageDrawable*> GLImageDrawable::m_lruList;
 
 #include "../imgtool/exiv2-0.18.2-qtbuild/src/image.hpp"
 #include "../3rdparty/md5/qtmd5.h"
@@ -30,6 +38,8 @@ GLImageDrawable::GLImageDrawable(QString file, QObject *parent)
 	, m_shadowColor(Qt::black)
 	, m_shadowOpacity(1.0)
 	, m_shadowDrawable(0)
+	, m_decodeSwapAxes(false)
+	, m_zoomDetailEnabled(false)
 {
 	//setImage(QImage("dot.gif"));
 	setCrossFadeMode(GLVideoDrawable::FrontAndBack);
@@ -44,16 +54,77 @@ GLImageDrawable::GLImageDrawable(QString file, QObject *parent)
 	connect(&m_borderDirtyBatchTimer, SIGNAL(timeout()), this, SLOT(reapplyBorder()));
 	m_borderDirtyBatchTimer.setSingleShot(true);
 	m_borderDirtyBatchTimer.setInterval(50);
+	
+	connect(&m_decodeSizeCheckTimer, SIGNAL(timeout()), this, SLOT(checkDecodeSize()));
+	m_decodeSizeCheckTimer.setSingleShot(true);
+	m_decodeSizeCheckTimer.setInterval(250);
 }
 
 GLImageDrawable::~GLImageDrawable()
-{}
+{
+	m_lruList.removeAll(this);
+	if(m_frame)
+	{
+		m_allocatedMemory -= frameMemory(m_frame);
+		if(liveStatus())
+			m_activeMemory -= frameMemory(m_frame);
+	}
+}
+
+void GLImageDrawable::setDecodedImageBudget(int bytes)
+{
+	m_decodedImageBudget = bytes;
+	enforceImageBudget(0);
+}
+
+int GLImageDrawable::frameMemory(VideoFramePtr frame)
+{
+	if(!frame)
+		return 0;
+	return frame->isRaw() ? frame->pointerLength() : frame->image().byteCount();
+}
+
+void GLImageDrawable::touchImageCache()
+{
+	m_lruList.removeAll(this);
+	m_lruList.prepend(this);
+}
+
+bool GLImageDrawable::enforceImageBudget(int neededBytes, GLImageDrawable *exclude)
+{
+	// Walk from the least-recently-used end of the list, releasing anything not on screen.
+	// releaseImage() removes the drawable from m_lruList, which only shifts items after i.
+	for(int i = m_lruList.size() - 1; 
+	    i >= 0 && m_allocatedMemory + neededBytes > m_decodedImageBudget; 
+	    i--)
+	{
+		GLImageDrawable *drawable = m_lruList.at(i);
+		if(drawable == exclude ||
+		   drawable->liveStatus() ||
+		   drawable->m_releasedImage ||
+		  !drawable->canReleaseImage())
+			continue;
+			
+		#ifdef DEBUG_MEMORY_USAGE
+		qDebug() << "GLImageDrawable::enforceImageBudget(): Evicting"<<(QObject*)drawable<<"to make room for"<<(neededBytes/1024)<<"Kb";
+		#endif
+		
+		drawable->releaseImage();
+	}
+	
+	return m_allocatedMemory + neededBytes <= m_decodedImageBudget;
+}
 
 void GLImageDrawable::setImage(const QImage& image, bool insidePaint)
 {
+	GLProfilerScope scope("setImage", "image", this);
 	
 	//qDebug() << "GLImageDrawable::setImage(): "<<(QObject*)this<<" mark1: insidePaint:"<<insidePaint;
-	if(m_allocatedMemory > IMAGE_ALLOCATION_CAP_MB*1024*1024 &&
+	
+	// Make room in the budget by evicting other (non-live) images first - if that isn't enough and we're
+	// not live ourself, delay the load until we go live.
+	bool fitsBudget = enforceImageBudget(image.byteCount() - frameMemory(m_frame), this);
+	if(!fitsBudget &&
 		!liveStatus() &&
 		canReleaseImage())
 	{
@@ -61,7 +132,7 @@ void GLImageDrawable::setImage(const QImage& image, bool insidePaint)
 		//qDebug() << "GLImageDrawable::setImage(): "<<(QObject*)this<<" NOT LOADING";
 
 		#ifdef DEBUG_MEMORY_USAGE
-		qDebug() << "GLImageDrawable::setImage(): "<<(QObject*)this<<" Allocated memory ("<<(m_allocatedMemory/1024/1024)<<"MB ) exceedes" << IMAGE_ALLOCATION_CAP_MB << "MB cap - delaying load until go-live";
+		qDebug() << "GLImageDrawable::setImage(): "<<(QObject*)this<<" Allocated memory ("<<(m_allocatedMemory/1024/1024)<<"MB ) exceedes" << (m_decodedImageBudget/1024/1024) << "MB budget - delaying load until go-live";
 		#endif
 		return;
 	}
@@ -87,7 +158,9 @@ void GLImageDrawable::setImage(const QImage& image, bool insidePaint)
 	// Take the memory off the list because when crossfade is done, the frame should get freed
 	if(m_frame)
 	{
-		m_allocatedMemory -= m_frame->pointerLength();
+		m_allocatedMemory -= frameMemory(m_frame);
+		if(liveStatus())
+			m_activeMemory -= frameMemory(m_frame);
 		#ifdef DEBUG_MEMORY_USAGE
 		qDebug() << "GLImageDrawable::setImage(): "<<(QObject*)this<<" Allocated memory down to:"<<(m_allocatedMemory/1024/1024)<<"MB";
 		#endif
@@ -148,8 +221,12 @@ void GLImageDrawable::setImage(const QImage& image, bool insidePaint)
 		memcpy(m_frame->allocPointer(localImage.byteCount()), (const uchar*)localImage.bits(), localImage.byteCount());
 	}
 
-	m_allocatedMemory += localImage.byteCount();
+	m_allocatedMemory += frameMemory(m_frame);
+	if(liveStatus())
+		m_activeMemory += frameMemory(m_frame);
 	m_image = image;
+	
+	touchImageCache();
 
 	// explicitly release the original image to see if that helps with memory...
 	//image = QImage();
@@ -187,6 +264,106 @@ void GLImageDrawable::setImage(const QImage& image, bool insidePaint)
 // 	}
 }
 
+// Returns the rotation (in degrees) needed to display \a file upright, based on the EXIF orientation tag
+static int exifRotationDegrees(const QString& file)
+{
+	int rotateDegrees = 0;
+	try
+	{
+		Exiv2::Image::AutoPtr exiv = Exiv2::ImageFactory::open(file.toStdString());
+		if(exiv.get() != 0)
+		{
+			exiv->readMetadata();
+			Exiv2::ExifData& exifData = exiv->exifData();
+			if (exifData.empty())
+			{
+				//qDebug() << file << ": No Exif data found in the file";
+			}
+
+			QString rotateSensor = exifData["Exif.Image.Orientation"].toString().c_str();
+			int rotationFlag = rotateSensor.toInt();
+			rotateDegrees = rotationFlag == 1 ||
+					rotationFlag == 2 ? 0 :
+					rotationFlag == 7 ||
+					rotationFlag == 8 ? -90 :
+					rotationFlag == 3 ||
+					rotationFlag == 4 ? -180 :
+					rotationFlag == 5 ||
+					rotationFlag == 6 ? -270 :
+					0;
+		}
+	}
+	catch (Exiv2::AnyError& e)
+	{
+		std::cout << "Caught Exiv2 exception '" << e << "'\n";
+		//return -1;
+	}
+	
+	return rotateDegrees;
+}
+
+QSize GLImageDrawable::decodeSizeFor(const QSize& originalSize, bool swapAxes)
+{
+	if(!originalSize.isValid())
+		return originalSize;
+	
+	QSizeF cap = m_zoomDetailEnabled ? 
+		QSizeF(MAX_ZOOMED_IMAGE_SIZE, MAX_ZOOMED_IMAGE_SIZE) :
+		QSizeF(MAX_IMAGE_WIDTH, MAX_IMAGE_HEIGHT);
+	
+	// Find the size the image will occupy on screen, in device pixels
+	QSizeF box = rect().size();
+	if(box.isEmpty())
+		box = canvasSize();
+	if(m_glw && !box.isEmpty())
+		box = QSizeF(box.width()  * qAbs(m_glw->transform().m11()),
+			     box.height() * qAbs(m_glw->transform().m22()));
+	if(box.isEmpty())
+		box = cap;
+	
+	box = box.boundedTo(cap);
+	if(swapAxes)
+		box.transpose();
+	
+	// Never upscale while decoding
+	if(originalSize.width()  <= box.width() &&
+	   originalSize.height() <= box.height())
+		return originalSize;
+	
+	QSizeF size = originalSize;
+	if(aspectRatioMode() == Qt::KeepAspectRatio)
+	{
+		size.scale(box, Qt::KeepAspectRatio);
+	}
+	else
+	{
+		// Image will be stretched or cropped to fill the box, so each axis has to cover the box
+		size.scale(box, Qt::KeepAspectRatioByExpanding);
+		size = size.boundedTo(originalSize);
+	}
+	
+	return size.toSize().expandedTo(QSize(1,1));
+}
+
+QImage GLImageDrawable::readScaledImage(QImageReader& reader, bool swapAxes)
+{
+	QSize originalSize = reader.size();
+	QSize decodeSize = decodeSizeFor(originalSize, swapAxes);
+	
+	// QImageReader only honors scaled size if the plugin supports it (JPEG does, in the DCT domain),
+	// otherwise it scales after decoding - which still keeps the full-size decode from sticking around.
+	if(decodeSize.isValid() && decodeSize != originalSize)
+		reader.setScaledSize(decodeSize);
+	
+	QImage image = reader.read();
+	
+	#ifdef DEBUG_MEMORY_USAGE
+	qDebug() << "GLImageDrawable::readScaledImage: "<<(QObject*)this<<" Decoded"<<originalSize<<"at"<<image.size()<<"with"<<(image.byteCount()/1024/1024)<<"MB memory usage";
+	#endif
+	
+	return image;
+}
+
 bool GLImageDrawable::setImageFile(const QString& file)
 {
 	//qDebug() << "GLImageDrawable::setImageFile(): "<<(QObject*)this<<" file:"<<file;
@@ -205,7 +382,15 @@ bool GLImageDrawable::setImageFile(const QString& file)
 		{
 			qDebug() << "GLImageDrawable::setImageFile: "<<file<<" does not exist, used cached image packed in drawable";
 			internalSetFilename(file);
-			setImage(m_cachedImage);
+			
+			QBuffer buffer(&m_cachedImageBytes);
+			QImageReader reader(&buffer);
+			m_originalSize = reader.size();
+			m_decodeSwapAxes = false;
+			
+			QImage image = readScaledImage(reader);
+			m_decodedSize = image.size();
+			setImage(image);
 			return true;
 		}
 		else
@@ -216,14 +401,24 @@ bool GLImageDrawable::setImageFile(const QString& file)
 	}
 	
 	internalSetFilename(file);
-
-	if(m_allocatedMemory > IMAGE_ALLOCATION_CAP_MB*1024*1024 &&
-		!liveStatus() &&
-		canReleaseImage())
+	
+	// Only reads the header - cheap compared to decoding the pixels
+	m_originalSize = QImageReader(file).size();
+	
+	int rotateDegrees = m_allowAutoRotate ? exifRotationDegrees(file) : 0;
+	bool swapAxes = rotateDegrees == -90 || rotateDegrees == -270;
+	m_decodeSwapAxes = swapAxes;
+	
+	QSize decodeSize = decodeSizeFor(m_originalSize, swapAxes);
+	int neededBytes = decodeSize.isValid() ? decodeSize.width() * decodeSize.height() * 4 : 0;
+	
+	if(!liveStatus() &&
+	    canReleaseImage() &&
+	   !enforceImageBudget(neededBytes - frameMemory(m_frame), this))
 	{
 		m_releasedImage = true;
  		#ifdef DEBUG_MEMORY_USAGE
- 		qDebug() << "GLImageDrawable::setImageFile(): "<<(QObject*)this<<" Allocated memory ("<<(m_allocatedMemory/1024/1024)<<"MB ) exceedes" << IMAGE_ALLOCATION_CAP_MB << "MB cap - delaying load until go-live";
+ 		qDebug() << "GLImageDrawable::setImageFile(): "<<(QObject*)this<<" Allocated memory ("<<(m_allocatedMemory/1024/1024)<<"MB ) exceedes" << (m_decodedImageBudget/1024/1024) << "MB budget - delaying load until go-live";
  		#endif
 		return true;
 	}
@@ -241,13 +436,17 @@ bool GLImageDrawable::setImageFile(const QString& file)
 	    QFileInfo(file).lastModified() <= m_cachedImageMtime)
 	{
 		qDebug() << "GLImageDrawable::setImageFile: "<<file<<" - Loaded image from bytes packed in drawable";
-		setImage(m_cachedImage);
+		
+		QBuffer buffer(&m_cachedImageBytes);
+		QImageReader reader(&buffer);
+		
+		m_decodeSwapAxes = false;
+		QImage image = readScaledImage(reader);
+		m_decodedSize = image.size();
+		setImage(image);
 		return true;
 	}
 	
-	QSize size = rect().size().toSize();
-
-
 	QString tempDir = QDir::temp().absolutePath();
 	QString glTempDir = QString("%1/glvidtex").arg(tempDir);
 	QString imgTempDir = QString("%1/glimagedrawable").arg(glTempDir);
@@ -257,10 +456,13 @@ bool GLImageDrawable::setImageFile(const QString& file)
 	if(!QDir(imgTempDir).exists())
 		QDir(glTempDir).mkdir("glimagedrawable");
 
+	// Include the decode size in the key since the same file can be decoded at different sizes
 	QString md5sum = MD5::md5sum(fileInfo.absoluteFilePath());
-	QString cachedImageKey = QString("%1/%2.jpg")
+	QString cachedImageKey = QString("%1/%2-%3x%4.jpg")
 		.arg(imgTempDir)
-		.arg(md5sum);
+		.arg(md5sum)
+		.arg(decodeSize.width())
+		.arg(decodeSize.height());
 
 	QImage image;
 
@@ -275,70 +477,27 @@ bool GLImageDrawable::setImageFile(const QString& file)
 		// We only need to cache it if we do something *more* than just load the bits - like rotate or scale it.
 		bool cacheNeeded = false;
 
-		image = QImage(file);
+		QImageReader reader(file);
+		image = readScaledImage(reader, swapAxes);
 		if(image.isNull())
 		{
 			qDebug() << "GLImageDrawable::setImageFile: "<<file<<" - Image loaded is Null!";
 			return false;
 		}
 
-		if(image.width()  > MAX_IMAGE_WIDTH ||
-		   image.height() > MAX_IMAGE_HEIGHT)
+		if(image.size() != m_originalSize)
+			cacheNeeded = true;
+
+		if(rotateDegrees != 0)
 		{
-			image = image.scaled(MAX_IMAGE_WIDTH,MAX_IMAGE_HEIGHT,Qt::KeepAspectRatio);
+			qDebug() << "GLImageDrawable::setImageFile: "<<file<<" - Rotating "<<rotateDegrees<<" degrees";
 
-			#ifdef DEBUG_MEMORY_USAGE
-			qDebug() << "GLImageDrawable::setImageFile: Scaled image to"<<image.size()<<"with"<<(image.byteCount()/1024/1024)<<"MB memory usage";
-			#endif
+			QTransform t = QTransform().rotate(rotateDegrees);
+			image = image.transformed(t);
 
 			cacheNeeded = true;
 		}
 
-		if(m_allowAutoRotate)
-		{
-			try
-			{
-				Exiv2::Image::AutoPtr exiv = Exiv2::ImageFactory::open(file.toStdString());
-				if(exiv.get() != 0)
-				{
-					exiv->readMetadata();
-					Exiv2::ExifData& exifData = exiv->exifData();
-					if (exifData.empty())
-					{
-						//qDebug() << file << ": No Exif data found in the file";
-					}
-
-					QString rotateSensor = exifData["Exif.Image.Orientation"].toString().c_str();
-					int rotationFlag = rotateSensor.toInt();
-					int rotateDegrees = rotationFlag == 1 ||
-							    rotationFlag == 2 ? 0 :
-							    rotationFlag == 7 ||
-							    rotationFlag == 8 ? -90 :
-							    rotationFlag == 3 ||
-							    rotationFlag == 4 ? -180 :
-							    rotationFlag == 5 ||
-							    rotationFlag == 6 ? -270 :
-							    0;
-
-					if(rotateDegrees != 0)
-					{
-						qDebug() << "GLImageDrawable::setImageFile: "<<file<<" - Rotating "<<rotateDegrees<<" degrees";
-
-						QTransform t = QTransform().rotate(rotateDegrees);
-						image = image.transformed(t);
-
-						cacheNeeded = true;
-					}
-
-				}
-			}
-			catch (Exiv2::AnyError& e)
-			{
-				std::cout << "Caught Exiv2 exception '" << e << "'\n";
-				//return -1;
-			}
-		}
-
 		// Write out cached image
 		if(cacheNeeded)
 		{
@@ -347,6 +506,10 @@ bool GLImageDrawable::setImageFile(const QString& file)
 			image.save(cachedImageKey,"JPEG");
 		}
 	}
+	
+	// Store the decode size in the same orientation as m_originalSize for checkDecodeSize()
+	m_decodedSize = swapAxes ? QSize(image.height(), image.width()) : image.size();
+	
 	//FilterCompare1.png
 	setImage(image);
 	
@@ -354,6 +517,38 @@ bool GLImageDrawable::setImageFile(const QString& file)
 
 }
 
+void GLImageDrawable::checkDecodeSize()
+{
+	if(m_imageFile.isEmpty() ||
+	   m_releasedImage ||
+	  !m_decodedSize.isValid() ||
+	  !m_originalSize.isValid())
+		return;
+	
+	// Already have every pixel in the file
+	if(m_decodedSize.width()  >= m_originalSize.width() &&
+	   m_decodedSize.height() >= m_originalSize.height())
+		return;
+	
+	// Same box the image was decoded against - m_decodedSize is stored un-rotated, like m_originalSize
+	QSize wanted = decodeSizeFor(m_originalSize, m_decodeSwapAxes);
+	if(wanted.width()  > m_decodedSize.width()  * DECODE_SIZE_SLACK ||
+	   wanted.height() > m_decodedSize.height() * DECODE_SIZE_SLACK)
+	{
+		qDebug() << "GLImageDrawable::checkDecodeSize: "<<(QObject*)this<<" Drawable now needs"<<wanted<<", decoded at"<<m_decodedSize<<", reloading"<<m_imageFile;
+		reloadImage();
+	}
+}
+
+void GLImageDrawable::setZoomDetailEnabled(bool flag)
+{
+	m_zoomDetailEnabled = flag;
+	setMipmapTextures(flag);
+	
+	if(flag)
+		m_decodeSizeCheckTimer.start();
+}
+
 void GLImageDrawable::internalSetFilename(QString file)
 {
 	setObjectName(QFileInfo(file).fileName());
@@ -386,10 +581,15 @@ void GLImageDrawable::releaseImage()
 		return;
 	}
 	m_releasedImage = true;
+	m_lruList.removeAll(this);
 	if(m_frame)
 	{
-		m_allocatedMemory -= m_frame->pointerLength();
-		//m_image = QImage();
+		m_allocatedMemory -= frameMemory(m_frame);
+		// m_image shares its pixels with the frame, so it has to go too in order to actually free the memory.
+		// It will be decoded again from m_imageFile by reloadImage().
+		m_image = QImage();
+		m_imageWithBorder = QImage();
+		m_decodedSize = QSize();
 		m_frame = VideoFramePtr(new VideoFrame());
 
 		#ifdef DEBUG_MEMORY_USAGE
@@ -403,11 +603,15 @@ void GLImageDrawable::setLiveStatus(bool flag)
 	GLVideoDrawable::setLiveStatus(flag);
 	if(flag)
 	{
+		// We're live already, so setImage() counts the reloaded frame as active itself
+		// (and a released image has nothing to count until then)
 		if(m_releasedImage)
 			reloadImage();
-
+		else
 		if(m_frame)
-			m_activeMemory += m_frame->pointerLength();;
+			m_activeMemory += frameMemory(m_frame);
+		
+		touchImageCache();
 
 		#ifdef DEBUG_MEMORY_USAGE
 		qDebug() << "GLImageDrawable::setLiveStatus("<<flag<<"): "<<(QObject*)this<<" Active memory usage up to:"<<(m_activeMemory/1024/1024)<<"MB";
@@ -423,13 +627,13 @@ void GLImageDrawable::setLiveStatus(bool flag)
 	else
 	{
 		if(m_frame)
-			m_activeMemory -= m_frame->pointerLength();;
+			m_activeMemory -= frameMemory(m_frame);
 		#ifdef DEBUG_MEMORY_USAGE
 		qDebug() << "GLImageDrawable::setLiveStatus("<<flag<<"): "<<(QObject*)this<<" Active memory usage down to:"<<(m_activeMemory/1024/1024)<<"MB";
 		#endif
-		if(canReleaseImage() &&
-		   m_allocatedMemory > IMAGE_ALLOCATION_CAP_MB*1024*1024)
-			releaseImage();
+		
+		// Now that we're off screen we're eligible for eviction - bring the cache back under budget
+		enforceImageBudget(0);
 	}
 }
 
@@ -457,12 +661,13 @@ void GLImageDrawable::loadPropsFromMap(const QVariantMap& map, bool /*onlyApplyI
 		m_cachedImageBytes = map["cached_image_bytes"].toByteArray();
 		if(!m_cachedImageBytes.isEmpty())
 		{
-			QImage image;
-			image.loadFromData(m_cachedImageBytes);
+			// Just validate the data here - the pixels are decoded on demand in setImageFile(),
+			// at the size actually needed, instead of keeping a full-size copy around
+			QBuffer buffer(&m_cachedImageBytes);
+			QImageReader reader(&buffer);
 			
-			if(!image.isNull())
+			if(reader.canRead())
 			{
-				m_cachedImage = image;
 				m_cachedImageMtime = map["cached_image_mtime"].toDateTime();
 				
 				qDebug() << "GLImageDrawable::loadPropsFromMap: Unpacked "<<m_cachedImageBytes.size()/1024<<" Kb from map for cached image "<<m_cachedImageFilename<<" in "<<t.elapsed()<<"ms";
@@ -606,11 +811,16 @@ void GLImageDrawable::borderDirty()
 
 void GLImageDrawable::reapplyBorder()
 {
+	// Border will be applied when the image is reloaded
+	if(m_releasedImage)
+		return;
 	setImage(m_image);
 }
 
 void GLImageDrawable::updateShadow()
 {
+	GLProfilerScope scope("updateShadow", "image", this);
+	
 	if(!m_shadowDrawable)
 		return;
 		
@@ -746,6 +956,10 @@ void GLImageDrawable::updateShadow()
 
 void GLImageDrawable::drawableResized(const QSizeF& /*newSize*/)
 {
+	// See if we need more pixels than we decoded - batched since resizes come in bursts when dragging in the editor
+	if(!m_imageFile.isEmpty())
+		m_decodeSizeCheckTimer.start();
+	
 	if(m_shadowDrawable)
 	{
 		QImage sourceImg = m_imageWithBorder.isNull() ? m_image : m_imageWithBorder;
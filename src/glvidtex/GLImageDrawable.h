@@ -17,6 +17,8 @@ class GLImageDrawable : public GLVideoDrawable
 	Q_PROPERTY(QPointF	shadowOffset 	READ shadowOffset	WRITE setShadowOffset);
 	Q_PROPERTY(QColor	shadowColor	READ shadowColor	WRITE setShadowColor);
 	Q_PROPERTY(double	shadowOpacity	READ shadowOpacity	WRITE setShadowOpacity);
+	
+	Q_PROPERTY(bool		zoomDetailEnabled READ isZoomDetailEnabled WRITE setZoomDetailEnabled);
 
 public:
 	GLImageDrawable(QString file="", QObject *parent=0);
@@ -38,6 +40,24 @@ public:
 	QPointF shadowOffset() { return m_shadowOffset; }
 	QColor shadowColor() { return m_shadowColor; }
 	double shadowOpacity() { return m_shadowOpacity; }
+	
+	/// If true, the image is re-decoded at a higher resolution (up to MAX_ZOOMED_IMAGE_SIZE)
+	/// when the drawable is scaled up past the size it was decoded at, and the texture
+	/// is uploaded with mipmaps so it still looks clean when zoomed back out.
+	bool isZoomDetailEnabled() { return m_zoomDetailEnabled; }
+	
+	/// The size the current image was actually decoded at - may be smaller than the file on disk
+	QSize decodedSize() { return m_decodedSize; }
+	/// The size of the image file on disk, before any downscaling
+	QSize originalSize() { return m_originalSize; }
+	
+	/// Global budget (in bytes) for decoded image data held by all GLImageDrawables.
+	/// When exceeded, images that are not live are released least-recently-used first.
+	static int decodedImageBudget() { return m_decodedImageBudget; }
+	static void setDecodedImageBudget(int bytes);
+	
+	static int allocatedMemory() { return m_allocatedMemory; }
+	static int activeMemory() { return m_activeMemory; }
 		
 signals:
 	void imageFileChanged(const QString&);
@@ -59,6 +79,7 @@ public slots:
 	void setShadowOpacity(double);
 	void setShadowOpacity(int percent) { setShadowOpacity(((double)percent) / 100.); }
 	
+	void setZoomDetailEnabled(bool);
 	
 protected:
 	void internalSetFilename(QString);
@@ -70,6 +91,24 @@ protected:
 	virtual void releaseImage();
 	virtual bool canReleaseImage();
 	
+	/// Returns the size to decode an image of \a originalSize at, based on the on-screen size
+	/// of this drawable (including the GLWidget's transform), capped at MAX_IMAGE_WIDTH/HEIGHT
+	/// (or MAX_ZOOMED_IMAGE_SIZE if zoomDetailEnabled()). If \a swapAxes is true, the image will
+	/// be rotated 90 degrees after decoding, so the target box is transposed.
+	QSize decodeSizeFor(const QSize& originalSize, bool swapAxes=false);
+	
+	/// Reads the image from \a reader, asking the image plugin to decode directly at decodeSizeFor()
+	/// (for JPEG this means libjpeg scales in the DCT domain instead of us scaling a full-size decode.)
+	QImage readScaledImage(QImageReader& reader, bool swapAxes=false);
+	
+	/// Move this drawable to the front of the LRU list of decoded images
+	void touchImageCache();
+	/// Release images (least recently used first) that are not live until \a neededBytes more can fit in the budget.
+	/// Returns true if there is room for \a neededBytes after eviction.
+	static bool enforceImageBudget(int neededBytes, GLImageDrawable *exclude=0);
+	/// Memory used by the decoded pixels in \a frame
+	static int frameMemory(VideoFramePtr frame);
+	
 	/// Hook for subclasses that handle their own border rendering such as GLTextDrawable
 	virtual void borderSettingsChanged() {}
 	/// Hook for subclasses that handle their own border rendering such as GLTextDrawable - return false to disable rendering of the border in GLImageDrawable
@@ -86,11 +125,23 @@ protected:
 	/// Caching for embedding the image data in the stored file
 	QString    m_cachedImageFilename;
 	QDateTime  m_cachedImageMtime;
-	QImage     m_cachedImage;
 	QByteArray m_cachedImageBytes;
 	
 	static int m_allocatedMemory;
 	static int m_activeMemory;
+	static int m_decodedImageBudget;
+	
+	/// Most recently used drawables at the front
+	static QList<GLImageDrawable*> m_lruList;
+	
+	QSize m_decodedSize;
+	QSize m_originalSize;
+	/// True if the image was decoded against a transposed box (EXIF rotation by +/-90 degrees), see decodeSizeFor()
+	bool m_decodeSwapAxes;
+	
+	bool m_zoomDetailEnabled;
+	/// Batches resize events before checking if we need to reload at a higher resolution
+	QTimer m_decodeSizeCheckTimer;
 	
 	/// Border attributes
 	QColor	m_borderColor;
@@ -121,6 +172,9 @@ protected slots:
 	void reapplyBorder();
 	void updateShadow();
 	
+	/// Reloads the image from disk if the drawable is now shown noticeably larger than it was decoded at
+	void checkDecodeSize();
+	
 private:
 	void setVideoSource(VideoSource*);
 };
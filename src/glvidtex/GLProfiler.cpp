@@ -0,0 +1,322 @@
+#include "GLProfiler.h"
+
+#include <QApplication>
+#include <QThread>
+#include <QPainter>
+#include <QFile>
+#include <QTextStream>
+#include <QTime>
+#include <QtAlgorithms>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <time.h>
+#endif
+
+GLProfiler *GLProfiler::m_instance = 0;
+
+static bool GLProfilerStat_moreThan(const GLProfilerStat &a, const GLProfilerStat &b)
+{
+	return a.avg > b.avg;
+}
+
+// Minimal JSON string escaping for object names and labels in the trace
+static QString GLProfiler_jsonString(const QString& str)
+{
+	QString out = str;
+	out.replace("\\", "\\\\");
+	out.replace("\"", "\\\"");
+	out.replace("\n", "\\n");
+	out.replace("\r", "\\r");
+	out.replace("\t", "\\t");
+	return "\"" + out + "\"";
+}
+
+GLProfiler *GLProfiler::instance()
+{
+	if(!m_instance)
+		m_instance = new GLProfiler();
+	return m_instance;
+}
+
+GLProfiler::GLProfiler()
+	: QObject()
+	, m_enabled(false)
+	, m_clockBase(0)
+	, m_eventPos(0)
+	, m_eventsWrapped(false)
+	, m_refreshRate(60.)
+	, m_lastFrame(-1)
+	, m_frameInterval(0)
+	, m_maxFrameInterval(0)
+	, m_frameCount(0)
+	, m_missedVsyncs(0)
+{
+	m_clockBase = clock();
+}
+
+qint64 GLProfiler::clock()
+{
+	#ifdef Q_OS_UNIX
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((qint64)ts.tv_sec) * 1000000 + ts.tv_nsec / 1000 - m_clockBase;
+	#else
+	// Only millisecond resolution, but still good enough to find the expensive drawables
+	static QTime time;
+	if(time.isNull())
+		time.start();
+	return ((qint64)time.elapsed()) * 1000 - m_clockBase;
+	#endif
+}
+
+void GLProfiler::setEnabled(bool flag)
+{
+	if(m_enabled == flag)
+		return;
+
+	if(flag)
+		reset();
+
+	m_enabled = flag;
+}
+
+void GLProfiler::setRefreshRate(double hz)
+{
+	if(hz > 0)
+		m_refreshRate = hz;
+}
+
+void GLProfiler::reset()
+{
+	QMutexLocker lock(&m_mutex);
+
+	m_events.clear();
+	m_eventPos = 0;
+	m_eventsWrapped = false;
+	m_stats.clear();
+
+	m_lastFrame = -1;
+	m_frameInterval = 0;
+	m_maxFrameInterval = 0;
+	m_frameCount = 0;
+	m_missedVsyncs = 0;
+}
+
+int GLProfiler::threadIndex()
+{
+	// Small, stable ids read much better in the trace viewer than raw thread handles
+	Qt::HANDLE handle = QThread::currentThreadId();
+	if(!m_threads.contains(handle))
+		m_threads.insert(handle, m_threads.size() + 1);
+	return m_threads.value(handle);
+}
+
+void GLProfiler::appendEvent(const GLProfilerEvent& event)
+{
+	// Ring buffer - once full, the oldest event is overwritten
+	if(m_events.size() < GLPROFILER_MAX_EVENTS)
+	{
+		m_events.append(event);
+	}
+	else
+	{
+		m_events[m_eventPos] = event;
+		m_eventsWrapped = true;
+	}
+	m_eventPos = (m_eventPos + 1) % GLPROFILER_MAX_EVENTS;
+}
+
+void GLProfiler::addEvent(const char *name, const char *category, QObject *object, qint64 start, qint64 end)
+{
+	if(!m_enabled)
+		return;
+
+	QString label = QString(name);
+	if(object)
+	{
+		QString objectName = object->objectName();
+		label = QString("%1 %2: %3")
+			.arg(object->metaObject()->className())
+			.arg(objectName.isEmpty() ? QString().sprintf("%p", object) : objectName)
+			.arg(name);
+	}
+
+	QMutexLocker lock(&m_mutex);
+
+	GLProfilerEvent event;
+	event.name     = label;
+	event.category = category;
+	event.start    = start;
+	event.duration = end - start;
+	event.thread   = threadIndex();
+	appendEvent(event);
+
+	GLProfilerStat &stat = m_stats[label];
+	if(!stat.count)
+	{
+		stat.label = label;
+		stat.avg = event.duration;
+	}
+	stat.count ++;
+	stat.last = event.duration;
+	stat.avg += (event.duration - stat.avg) / 16.;
+	if(event.duration > stat.max)
+		stat.max = event.duration;
+}
+
+void GLProfiler::frameStarted()
+{
+	if(!m_enabled)
+		return;
+
+	qint64 now = clock();
+
+	QMutexLocker lock(&m_mutex);
+
+	m_frameCount ++;
+
+	if(m_lastFrame >= 0)
+	{
+		double interval = (now - m_lastFrame) / 1000.;
+		m_frameInterval = m_frameInterval > 0 ? m_frameInterval + (interval - m_frameInterval) / 16. : interval;
+		if(interval > m_maxFrameInterval)
+			m_maxFrameInterval = interval;
+
+		// Anything more than half a refresh late means we missed at least one vsync
+		double period = 1000. / m_refreshRate;
+		int missed = (int)(interval / period + 0.5) - 1;
+		if(missed > 0)
+		{
+			m_missedVsyncs += missed;
+
+			GLProfilerEvent event;
+			event.name     = QString("Missed %1 vsync(s)").arg(missed);
+			event.category = "frame";
+			event.phase    = 'i';
+			event.start    = now;
+			event.thread   = threadIndex();
+			appendEvent(event);
+		}
+	}
+
+	m_lastFrame = now;
+}
+
+QList<GLProfilerStat> GLProfiler::stats()
+{
+	QMutexLocker lock(&m_mutex);
+	QList<GLProfilerStat> list = m_stats.values();
+	lock.unlock();
+
+	qSort(list.begin(), list.end(), GLProfilerStat_moreThan);
+	return list;
+}
+
+void GLProfiler::drawOverlay(QPainter *painter, const QRect& rect)
+{
+	QList<GLProfilerStat> list = stats();
+
+	QStringList lines;
+	lines << QString("%1 fps, interval %2 ms (max %3), %4 missed vsyncs in %5 frames")
+		.arg(fps(), 0, 'f', 1)
+		.arg(frameInterval(), 0, 'f', 1)
+		.arg(maxFrameInterval(), 0, 'f', 1)
+		.arg(missedVsyncs())
+		.arg(frameCount());
+	lines << "    avg ms    max ms  stage";
+
+	for(int i=0; i<list.size() && i<GLPROFILER_OVERLAY_ROWS; i++)
+	{
+		const GLProfilerStat &stat = list[i];
+		lines << QString("%1  %2  %3")
+			.arg(stat.avg / 1000., 8, 'f', 2)
+			.arg(stat.max / 1000., 8, 'f', 2)
+			.arg(stat.label);
+	}
+
+	QFont font("Monospace");
+	font.setStyleHint(QFont::TypeWriter);
+	font.setPixelSize(11);
+
+	QFontMetrics metrics(font);
+	int width = 0;
+	foreach(QString line, lines)
+		width = qMax(width, metrics.width(line));
+
+	int lineHeight = metrics.height();
+	QRect box(rect.topLeft() + QPoint(10,10), QSize(width + 10, lineHeight * lines.size() + 10));
+
+	painter->save();
+	painter->setFont(font);
+	painter->fillRect(box, QColor(0,0,0,180));
+	painter->setPen(Qt::white);
+
+	int y = box.top() + 5 + metrics.ascent();
+	foreach(QString line, lines)
+	{
+		painter->drawText(box.left() + 5, y, line);
+		y += lineHeight;
+	}
+
+	painter->restore();
+}
+
+bool GLProfiler::writeChromeTrace(const QString& fileName)
+{
+	QFile file(fileName);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qDebug() << "GLProfiler::writeChromeTrace(): Unable to open"<<fileName<<"for writing";
+		return false;
+	}
+
+	QMutexLocker lock(&m_mutex);
+
+	QTextStream stream(&file);
+	stream << "{\"traceEvents\":[\n";
+
+	// Oldest first
+	int count = m_events.size();
+	int first = m_eventsWrapped ? m_eventPos : 0;
+	for(int i=0; i<count; i++)
+	{
+		const GLProfilerEvent &event = m_events[(first + i) % count];
+
+		stream << "{\"name\":" << GLProfiler_jsonString(event.name)
+		       << ",\"cat\":" << GLProfiler_jsonString(event.category)
+		       << ",\"ph\":\"" << event.phase << "\""
+		       << ",\"ts\":" << event.start;
+		if(event.phase == 'X')
+			stream << ",\"dur\":" << event.duration;
+		else
+			stream << ",\"s\":\"g\"";
+		stream << ",\"pid\":1,\"tid\":" << event.thread << "}";
+
+		if(i < count - 1)
+			stream << ",";
+		stream << "\n";
+	}
+
+	stream << "],\"displayTimeUnit\":\"ms\"}\n";
+
+	//qDebug() << "GLProfiler::writeChromeTrace(): Wrote"<<count<<"events to"<<fileName;
+	return true;
+}
+
+void GLProfiler::setTraceFile(const QString& file)
+{
+	if(m_traceFile.isEmpty() && !file.isEmpty())
+		connect(qApp, SIGNAL(aboutToQuit()), this, SLOT(writeTraceFile()));
+	else
+	if(!m_traceFile.isEmpty() && file.isEmpty())
+		disconnect(qApp, SIGNAL(aboutToQuit()), this, SLOT(writeTraceFile()));
+
+	m_traceFile = file;
+}
+
+void GLProfiler::writeTraceFile()
+{
+	if(!m_traceFile.isEmpty())
+		writeChromeTrace(m_traceFile);
+}
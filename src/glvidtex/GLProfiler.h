@@ -0,0 +1,173 @@
+#ifndef GLProfiler_H
+#define GLProfiler_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QRect>
+
+class QPainter;
+
+/// Number of events GLProfiler keeps for writeChromeTrace() - older events are overwritten
+#define GLPROFILER_MAX_EVENTS 100000
+/// Number of drawable/stage rows shown in the overlay
+#define GLPROFILER_OVERLAY_ROWS 16
+
+/// \class GLProfilerEvent
+/// One timed section (or instant, e.g. a missed vsync) recorded by GLProfiler
+class GLProfilerEvent
+{
+public:
+	GLProfilerEvent() : phase('X'), start(0), duration(0), thread(0) {}
+
+	QString name;
+	QString category;
+	/// Chrome trace phase - 'X' for a complete event with a duration, 'i' for an instant
+	char phase;
+	/// Microseconds since the profiler was created
+	qint64 start;
+	qint64 duration;
+	int thread;
+};
+
+/// \class GLProfilerStat
+/// Running totals for one stage of one object, as shown in the overlay
+class GLProfilerStat
+{
+public:
+	GLProfilerStat() : count(0), last(0), avg(0), max(0) {}
+
+	QString label;
+	int count;
+	/// All in microseconds. avg is a moving average, weighted to roughly the last 16 calls.
+	qint64 last;
+	double avg;
+	qint64 max;
+};
+
+/// \class GLProfiler
+/// Records where frame time goes in GLWidget - per-drawable time in paintGL() and updateTexture(), text and image
+/// preparation, and frame intervals (with an estimate of missed vsyncs.)
+///
+/// Disabled by default, in which case GLProfilerScope costs one bool check. Once enabled, the stats can be shown
+/// on top of a GLWidget with GLWidget::setProfilerOverlay() and the raw events written out with writeChromeTrace()
+/// for loading in chrome://tracing.
+///
+/// Thread-safe, since text is rendered off the GUI thread.
+class GLProfiler : public QObject
+{
+	Q_OBJECT
+public:
+	static GLProfiler *instance();
+
+	bool isEnabled() { return m_enabled; }
+
+	/// Monotonic clock in microseconds
+	qint64 clock();
+
+	/// Records a section of \a category named \a name (e.g. "paintGL") that ran from \a start to \a end (clock() values)
+	/// for \a object (may be 0.) Usually called by GLProfilerScope.
+	void addEvent(const char *name, const char *category, QObject *object, qint64 start, qint64 end);
+
+	/// Called by GLWidget at the start of every paintGL() to track frame intervals and missed vsyncs
+	void frameStarted();
+
+	/// Display refresh rate used to count missed vsyncs, defaults to 60Hz
+	double refreshRate() { return m_refreshRate; }
+
+	/// Frame stats - intervals in ms
+	double fps() { return m_frameInterval > 0 ? 1000. / m_frameInterval : 0; }
+	double frameInterval() { return m_frameInterval; }
+	double maxFrameInterval() { return m_maxFrameInterval; }
+	int frameCount() { return m_frameCount; }
+	int missedVsyncs() { return m_missedVsyncs; }
+
+	/// Per object/stage stats, sorted by average time, most expensive first
+	QList<GLProfilerStat> stats();
+
+	/// Draws the frame stats and the most expensive stats() in the top left of \a rect
+	void drawOverlay(QPainter *painter, const QRect& rect);
+
+	/// Writes the recorded events as a Chrome trace (JSON), returns false if \a file can't be written
+	bool writeChromeTrace(const QString& file);
+
+	/// If set, writeChromeTrace() is called with \a file when the application quits
+	QString traceFile() { return m_traceFile; }
+
+public slots:
+	void setEnabled(bool);
+	void setRefreshRate(double hz);
+	void setTraceFile(const QString& file);
+
+	/// Clears all events and stats
+	void reset();
+
+private slots:
+	void writeTraceFile();
+
+private:
+	GLProfiler();
+	static GLProfiler *m_instance;
+
+	// Both expect m_mutex to be locked
+	int threadIndex();
+	void appendEvent(const GLProfilerEvent&);
+
+	bool m_enabled;
+	QMutex m_mutex;
+
+	qint64 m_clockBase;
+
+	QVector<GLProfilerEvent> m_events;
+	int m_eventPos;
+	bool m_eventsWrapped;
+
+	QHash<QString,GLProfilerStat> m_stats;
+	QHash<Qt::HANDLE,int> m_threads;
+
+	double m_refreshRate;
+	qint64 m_lastFrame;
+	double m_frameInterval;
+	double m_maxFrameInterval;
+	int m_frameCount;
+	int m_missedVsyncs;
+
+	QString m_traceFile;
+};
+
+/// \class GLProfilerScope
+/// Times the enclosing scope and hands it to GLProfiler::addEvent(), e.g.
+///    GLProfilerScope scope("updateTexture", "texture", this);
+/// \a name and \a category must be string literals (or otherwise outlive the scope.)
+class GLProfilerScope
+{
+public:
+	GLProfilerScope(const char *name, const char *category, QObject *object = 0)
+		: m_name(name)
+		, m_category(category)
+		, m_object(object)
+		, m_start(-1)
+	{
+		if(GLProfiler::instance()->isEnabled())
+			m_start = GLProfiler::instance()->clock();
+	}
+
+	~GLProfilerScope()
+	{
+		if(m_start >= 0)
+		{
+			GLProfiler *profiler = GLProfiler::instance();
+			profiler->addEvent(m_name, m_category, m_object, m_start, profiler->clock());
+		}
+	}
+
+private:
+	const char *m_name;
+	const char *m_category;
+	QObject *m_object;
+	qint64 m_start;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "GLSceneGroupType.h"
 #include "GLDrawable.h"
 #include "GLWidget.h"
+#include "GLScheduler.h"
 
 #include "MetaObjectUtil.h"
 
@@ -1299,19 +1300,22 @@ void GLSceneGroup::setAutoSchedule(bool flag)
 GLSceneGroupPlaylist::GLSceneGroupPlaylist(GLSceneGroup *group)
 	: QObject(group)
 	, m_group(group)
+	, m_isPlaying(false)
 	, m_playTime(0)
 	, m_currentItemIndex(-1)
 	, m_isRandom(false)
 	, m_currentItem(0)
+	, m_itemStartClock(0)
+	, m_itemDueClock(0)
+	, m_itemEventId(-1)
+	, m_advancing(false)
+	, m_lastScheduledDue(-1)
 {
-	connect(&m_currentItemTimer, SIGNAL(timeout()), this, SLOT(nextItem()));
-	m_currentItemTimer.setSingleShot(true);
-	m_currentItemTimer.setInterval(0);
 }
 
 GLSceneGroupPlaylist::~GLSceneGroupPlaylist()
 {
-
+	GLScheduler::instance()->cancelAll(this);
 }
 
 GLScene *GLSceneGroupPlaylist::currentItem()
@@ -1354,11 +1358,127 @@ void GLSceneGroupPlaylist::play(bool restart)
 {
 	if(restart)
 		m_playTime = 0;
-	m_currentItemTimer.start();
+	
+	GLScheduler *scheduler = GLScheduler::instance();
+	scheduler->cancelAll(this);
+	m_itemEventId = -1;
+	m_isPlaying = true;
+	
+	scheduleItems();
+	
+	// Resume the current item if it still has time left, otherwise move on right away
+	if(!currentItem() || m_itemDueClock <= scheduler->clock())
+		m_itemDueClock = scheduler->clock();
+	scheduleCurrentItem();
 }
 void GLSceneGroupPlaylist::stop()
 {
-	m_currentItemTimer.stop();
+	m_isPlaying = false;
+	GLScheduler::instance()->cancelAll(this);
+	m_itemEventId = -1;
+}
+
+void GLSceneGroupPlaylist::scheduleCurrentItem()
+{
+	GLScheduler *scheduler = GLScheduler::instance();
+	scheduler->cancel(m_itemEventId);
+	m_itemEventId = -1;
+	
+	if(!m_isPlaying)
+		return;
+	
+	// Tag with the scene that will be shown next (when we know it) so players can pre-load it
+	GLScene *next = 0;
+	if(!m_isRandom && !m_group->isEmpty())
+		next = m_group->at((m_currentItemIndex + 1) % m_group->size());
+	
+	m_itemEventId = scheduler->schedule(m_itemDueClock, this, "currentItemDue",
+		next ? qVariantFromValue((QObject*)next) : QVariant());
+}
+
+void GLSceneGroupPlaylist::currentItemDue()
+{
+	m_itemEventId = -1;
+	if(m_group->isEmpty())
+		return;
+	
+	qint64 now = GLScheduler::instance()->clock();
+	
+	// If we were held up for longer than the following item(s) would have been on screen, skip them
+	// instead of flashing each one up for a moment
+	if(!m_isRandom)
+	{
+		double total = duration();
+		if(total > 0 && now - m_itemDueClock >= (qint64)(total * 1000.))
+			m_itemDueClock += ((now - m_itemDueClock) / (qint64)(total * 1000.)) * (qint64)(total * 1000.);
+		
+		for(int i=0; i<m_group->size(); i++)
+		{
+			int nextIdx = (m_currentItemIndex + 1) % m_group->size();
+			qint64 nextDue = m_itemDueClock + (qint64)(m_group->at(nextIdx)->duration() * 1000.);
+			if(nextDue > now)
+				break;
+			
+			m_currentItemIndex = nextIdx;
+			m_itemDueClock = nextDue;
+		}
+	}
+	
+	m_advancing = true;
+	nextItem();
+	m_advancing = false;
+}
+
+void GLSceneGroupPlaylist::scheduleItems()
+{
+	GLScheduler *scheduler = GLScheduler::instance();
+	qint64 now = scheduler->clock();
+	
+	foreach(GLScene *scene, m_group->sceneList())
+	{
+		if(scene->autoSchedule() || !scene->scheduledTime().isValid())
+			continue;
+		
+		qint64 due = scheduler->clockFor(scene->scheduledTime());
+		if(due > now)
+			scheduler->schedule(due, this, "scheduledItemDue", qVariantFromValue((QObject*)scene));
+	}
+}
+
+void GLSceneGroupPlaylist::scheduledItemDue()
+{
+	GLScheduler *scheduler = GLScheduler::instance();
+	qint64 now = scheduler->clock();
+	
+	// If several came due while we were busy, the latest one wins
+	GLScene *dueScene = 0;
+	qint64 dueClock = -1;
+	foreach(GLScene *scene, m_group->sceneList())
+	{
+		if(scene->autoSchedule() || !scene->scheduledTime().isValid())
+			continue;
+		
+		qint64 due = scheduler->clockFor(scene->scheduledTime());
+		if(due <= now + GLSCHEDULER_TICK_MS &&
+		   due > m_lastScheduledDue &&
+		   due > dueClock)
+		{
+			dueScene = scene;
+			dueClock = due;
+		}
+	}
+	
+	if(!dueScene)
+		return;
+	
+	m_lastScheduledDue = dueClock;
+	
+	// Start timing the scene from when it was scheduled, not when we got to it
+	m_itemDueClock = dueClock;
+	m_advancing = true;
+	m_currentItemIndex = -1; // make sure playItem() doesn't ignore it if it's already showing
+	playItem(dueScene);
+	m_advancing = false;
 }
 
 void GLSceneGroupPlaylist::playItem(GLScene *item)
@@ -1400,19 +1520,22 @@ void GLSceneGroupPlaylist::setCurrentItem(GLScene *item)
 	m_currentItemIndex = idx;
 	m_playTime = timeFor(item);
 	
-	m_currentItemTimer.stop();
+	GLScheduler *scheduler = GLScheduler::instance();
+	scheduler->cancel(m_itemEventId);
+	m_itemEventId = -1;
 	
-	int dur = (int)(item->duration() * 1000);
+	qint64 dur = (qint64)(item->duration() * 1000);
 		
 	if(item->duration() <= 0.01)
 		return;
 	else
 	{
 		//qDebug() << "GLSceneGroupPlaylist::setCurrentItem: Starting timer on item:"<<item<<", num:"<<m_currentItemIndex<<"for"<<item->duration()<<"sec";
-		m_currentItemTimer.stop();
-		m_currentItemTimer.setInterval(dur);
-		m_currentItemTimer.start();
-		m_currentElapsedTime.restart();
+		
+		// When advancing on schedule, the item starts when the previous one was due to end, otherwise (e.g. the user picked it) it starts now
+		m_itemStartClock = m_advancing ? m_itemDueClock : scheduler->clock();
+		m_itemDueClock   = m_itemStartClock + dur;
+		scheduleCurrentItem();
 		
 		if(m_currentItem)
 			disconnect(m_currentItem, 0, this, 0);
@@ -1427,17 +1550,20 @@ void GLSceneGroupPlaylist::sceneDurationChanged(double d)
 	if(sender() != m_currentItem)
 		return;
 		
-	double e = ((double)m_currentElapsedTime.elapsed()) / 1000.;
+	qint64 now = GLScheduler::instance()->clock();
+	double e = ((double)(now - m_itemStartClock)) / 1000.;
 	double newDur = d - e;
 	if(newDur < 0)
+	{
+		// Already past the new duration - give it the full new duration from now
 		newDur = d;
+		m_itemStartClock = now;
+	}
 	if(newDur > 0)
 	{
-		qDebug() << "GLSceneGroupPlaylist::sceneDurationChanged: New duration:"<<d<<", already elapsed:"<<e<<", new timer length:"<<newDur;
-		m_currentItemTimer.stop();
-		m_currentItemTimer.setInterval((int)( /*newDur */ d * 1000. ));
-		m_currentItemTimer.start();
-		m_currentElapsedTime.restart();
+		qDebug() << "GLSceneGroupPlaylist::sceneDurationChanged: New duration:"<<d<<", already elapsed:"<<e<<", remaining:"<<newDur;
+		m_itemDueClock = m_itemStartClock + (qint64)(d * 1000.);
+		scheduleCurrentItem();
 	}
 	else
 	{
@@ -1497,7 +1623,7 @@ void GLSceneGroupPlaylist::nextItem()
 	if(next >= m_group->size())
 		next = 0;
 		
-	double e = ((double)m_currentElapsedTime.elapsed()) / 1000.;
+	double e = ((double)(GLScheduler::instance()->clock() - m_itemStartClock)) / 1000.;
 	qDebug() << "GLSceneGroupPlaylist::nextItem(): Scene#:"<<next<<", elapsed:"<<e;
 	playItem(m_group->at(next));
 }
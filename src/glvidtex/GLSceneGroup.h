@@ -438,18 +438,29 @@ private slots:
 	
 // 	void playlistItemChangedSlot();
 // 	void timerTick();
+	void currentItemDue();
+	void scheduledItemDue();
 
 private:
+	void scheduleCurrentItem();
+	void scheduleItems();
+	
 	GLSceneGroup *m_group;
 	
 	bool m_isPlaying;
-	QTimer m_currentItemTimer;
 	double m_playTime;
 	int m_currentItemIndex;
 	bool m_isRandom;
 	
-	QTime m_currentElapsedTime;
 	GLScene *m_currentItem;
+	
+	// GLScheduler::clock() values for when the current item started and when it's due to end.
+	// When an item ends on time, the next one starts at the previous due time rather than whenever we got to it, so there's no drift.
+	qint64 m_itemStartClock;
+	qint64 m_itemDueClock;
+	int m_itemEventId;
+	bool m_advancing;
+	qint64 m_lastScheduledDue;
 };
 
 class GLSceneGroupCollection : public QAbstractListModel
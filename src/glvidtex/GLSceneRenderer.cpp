@@ -0,0 +1,217 @@
+#include "GLSceneRenderer.h"
+
+#include "GLSceneGroup.h"
+#include "GLSceneGroupType.h"
+#include "GLDrawable.h"
+#include "SceneCapture.h"
+
+#include <QDebug>
+
+GLSceneRenderer::GLSceneRenderer(QObject *parent)
+	: VideoSource(parent)
+	, m_graphicsScene(new QGraphicsScene(this))
+	, m_scene(0)
+	, m_canvasSize(1000.,750.)
+	, m_frameSize(320,240)
+	, m_fps(GLSCENERENDERER_DEFAULT_FPS)
+	, m_capture(0)
+	, m_lastFrameNumber(-1)
+	, m_lastRenderTime(0)
+	, m_renderedFrameCount(0)
+{
+	setIsBuffered(false);
+	setAutoDestroy(false);
+
+	m_graphicsScene->setSceneRect(QRectF(QPointF(0,0), m_canvasSize));
+
+	connect(&m_frameTimer, SIGNAL(timeout()), this, SLOT(renderFrame()));
+	setFps(m_fps);
+}
+
+GLSceneRenderer::~GLSceneRenderer()
+{
+	detachScene();
+	releaseCapture();
+}
+
+void GLSceneRenderer::consumerRegistered(QObject*)
+{
+	if(!m_frameTimer.isActive())
+		m_frameTimer.start();
+}
+
+void GLSceneRenderer::consumerReleased(QObject*)
+{
+	if(m_consumerList.isEmpty())
+		m_frameTimer.stop();
+}
+
+void GLSceneRenderer::setScene(GLScene *scene)
+{
+	if(m_scene == scene)
+		return;
+
+	detachScene();
+
+	m_scene = scene;
+	if(!m_scene)
+		return;
+
+	connect(m_scene, SIGNAL(destroyed()), this, SLOT(sceneDestroyed()));
+	connect(m_scene, SIGNAL(drawableAdded(GLDrawable*)), this, SLOT(drawableAdded(GLDrawable*)));
+	connect(m_scene, SIGNAL(drawableRemoved(GLDrawable*)), this, SLOT(drawableRemoved(GLDrawable*)));
+
+	m_scene->setGraphicsScene(m_graphicsScene);
+
+	// Same as PlayerWindow::addScene(), minus the fade in - there's nobody watching the fade
+	foreach(GLDrawable *drawable, m_scene->drawableList())
+	{
+		drawable->setCanvasSize(m_canvasSize);
+		if(drawable->playlist()->size() > 0)
+			drawable->playlist()->play();
+	}
+
+	if(m_scene->sceneType())
+		m_scene->sceneType()->setLiveStatus(true);
+
+	invalidate();
+}
+
+void GLSceneRenderer::detachScene()
+{
+	if(!m_scene)
+		return;
+
+	disconnect(m_scene, 0, this, 0);
+
+	if(m_scene->sceneType())
+		m_scene->sceneType()->setLiveStatus(false);
+
+	m_scene->setGraphicsScene(0);
+	m_scene = 0;
+}
+
+void GLSceneRenderer::sceneDestroyed()
+{
+	// The drawables went with the scene (and out of m_graphicsScene with them)
+	m_scene = 0;
+	invalidate();
+}
+
+void GLSceneRenderer::drawableAdded(GLDrawable *drawable)
+{
+	drawable->setCanvasSize(m_canvasSize);
+	m_graphicsScene->addItem(drawable);
+}
+
+void GLSceneRenderer::drawableRemoved(GLDrawable *drawable)
+{
+	if(drawable->scene() == m_graphicsScene)
+		m_graphicsScene->removeItem(drawable);
+}
+
+void GLSceneRenderer::setCanvasSize(const QSizeF& size)
+{
+	if(m_canvasSize == size || !size.isValid())
+		return;
+
+	m_canvasSize = size;
+	m_graphicsScene->setSceneRect(QRectF(QPointF(0,0), m_canvasSize));
+
+	if(m_scene)
+		foreach(GLDrawable *drawable, m_scene->drawableList())
+			drawable->setCanvasSize(m_canvasSize);
+}
+
+void GLSceneRenderer::setFrameSize(const QSize& size)
+{
+	if(m_frameSize == size || size.isEmpty())
+		return;
+
+	m_frameSize = size;
+
+	// Captures are shared per frame size, so get a new one instead of resizing this one
+	releaseCapture();
+}
+
+void GLSceneRenderer::releaseCapture()
+{
+	if(!m_capture)
+		return;
+
+	m_capture->release();
+	m_capture = 0;
+	m_lastFrameNumber = -1;
+}
+
+void GLSceneRenderer::setFps(int fps)
+{
+	if(fps < 1)
+		fps = 1;
+
+	m_fps = fps;
+	m_frameTimer.setInterval(1000/m_fps);
+}
+
+void GLSceneRenderer::invalidate()
+{
+	if(m_capture)
+		m_capture->invalidate();
+}
+
+QImage GLSceneRenderer::renderImage()
+{
+	if(!m_capture)
+		m_capture = SceneCapture::captureForScene(m_graphicsScene, m_frameSize);
+
+	int frameNumber = m_capture->frameNumber();
+	m_renderClock.start();
+
+	QImage image = m_capture->frame();
+
+	if(m_capture->frameNumber() != frameNumber)
+	{
+		m_lastRenderTime = m_renderClock.elapsed();
+		m_renderedFrameCount ++;
+		//qDebug() << "GLSceneRenderer::renderImage(): Frame"<<m_renderedFrameCount<<"took"<<m_lastRenderTime<<"ms";
+	}
+	else
+	{
+		m_lastRenderTime = 0;
+	}
+
+	return image;
+}
+
+void GLSceneRenderer::renderFrame()
+{
+	QImage image = renderImage();
+
+	// Nothing changed in the scene, consumers still have the last frame
+	if(m_capture->frameNumber() == m_lastFrameNumber)
+		return;
+
+	m_lastFrameNumber = m_capture->frameNumber();
+
+	enqueue(new VideoFrame(image.convertToFormat(QImage::Format_ARGB32), 1000/m_fps, QTime::currentTime()));
+}
+
+QImage GLSceneRenderer::renderScene(GLScene *scene, const QSize& frameSize, const QSizeF& canvasSize)
+{
+	if(!scene)
+		return QImage();
+
+	GLScene *copy = scene->clone();
+
+	GLSceneRenderer renderer;
+	renderer.setCanvasSize(canvasSize);
+	renderer.setFrameSize(frameSize);
+	renderer.setScene(copy);
+
+	QImage image = renderer.renderImage().convertToFormat(QImage::Format_ARGB32);
+
+	renderer.setScene(0);
+	delete copy;
+
+	return image;
+}
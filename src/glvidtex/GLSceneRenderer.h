@@ -0,0 +1,101 @@
+#ifndef GLSceneRenderer_H
+#define GLSceneRenderer_H
+
+#include <QGraphicsScene>
+#include <QTimer>
+#include <QTime>
+
+#include "../livemix/VideoSource.h"
+
+class GLScene;
+class GLDrawable;
+class SceneCapture;
+
+/// Default frame rate for GLSceneRenderer, same as PlayerCompatOutputStream
+#define GLSCENERENDERER_DEFAULT_FPS 5
+
+/// \class GLSceneRenderer
+/// Renders a GLScene without a GLWidget or any window on screen - for preview feeds, thumbnails of scenes
+/// and timing scenes on build machines.
+///
+/// The scene's drawables are added to a private QGraphicsScene (the same software path PlayerWindow uses in 'compat'
+/// mode) and captured with SceneCapture at frameSize(), so only what changed is re-rendered. As a VideoSource, it
+/// renders at fps() while it has consumers, and only sends a frame when something in the scene actually changed.
+/// renderImage() renders a single frame on demand, regardless of consumers.
+///
+/// A drawable can only be in one QGraphicsScene at a time, so don't give it a scene that's on air in a player -
+/// give it a GLScene::clone() instead, like renderScene() does.
+class GLSceneRenderer : public VideoSource
+{
+	Q_OBJECT
+
+public:
+	GLSceneRenderer(QObject *parent=0);
+	virtual ~GLSceneRenderer();
+
+	VideoFormat videoFormat() { return VideoFormat(VideoFrame::BUFFER_IMAGE, QVideoFrame::Format_ARGB32, m_frameSize); }
+
+	GLScene *scene() { return m_scene; }
+	QGraphicsScene *graphicsScene() { return m_graphicsScene; }
+
+	/// Size of the canvas the scene was laid out on, defaults to 1000x750 (same as GLDrawable::canvasSize())
+	QSizeF canvasSize() { return m_canvasSize; }
+	/// Size of the frames rendered, the canvas is letterboxed into it. Defaults to 320x240.
+	QSize frameSize() { return m_frameSize; }
+	int fps() { return m_fps; }
+
+	/// Renders (whatever changed of) the scene right now and returns the frame
+	QImage renderImage();
+
+	/// Time in ms the last renderImage() took - zero if nothing had changed since the frame before
+	int lastRenderTime() { return m_lastRenderTime; }
+	/// Number of frames actually rendered (not counting calls where nothing changed)
+	int renderedFrameCount() { return m_renderedFrameCount; }
+
+	/// Renders a single frame of a copy of \a scene at \a frameSize - the scene itself is left untouched,
+	/// so this is safe to call on a scene that's live in a player.
+	static QImage renderScene(GLScene *scene, const QSize& frameSize, const QSizeF& canvasSize = QSizeF(1000.,750.));
+
+public slots:
+	/// Shows \a scene (removing the previous one, if any.) The renderer doesn't take ownership of the scene.
+	void setScene(GLScene *scene);
+
+	void setCanvasSize(const QSizeF&);
+	void setFrameSize(const QSize&);
+	void setFps(int);
+
+	/// Forces the next frame to render the entire scene, not just what changed
+	void invalidate();
+
+private slots:
+	void renderFrame();
+	void sceneDestroyed();
+	void drawableAdded(GLDrawable*);
+	void drawableRemoved(GLDrawable*);
+
+protected:
+	// VideoSource::
+	virtual void consumerRegistered(QObject*);
+	virtual void consumerReleased(QObject*);
+
+private:
+	void detachScene();
+	void releaseCapture();
+
+	QGraphicsScene *m_graphicsScene;
+	GLScene *m_scene;
+
+	QSizeF m_canvasSize;
+	QSize m_frameSize;
+	int m_fps;
+	QTimer m_frameTimer;
+
+	SceneCapture *m_capture;
+	int m_lastFrameNumber;
+
+	QTime m_renderClock;
+	int m_lastRenderTime;
+	int m_renderedFrameCount;
+};
+
+#endif
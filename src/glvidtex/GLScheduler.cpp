@@ -0,0 +1,263 @@
+#include "GLScheduler.h"
+
+#include <QDebug>
+#include <QtAlgorithms>
+
+GLScheduler *GLScheduler::m_instance = 0;
+
+static bool GLScheduledEvent_lessThan(const GLScheduledEvent &a, const GLScheduledEvent &b)
+{
+	return a.deadline < b.deadline;
+}
+
+GLScheduler *GLScheduler::instance()
+{
+	if(!m_instance)
+		m_instance = new GLScheduler();
+	return m_instance;
+}
+
+GLScheduler::GLScheduler()
+	: QObject()
+	#if QT_VERSION < 0x040700
+	, m_clockWrapOffset(0)
+	, m_lastClockMsecs(0)
+	#endif
+	, m_currentTick(0)
+	, m_eventCount(0)
+	, m_nextId(1)
+	, m_catchUpCount(0)
+{
+	m_wheel.resize(GLSCHEDULER_SLOTS);
+	m_clock.start();
+
+	m_wheelTimer.setSingleShot(true);
+	connect(&m_wheelTimer, SIGNAL(timeout()), this, SLOT(wheelTick()));
+}
+
+qint64 GLScheduler::clock()
+{
+	#if QT_VERSION >= 0x040700
+	return m_clock.elapsed();
+	#else
+	// QTime::elapsed() wraps at midnight
+	int msecs = m_clock.elapsed();
+	if(msecs < m_lastClockMsecs)
+		m_clockWrapOffset += 24 * 60 * 60 * 1000;
+	m_lastClockMsecs = msecs;
+	return m_clockWrapOffset + msecs;
+	#endif
+}
+
+qint64 GLScheduler::clockFor(const QDateTime& dateTime)
+{
+	QDateTime now = QDateTime::currentDateTime();
+	qint64 diff = ((qint64)now.secsTo(dateTime)) * 1000 + (dateTime.time().msec() - now.time().msec());
+	return clock() + diff;
+}
+
+int GLScheduler::slotFor(qint64 deadline)
+{
+	qint64 tick = deadline / GLSCHEDULER_TICK_MS;
+	if(tick <= m_currentTick)
+		tick = m_currentTick + 1;
+	return (int)(tick % GLSCHEDULER_SLOTS);
+}
+
+int GLScheduler::schedule(qint64 deadline, QObject *receiver, const char *method, const QVariant& tag)
+{
+	if(!receiver || !method)
+		return -1;
+
+	// Wheel was idle, so m_currentTick is stale - bring it up to now so the event doesn't land in a slot we already passed
+	if(m_eventCount == 0)
+		m_currentTick = clock() / GLSCHEDULER_TICK_MS - 1;
+
+	GLScheduledEvent event;
+	event.id       = m_nextId ++;
+	event.deadline = deadline;
+	event.receiver = receiver;
+	event.method   = method;
+	event.tag      = tag;
+
+	m_wheel[slotFor(deadline)] << event;
+	m_eventCount ++;
+
+	updateTimer();
+
+	emit eventScheduled(event.id);
+
+	return event.id;
+}
+
+int GLScheduler::scheduleIn(int msecs, QObject *receiver, const char *method, const QVariant& tag)
+{
+	return schedule(clock() + msecs, receiver, method, tag);
+}
+
+void GLScheduler::cancel(int id)
+{
+	if(id < 0)
+		return;
+
+	for(int slot=0; slot<m_wheel.size(); slot++)
+	{
+		QList<GLScheduledEvent> &list = m_wheel[slot];
+		for(int i=0; i<list.size(); i++)
+		{
+			if(list[i].id == id)
+			{
+				list.removeAt(i);
+				m_eventCount --;
+				updateTimer();
+				return;
+			}
+		}
+	}
+
+	// Already off the wheel, waiting its turn in wheelTick()
+	for(int i=0; i<m_due.size(); i++)
+	{
+		if(m_due[i].id == id)
+		{
+			m_due.removeAt(i);
+			return;
+		}
+	}
+}
+
+void GLScheduler::cancelAll(QObject *receiver)
+{
+	for(int slot=0; slot<m_wheel.size(); slot++)
+	{
+		QList<GLScheduledEvent> &list = m_wheel[slot];
+		for(int i=list.size()-1; i>=0; i--)
+		{
+			if(list[i].receiver == receiver || !list[i].receiver)
+			{
+				list.removeAt(i);
+				m_eventCount --;
+			}
+		}
+	}
+
+	for(int i=m_due.size()-1; i>=0; i--)
+		if(m_due[i].receiver == receiver || !m_due[i].receiver)
+			m_due.removeAt(i);
+
+	updateTimer();
+}
+
+QList<GLScheduledEvent> GLScheduler::upcomingEvents(int withinMsecs)
+{
+	qint64 limit = clock() + withinMsecs;
+
+	QList<GLScheduledEvent> events;
+	foreach(QList<GLScheduledEvent> list, m_wheel)
+		foreach(GLScheduledEvent event, list)
+			if(event.deadline <= limit && event.receiver)
+				events << event;
+
+	qSort(events.begin(), events.end(), GLScheduledEvent_lessThan);
+	return events;
+}
+
+GLScheduledEvent GLScheduler::nextEvent(QObject *receiver)
+{
+	GLScheduledEvent next;
+	foreach(QList<GLScheduledEvent> list, m_wheel)
+		foreach(GLScheduledEvent event, list)
+			if(event.receiver == receiver &&
+			   (next.id < 0 || event.deadline < next.deadline))
+				next = event;
+	return next;
+}
+
+void GLScheduler::updateTimer()
+{
+	if(m_eventCount <= 0)
+	{
+		m_eventCount = 0;
+		m_wheelTimer.stop();
+		return;
+	}
+
+	// Sleep until the tick after the earliest deadline instead of spinning through empty slots
+	qint64 earliest = -1;
+	foreach(QList<GLScheduledEvent> list, m_wheel)
+		foreach(GLScheduledEvent event, list)
+			if(earliest < 0 || event.deadline < earliest)
+				earliest = event.deadline;
+
+	qint64 dueTick = earliest / GLSCHEDULER_TICK_MS + 1;
+	qint64 wait = dueTick * GLSCHEDULER_TICK_MS - clock();
+	if(wait < GLSCHEDULER_TICK_MS)
+		wait = GLSCHEDULER_TICK_MS;
+	if(wait > 60 * 1000)
+		wait = 60 * 1000;
+
+	m_wheelTimer.start((int)wait);
+}
+
+void GLScheduler::wheelTick()
+{
+	qint64 now = clock();
+
+	// Only process ticks that are completely in the past
+	qint64 lastCompleteTick = now / GLSCHEDULER_TICK_MS - 1;
+	if(lastCompleteTick <= m_currentTick)
+	{
+		updateTimer();
+		return;
+	}
+
+	qint64 ticks = lastCompleteTick - m_currentTick;
+	if(ticks > GLSCHEDULER_SLOTS)
+		ticks = GLSCHEDULER_SLOTS;
+
+	// GUI thread was busy, catch up on everything that came due while we weren't looking
+	//if(ticks > 1)
+	//	qDebug() << "GLScheduler::wheelTick(): Catching up"<<ticks<<"ticks";
+
+	QList<GLScheduledEvent> due;
+	for(qint64 tick = m_currentTick + 1; tick <= m_currentTick + ticks; tick++)
+	{
+		QList<GLScheduledEvent> &list = m_wheel[(int)(tick % GLSCHEDULER_SLOTS)];
+		for(int i=list.size()-1; i>=0; i--)
+		{
+			// Events a whole revolution (or more) away stay put
+			if(list[i].deadline / GLSCHEDULER_TICK_MS <= lastCompleteTick)
+			{
+				due << list.takeAt(i);
+				m_eventCount --;
+			}
+		}
+	}
+
+	m_currentTick = lastCompleteTick;
+
+	if(!due.isEmpty())
+	{
+		qSort(due.begin(), due.end(), GLScheduledEvent_lessThan);
+
+		if(now - due.first().deadline > GLSCHEDULER_TICK_MS * 2)
+			m_catchUpCount ++;
+
+		// Handlers may cancel() events in this same batch, so take them off m_due one at a time
+		// instead of walking a copy
+		m_due << due;
+		qSort(m_due.begin(), m_due.end(), GLScheduledEvent_lessThan);
+
+		while(!m_due.isEmpty())
+		{
+			GLScheduledEvent event = m_due.takeFirst();
+			if(!event.receiver)
+				continue;
+
+			//qDebug() << "GLScheduler::wheelTick(): Firing"<<event.id<<event.method<<"on"<<(QObject*)event.receiver<<", late by"<<(now - event.deadline)<<"ms";
+			QMetaObject::invokeMethod(event.receiver, event.method.constData(), Qt::DirectConnection);
+		}
+	}
+
+	updateTimer();
+}
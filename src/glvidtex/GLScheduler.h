@@ -0,0 +1,118 @@
+#ifndef GLScheduler_H
+#define GLScheduler_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <QVariant>
+#include <QVector>
+#include <QList>
+#include <QDateTime>
+
+#if QT_VERSION >= 0x040700
+#include <QElapsedTimer>
+#else
+#include <QTime>
+#endif
+
+/// Resolution of the scheduler wheel, in milliseconds. Events fire on the first wheel tick at or after their deadline.
+#define GLSCHEDULER_TICK_MS   10
+/// Number of slots in the wheel - events further out than GLSCHEDULER_TICK_MS * GLSCHEDULER_SLOTS just stay in their slot for extra revolutions
+#define GLSCHEDULER_SLOTS     512
+
+/// \class GLScheduledEvent
+/// An event registered with GLScheduler, as returned by GLScheduler::upcomingEvents()
+class GLScheduledEvent
+{
+public:
+	GLScheduledEvent() : id(-1), deadline(0) {}
+
+	/// Handle returned by GLScheduler::schedule()
+	int id;
+	/// GLScheduler::clock() value the event is due at
+	qint64 deadline;
+	/// Object and slot (no arguments) to invoke when due
+	QPointer<QObject> receiver;
+	QByteArray method;
+	/// Whatever the scheduling object wants to tell players about the event, e.g. the GLPlaylistItem or GLScene about to be shown
+	QVariant tag;
+};
+
+/// \class GLScheduler
+/// Central timer wheel that drives GLDrawablePlaylist and GLSceneGroupPlaylist (and anything else that needs to do something at a given time.)
+///
+/// All times are measured against clock(), a monotonic millisecond clock that isn't affected by the GUI thread being busy
+/// or by changes to the system time. Playlists compute their position from clock() instead of counting timer ticks,
+/// so they don't drift. If the GUI thread stalls for longer than a tick, all the events that came due in the meantime
+/// are fired (in deadline order) as soon as the scheduler gets control back - it's up to the receiver to catch up,
+/// e.g. by checking clock() against its own start time.
+///
+/// Players can call upcomingEvents() to find out what's coming up so they can pre-load media.
+class GLScheduler : public QObject
+{
+	Q_OBJECT
+public:
+	static GLScheduler *instance();
+
+	/// Monotonic clock in milliseconds
+	qint64 clock();
+
+	/// Converts a wall-clock time to a clock() value, e.g. for GLPlaylistItem::scheduledTime()
+	qint64 clockFor(const QDateTime&);
+
+	/// Invokes \a method (the name of a slot with no arguments) on \a receiver when clock() reaches \a deadline.
+	/// Returns an id that can be passed to cancel(). If the deadline has already passed, the event fires on the next tick.
+	int schedule(qint64 deadline, QObject *receiver, const char *method, const QVariant& tag = QVariant());
+	/// Same as schedule(), but \a msecs from now
+	int scheduleIn(int msecs, QObject *receiver, const char *method, const QVariant& tag = QVariant());
+
+	/// Removes the event. Safe to call with an id that already fired or -1, and from an event handler -
+	/// an event due in the same tick as the handler's won't fire once cancelled.
+	void cancel(int id);
+	/// Removes all events for \a receiver
+	void cancelAll(QObject *receiver);
+
+	/// Returns the events due within \a withinMsecs of now, sorted by deadline
+	QList<GLScheduledEvent> upcomingEvents(int withinMsecs);
+	/// Returns the next event for \a receiver, or an event with id -1 if nothing scheduled
+	GLScheduledEvent nextEvent(QObject *receiver);
+
+	/// Number of times a tick came more than one tick late and had to catch up
+	int catchUpCount() { return m_catchUpCount; }
+
+signals:
+	/// Emitted after an event is scheduled, so players can refresh their pre-load list
+	void eventScheduled(int id);
+
+private slots:
+	void wheelTick();
+
+private:
+	GLScheduler();
+
+	int slotFor(qint64 deadline);
+	void updateTimer();
+
+	static GLScheduler *m_instance;
+
+	#if QT_VERSION >= 0x040700
+	QElapsedTimer m_clock;
+	#else
+	QTime m_clock;
+	qint64 m_clockWrapOffset;
+	int m_lastClockMsecs;
+	#endif
+
+	QTimer m_wheelTimer;
+	QVector< QList<GLScheduledEvent> > m_wheel;
+	/// Events taken off the wheel by wheelTick() that haven't fired yet - cancel() removes from here too,
+	/// so a handler can cancel an event that came due in the same tick
+	QList<GLScheduledEvent> m_due;
+	/// Wheel tick number (clock() / GLSCHEDULER_TICK_MS) processed last
+	qint64 m_currentTick;
+	int m_eventCount;
+	int m_nextId;
+	int m_catchUpCount;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "GLSceneGroup.h"
 
 #include "GLWidget.h"
+#include "GLProfiler.h"
 
 #include <QVideoFrame>
 #include <QAbstractVideoSurface>
@@ -118,6 +119,7 @@ GLVideoDrawable::GLVideoDrawable(QObject *parent)
 	, m_videoSenderPort(-1)
 	, m_ignoreAspectRatio(false)
 	, m_crossFadeMode(JustFront)
+	, m_mipmapTextures(false)
 	, m_isCameraThread(false)
 	, m_updateLeader(0)
 	, m_electionNeeded(false)
@@ -265,6 +267,20 @@ void GLVideoDrawable::setVideoSenderPort(int port)
 	}
 }
 
+QList<QVideoFrame::PixelFormat> GLVideoDrawable::acceptedFormats()
+{
+	// YUV->RGB conversion is done in the shaders
+	if(m_useShaders)
+		return m_imagePixelFormats;
+	
+	// No shaders - only formats that can be uploaded as RGB textures
+	return QList<QVideoFrame::PixelFormat>()
+		<< QVideoFrame::Format_RGB32
+		<< QVideoFrame::Format_ARGB32
+		<< QVideoFrame::Format_RGB24
+		<< QVideoFrame::Format_RGB565;
+}
+
 void GLVideoDrawable::setVideoSource(VideoSource *source)
 {
 	if(m_source == source)
@@ -308,6 +324,7 @@ void GLVideoDrawable::setVideoSource(VideoSource *source)
 	m_source = source;
 	if(m_source)
 	{
+		m_source->setAcceptedFormats(this, acceptedFormats());
 		m_source->registerConsumer(this);
 		
 		// If m_isCameraThread, then we tell GLWidget to updateGL *now* instead of using a 0-length timer to batch updateGL() calls into a single call
@@ -1132,6 +1149,12 @@ void GLVideoDrawable::initGL()
 		m_program = new QGLShaderProgram(glWidget()->context(), this);
 		m_program2 = new QGLShaderProgram(glWidget()->context(), this);
 	}
+	
+	// Now we know if we can do YUV - sources may have to switch to RGB
+	if(m_source)
+		m_source->setAcceptedFormats(this, acceptedFormats());
+	if(m_source2)
+		m_source2->setAcceptedFormats(this, acceptedFormats());
 
 	m_glInited = true;
 	//qDebug() << "GLVideoDrawable::initGL(): "<<objectName();
@@ -2191,6 +2214,8 @@ static void uploadTexture(GLuint tx_id, const QImage &image)
 
 void GLVideoDrawable::updateTexture(bool secondSource)
 {
+	GLProfilerScope scope("updateTexture", "texture", this);
+	
 //   	if(property("-debug").toBool())
    		//qDebug() << "GLVideoDrawable::updateTexture(): "<<(QObject*)this<<" secondSource:"<<secondSource;
 		//qDebug() << "GLVideoDrawable::updateTexture(): "<<(QObject*)this;
@@ -2467,6 +2492,13 @@ void GLVideoDrawable::updateTexture(bool secondSource)
 				const QImage &constRef = !secondSource ? m_frame->image() : m_frame2->image(); // avoid detach in .bits()
 
 				glBindTexture(GL_TEXTURE_2D, !secondSource ? m_textureIds[i] : m_textureIds2[i]);
+				
+				// GL_GENERATE_MIPMAP has to be set *before* the glTexImage2D() call for the driver
+				// to build the mipmap chain as part of the upload.
+				#ifdef GL_GENERATE_MIPMAP_SGIS
+				glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, m_mipmapTextures ? GL_TRUE : GL_FALSE);
+				#endif
+				
 				if(m_useShaders)
 				{
 					if(!secondSource)
@@ -2545,7 +2577,11 @@ void GLVideoDrawable::updateTexture(bool secondSource)
 				}
 
 				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				#ifdef GL_GENERATE_MIPMAP_SGIS
+				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_mipmapTextures ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+				#else
 				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				#endif
 // 				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 // 				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
@@ -3523,6 +3559,22 @@ void GLVideoDrawable::setCrossFadeMode(CrossFadeMode mode)
 	m_crossFadeMode = mode;
 }
 
+void GLVideoDrawable::setMipmapTextures(bool flag)
+{
+	if(m_mipmapTextures == flag)
+		return;
+		
+	m_mipmapTextures = flag;
+	
+	// Force a re-upload so the new filtering takes effect
+	if(m_frame)
+	{
+		m_texturesInited = false;
+		updateTexture();
+		updateGL();
+	}
+}
+
 void GLVideoDrawable::setLevelsEnabled(bool flag)
 {
 	m_levelsEnabled = flag;
@@ -187,6 +187,12 @@ public:
 	enum CrossFadeMode { FrontAndBack, JustFront };
 	CrossFadeMode crossFadeMode() { return m_crossFadeMode; }
 	
+	bool mipmapTextures() { return m_mipmapTextures; }
+	
+	/// Returns the pixel formats this drawable can draw - everything in m_imagePixelFormats with GLSL shaders,
+	/// only the RGB formats without them. Only known for sure after initGL(), shaders are assumed until then.
+	QList<QVideoFrame::PixelFormat> acceptedFormats();
+	
 	bool liveStatus() { return m_liveStatus; }
 	
 	int blackLevel() { return m_blackLevel; }
@@ -277,6 +283,10 @@ public slots:
 	
 	void setCrossFadeMode(CrossFadeMode mode);
 	
+	/// If true, QImage-based frames are uploaded with a full mipmap chain so that
+	/// large images shown minified (or zoomed back out) filter cleanly. Default false.
+	void setMipmapTextures(bool flag);
+	
 	void setFilterType(int type) { setFilterType((FilterType)type); }
 	void setFilterType(FilterType filterType); 
 	void setSharpAmount(double value);
@@ -488,6 +498,8 @@ private:
 	
 	CrossFadeMode m_crossFadeMode;
 	
+	bool m_mipmapTextures;
+	
 	// If setVideoSource() receives a CameraThread(), then this is called to hold an election among all the GLVideoDrawables
 	// on the GLWidget with a CameraThread source. The video drawable with the highest avg FPS is elected the
 	// updateLeader and will be the only drawable with a camerathread that calls updateGL() on frameReady() - all other 
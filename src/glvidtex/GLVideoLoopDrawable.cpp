@@ -12,12 +12,11 @@
 GLVideoLoopDrawable::GLVideoLoopDrawable(QString file, QObject *parent)
 	: GLVideoDrawable(parent)
 	, m_videoLength(-1)
+	, m_videoThread(0)
 {
 	if(!file.isEmpty())
 		setVideoFile(file);
 	
-	connect(this, SIGNAL(sourceDiscarded(VideoSource*)), this, SLOT(deleteSource(VideoSource*)));
-	
 	//QTimer::singleShot(1500, this, SLOT(testXfade()));
 }
 	
@@ -43,8 +42,9 @@ bool GLVideoLoopDrawable::setVideoFile(const QString& file)
 	
 	m_videoFile = file;
 	
-	m_videoThread = new VideoThread();
-	m_videoThread->setVideo(file);
+	// Shared with any other drawable showing the same file, comes back already started (paused.)
+	// The thread deletes itself once the last drawable releases it, so no need to delete it in sourceDiscarded()
+	m_videoThread = VideoThread::threadForFile(file);
 	
 	// Assuming duration in seconds
 	m_videoLength = m_videoThread->duration(); // / 1000.;
@@ -52,8 +52,6 @@ bool GLVideoLoopDrawable::setVideoFile(const QString& file)
 	//source->setVideo("../samples/BlueFish/EssentialsVol05_Abstract_Media/HD/Countdowns/Abstract_Countdown_3_HD.mp4");
 	//source->setVideo("../samples/BlueFish/EssentialsVol05_Abstract_Media/SD/Countdowns/Abstract_Countdown_3_SD.mpg");
 	
-	m_videoThread->start(true); // true = start paused
-	
 	setVideoSource(m_videoThread);
 	setObjectName(qPrintable(file));
 	
@@ -65,22 +63,28 @@ bool GLVideoLoopDrawable::setVideoFile(const QString& file)
 	
 }
 
-void GLVideoLoopDrawable::deleteSource(VideoSource *source)
+void GLVideoLoopDrawable::seekVideo(int ms)
 {
-	VideoThread *vt = dynamic_cast<VideoThread*>(source);
-	if(vt)
-	{
-		qDebug() << "GLVideoLoopDrawable::deleteSource: Deleting video thread:" <<vt;
-		delete vt;
-		vt = 0;
-		source = 0;
-	}
-	else
+	if(!m_videoThread)
+		return;
+	
+	VideoThread *thread = m_videoThread->detachConsumer(this);
+	if(thread != m_videoThread)
 	{
-		qDebug() << "GLVideoLoopDrawable::deleteSource: Source not deleted because its not a 'VideoThread':" <<source;
+		//qDebug() << "GLVideoLoopDrawable::seekVideo: Split off from shared thread"<<m_videoThread<<"to"<<thread;
+		m_videoThread = thread;
+		setVideoSource(thread);
 	}
+	
+	m_videoThread->seek(ms);
 }
 
+void GLVideoLoopDrawable::pauseVideo()
+{
+	// Only pauses if no other drawable still wants the shared thread playing
+	if(m_videoThread && !liveStatus())
+		m_videoThread->setConsumerPlaying(this, false);
+}
 
 void GLVideoLoopDrawable::setLiveStatus(bool flag)
 {
@@ -95,7 +99,7 @@ void GLVideoLoopDrawable::setLiveStatus(bool flag)
 		{
 			if(m_videoThread)
 			{
-				m_videoThread->play();
+				m_videoThread->setConsumerPlaying(this, true);
 			}
 			else
 			{
@@ -112,7 +116,7 @@ void GLVideoLoopDrawable::setLiveStatus(bool flag)
 	{
 		if(m_videoThread)
 		{
-			QTimer::singleShot(xfadeLength(), m_videoThread, SLOT(pause())); 
+			QTimer::singleShot(xfadeLength(), this, SLOT(pauseVideo()));
 		}
 		else
 		{
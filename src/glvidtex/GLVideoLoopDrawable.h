@@ -23,10 +23,14 @@ signals:
 public slots:
 	bool setVideoFile(const QString&);
 	
+	/// Seeks to \a ms into the video. If other drawables share the same VideoThread, this drawable
+	/// gets a thread of its own first so they keep playing undisturbed.
+	void seekVideo(int ms);
+	
 private slots:
 	void testXfade();
 	
-	void deleteSource(VideoSource*);
+	void pauseVideo();
 	
 
 protected:
@@ -8,6 +8,7 @@
 #include <QtOpenGL>
 #include "GLWidget.h"
 #include "GLDrawable.h"
+#include "GLProfiler.h"
 
 #include <math.h>
 
@@ -291,6 +292,7 @@ GLWidget::GLWidget(QWidget *parent, QGLWidget *shareWidget)
 	, m_readbackFbo(0)
 	, m_firstPbo(false)
 	, m_backgroundColor(Qt::transparent) //Qt::black) 
+	, m_profilerOverlay(false)
 {
 
 	m_readbackSize = QSize(640,480);
@@ -1135,6 +1137,9 @@ void GLWidget::paintGL()
 		
 	//qDebug() << "GLWidget::paintGL(): Starting paint routines...";
 
+	GLProfiler::instance()->frameStarted();
+	GLProfilerScope frameScope("paintGL", "frame", this);
+
 	// Render all drawables into the FBO
 	//if(m_fbo)
 	//	m_fbo->bind();
@@ -1165,6 +1170,7 @@ void GLWidget::paintGL()
 		   drawable->rect().intersects(viewport))
 		   {
 			//qDebug() << "GLWidget::paintGL(): drawable:"<<((QObject*)drawable);
+			GLProfilerScope scope("paintGL", "paint", drawable);
 			drawable->paintGL();
 		   }
 // 		qDebug() << "GLWidget::paintGL(): drawable:"<<((void*)drawable)<<", draw done";
@@ -1919,12 +1925,46 @@ void GLWidget::paintGL()
 	}
 //
 	//QTimer::singleShot(0, this, SIGNAL(updated()));
+	
+	if(m_profilerOverlay)
+		drawProfilerOverlay();
+	
 	emit updated();
 
 	//qDebug() << "GLWidget::paintGL: elapsed:"<<time.elapsed()<<"ms";
 }
 
 
+void GLWidget::drawProfilerOverlay()
+{
+	// Drawn after the output stream readback, so it only ever shows up on screen
+	QPainter painter(this);
+	GLProfiler::instance()->drawOverlay(&painter, rect());
+	painter.end();
+	
+	// QPainter leaves its own GL state behind - put back what initializeGL() and resizeGL() set up
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	
+	glViewport(0, 0, width(), height());
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0, width(), height(), 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+}
+
+void GLWidget::setProfilerOverlay(bool flag)
+{
+	m_profilerOverlay = flag;
+	if(flag)
+		GLProfiler::instance()->setEnabled(true);
+	
+	updateGL();
+}
+
 void GLWidget::setFlipHorizontal(bool value)
 {
 	defaultSubview()->setFlipHorizontal(value);
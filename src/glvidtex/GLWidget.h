@@ -302,6 +302,9 @@ public:
 	bool fboEnabled() { return m_fboEnabled; }
 	
 	QColor backgroundColor() { return m_backgroundColor; }
+	
+	/// True if GLProfiler stats are drawn on top of the widget (only on screen, never in outputStream())
+	bool profilerOverlay() { return m_profilerOverlay; }
 
 signals:
 	void clicked();
@@ -353,6 +356,9 @@ public slots:
 	
 	void setBackgroundColor(QColor);
 	
+	/// Turning on the overlay also enables GLProfiler
+	void setProfilerOverlay(bool);
+	
 protected slots:
 	void zIndexChanged();
 	
@@ -378,6 +384,7 @@ protected:
 
 private:
 	void initShaders();
+	void drawProfilerOverlay();
 	//void initAlphaMask();
 	//void updateWarpMatrix();
 	
@@ -449,6 +456,8 @@ private:
 	
 	// default is black
 	QColor m_backgroundColor;
+	
+	bool m_profilerOverlay;
 };
 
 #endif
@@ -1,4 +1,5 @@
 #include "HistogramFilter.h"
+#include "ImageStats.h"
 
 HistogramFilter::HistogramFilter(QObject* parent)
 	: VideoFilter(parent)
@@ -8,7 +9,9 @@ HistogramFilter::HistogramFilter(QObject* parent)
 	, m_calcHsvStats(true)
 	, m_frameAccumEnabled(false)
 	, m_frameAccumNum(10) // just a guess
+	, m_frameAccum(FrameAccumulator::ExponentialAverage, 10)
 	, m_drawBorder(true)
+	, m_sampleStride(0)
 {
 	//setIsThreaded(true);
 }
@@ -42,11 +45,14 @@ void HistogramFilter::setCalcHsvStats(bool flag)
 void HistogramFilter::setFrameAccumEnabled(bool enab)
 {
 	m_frameAccumEnabled = enab;
+	if(!enab)
+		m_frameAccum.reset();
 }
 
 void HistogramFilter::setFrameAccumNum(int n)
 {
 	m_frameAccumNum = n;
+	m_frameAccum.setFrameCount(n);
 }
 
 void HistogramFilter::processFrame()
@@ -58,12 +64,16 @@ void HistogramFilter::processFrame()
 	QImage image = frameImage();
 	QImage histo = makeHistogram(image);
 	
-	VideoFrame *frame = new VideoFrame(histo,m_frame->holdTime());
-	
-	if(m_includeOriginalImage)
-		frame->setCaptureTime(m_frame->captureTime());
-	
-	enqueue(frame);
+	enqueueImage(histo);
+}
+
+QList<QImage::Format> HistogramFilter::acceptedFormats()
+{
+	// ImageStats and FrameAccumulator read all of these directly
+	return QList<QImage::Format>()
+		<< QImage::Format_RGB32
+		<< QImage::Format_ARGB32
+		<< QImage::Format_ARGB32_Premultiplied;
 }
 	
 void HistogramFilter::drawBarRect(QPainter *p, int min, int max, int avg, int startX, int startY, int w, int h)
@@ -102,126 +112,22 @@ QImage HistogramFilter::makeHistogram(const QImage& image)
 	//smallSize.scale(160,120,Qt::KeepAspectRatio);
 	
 	QImage origScaled = image;//.scaled(640,480).scaled(smallSize);
-	if(origScaled.format() != QImage::Format_RGB32)
-		origScaled = origScaled.convertToFormat(QImage::Format_RGB32);
 		
 	if(m_frameAccumEnabled)
-	{
-		m_frameAccum.enqueue(origScaled);
-		
-		if(m_frameAccum.size() >= m_frameAccumNum)
-			m_frameAccum.dequeue();
-		
-		QPainter p(&origScaled);
-		p.fillRect(origScaled.rect(), Qt::black);
-		
-		double opac = 1. / (double)m_frameAccum.size();
-		//qDebug() << "HistogramFilter::makeHistogram: [FRAME ACCUM] Queue Size: "<<m_frameAccum.size()<<", opac:"<<opac; 
-		
-		int counter = 0;
-		foreach(QImage img, m_frameAccum)
-		{
-			p.setOpacity(counter == 0 ? 1 : opac);
-			p.drawImage(0,0,img);
-			counter ++;
-		}
-	}
-	
-
+		origScaled = m_frameAccum.addFrame(origScaled);
 	
-	// Setup our list of color values and set to 0
-	int histo[7][256];
-	for(int c=0;c<7;c++)
-		for(int i=0;i<256;i++)
-			histo[c][i] = 0;
+	// Histograms and HSV min/max/avg for the whole frame - see ImageStats for the heavy lifting
+	int stride = m_sampleStride > 0 ? m_sampleStride : ImageStats::strideFor(origScaled.size(), HISTOGRAM_MAX_SAMPLES);
+	ImageStats stats = ImageStats::compute(origScaled, m_calcHsvStats || m_histoType == HSV, stride);
 	
-	QColor hsvConverter;
-	int h,s,v;
+	int (&histo)[ImageStats::ChannelCount][256] = stats.histogram;
 	
-	int hsvMin[3] = {255,255,255};
-	int hsvMax[3] = {0,0,0};
-	int hsvAvg[3] = {0,0,0};
-	int avgCounter = 0;
+	int hsvMin[3] = { stats.min[ImageStats::Hue], stats.min[ImageStats::Sat], stats.min[ImageStats::Val] };
+	int hsvMax[3] = { stats.max[ImageStats::Hue], stats.max[ImageStats::Sat], stats.max[ImageStats::Val] };
+	int hsvAvg[3] = { stats.avg[ImageStats::Hue], stats.avg[ImageStats::Sat], stats.avg[ImageStats::Val] };
 	
-	// Convert each pixel to grayscale and count the number of times each
-	// grayscale value appears in the image
-	int bytesPerLine = origScaled.bytesPerLine();
-	for(int y=0; y<smallSize.height(); y++)
-	{
-		const uchar *line = (const uchar*)origScaled.scanLine(y);
-		for(int x=0; x<bytesPerLine; x+=4)
-		{
-			
-// 			const uchar a = line[x];
-// 			const uchar r = x+1 >= bytesPerLine ? 0 : line[x+1];
-// 			const uchar g = x+2 >= bytesPerLine ? 0 : line[x+2];
-// 			const uchar b = x+3 >= bytesPerLine ? 0 : line[x+3];
-
-			// Docs say QImage::Format_RGB32 stores colors as 0xffRRGGBB - 
-			// - but when testing with a 4x1 image of (white,red,green,blue),
-			//   I find that the colors (on linux 32bit anyway) were stored BGRA...is that only linux or is that all Qt platforms with Format_RGB32?  
-			const uchar b = line[x];
-			const uchar g = x+1 >= bytesPerLine ? 0 : line[x+1];
-			const uchar r = x+2 >= bytesPerLine ? 0 : line[x+2];
-// 			const uchar a = x+3 >= bytesPerLine ? 0 : line[x+3];
-			if(r || g || b)
-			{
-				// These grayscale conversion values are just rough estimates based on my google research - adjust to suit your tastes
-				int gray = (int)( r * .30 + g * .59 + b * .11 );
-				//qDebug() << "val:"<<(int)val<<", r:"<<qRed(pixel)<<", g:"<<qGreen(pixel)<<", b:"<<qBlue(pixel)<<", gray:"<<gray;
-				//qDebug() << "r:"<<r<<", g:"<<g<<", b:"<<b<<", gray:"<<gray;
-				histo[0][gray] ++;
-				histo[1][r]++;
-				histo[2][g]++;
-				histo[3][b]++;
-				
-				if(m_calcHsvStats || m_histoType == HSV)
-				{
-					
-					hsvConverter.setRgb(r,g,b);
-					hsvConverter.getHsv(&h,&s,&v);
-					
-					/// HACK scale Hue to be between 0-256 instead of 0-265
-					h = (int) ( (((double)h)/359.)*255 );
-					
-					histo[4][h]++;
-					histo[5][s]++;
-					histo[6][v]++;
-					
-					if(h > hsvMax[0])
-						hsvMax[0] = h;
-					if(s > hsvMax[1])
-						hsvMax[1] = s;
-					if(v > hsvMax[2])
-						hsvMax[2] = v;
-					if(h && h < hsvMin[0])
-						hsvMin[0] = h;
-					if(s && s < hsvMin[1])
-						hsvMin[1] = s;
-					if(v && v < hsvMin[2])
-						hsvMin[2] = v;
-					
-					hsvAvg[0] += h;
-					hsvAvg[1] += s;
-					hsvAvg[2] += v;
-					
-					avgCounter ++;
-				}
-				
-				//qDebug() << "r:"<<r<<" \t g:"<<g<<" \t b:"<<b<<" \t gray:"<<gray<<", h:"<<h<<", s:"<<s<<", v:"<<v<<", x:"<<x<<",y:"<<y; 
-			} 
-		}
-	}
-	
-	//qDebug() << "avgCounter:"<<avgCounter;
 	if(m_calcHsvStats)
 	{
-		if(avgCounter == 0)
-			avgCounter = 1;
-		hsvAvg[0] /= avgCounter;
-		hsvAvg[1] /= avgCounter;
-		hsvAvg[2] /= avgCounter;
-		
 		emit hsvStatsUpdated(hsvMin[0],hsvMax[0],hsvAvg[0],hsvMin[1],hsvMax[1],hsvAvg[1],hsvMin[2],hsvMax[2],hsvAvg[2]);
 		
 // 		qDebug() << "HSV min/max/avg: " <<
@@ -3,6 +3,10 @@
 
 #include <QtGui>
 #include "VideoFilter.h"
+#include "FrameAccumulator.h"
+
+/// Max number of pixels sampled per frame when sampleStride() is automatic
+#define HISTOGRAM_MAX_SAMPLES (640*360)
 
 class HistogramFilter : public VideoFilter
 {
@@ -22,6 +26,10 @@ public:
 	bool frameAccumEnabled() { return m_frameAccumEnabled; }
 	int frameAccumNum() { return m_frameAccumNum; }
 	bool drawBorder() { return m_drawBorder; }
+	
+	/// Only every Nth pixel of every Nth row is sampled for the stats. 0 (the default) picks a stride automatically
+	/// so no more than HISTOGRAM_MAX_SAMPLES pixels are looked at.
+	int sampleStride() { return m_sampleStride; }
 
 public slots:
 	void setHistoType(HistoType type);
@@ -34,6 +42,8 @@ public slots:
 	void setFrameAccumNum(int);
 	
 	void setDrawBorder(bool flag) { m_drawBorder = flag; }
+	
+	void setSampleStride(int stride) { m_sampleStride = stride; }
 
 signals:
 	void hsvStatsUpdated(int hMin, int hMax, int hAvg, 
@@ -42,6 +52,7 @@ signals:
 		
 protected:
 	virtual void processFrame();
+	virtual QList<QImage::Format> acceptedFormats();
 	
 	QImage makeHistogram(const QImage& image);
 	
@@ -56,10 +67,11 @@ protected:
 	bool m_frameAccumEnabled;
 	int m_frameAccumNum;
 	
-	QQueue<QImage> m_frameAccum;
+	FrameAccumulator m_frameAccum;
 	
 	bool m_drawBorder;
 	
+	int m_sampleStride;
 	
 };
 
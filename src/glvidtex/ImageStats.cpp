@@ -0,0 +1,256 @@
+#include "ImageStats.h"
+
+#include <QThread>
+#include <QList>
+#include <QFuture>
+#include <QtConcurrentRun>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGESTATS_SSE2
+#endif
+
+// Integer luma weights (/256), approx. the .30/.59/.11 HistogramFilter always used
+#define LUMA_R 77
+#define LUMA_G 151
+#define LUMA_B 28
+
+// Lookup tables so the HSV conversion needs no divisions
+class ImageStatsTables
+{
+public:
+	ImageStatsTables()
+	{
+		satRecip[0] = 0;
+		hueRecip[0] = 0;
+		for(int i=1; i<256; i++)
+		{
+			// s = delta * 255 / max, h = diff * 60 / delta, both in 16.16 fixed point
+			satRecip[i] = (255 << 16) / i;
+			hueRecip[i] = (60 << 16) / i;
+		}
+
+		// Same scaling HistogramFilter always used to squeeze 0-359 into 0-255
+		for(int i=0; i<360; i++)
+			hueScale[i] = (int) ( (((double)i)/359.)*255 );
+	}
+
+	int satRecip[256];
+	int hueRecip[256];
+	int hueScale[360];
+};
+
+static ImageStatsTables tables;
+
+static inline void countPixel(ImageStats *stats, int r, int g, int b, int gray, bool calcHsv)
+{
+	stats->histogram[ImageStats::Luma][gray] ++;
+	stats->histogram[ImageStats::Red][r] ++;
+	stats->histogram[ImageStats::Green][g] ++;
+	stats->histogram[ImageStats::Blue][b] ++;
+	stats->pixelCount ++;
+
+	if(!calcHsv)
+		return;
+
+	int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+	int min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+	int delta = max - min;
+
+	int s = (delta * tables.satRecip[max] + (1 << 15)) >> 16;
+	int h = 0;
+	if(delta)
+	{
+		int deg =
+			max == r ?       ((g - b) * tables.hueRecip[delta]) >> 16 :
+			max == g ? 120 + (((b - r) * tables.hueRecip[delta]) >> 16) :
+			           240 + (((r - g) * tables.hueRecip[delta]) >> 16);
+		if(deg < 0)
+			deg += 360;
+		if(deg >= 360)
+			deg -= 360;
+		h = tables.hueScale[deg];
+	}
+
+	stats->histogram[ImageStats::Hue][h] ++;
+	stats->histogram[ImageStats::Sat][s > 255 ? 255 : s] ++;
+	stats->histogram[ImageStats::Val][max] ++;
+}
+
+ImageStats::ImageStats()
+{
+	clear();
+}
+
+void ImageStats::clear()
+{
+	memset(histogram, 0, sizeof(histogram));
+	for(int c=0; c<ChannelCount; c++)
+	{
+		min[c] = 255;
+		max[c] = 0;
+		avg[c] = 0;
+	}
+	pixelCount = 0;
+	hasHsv = false;
+}
+
+void ImageStats::add(const ImageStats& other)
+{
+	for(int c=0; c<ChannelCount; c++)
+		for(int i=0; i<256; i++)
+			histogram[c][i] += other.histogram[c][i];
+	pixelCount += other.pixelCount;
+}
+
+void ImageStats::finish()
+{
+	// min/max/avg fall straight out of the histograms, no need to track them per pixel
+	for(int c=0; c<ChannelCount; c++)
+	{
+		qint64 sum = 0;
+		min[c] = 255;
+		max[c] = 0;
+		for(int i=0; i<256; i++)
+		{
+			int count = histogram[c][i];
+			if(!count)
+				continue;
+			if(i && i < min[c])
+				min[c] = i;
+			if(i > max[c])
+				max[c] = i;
+			sum += ((qint64)i) * count;
+		}
+		avg[c] = pixelCount ? (int)(sum / pixelCount) : 0;
+	}
+}
+
+int ImageStats::strideFor(const QSize& size, int maxSamples)
+{
+	int stride = 1;
+	while(maxSamples > 0 &&
+	      (size.width() / stride) * (size.height() / stride) > maxSamples)
+		stride ++;
+	return stride;
+}
+
+void ImageStats::computeRows(const QImage *image, ImageStats *stats, bool calcHsv, int stride, int startRow, int endRow)
+{
+	const int width = image->width();
+
+	for(int y=startRow; y<endRow; y+=stride)
+	{
+		const uint *line = (const uint*)image->scanLine(y);
+		int x = 0;
+
+		#ifdef IMAGESTATS_SSE2
+		if(stride == 1)
+		{
+			// Unpack four pixels at a time and compute their luma in parallel, then bin them.
+			// All values stay below 2^16 in each 32bit lane, so 16bit multiplies are safe.
+			const __m128i mask  = _mm_set1_epi32(0xff);
+			const __m128i lumaR = _mm_set1_epi32(LUMA_R);
+			const __m128i lumaG = _mm_set1_epi32(LUMA_G);
+			const __m128i lumaB = _mm_set1_epi32(LUMA_B);
+			int r[4] __attribute__((aligned(16)));
+			int g[4] __attribute__((aligned(16)));
+			int b[4] __attribute__((aligned(16)));
+			int gray[4] __attribute__((aligned(16)));
+
+			for(; x+4 <= width; x+=4)
+			{
+				__m128i px = _mm_loadu_si128((const __m128i*)(line + x));
+				__m128i vb = _mm_and_si128(px, mask);
+				__m128i vg = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+				__m128i vr = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+
+				// Whole block black - nothing to count
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_or_si128(_mm_or_si128(vr, vg), vb), _mm_setzero_si128())) == 0xffff)
+					continue;
+
+				__m128i vgray = _mm_add_epi32(_mm_add_epi32(
+							_mm_mullo_epi16(vr, lumaR),
+							_mm_mullo_epi16(vg, lumaG)),
+							_mm_mullo_epi16(vb, lumaB));
+				vgray = _mm_srli_epi32(vgray, 8);
+
+				_mm_store_si128((__m128i*)r, vr);
+				_mm_store_si128((__m128i*)g, vg);
+				_mm_store_si128((__m128i*)b, vb);
+				_mm_store_si128((__m128i*)gray, vgray);
+
+				for(int i=0; i<4; i++)
+					if(r[i] || g[i] || b[i])
+						countPixel(stats, r[i], g[i], b[i], gray[i], calcHsv);
+			}
+		}
+		#endif
+
+		for(; x<width; x+=stride)
+		{
+			const uint pixel = line[x];
+			const int r = qRed(pixel);
+			const int g = qGreen(pixel);
+			const int b = qBlue(pixel);
+			if(r || g || b)
+				countPixel(stats, r, g, b, (r * LUMA_R + g * LUMA_G + b * LUMA_B) >> 8, calcHsv);
+		}
+	}
+}
+
+ImageStats ImageStats::compute(const QImage& sourceImage, bool calcHsv, int stride, int maxThreads)
+{
+	ImageStats stats;
+	if(sourceImage.isNull())
+		return stats;
+
+	QImage image = sourceImage;
+	if(image.format() != QImage::Format_RGB32 &&
+	   image.format() != QImage::Format_ARGB32 &&
+	   image.format() != QImage::Format_ARGB32_Premultiplied)
+		image = image.convertToFormat(QImage::Format_RGB32);
+
+	if(stride < 1)
+		stride = 1;
+
+	int threads = maxThreads > 0 ? maxThreads : QThread::idealThreadCount();
+	int samples = (image.width() / stride) * (image.height() / stride);
+	if(threads > samples / IMAGESTATS_MIN_PIXELS_PER_THREAD)
+		threads = samples / IMAGESTATS_MIN_PIXELS_PER_THREAD;
+
+	if(threads <= 1)
+	{
+		computeRows(&image, &stats, calcHsv, stride, 0, image.height());
+	}
+	else
+	{
+		// Split into bands of whole sampled rows, each band gets its own histograms which are merged at the end
+		int sampledRows = (image.height() + stride - 1) / stride;
+		int rowsPerBand = (sampledRows + threads - 1) / threads;
+
+		QList<ImageStats> partials;
+		for(int i=0; i<threads; i++)
+			partials << ImageStats();
+
+		QList< QFuture<void> > futures;
+		for(int i=0; i<threads; i++)
+		{
+			int startRow = i * rowsPerBand * stride;
+			int endRow   = qMin(image.height(), (i+1) * rowsPerBand * stride);
+			if(startRow >= endRow)
+				break;
+			futures << QtConcurrent::run(&ImageStats::computeRows, (const QImage*)&image, &partials[i], calcHsv, stride, startRow, endRow);
+		}
+
+		for(int i=0; i<futures.size(); i++)
+		{
+			futures[i].waitForFinished();
+			stats.add(partials[i]);
+		}
+	}
+
+	stats.hasHsv = calcHsv;
+	stats.finish();
+	return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef ImageStats_H
+#define ImageStats_H
+
+#include <QImage>
+
+/// Below this many (sampled) pixels, ImageStats::compute() doesn't bother splitting the work across threads
+#define IMAGESTATS_MIN_PIXELS_PER_THREAD (320*240)
+
+/// \class ImageStats
+/// Per-channel histograms and min/max/average for an image - luma, red, green, blue and (optionally) hue, saturation and value.
+///
+/// compute() converts pixels with integer math only (no QColor), using SSE2 where available, can sample every
+/// Nth row/column, and splits large frames into bands processed on the global QThreadPool.
+///
+/// As in HistogramFilter's original implementation, pure black pixels are ignored, hue is scaled to 0-255, and the min
+/// of a channel is the lowest non-zero value seen.
+class ImageStats
+{
+public:
+	enum Channel
+	{
+		Luma = 0,
+		Red,
+		Green,
+		Blue,
+		Hue,
+		Sat,
+		Val,
+
+		ChannelCount
+	};
+
+	ImageStats();
+	void clear();
+
+	/// Computes stats for \a image. If \a calcHsv is false, the Hue/Sat/Val channels are left empty.
+	/// \a stride samples every Nth pixel of every Nth row (1 = every pixel.)
+	/// \a maxThreads limits the number of bands the image is split into, 0 means QThread::idealThreadCount().
+	static ImageStats compute(const QImage& image, bool calcHsv = true, int stride = 1, int maxThreads = 0);
+
+	/// Returns a stride so that roughly no more than \a maxSamples pixels of \a size are sampled
+	static int strideFor(const QSize& size, int maxSamples);
+
+	int histogram[ChannelCount][256];
+	int min[ChannelCount];
+	int max[ChannelCount];
+	int avg[ChannelCount];
+
+	/// Number of (non-black) pixels counted
+	int pixelCount;
+	bool hasHsv;
+
+private:
+	void add(const ImageStats& other);
+	void finish();
+
+	static void computeRows(const QImage *image, ImageStats *stats, bool calcHsv, int stride, int startRow, int endRow);
+};
+
+#endif
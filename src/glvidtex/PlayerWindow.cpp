@@ -16,6 +16,8 @@
 #include "VideoSender.h"
 
 #include "GLSceneTypes.h"
+#include "SceneCapture.h"
+#include "GLProfiler.h"
 
 //#include "SharedMemorySender.h"
 #ifndef Q_OS_WIN
@@ -76,6 +78,8 @@ PlayerCompatOutputStream::PlayerCompatOutputStream(PlayerWindow *parent)
 	: VideoSource(parent)
 	, m_win(parent)
 	, m_fps(5)
+	, m_capture(0)
+	, m_lastFrameNumber(-1)
 {
  	setIsBuffered(false);
 	setImage(QImage("dot.gif"));
@@ -88,6 +92,12 @@ PlayerCompatOutputStream::PlayerCompatOutputStream(PlayerWindow *parent)
 	setAutoDestroy(false);
 }
 
+PlayerCompatOutputStream::~PlayerCompatOutputStream()
+{
+	if(m_capture)
+		m_capture->release();
+}
+
 void PlayerCompatOutputStream::consumerRegistered(QObject*)
 {
 	if(!m_frameReadyTimer.isActive())
@@ -112,19 +122,25 @@ void PlayerCompatOutputStream::setImage(QImage img)
 
 void PlayerCompatOutputStream::renderScene()
 {
-	QImage image(320,240,QImage::Format_ARGB32);
-	memset(image.scanLine(0),0,image.byteCount());
-	QPainter p(&image);
+	if(!m_win->graphicsScene())
+	{
+		qDebug() << "PlayerCompatOutputStream::renderScene: No graphics scene available, unable to render.";
+		return;
+	}
 
-	//qDebug() << "PlayerCompatOutputStream::renderScene(): Image size:"<<image.size();
+	if(!m_capture)
+		m_capture = SceneCapture::captureForScene(m_win->graphicsScene(), QSize(320,240));
 
+	// Only re-renders what changed in the scene - and if nothing did, there's no need to send a new frame
+	QImage image = m_capture->frame();
+	if(m_capture->frameNumber() == m_lastFrameNumber)
+		return;
 
-	if(m_win->graphicsScene())
-		m_win->graphicsScene()->render(&p);
-	else
-		qDebug() << "PlayerCompatOutputStream::renderScene: No graphics scene available, unable to render.";
+	m_lastFrameNumber = m_capture->frameNumber();
+
+	//qDebug() << "PlayerCompatOutputStream::renderScene(): Image size:"<<image.size();
 
-	p.end();
+	image = image.convertToFormat(QImage::Format_ARGB32);
 
 // 	qDebug() << "PlayerCompatOutputStream::renderScene: Image size:"<<image.size();
 // 	image.save("comapt.jpg");
@@ -310,6 +326,17 @@ void PlayerWindow::loadConfig(const QString& configFile, bool verbose)
 			else
 				m_glWidget->setAlphaMask(alphamask);
 		}
+		
+		// Profiling - overlay on screen and/or a Chrome trace (chrome://tracing) written on exit
+		QString traceFile = READ_STRING("profiler-trace","");
+		if(!traceFile.isEmpty())
+		{
+			GLProfiler::instance()->setEnabled(true);
+			GLProfiler::instance()->setTraceFile(traceFile);
+		}
+		
+		GLProfiler::instance()->setRefreshRate(READ_STRING("refresh-rate","60").toDouble());
+		m_glWidget->setProfilerOverlay(READ_STRING("profiler-overlay","false") == "true");
 	}
 
 	m_validUser = READ_STRING("user","player");
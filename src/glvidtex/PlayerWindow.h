@@ -22,6 +22,7 @@ class GLPlaylistItem;
 class GLRectDrawable;
 class GLDrawable;
 class SharedMemorySender;
+class SceneCapture;
 class V4LOutput;
 class GLWidgetSubview;
 
@@ -38,7 +39,7 @@ protected:
 	PlayerCompatOutputStream(PlayerWindow *parent=0);
 
 public:
-	//virtual ~StaticVideoSource() {}
+	virtual ~PlayerCompatOutputStream();
 
 	VideoFormat videoFormat() { return VideoFormat(VideoFrame::BUFFER_IMAGE,QVideoFrame::Format_ARGB32); }
 	//VideoFormat videoFormat() { return VideoFormat(VideoFrame::BUFFER_BYTEARRAY,QVideoFrame::Format_ARGB32); }
@@ -65,6 +66,9 @@ private:
 	QImage m_image;
 	int m_fps;
 	QTimer m_frameReadyTimer;
+	
+	SceneCapture *m_capture;
+	int m_lastFrameNumber;
 };
 
 
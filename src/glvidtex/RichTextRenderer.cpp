@@ -1,5 +1,6 @@
 #include "RichTextRenderer.h"
 #include "../ImageFilters.h"
+#include "GLProfiler.h"
 
 QCache<QString,double> RichTextRenderer::static_autoTextSizeCache;
 
@@ -314,6 +315,8 @@ void RichTextRenderer::update()
 
 QImage RichTextRenderer::renderText()
 {
+	GLProfilerScope scope("renderText", "text", this);
+	
 // 	qDebug()<<itemName()<<"TextBoxWarmingThread::run(): htmlCode:"<<htmlCode;
 	//qDebug() << "RichTextRenderer::renderText(): HTML:"<<html();
 	//qDebug() << "RichTextRenderer::update(): Update Start...";
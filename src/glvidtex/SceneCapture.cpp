@@ -0,0 +1,204 @@
+#include "SceneCapture.h"
+
+#include <QPainter>
+#include <QDebug>
+
+// If the dirty region is made of more rects than this, just render its bounding rect
+#define MAX_DIRTY_RECTS 8
+
+// If the dirty bounding rect covers more than this much of the frame, render the whole frame in one pass
+#define FULL_REPAINT_RATIO 0.6
+
+QList<SceneCapture*> SceneCapture::m_captureList;
+
+SceneCapture *SceneCapture::captureForScene(QGraphicsScene *scene, const QSize& frameSize)
+{
+	if(!scene || frameSize.isEmpty())
+		return 0;
+
+	foreach(SceneCapture *capture, m_captureList)
+	{
+		if(capture->m_scene == scene &&
+		   capture->m_frameSize == frameSize)
+		{
+			capture->m_refCount ++;
+			//qDebug() << "SceneCapture::captureForScene(): "<<scene<<frameSize<<": [CACHE HIT] refs:"<<capture->m_refCount;
+			return capture;
+		}
+	}
+
+	SceneCapture *capture = new SceneCapture(scene, frameSize);
+	m_captureList << capture;
+	//qDebug() << "SceneCapture::captureForScene(): "<<scene<<frameSize<<": [CACHE MISS]";
+	return capture;
+}
+
+SceneCapture::SceneCapture(QGraphicsScene *scene, const QSize& frameSize)
+	: QObject()
+	, m_refCount(1)
+	, m_scene(scene)
+	, m_frameSize(frameSize)
+	, m_fullRepaint(true)
+	, m_frameNumber(0)
+{
+	connect(m_scene, SIGNAL(changed(const QList<QRectF>&)), this, SLOT(sceneChanged(const QList<QRectF>&)));
+	connect(m_scene, SIGNAL(sceneRectChanged(const QRectF&)), this, SLOT(invalidate()));
+	connect(m_scene, SIGNAL(destroyed()), this, SLOT(sceneDestroyed()));
+}
+
+SceneCapture::~SceneCapture()
+{
+	m_captureList.removeAll(this);
+}
+
+void SceneCapture::release()
+{
+	m_refCount --;
+	if(m_refCount <= 0)
+	{
+		m_captureList.removeAll(this);
+		deleteLater();
+	}
+}
+
+void SceneCapture::sceneDestroyed()
+{
+	// Keep serving the last frame until our users release us, but don't hand us out for a new scene at the same address
+	m_scene = 0;
+	m_captureList.removeAll(this);
+}
+
+void SceneCapture::setSourceRect(const QRectF& rect)
+{
+	if(m_sourceRect == rect)
+		return;
+
+	m_sourceRect = rect;
+	m_fullRepaint = true;
+}
+
+void SceneCapture::invalidate()
+{
+	m_fullRepaint = true;
+}
+
+bool SceneCapture::hasChangedSince(int frameNumber)
+{
+	return m_frameNumber != frameNumber ||
+	       m_fullRepaint ||
+	       !m_dirtyRegion.isEmpty();
+}
+
+void SceneCapture::updateRects(const QRectF& sourceRect)
+{
+	m_renderedSourceRect = sourceRect;
+
+	QRect targetFrame(QPoint(0,0), m_frameSize);
+	QSize nativeSize = sourceRect.size().toSize();
+	nativeSize.scale(targetFrame.size(), Qt::KeepAspectRatio);
+
+	m_targetRect = QRect(0, 0, nativeSize.width(), nativeSize.height());
+	m_targetRect.moveCenter(targetFrame.center());
+
+	// Same mapping QGraphicsScene::render() uses for target/source, so partial renders line up exactly with a full render
+	m_sceneToImage = QTransform()
+		.translate(m_targetRect.left(), m_targetRect.top())
+		.scale(m_targetRect.width()  / sourceRect.width(),
+		       m_targetRect.height() / sourceRect.height())
+		.translate(-sourceRect.left(), -sourceRect.top());
+
+	m_imageToScene = m_sceneToImage.inverted();
+}
+
+void SceneCapture::sceneChanged(const QList<QRectF>& rects)
+{
+	if(m_fullRepaint)
+		return;
+
+	QRect frameRect(QPoint(0,0), m_frameSize);
+	foreach(QRectF rect, rects)
+	{
+		// Pad by a pixel so scaled/antialiased edges don't leave trails
+		QRect mapped = m_sceneToImage.mapRect(rect).toAlignedRect().adjusted(-1,-1,1,1);
+		m_dirtyRegion += mapped & frameRect;
+	}
+}
+
+QImage SceneCapture::frame()
+{
+	if(!m_scene)
+		return m_backBuffer;
+
+	QRectF sourceRect = m_sourceRect.isValid() ? m_sourceRect : m_scene->sceneRect();
+	if(!sourceRect.isValid())
+		return m_backBuffer;
+
+	if(m_backBuffer.isNull())
+	{
+		m_backBuffer = QImage(m_frameSize, QImage::Format_ARGB32_Premultiplied);
+		m_fullRepaint = true;
+	}
+
+	if(sourceRect != m_renderedSourceRect)
+	{
+		updateRects(sourceRect);
+		m_fullRepaint = true;
+	}
+
+	if(!m_fullRepaint && m_dirtyRegion.isEmpty())
+		return m_backBuffer;
+
+	QVector<QRect> rects;
+	if(m_fullRepaint)
+	{
+		rects << m_backBuffer.rect();
+	}
+	else
+	{
+		QRect bounds = m_dirtyRegion.boundingRect();
+		rects = m_dirtyRegion.rects();
+
+		if(rects.size() > MAX_DIRTY_RECTS ||
+		   bounds.width() * bounds.height() > m_frameSize.width() * m_frameSize.height() * FULL_REPAINT_RATIO)
+			rects = QVector<QRect>() << bounds;
+	}
+
+	//qDebug() << "SceneCapture::frame(): Rendering "<<rects.size()<<" rects, full repaint:"<<m_fullRepaint;
+
+	QPainter painter(&m_backBuffer);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+	painter.setRenderHint(QPainter::Antialiasing, false);
+	painter.setRenderHint(QPainter::TextAntialiasing, false);
+
+	foreach(QRect rect, rects)
+	{
+		rect &= m_backBuffer.rect();
+		if(rect.isEmpty())
+			continue;
+
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.fillRect(rect, Qt::transparent);
+		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+		QRect target = rect & m_targetRect;
+		if(target.isEmpty())
+			continue;
+
+		// Rendering just the source rect under the dirty rect means the scene only has to paint the items in it
+		painter.save();
+		painter.setClipRect(target);
+		m_scene->render(&painter,
+			target,
+			m_imageToScene.mapRect(QRectF(target)),
+			Qt::IgnoreAspectRatio);
+		painter.restore();
+	}
+
+	painter.end();
+
+	m_dirtyRegion = QRegion();
+	m_fullRepaint = false;
+	m_frameNumber ++;
+
+	return m_backBuffer;
+}
@@ -0,0 +1,83 @@
+#ifndef SceneCapture_H
+#define SceneCapture_H
+
+#include <QObject>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QRegion>
+#include <QTransform>
+
+/// \class SceneCapture
+/// Keeps a persistent rendering of a QGraphicsScene, shared by every output that wants frames of that scene at the same size
+/// (JpegServer, SharedMemoryImageWriter, PlayerCompatOutputStream, ...)
+///
+/// Instead of rendering the whole scene into a fresh image for every frame, SceneCapture listens to QGraphicsScene::changed()
+/// and only re-renders the dirty regions into its back buffer when frame() is called. frameNumber() only changes
+/// when something was actually re-rendered, so consumers can skip encoding/sending frames that didn't change.
+///
+/// The scene is letterboxed into frameSize() (keeping the aspect ratio of sourceRect()), the rest of the frame is transparent.
+/// Frames are QImage::Format_ARGB32_Premultiplied.
+class SceneCapture : public QObject
+{
+	Q_OBJECT
+public:
+	/// Returns the shared capture for \a scene at \a frameSize, creating it if needed.
+	/// Every call must be matched by a call to release().
+	static SceneCapture *captureForScene(QGraphicsScene *scene, const QSize& frameSize);
+	/// Releases the reference from captureForScene(). The capture is deleted when the last reference is released.
+	void release();
+
+	QGraphicsScene *scene() { return m_scene; }
+	QSize frameSize() { return m_frameSize; }
+
+	/// The area of the scene to capture. If not set, QGraphicsScene::sceneRect() is used.
+	/// Note this is shared by all users of the capture.
+	QRectF sourceRect() { return m_sourceRect; }
+	void setSourceRect(const QRectF&);
+
+	/// Re-renders whatever changed since the last call and returns the frame.
+	/// The image is implicitly shared, so holding on to it is cheap until the next change.
+	QImage frame();
+
+	/// Increments each time frame() re-renders something. Compare against the value from the last frame()
+	/// to find out if the frame changed.
+	int frameNumber() { return m_frameNumber; }
+
+	/// Returns true if the scene changed since frame() returned \a frameNumber.
+	/// Does not render anything.
+	bool hasChangedSince(int frameNumber);
+
+public slots:
+	/// Forces the next frame() to re-render the entire scene
+	void invalidate();
+
+private slots:
+	void sceneChanged(const QList<QRectF>&);
+	void sceneDestroyed();
+
+private:
+	SceneCapture(QGraphicsScene *scene, const QSize& frameSize);
+	~SceneCapture();
+
+	void updateRects(const QRectF& sourceRect);
+
+	static QList<SceneCapture*> m_captureList;
+	int m_refCount;
+
+	QGraphicsScene *m_scene;
+	QSize m_frameSize;
+
+	QRectF m_sourceRect;
+	QRectF m_renderedSourceRect;
+	QRect m_targetRect;
+	QTransform m_sceneToImage;
+	QTransform m_imageToScene;
+
+	QImage m_backBuffer;
+	QRegion m_dirtyRegion;
+	bool m_fullRepaint;
+
+	int m_frameNumber;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SchedulerTest_H
+#define SchedulerTest_H
+
+#include <QObject>
+#include <QCoreApplication>
+#include <stdio.h>
+
+#include "GLScheduler.h"
+
+/// \class SchedulerTest
+/// Checks GLScheduler corner cases that playlists depend on - run via the 'schedulertest' target,
+/// exits with 0 if everything passed
+class SchedulerTest : public QObject
+{
+	Q_OBJECT
+public:
+	SchedulerTest()
+		: m_cancelId(-1)
+		, m_cancelledFired(false)
+		, m_cancellerFired(false)
+		, m_failures(0)
+	{}
+
+	int failures() { return m_failures; }
+
+public slots:
+	void start()
+	{
+		GLScheduler *scheduler = GLScheduler::instance();
+
+		// Two events a few ms apart in the same wheel tick, a few ticks from now, so both come due in one wheelTick()
+		qint64 base = (scheduler->clock() / GLSCHEDULER_TICK_MS + 5) * GLSCHEDULER_TICK_MS;
+		scheduler->schedule(base + 1, this, "cancellerDue");
+		m_cancelId = scheduler->schedule(base + 8, this, "cancelledDue");
+
+		scheduler->scheduleIn(GLSCHEDULER_TICK_MS * 20, this, "finish");
+	}
+
+	void cancellerDue()
+	{
+		m_cancellerFired = true;
+		GLScheduler::instance()->cancel(m_cancelId);
+	}
+
+	void cancelledDue()
+	{
+		m_cancelledFired = true;
+	}
+
+	void finish()
+	{
+		check(m_cancellerFired, "first event in the tick fired");
+		check(!m_cancelledFired, "event cancelled by a handler in the same tick didn't fire");
+		check(GLScheduler::instance()->nextEvent(this).id < 0, "nothing left scheduled");
+		QCoreApplication::exit(m_failures);
+	}
+
+private:
+	void check(bool ok, const char *what)
+	{
+		printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+		if(!ok)
+			m_failures ++;
+	}
+
+	int m_cancelId;
+	bool m_cancelledFired;
+	bool m_cancellerFired;
+	int m_failures;
+};
+
+#endif
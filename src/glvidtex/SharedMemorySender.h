@@ -4,18 +4,17 @@
 #include <QtGui>
 
 #include "../livemix/VideoFrame.h"
+#include "../livemix/SharedMemoryRing.h"
 #include "VideoConsumer.h"
 
-#define FRAME_WIDTH  1024
-#define FRAME_HEIGHT 768
-#define FRAME_FORMAT QImage::Format_ARGB32
-
+/// Publishes frames from a VideoSource into a SharedMemoryRing for other processes (e.g. glstreamenc) to read with DVizSharedMemoryThread.
+/// Frames are written at their native size and pixel format, unless larger than \a maxFrameSize.
 class SharedMemorySender : public QObject, 
 			   public VideoConsumer
 {
 	Q_OBJECT
 public:
-	SharedMemorySender(QString key = "SharedMemorySender-1.0", QObject *parent=0);
+	SharedMemorySender(QString key = "SharedMemorySender-1.0", QObject *parent=0, const QSize& maxFrameSize = QSize(SHMEM_RING_MAX_WIDTH, SHMEM_RING_MAX_HEIGHT));
 	~SharedMemorySender();
 	
 	void setVideoSource(VideoSource *source);
@@ -28,8 +27,7 @@ private slots:
 	void processFrame();
 	
 private:
-	QSharedMemory m_sharedMemory;
-	int m_memorySize;
+	SharedMemoryRingWriter m_ring;
 	
 	//QImage m_image;
 	
@@ -1,44 +1,103 @@
-
-
 #include "StreamEncoderProcess.h"
 #include "../livemix/DVizSharedMemoryThread.h"
 #include "VideoEncoder.h"
+#include "VideoScaleFilter.h"
 
-StreamEncoderProcess::StreamEncoderProcess(QObject *parent)
+StreamEncoderProcess::StreamEncoderProcess(const QString& configFile, bool verbose, QObject *parent)
 	: QObject(parent)
+	, m_shMemRec(0)
 {
-	m_shMemRec = DVizSharedMemoryThread::threadForKey("PlayerWindow-2");
-	
-	QString outputFile = "test-output/output.avi";
-	
-// 	QFileInfo info(outputFile);
-// 	if(info.exists())
-// 	{
-// 		int counter = 1;
-// 		QString newFile;
-// 		while(QFileInfo(newFile = QString("%1-%2.%3")
-// 			.arg(info.baseName())
-// 			.arg(counter)
-// 			.arg(info.completeSuffix()))
-// 			.exists())
-// 			
-// 			counter++;
-// 		
-// 		qDebug() << "StreamEncoderProcess: Video output file"<<outputFile<<"exists, writing to"<<newFile<<"instead.";
-// 		outputFile = newFile;
-// 	}
-
-	
-	/*m_encoder = new VideoEncoder(outputFile);
-	m_encoder->setVideoSource(m_shMemRec);
-	m_encoder->startEncoder();*/ 
+	loadConfig(configFile, verbose);
 };
 
 StreamEncoderProcess::~StreamEncoderProcess()
 {
-	if(m_encoder)
+	// Encoders write out whatever they still have queued before they're gone
+	qDeleteAll(m_encoders);
+	m_encoders.clear();
+	
+	qDeleteAll(m_scalers);
+	m_scalers.clear();
+}
+
+void StreamEncoderProcess::loadConfig(const QString& configFile, bool verbose)
+{
+	if(verbose)
+		qDebug() << "StreamEncoderProcess: Reading settings from "<<configFile;
+	
+	QSettings settings(configFile,QSettings::IniFormat);
+	
+	QString key = settings.value("source","PlayerWindow-2").toString();
+	m_shMemRec = DVizSharedMemoryThread::threadForKey(key);
+	
+	// Every scaler (and every encoder fed straight from the feed) must see every frame,
+	// so don't let one consumer dequeue frames out from under the others
+	m_shMemRec->setIsBuffered(false);
+	
+	QStringList outputs = settings.value("outputs").toStringList();
+	if(outputs.isEmpty())
 	{
-		delete m_encoder;
-		m_encoder = 0;
+		qDebug() << "StreamEncoderProcess: No outputs listed in"<<configFile<<", writing to test-output/output.avi";
+		addOutput("test-output/output.avi", QSize(1024,768), 2000000, "", 0);
+		return;
 	}
+	
+	foreach(QString output, outputs)
+	{
+		settings.beginGroup(output);
+		
+		QString file = settings.value("file", QString("%1.avi").arg(output)).toString();
+		
+		QStringList parts = settings.value("size","1024x768").toString().split("x");
+		QSize size(parts[0].toInt(), parts.size() > 1 ? parts[1].toInt() : 0);
+		
+		// Given in kbit/s in the config
+		int bitrate = settings.value("bitrate", 2000).toInt() * 1000;
+		
+		QString format = settings.value("format").toString();
+		int segmentLength = settings.value("segment-minutes", 0).toInt();
+		
+		settings.endGroup();
+		
+		if(verbose)
+			qDebug() << "StreamEncoderProcess: Output"<<output<<": file:"<<file<<", size:"<<size<<", bitrate:"<<bitrate<<", format:"<<format<<", segment minutes:"<<segmentLength;
+		
+		if(!size.isValid() || size.isEmpty())
+		{
+			qDebug() << "StreamEncoderProcess: Invalid size for output"<<output<<", skipping.";
+			continue;
+		}
+		
+		addOutput(file, size, bitrate, format, segmentLength);
+	}
+}
+
+void StreamEncoderProcess::addOutput(const QString& file, const QSize& size, int bitrate, const QString& format, int segmentLength)
+{
+	QDir().mkpath(QFileInfo(file).absolutePath());
+	
+	VideoEncoder *encoder = new VideoEncoder(file);
+	encoder->setVideoSize(size);
+	encoder->setVideoBitrate(bitrate);
+	encoder->setFormatName(format);
+	encoder->setSegmentLength(segmentLength);
+	encoder->setVideoSource(sourceForSize(size));
+	encoder->startEncoder();
+	
+	m_encoders << encoder;
+}
+
+VideoSource *StreamEncoderProcess::sourceForSize(const QSize& size)
+{
+	foreach(VideoScaleFilter *scaler, m_scalers)
+		if(scaler->targetSize() == size)
+			return scaler;
+	
+	// Frames already at the target size go through the scaler untouched, so every output can just use one
+	VideoScaleFilter *scaler = new VideoScaleFilter(size);
+	scaler->setIsBuffered(false);
+	scaler->setVideoSource(m_shMemRec);
+	
+	m_scalers << scaler;
+	return scaler;
 }
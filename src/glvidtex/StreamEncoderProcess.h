@@ -5,18 +5,37 @@
 
 class DVizSharedMemoryThread;
 class VideoEncoder;
+class VideoScaleFilter;
+class VideoSource;
 
+/// \class StreamEncoderProcess
+/// Encodes the program output of glplayer (received via shared memory) to any number of outputs at once,
+/// e.g. a full quality archive file and a low bitrate confidence monitor stream.
+///
+/// The shared memory feed is read once, scaled once for each distinct output size (see VideoScaleFilter),
+/// and each output is encoded by its own VideoEncoder thread. Outputs are configured in an INI file - see streamenc.ini.
 class StreamEncoderProcess : public QObject
 {
 	Q_OBJECT
 public:
-	StreamEncoderProcess(QObject *parent=0);
+	StreamEncoderProcess(const QString& configFile = "streamenc.ini", bool verbose = false, QObject *parent=0);
 	~StreamEncoderProcess();
+	
+	QList<VideoEncoder*> encoders() { return m_encoders; }
 
 private:
+	void loadConfig(const QString& configFile, bool verbose);
+	void addOutput(const QString& file, const QSize& size, int bitrate, const QString& format, int segmentLength);
+	
+	// Returns the scaler for \a size, creating it if needed
+	VideoSource *sourceForSize(const QSize& size);
+	
 	DVizSharedMemoryThread *m_shMemRec;
-	VideoEncoder *m_encoder;	
+	QList<VideoScaleFilter*> m_scalers;
+	QList<VideoEncoder*> m_encoders;
 
 };
 
 #endif
+
+
@@ -125,6 +125,12 @@ void V4LOutput::setVideoSource(VideoSource *source)
 	m_source = source;
 	if(m_source)
 	{	
+		// RGB only - registering makes sure the source doesn't switch to handing out YUV frames
+		m_source->setAcceptedFormats(this, QList<QVideoFrame::PixelFormat>()
+			<< QVideoFrame::Format_RGB32
+			<< QVideoFrame::Format_ARGB32);
+		m_source->registerConsumer(this);
+		
 		connect(m_source, SIGNAL(frameReady()), this, SLOT(frameReady()));
 		connect(m_source, SIGNAL(destroyed()), this, SLOT(disconnectVideoSource()));
 		
@@ -145,6 +151,9 @@ void V4LOutput::disconnectVideoSource()
 	if(!m_source)
 		return;
 	disconnect(m_source, 0, this, 0);
+	// Not if the source is being deleted - it's only a QObject by the time destroyed() is emitted
+	if(sender() != m_source)
+		m_source->release(this);
 	m_source = 0;
 }
 
@@ -13,6 +13,8 @@ VideoDifferenceFilter::VideoDifferenceFilter(QObject *parent)
 	, m_filterType(FrameToFirstFrame)
 	//, m_outputType(BinarySmoothed)
 	, m_outputType(BackgroundReplace)
+	, m_frameAccum(FrameAccumulator::ExponentialAverage, 5)
+	, m_firstFrameAccum(FrameAccumulator::WindowAverage, 3)
 	, m_frameCount(0)
 {
 	m_newBackground = QImage("Pm5544.jpg");
@@ -26,11 +28,14 @@ VideoDifferenceFilter::~VideoDifferenceFilter()
 void VideoDifferenceFilter::setFrameAccumEnabled(bool enab)
 {
 	m_frameAccumEnabled = enab;
+	if(!enab)
+		m_frameAccum.reset();
 }
 
 void VideoDifferenceFilter::setFrameAccumNum(int n)
 {
 	m_frameAccumNum = n;
+	m_frameAccum.setFrameCount(n);
 }
 
 void VideoDifferenceFilter::setThreshold(int x)
@@ -63,12 +68,7 @@ void VideoDifferenceFilter::processFrame()
 	QImage image = frameImage();	
 	QImage histo = createDifferenceImage(image);
 	
-	VideoFrame *frame = new VideoFrame(histo,m_frame->holdTime());
-	
-	if(m_includeOriginalImage)
-		frame->setCaptureTime(m_frame->captureTime());
-	
-	enqueue(frame);
+	enqueueImage(histo);
 }
 
 // QImage IplImageToQImage(IplImage *iplImg)
@@ -278,24 +278,7 @@ QImage VideoDifferenceFilter::createDifferenceImage(QImage image)
 	
 	if(m_frameAccumEnabled)
 	{
-		m_frameAccum.enqueue(origScaled);
-		
-		if(m_frameAccum.size() >= m_frameAccumNum)
-			m_frameAccum.dequeue();
-		
-		QPainter p(&origScaled);
-		p.fillRect(origScaled.rect(), Qt::black);
-		
-		double opac = 1. / (double)m_frameAccum.size();
-		//qDebug() << "HistogramFilter::makeHistogram: [FRAME ACCUM] Queue Size: "<<m_frameAccum.size()<<", opac:"<<opac; 
-		
-		int counter = 0;
-		foreach(QImage img, m_frameAccum)
-		{
-			p.setOpacity(counter == 0 ? 1 : opac);
-			p.drawImage(0,0,img);
-			counter ++;
-		}
+		origScaled = m_frameAccum.addFrame(origScaled);
 	}
 	else
 	{
@@ -319,27 +302,8 @@ QImage VideoDifferenceFilter::createDifferenceImage(QImage image)
 	else
 	if(m_filterType == FrameToFirstFrame)
 	{
-		if(m_firstImage.isNull())
-			m_firstImage = QImage(origScaled.size(), origScaled.format());
-			
-		if(m_firstFrameAccum.size() < 3)
-		{
-			m_firstFrameAccum.enqueue(origScaled);
-			
-			QPainter p(&m_firstImage);
-			p.fillRect(m_lastImage.rect(), Qt::black);
-			
-			double opac = 1. / (double)m_firstFrameAccum.size();
-			//qDebug() << "HistogramFilter::makeHistogram: [FRAME ACCUM] Queue Size: "<<m_firstFrameAccum.size()<<", opac:"<<opac; 
-			
-			int counter = 0;
-			foreach(QImage img, m_firstFrameAccum)
-			{
-				p.setOpacity(counter == 0 ? 1 : opac);
-				p.drawImage(0,0,img);
-				counter ++;
-			}
-		}
+		if(m_firstFrameAccum.accumulated() < m_firstFrameAccum.frameCount())
+			m_firstImage = m_firstFrameAccum.addFrame(origScaled);
 		
 		baseFrame = m_firstImage;
 	}
@@ -3,6 +3,7 @@
 
 #include <QtGui>
 #include "VideoFilter.h"
+#include "FrameAccumulator.h"
 
 class VideoDifferenceFilter : public VideoFilter
 {
@@ -61,9 +62,10 @@ protected:
 	
 	OutputType m_outputType;
 	
-	QQueue<QImage> m_frameAccum;
+	FrameAccumulator m_frameAccum;
 	
-	QQueue<QImage> m_firstFrameAccum;
+	// Averages the first few frames into m_firstImage for FrameToFirstFrame
+	FrameAccumulator m_firstFrameAccum;
 	
 	int m_frameCount;
 };
@@ -14,6 +14,9 @@
 
 #include "VideoEncoder.h"
 
+#include <QFileInfo>
+#include <QDir>
+
 /**************************************************************/
 /* audio output */
 
@@ -132,13 +135,18 @@ void VideoEncoder::writeAudioFrame(AVFormatContext *oc, AVStream *st)
 
 	c = st->codec;
 
-	getDummyAudioFrame(m_audioData.samples, m_audioData.audio_input_frame_size, c->channels);
+	// Nothing feeds us audio yet, so the audio track is silence - getDummyAudioFrame() would give a test tone
+	//getDummyAudioFrame(m_audioData.samples, m_audioData.audio_input_frame_size, c->channels);
+	memset(m_audioData.samples, 0, m_audioData.audio_input_frame_size * 2 * c->channels);
 
 	pkt.size = avcodec_encode_audio(c, m_audioData.audio_outbuf, m_audioData.audio_outbuf_size, m_audioData.samples);
 
-	if (c->coded_frame &&
-	    c->coded_frame->pts != (int)AV_NOPTS_VALUE)
-		pkt.pts = av_rescale_q(c->coded_frame->pts, c->time_base, st->time_base);
+	// Audio pts counts samples, so it lines up with the video timestamps no matter what the codec does
+	AVRational sampleTimeBase;
+	sampleTimeBase.num = 1;
+	sampleTimeBase.den = c->sample_rate;
+	pkt.pts = av_rescale_q(m_audioSamples, sampleTimeBase, st->time_base);
+	m_audioSamples += m_audioData.audio_input_frame_size;
 
 	pkt.flags |= AV_PKT_FLAG_KEY;
 	pkt.stream_index = st->index;
@@ -152,6 +160,16 @@ void VideoEncoder::writeAudioFrame(AVFormatContext *oc, AVStream *st)
 	}
 }
 
+void VideoEncoder::writeAudioUntil(AVFormatContext *oc, AVStream *st, int timestamp)
+{
+	if(!st)
+		return;
+
+	AVCodecContext *c = st->codec;
+	while(m_audioSamples * 1000 / c->sample_rate < timestamp)
+		writeAudioFrame(oc, st);
+}
+
 void VideoEncoder::closeAudio(AVFormatContext */*oc*/, AVStream *st)
 {
 	avcodec_close(st->codec);
@@ -182,12 +200,12 @@ AVStream *VideoEncoder::addVideoStream(AVFormatContext *oc, enum CodecID codec_i
 	c->codec_type = CODEC_TYPE_VIDEO;
 
 	/* put sample parameters */
-	c->bit_rate = 2000000;
+	c->bit_rate = m_videoBitrate;
 	//c->bit_rate = 2000000;
 
 	/* resolution must be a multiple of two */
-	c->width  = 1024;
-	c->height = 768;
+	c->width  = m_videoSize.width()  & ~1;
+	c->height = m_videoSize.height() & ~1;
 
 	/* time base: this is the fundamental unit of time (in seconds) in terms
 	   of which frame timestamps are represented. for fixed-fps content,
@@ -282,19 +300,8 @@ void VideoEncoder::openVideo(AVFormatContext *oc, AVStream *st)
 		exit(1);
 	}
 
-	/* if the output format is not YUV420P, then a temporary YUV420P
-	   picture is needed too. It is then converted to the required
-	   output format */
+	// Frames are converted and scaled straight into m_videoData.picture by sws_scale() in fillAvPicture()
 	m_videoData.tmp_picture = NULL;
-	if (c->pix_fmt != NATIVE_PIX_FMT)
-	{
-		m_videoData.tmp_picture = allocPicture(NATIVE_PIX_FMT, c->width, c->height);
-		if (!m_videoData.tmp_picture)
-		{
-			fprintf(stderr, "VideoEncoder::openVideo: Could not allocate temporary picture\n");
-			exit(1);
-		}
-	}
 }
 
 /* prepare a dummy image */
@@ -324,70 +331,133 @@ void VideoEncoder::fillDummyYuvImage(AVFrame *pict, int frame_index, int width,
 	}
 }
 
-void VideoEncoder::fillAvPicture(AVFrame *pict, int frame_index, int width, int height)
+bool VideoEncoder::fillAvPicture(AVFrame *pict, VideoFramePtr frame, int width, int height)
 {
-	// If no data pending, pull the frame from the video source in order to compensate
-	// for idiotic sources like DVizSharedMEmoryThread which sometimes doesnt emit frameReady() signals
-	if(!m_dataPtr || m_byteCount<=0)
-		frameReady();
-
-	if(!m_dataPtr || m_byteCount<=0)
-		return;
-
-	m_dataLock.lock();
-	memcpy(pict->data[0], m_dataPtr.data(), m_byteCount);
-	m_dataLock.unlock();
-	
-	m_byteCount =0;
-}
-
-void VideoEncoder::writeVideoFrame(AVFormatContext *oc, AVStream *st)
-{
-	int out_size, ret = 0;
-	AVCodecContext *c;
+	if(frame->isRaw() && frame->pixelFormat() == QVideoFrame::Format_YUV420P)
+	{
+		// Planes back to back, as VideoFrame::setYuv420PData() lays them out - no need to go through RGB
+		const int w = frame->size().width();
+		const int h = frame->size().height();
+		uint8_t *srcData[4] = { frame->pointer(), frame->pointer() + w * h, frame->pointer() + w * h * 5 / 4, 0 };
+		int srcLinesize[4]  = { w, w/2, w/2, 0 };
+
+		m_imgConvertCtx = sws_getCachedContext(m_imgConvertCtx,
+						w, h, PIX_FMT_YUV420P,
+						width, height, (PixelFormat)m_videoStream->codec->pix_fmt,
+						SWS_BILINEAR, NULL, NULL, NULL);
+		if (m_imgConvertCtx == NULL)
+		{
+			qDebug() << "VideoEncoder::fillAvPicture: Cannot initialize the YUV conversion context for"<<frame->size()<<"to"<<width<<"x"<<height;
+			return false;
+		}
 
-	c = st->codec;
+		sws_scale(m_imgConvertCtx, srcData, srcLinesize, 0, h, pict->data, pict->linesize);
+		return true;
+	}
 
-// 	if(m_videoData.frame_count >= m_numFrames)
-// 	{
-// 		/* no more frame to compress. The codec has a latency of a few
-// 		   frames if using B frames, so we get the last frames by
-// 		   passing the same picture again */
-// 	}
-// 	else
-// 	{
-		if (c->pix_fmt != NATIVE_PIX_FMT)
+	QImage img;
+	if(!frame->image().isNull())
+	{
+		img = frame->image();
+		//qDebug() << "VideoEncoder::fillAvPicture: Located from VideoFrame/QImage data";
+	}
+	else
+	{
+		const QImage::Format imageFormat = QVideoFrame::imageFormatFromPixelFormat(frame->pixelFormat());
+		if(imageFormat != QImage::Format_Invalid)
 		{
-			/* as we only generate a YUV420P picture, we must convert it
-			to the codec pixel format if needed */
-			if (m_imgConvertCtx == NULL)
-			{
-				m_imgConvertCtx = sws_getContext(c->width, c->height,
-								NATIVE_PIX_FMT,
-								c->width, c->height,
-								c->pix_fmt,
-								SWS_BICUBIC, NULL, NULL, NULL);
-				if (m_imgConvertCtx == NULL)
-				{
-					fprintf(stderr, "Cannot initialize the conversion context\n");
-					exit(1);
-				}
-			}
-
-			//fillDummyYuvImage(m_videoData.tmp_picture, m_videoData.frame_count, c->width, c->height);
-			fillAvPicture(m_videoData.tmp_picture, m_videoData.frame_count, c->width, c->height);
+			// Wraps the frame's buffer, no copy - the frame stays alive until we're done with it
+			img = QImage(frame->pointer(),
+				frame->size().width(),
+				frame->size().height(),
+				frame->size().width() *
+					(imageFormat == QImage::Format_RGB16  ||
+					 imageFormat == QImage::Format_RGB555 ||
+					 imageFormat == QImage::Format_RGB444 ||
+					 imageFormat == QImage::Format_ARGB4444_Premultiplied ? 2 :
+					 imageFormat == QImage::Format_RGB888 ||
+					 imageFormat == QImage::Format_RGB666 ||
+					 imageFormat == QImage::Format_ARGB6666_Premultiplied ? 3 :
+					 4),
+				imageFormat);
 
-			sws_scale(m_imgConvertCtx, m_videoData.tmp_picture->data, m_videoData.tmp_picture->linesize,
-				0, c->height, m_videoData.picture->data, m_videoData.picture->linesize);
+			//qDebug() << "VideoEncoder::fillAvPicture: Loaded from raw VideoFrame data";
 		}
 		else
 		{
-			//fillDummyYuvImage(m_videoData.picture, m_videoData.frame_count, c->width, c->height);
-			fillAvPicture(m_videoData.picture, m_videoData.frame_count, c->width, c->height);
+			qDebug() << "VideoEncoder::fillAvPicture: Unable to convert pixel format to a valid image format, cannot encode frame. Pixel Format:"<<frame->pixelFormat();
+			return false;
 		}
-	//}
+	}
 
+	if(img.isNull())
+		return false;
+
+	// swscale takes these directly, anything else goes through QImage first
+	PixelFormat srcFormat;
+	switch(img.format())
+	{
+		case QImage::Format_RGB32:
+		case QImage::Format_ARGB32:
+		case QImage::Format_ARGB32_Premultiplied:
+			srcFormat = NATIVE_PIX_FMT;
+			break;
+		case QImage::Format_RGB888:
+			srcFormat = PIX_FMT_RGB24;
+			break;
+		case QImage::Format_RGB16:
+			srcFormat = PIX_FMT_RGB565;
+			break;
+		default:
+			//qDebug() << "VideoEncoder::fillAvPicture: Converting to QImage::Format_ARGB32";
+			img = img.convertToFormat(QImage::Format_ARGB32);
+			srcFormat = NATIVE_PIX_FMT;
+			break;
+	}
+
+	// Scale and convert to the codec's pixel format in one pass
+	m_imgConvertCtx = sws_getCachedContext(m_imgConvertCtx,
+						img.width(), img.height(), srcFormat,
+						width, height, (PixelFormat)m_videoStream->codec->pix_fmt,
+						SWS_BILINEAR, NULL, NULL, NULL);
+	if (m_imgConvertCtx == NULL)
+	{
+		qDebug() << "VideoEncoder::fillAvPicture: Cannot initialize the conversion context for"<<img.size()<<"to"<<width<<"x"<<height;
+		return false;
+	}
+
+	const QImage& constImg = img;
+	uint8_t *srcData[4] = { (uint8_t*)constImg.bits(), 0, 0, 0 };
+	int srcLinesize[4]  = { constImg.bytesPerLine(), 0, 0, 0 };
+
+	sws_scale(m_imgConvertCtx, srcData, srcLinesize, 0, img.height(), pict->data, pict->linesize);
+
+	return true;
+}
+
+void VideoEncoder::writeVideoFrame(AVFormatContext *oc, AVStream *st, const VideoEncoderFrame& frame, int timestamp)
+{
+	AVCodecContext *c = st->codec;
 
+	// PTS (in codec time base, 1/m_frameRate) comes from the capture time. A frame captured within the
+	// same frame period as the last one is dropped - giving it the next pts would push the video ahead of
+	// its capture time (and of the audio) for as long as the source runs faster than m_frameRate.
+	int64_t pts = (int64_t)timestamp * c->time_base.den / (1000 * c->time_base.num);
+	if(pts <= m_lastPts)
+	{
+		QMutexLocker lock(&m_queueMutex);
+		m_droppedFrames ++;
+		return;
+	}
+
+	if(!fillAvPicture(m_videoData.picture, frame.frame, c->width, c->height))
+		return;
+
+	m_lastPts = pts;
+
+	m_videoData.picture->pts = pts;
+
+	int ret = 0;
 	if (oc->oformat->flags & AVFMT_RAWPICTURE)
 	{
 		/* raw video case. The API will change slightly in the near
@@ -399,69 +469,58 @@ void VideoEncoder::writeVideoFrame(AVFormatContext *oc, AVStream *st)
 		pkt.stream_index = st->index;
 		pkt.data = (uint8_t *)m_videoData.picture;
 		pkt.size = sizeof(AVPicture);
+		pkt.pts = av_rescale_q(pts, c->time_base, st->time_base);
 
 		ret = av_interleaved_write_frame(oc, &pkt);
+		if (ret != 0)
+			qDebug() << "VideoEncoder::writeVideoFrame: Error while writing video frame";
 	}
 	else
 	{
 		/* encode the image */
-		out_size = avcodec_encode_video(c, m_videoData.video_outbuf, m_videoData.video_outbuf_size, m_videoData.picture);
+		int out_size = avcodec_encode_video(c, m_videoData.video_outbuf, m_videoData.video_outbuf_size, m_videoData.picture);
 		/* if zero size, it means the image was buffered */
 		if (out_size > 0)
-		{
-			AVPacket pkt;
-			av_init_packet(&pkt);
-
-			if (c->coded_frame->pts != (int)AV_NOPTS_VALUE)
-			{
-				if(m_starTime.isNull())
-					m_starTime = m_captureTime;
-				int timecode = m_starTime.msecsTo(m_captureTime);
-				
-				int my_pts = (int)(timecode / 1000. * c->time_base.den);
-				if(m_lastPts < 0)
-					m_lastPts = my_pts;
-				if(my_pts == m_lastPts)
-					my_pts ++;
-				if(my_pts < m_lastPts)
-					my_pts = m_lastPts+1; 
-				
-				//int my_pts = (int)(m_runtime.elapsed() / 1000. * 30);
-				pkt.pts = av_rescale_q(c->coded_frame->pts, c->time_base, st->time_base);
-				
-				qDebug() << "VideoEncoder::writeFrame: pkt.pts:"<<pkt.pts<<", c->coded_frame->pts:"<<c->coded_frame->pts
-					//<<", c->time_base:"<<c->time_base.num<<"/"<<c->time_base.den
-					//<<", st->time_base:"<<st->time_base.num<<"/"<<st->time_base.den
-					<<", my_pts:"<<my_pts
-					;//<<", m_lastPts:"<<m_lastPts
-					//<<", m_captureTime:"<<m_captureTime.second() * 1000 + m_captureTime.msec();
-					
-				pkt.pts   = my_pts;
-				m_lastPts = my_pts;
-			}
-				
-			if(c->coded_frame->key_frame)
-				pkt.flags |= AV_PKT_FLAG_KEY;
-			pkt.stream_index = st->index;
-			pkt.data = m_videoData.video_outbuf;
-			pkt.size = out_size;
-
-			/* write the compressed frame in the media file */
-			ret = av_interleaved_write_frame(oc, &pkt);
-		}
-		else
-		{
-			ret = 0;
-		}
-	}
-	if (ret != 0)
-	{
-		fprintf(stderr, "Error while writing video frame\n");
-		exit(1);
+			writeVideoPacket(oc, st, out_size);
 	}
+
 	m_videoData.frame_count++;
 }
 
+void VideoEncoder::writeVideoPacket(AVFormatContext *oc, AVStream *st, int size)
+{
+	AVCodecContext *c = st->codec;
+
+	AVPacket pkt;
+	av_init_packet(&pkt);
+
+	// coded_frame is the frame this packet belongs to, which isn't necessarily the one we just passed in if the codec uses B-frames
+	if (c->coded_frame->pts != (int64_t)AV_NOPTS_VALUE)
+		pkt.pts = av_rescale_q(c->coded_frame->pts, c->time_base, st->time_base);
+
+	//qDebug() << "VideoEncoder::writeVideoPacket: pkt.pts:"<<pkt.pts<<", c->coded_frame->pts:"<<c->coded_frame->pts;
+
+	if(c->coded_frame->key_frame)
+		pkt.flags |= AV_PKT_FLAG_KEY;
+	pkt.stream_index = st->index;
+	pkt.data = m_videoData.video_outbuf;
+	pkt.size = size;
+
+	/* write the compressed frame in the media file */
+	if (av_interleaved_write_frame(oc, &pkt) != 0)
+		qDebug() << "VideoEncoder::writeVideoPacket: Error while writing video frame";
+}
+
+void VideoEncoder::flushVideo(AVFormatContext *oc, AVStream *st)
+{
+	if (!st || (oc->oformat->flags & AVFMT_RAWPICTURE))
+		return;
+
+	int out_size;
+	while((out_size = avcodec_encode_video(st->codec, m_videoData.video_outbuf, m_videoData.video_outbuf_size, NULL)) > 0)
+		writeVideoPacket(oc, st, out_size);
+}
+
 void VideoEncoder::closeVideo(AVFormatContext */*oc*/, AVStream *st)
 {
 	avcodec_close(st->codec);
@@ -481,12 +540,23 @@ void VideoEncoder::closeVideo(AVFormatContext */*oc*/, AVStream *st)
 VideoEncoder::VideoEncoder(const QString&file, QObject *parent)
 	: QThread(parent)
 	, m_filename(file)
+	, m_videoSize(1024,768)
+	, m_videoBitrate(2000000)
 	, m_imgConvertCtx(0)
 	, m_encodingStarted(false)
 	, m_encodingStopped(true)
 	, m_source(0)
 	, m_killed(false)
-	, m_byteCount(0)
+	, m_acceptingFrames(false)
+	, m_captureClock(0)
+	, m_segmentStart(0)
+	, m_segmentLength(0)
+	, m_segmentNumber(1)
+	, m_lastPts(-1)
+	, m_audioSamples(0)
+	, m_droppedFrames(0)
+	, m_framesEncoded(0)
+	, m_encoderLag(0)
 {
 	//qDebug() << "VideoEncoder: Constructing with filename:"<<m_filename;
 	/* initialize libavcodec, and register all codecs and formats */
@@ -516,7 +586,8 @@ void VideoEncoder::setVideoSource(VideoSource *source)
 
 	if(m_source)
 	{
-		connect(m_source, SIGNAL(frameReady()), this, SLOT(frameReady()));
+		// frameReady() just queues the frame, so take it right in the source's thread
+		connect(m_source, SIGNAL(frameReady()), this, SLOT(frameReady()), Qt::DirectConnection);
 		connect(m_source, SIGNAL(destroyed()), this, SLOT(disconnectVideoSource()));
 
 		//qDebug() << "GLVideoDrawable::setVideoSource(): "<<objectName()<<" m_source:"<<m_source;
@@ -560,21 +631,26 @@ bool VideoEncoder::startEncoder(const QString& filename, double duration, int fr
 		return false;
 	}
 
-	frameRate = 30;
-
 	m_duration  = duration;
 	m_frameRate = frameRate;
 	m_numFrames = ((int)(m_duration * m_frameRate));
 	
-	m_lastPts   = -1;
+	m_segmentStart  = 0;
+	m_segmentNumber = 1;
+	m_droppedFrames = 0;
+	m_framesEncoded = 0;
+	m_encoderLag    = 0;
+	
+	m_queueMutex.lock();
+	m_frameQueue.clear();
+	m_lastCaptureTime = QTime();
+	m_captureClock = 0;
+	m_killed = false;
+	m_acceptingFrames = true;
+	m_queueMutex.unlock();
 
 	start();
 
-	// TODO Will this work? The idea is to move
-	// the scaling done in frameReady() into the
-	// encoder thread as opposed to the source thread.
-	moveToThread(this);
-
 	return true;
 }
 
@@ -582,80 +658,64 @@ bool VideoEncoder::startEncoder(const QString& filename, double duration, int fr
 
 void VideoEncoder::frameReady()
 {
-	QTime t;
-	t.start();	
 	if(!m_source)
 		return;
 
-	if(!m_encodingStarted)
-		return;
-
 	VideoFramePtr frame = m_source->frame();
-	if(!frame)
+	if(!frame || !frame->isValid())
 		return;
 
-	QImage img;
-	if(!frame->image().isNull())
-	{
-		img = frame->image();
-		//qDebug() << "VideoEncoder::fillAvPicture: Located from VideoFrame/QImage data";
-	}
-	else
-	{
-		const QImage::Format imageFormat = QVideoFrame::imageFormatFromPixelFormat(frame->pixelFormat());
-		if(imageFormat != QImage::Format_Invalid)
-		{
-			img = QImage(frame->pointer(),
-				frame->size().width(),
-				frame->size().height(),
-				frame->size().width() *
-					(imageFormat == QImage::Format_RGB16  ||
-					 imageFormat == QImage::Format_RGB555 ||
-					 imageFormat == QImage::Format_RGB444 ||
-					 imageFormat == QImage::Format_ARGB4444_Premultiplied ? 2 :
-					 imageFormat == QImage::Format_RGB888 ||
-					 imageFormat == QImage::Format_RGB666 ||
-					 imageFormat == QImage::Format_ARGB6666_Premultiplied ? 3 :
-					 4),
-				imageFormat);
+	QMutexLocker lock(&m_queueMutex);
+	if(!m_acceptingFrames)
+		return;
 
-			//qDebug() << "VideoEncoder::fillAvPicture: Loaded from raw VideoFrame data";
-		}
-		else
-		{
-			qDebug() << "VideoEncoder::frameReady: Unable to convert pixel format to a valid image format, cannot scale frame. Pixel Format:"<<frame->pixelFormat();
-		}
-	}
+	QTime captureTime = frame->captureTime();
+	if(captureTime.isNull())
+		captureTime = QTime::currentTime();
 
+	if(m_lastCaptureTime.isNull())
+		m_lastCaptureTime = captureTime;
 
-	if(img.format() != QImage::Format_ARGB32)
-	{
-		//qDebug() << "VideoEncoder::frameReady: Converting to QImage::Format_ARGB32";
-		img = img.convertToFormat(QImage::Format_ARGB32);
-	}
+	// QTime wraps at midnight - frames are never 12 hours apart, so a big step back is a wrap
+	int sinceLast = m_lastCaptureTime.msecsTo(captureTime);
+	if(sinceLast < -12 * 60 * 60 * 1000)
+		sinceLast += 24 * 60 * 60 * 1000;
+	m_captureClock += sinceLast;
+	m_lastCaptureTime = captureTime;
 
-	AVCodecContext *c = m_videoStream->codec;
+	VideoEncoderFrame queued;
+	queued.frame = frame;
+	queued.timestamp = m_captureClock;
+	queued.queuedAt.start();
 
-	if(img.size() != QSize(c->width,c->height))
+	while(m_frameQueue.size() >= VIDEOENCODER_MAX_QUEUE)
 	{
-		//qDebug() << "VideoEncoder::frameReady: Scaling from:"<<img.size()<<" to "<<c->width<<"x"<<c->height;
-		img = img.scaled(c->width,c->height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		m_frameQueue.dequeue();
+		m_droppedFrames ++;
+		//qDebug() << "VideoEncoder::frameReady(): Queue full, dropped frame, total dropped:"<<m_droppedFrames;
 	}
 
-	uchar *ptr = (uchar*)malloc(sizeof(uchar) * img.byteCount());
-	const uchar *src = (const uchar*)img.bits();
-	memcpy(ptr, src, img.byteCount());
+	m_frameQueue.enqueue(queued);
+	m_frameQueued.wakeOne();
+}
 
-	m_dataLock.lock();
+int VideoEncoder::queueDepth()
+{
+	QMutexLocker lock(&m_queueMutex);
+	return m_frameQueue.size();
+}
 
-	m_dataPtr = QSharedPointer<uchar>(ptr);
-	m_byteCount = img.byteCount();
-	m_captureTime = frame->captureTime();
-	
-	m_dataLock.unlock();
-	
-	//qDebug() << "VideoEncoder::frameReady(): Run time:"<<t.elapsed();
+QString VideoEncoder::segmentFilename()
+{
+	if(m_segmentLength <= 0)
+		return m_filename;
+
+	QFileInfo info(m_filename);
+	QString name = QString("%1-%2").arg(info.completeBaseName()).arg(m_segmentNumber, 3, 10, QChar('0'));
+	if(!info.suffix().isEmpty())
+		name += "." + info.suffix();
 
+	return info.dir().filePath(name);
 }
 
 bool VideoEncoder::setupInternal()
@@ -663,9 +723,21 @@ bool VideoEncoder::setupInternal()
 	m_encodingStarted = true;
 	m_audioPts = 0.0;
 	m_videoPts = 0.0;
+	m_lastPts = -1;
+	m_audioSamples = 0;
+
+	QString filename = segmentFilename();
 
 	/* auto detect the output format from the name. default is mpeg. */
-	m_fmt = guess_format(NULL, qPrintable(m_filename), NULL);
+	m_fmt = 0;
+	if(!m_formatName.isEmpty())
+	{
+		m_fmt = guess_format(qPrintable(m_formatName), NULL, NULL);
+		if(!m_fmt)
+			qDebug() << "VideoEncoder::setupInternal: Unknown format"<<m_formatName<<", guessing from file name instead";
+	}
+	if (!m_fmt)
+		m_fmt = guess_format(NULL, qPrintable(filename), NULL);
 	if (!m_fmt)
 	{
 		printf("Could not deduce output format from file extension: using MPEG.\n");
@@ -691,7 +763,7 @@ bool VideoEncoder::setupInternal()
 		return false;
 	}
 	m_outputContext->oformat = m_fmt;
-	snprintf(m_outputContext->filename, sizeof(m_outputContext->filename), "%s", qPrintable(m_filename));
+	snprintf(m_outputContext->filename, sizeof(m_outputContext->filename), "%s", qPrintable(filename));
 
 	/* add the audio and video streams using the default format codecs
 	and initialize the codecs */
@@ -727,7 +799,7 @@ bool VideoEncoder::setupInternal()
 		return false;
 	}
 
-	dump_format(m_outputContext, 0, qPrintable(m_filename), 1);
+	dump_format(m_outputContext, 0, qPrintable(filename), 1);
 
 	/* now that all the parameters are set, we can open the audio and
 	video codecs and allocate the necessary encode buffers */
@@ -739,9 +811,9 @@ bool VideoEncoder::setupInternal()
 	/* open the output file, if needed */
 	if (!(m_fmt->flags & AVFMT_NOFILE))
 	{
-		if (url_fopen(&m_outputContext->pb, qPrintable(m_filename), URL_WRONLY) < 0)
+		if (url_fopen(&m_outputContext->pb, qPrintable(filename), URL_WRONLY) < 0)
 		{
-			fprintf(stderr, "VideoEncoder::startEncoder: Could not open '%s' for writing\n", qPrintable(m_filename));
+			fprintf(stderr, "VideoEncoder::startEncoder: Could not open '%s' for writing\n", qPrintable(filename));
 			//exit(1);
 			return false;
 		}
@@ -753,6 +825,8 @@ bool VideoEncoder::setupInternal()
 	m_encodingStarted = true;
 	m_encodingStopped = false;
 
+	emit segmentStarted(filename);
+
 	return true;
 }
 
@@ -761,75 +835,80 @@ void VideoEncoder::run()
 	if(!setupInternal())
 	{
 		qDebug() << "VideoEncoder::run(): Error doing internal setup. Not starting encoder.";
+		m_queueMutex.lock();
+		m_acceptingFrames = false;
+		m_frameQueue.clear();
+		m_queueMutex.unlock();
 		return;
 	}
 
 	m_runtime.start();
 
-	m_killed = false;
-	while(!m_killed)
+	forever
 	{
-		/* compute current audio and video time */
-		if (m_audioStream)
-			m_audioPts = (double)m_audioStream->pts.val * m_audioStream->time_base.num / m_audioStream->time_base.den;
-		else
-			m_audioPts = 0.0;
+		VideoEncoderFrame next;
+		{
+			QMutexLocker lock(&m_queueMutex);
+			while(m_frameQueue.isEmpty() && !m_killed)
+				m_frameQueued.wait(&m_queueMutex);
 
-		if (m_videoStream)
-			m_videoPts = (double)m_videoStream->pts.val * m_videoStream->time_base.num / m_videoStream->time_base.den;
-		else
-			m_videoPts = 0.0;
+			// When stopped, we still write out everything that was queued before stopping
+			if(m_frameQueue.isEmpty())
+				break;
 
-		if ((!m_audioStream) &&// || m_audioPts >= m_duration) &&
-		    (!m_videoStream))// || m_videoPts >= m_duration))
-		{
-			qDebug() << "VideoEncoder::run(): Streams dont exist, stopping.";
-			m_killed = true;
-			//stopEncoder();
+			next = m_frameQueue.dequeue();
 		}
-		else
+
+		int timestamp = (int)(next.timestamp - m_segmentStart);
+
+		if(m_segmentLength > 0 &&
+		   timestamp >= m_segmentLength * 60 * 1000)
 		{
-			//printf("VideoEncoder::run(): Video PTS: %f | Audio PTS: %f | Runtime: %.02f\n",m_videoPts,m_audioPts,m_runtime.elapsed() / 1000.);
-
-// 			/* write interleaved audio and video frames */
-// 			if (!m_videoStream || (m_videoStream && m_audioStream && m_audioPts < m_videoPts))
-// 			{
-// 				writeAudioFrame(m_outputContext, m_audioStream);
-// 				//printf(" + AudioFrame %f < %f\n",m_audioPts,m_videoPts);
-// 			}
-// 			else
-// 			{
-				writeVideoFrame(m_outputContext, m_videoStream);
-				//printf(" + VideoFrame %f < %f\n",m_videoPts,m_audioPts);
-//		 	}
+			//qDebug() << "VideoEncoder::run(): Segment"<<m_segmentNumber<<"complete, starting next segment";
+			flushVideo(m_outputContext, m_videoStream);
+			teardownInternal();
+
+			m_segmentNumber ++;
+			m_segmentStart = next.timestamp;
+			timestamp = 0;
+
+			if(!setupInternal())
+			{
+				qDebug() << "VideoEncoder::run(): Error starting segment"<<m_segmentNumber<<", stopping encoder.";
+				m_queueMutex.lock();
+				m_acceptingFrames = false;
+				m_frameQueue.clear();
+				m_queueMutex.unlock();
+				return;
+			}
 		}
 
-// 		double diff = m_videoPts - (m_runtime.elapsed() /1000.);
-// 		if(diff > 0 && diff <= 30) // arbitrary max
-// 		{
-// 			//diff *= .75;
-// 			diff *= 1000;
-// 			qDebug() << "VideoEncoder::run(): Sleeping for "<<diff<<"ms";
-// 			msleep((int)diff);
-// 		}
-// 		else
-// 			qDebug() << "VideoEncoder::run(): Not sleeping, diff is "<<diff<<"ms";
-// 			//msleep(1000 / m_frameRate * .75);
-		msleep(40);
-		//yieldCurrentThread();
+		// Keep audio in step with the video so av_interleaved_write_frame() can interleave them properly
+		writeAudioUntil(m_outputContext, m_audioStream, timestamp);
+		writeVideoFrame(m_outputContext, m_videoStream, next, timestamp);
+
+		m_framesEncoded ++;
+		m_encoderLag = next.queuedAt.elapsed();
+
+		//qDebug() << "VideoEncoder::run(): Frame"<<m_framesEncoded<<"at"<<timestamp<<"ms, lag:"<<m_encoderLag<<"ms, queue:"<<queueDepth();
 	}
 
+	flushVideo(m_outputContext, m_videoStream);
 	teardownInternal();
 }
 
 void VideoEncoder::stopEncoder()
 {
-	if(m_encodingStopped)
+	if(m_encodingStopped && !isRunning())
 		return;
 
-	// Wait for the encoder to stop
+	m_queueMutex.lock();
+	m_acceptingFrames = false;
 	m_killed = true;
-	quit();
+	m_frameQueued.wakeAll();
+	m_queueMutex.unlock();
+
+	// Wait for the encoder to write out the queue and stop
 	wait();
 }
 
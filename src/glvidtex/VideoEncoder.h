@@ -25,6 +25,11 @@ extern "C" {
 
 #include "../livemix/VideoSource.h"
 
+#include <QWaitCondition>
+
+/// Max number of frames waiting to be encoded. If the encoder falls further behind than this, the oldest frames are dropped.
+#define VIDEOENCODER_MAX_QUEUE 90
+
 class VideoEncoderData
 {
 public:
@@ -47,6 +52,28 @@ public:
 	
 };
 
+/// A frame waiting in VideoEncoder's queue
+class VideoEncoderFrame
+{
+public:
+	VideoFramePtr frame;
+	/// Milliseconds since the first frame of the recording, from VideoFrame::captureTime()
+	qint64 timestamp;
+	/// Started when the frame was queued, for VideoEncoder::encoderLag()
+	QTime queuedAt;
+};
+
+/// \class VideoEncoder
+/// Records frames from a VideoSource to a file.
+///
+/// frameReady() only timestamps incoming frames and queues them (up to VIDEOENCODER_MAX_QUEUE) - conversion,
+/// scaling and encoding all happen on the encoder thread. Presentation timestamps come from the frames' capture times,
+/// so the recording plays back at the rate frames were captured, without duplicated frames. Frames that come in faster
+/// than the frame rate given to startEncoder() are dropped.
+/// Audio (currently silence - there is no audio source yet) is interleaved up to the time of each video frame.
+///
+/// If segmentLength() is set, a new file is started every segmentLength() minutes. Frames keep queueing
+/// while the old file is closed and the new one opened, so nothing is dropped between segments.
 class VideoEncoder : public QThread
 {
 	Q_OBJECT
@@ -60,6 +87,34 @@ public:
 	
 	bool encodingStarted() { return m_encodingStarted; }
 	
+	/// Size of the encoded video, default 1024x768. Rounded down to even numbers. Set before startEncoder().
+	QSize videoSize() { return m_videoSize; }
+	void setVideoSize(const QSize& size) { m_videoSize = size; }
+	
+	/// Video bitrate in bits per second, default 2000000. Set before startEncoder().
+	int videoBitrate() { return m_videoBitrate; }
+	void setVideoBitrate(int bitrate) { m_videoBitrate = bitrate; }
+	
+	/// Short name of the container format (e.g. "avi", "flv", "mpegts") - if empty (the default), it's guessed from the filename.
+	QString formatName() { return m_formatName; }
+	void setFormatName(const QString& name) { m_formatName = name; }
+	
+	/// Minutes per file, 0 (the default) records everything to one file.
+	/// Segments are named like the filename given to startEncoder(), with "-001", "-002", etc. added before the extension.
+	int segmentLength() { return m_segmentLength; }
+	void setSegmentLength(int minutes) { m_segmentLength = minutes; }
+	/// Number of the segment currently being written, starting at 1
+	int segmentNumber() { return m_segmentNumber; }
+	
+	/// Frames waiting to be encoded
+	int queueDepth();
+	/// Frames dropped because the queue was full, or because they came in faster than the frame rate given to startEncoder()
+	int droppedFrames() { return m_droppedFrames; }
+	/// Frames written since startEncoder()
+	int framesEncoded() { return m_framesEncoded; }
+	/// Milliseconds between the last frame being queued and being written to disk
+	int encoderLag() { return m_encoderLag; }
+	
 public slots:
 	void setVideoSource(VideoSource *);
 	void disconnectVideoSource();
@@ -68,6 +123,10 @@ public slots:
 	// stopENcoder() is also called automatically from disconnectVideoSource()
 	void stopEncoder();
 
+signals:
+	/// Emitted from the encoder thread whenever a new file is opened
+	void segmentStarted(const QString& filename);
+
 
 protected slots:
 	void frameReady();
@@ -81,14 +140,19 @@ protected:
 	void openAudio(AVFormatContext *oc, AVStream *st);
 	void getDummyAudioFrame(int16_t *samples, int frame_size, int nb_channels);
 	void writeAudioFrame(AVFormatContext *oc, AVStream *st);
+	// Writes audio frames until the audio stream reaches \a timestamp (ms)
+	void writeAudioUntil(AVFormatContext *oc, AVStream *st, int timestamp);
 	void closeAudio(AVFormatContext *oc, AVStream *st);
 	
 	AVStream *addVideoStream(AVFormatContext *oc, enum CodecID codec_id);
 	AVFrame *allocPicture(enum PixelFormat pix_fmt, int width, int height);
 	void openVideo(AVFormatContext *oc, AVStream *st);
 	void fillDummyYuvImage(AVFrame *pict, int frame_index, int width, int height);
-	void fillAvPicture(AVFrame *pict, int frame_index, int width, int height);
-	void writeVideoFrame(AVFormatContext *oc, AVStream *st);
+	bool fillAvPicture(AVFrame *pict, VideoFramePtr frame, int width, int height);
+	void writeVideoFrame(AVFormatContext *oc, AVStream *st, const VideoEncoderFrame& frame, int timestamp);
+	void writeVideoPacket(AVFormatContext *oc, AVStream *st, int size);
+	// Writes out frames still buffered in the codec (B-frames, etc)
+	void flushVideo(AVFormatContext *oc, AVStream *st);
 	void closeVideo(AVFormatContext *oc, AVStream *st);
 	
 private:
@@ -104,6 +168,10 @@ private:
 		
 	QString m_filename;
 	
+	QSize m_videoSize;
+	int m_videoBitrate;
+	QString m_formatName;
+	
 	double m_duration;
 	int m_frameRate;
 	int m_numFrames;
@@ -119,12 +187,30 @@ private:
 	
 	QTime m_runtime;
 	
-	QSharedPointer<uchar> m_dataPtr;
-	int m_byteCount;
-	QTime m_captureTime;
-	QTime m_starTime;
-	int m_lastPts;
-	QMutex m_dataLock;
+	QString segmentFilename();
+	
+	// Frames waiting for the encoder thread
+	QQueue<VideoEncoderFrame> m_frameQueue;
+	QMutex m_queueMutex;
+	QWaitCondition m_frameQueued;
+	bool m_acceptingFrames;
+	
+	// Capture time of the last frame queued, null before the first one
+	QTime m_lastCaptureTime;
+	// Timestamp (ms since the first frame) of the last frame queued - added up from frame to frame,
+	// so it keeps counting across any number of midnights
+	qint64 m_captureClock;
+	// Timestamp (ms) the current segment started at
+	qint64 m_segmentStart;
+	int m_segmentLength;
+	int m_segmentNumber;
+	
+	int64_t m_lastPts;
+	int64_t m_audioSamples;
+	
+	int m_droppedFrames;
+	int m_framesEncoded;
+	int m_encoderLag;
 };
 
 #endif 
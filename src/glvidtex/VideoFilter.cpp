@@ -1,12 +1,29 @@
 #include "VideoFilter.h"
 
+QThreadPool *VideoFilter::m_threadPool = 0;
+
+class VideoFilterJob : public QRunnable
+{
+public:
+	VideoFilterJob(VideoFilter *filter) : m_filter(filter) {}
+	virtual void run() { m_filter->processPendingFrames(); }
+private:
+	VideoFilter *m_filter;
+};
+
+QThreadPool *VideoFilter::threadPool()
+{
+	if(!m_threadPool)
+		m_threadPool = new QThreadPool();
+	return m_threadPool;
+}
+
 VideoFilter::VideoFilter(QObject *parent)
 	: VideoSource(parent)
 	, VideoConsumer()
-	, m_frameDirty(false)
-	, m_threadFps(30)
 	, m_fpsLimit(-1)
 	, m_isThreaded(false)
+	, m_jobQueued(false)
 	
 {
 	connect(&m_processTimer, SIGNAL(timeout()), this, SLOT(processFrame()));
@@ -16,6 +33,8 @@ VideoFilter::VideoFilter(QObject *parent)
 
 VideoFilter::~VideoFilter()
 {
+	// Too late to stop threading here - a queued job could call processFrame() on the half destroyed filter
+	Q_ASSERT(!isThreaded());
 	setVideoSource(0);
 }
 
@@ -33,7 +52,7 @@ void VideoFilter::setVideoSource(VideoSource* source)
 	
 	if(m_source)
 	{
-		connect(m_source, SIGNAL(frameReady()), this, SLOT(frameAvailable()));
+		connectVideoSource();
 		connect(m_source, SIGNAL(destroyed()),  this, SLOT(disconnectVideoSource()));
 		m_source->registerConsumer(this);
 		
@@ -46,6 +65,15 @@ void VideoFilter::setVideoSource(VideoSource* source)
 	}
 }
 
+void VideoFilter::connectVideoSource()
+{
+	disconnect(m_source, SIGNAL(frameReady()), this, SLOT(frameAvailable()));
+	
+	// Threaded stages pick up frames right in the thread that produced them (frameAvailable() only hands the frame to the pool),
+	// instead of waiting for a round trip through the GUI event loop
+	connect(m_source, SIGNAL(frameReady()), this, SLOT(frameAvailable()), m_isThreaded ? Qt::DirectConnection : Qt::AutoConnection);
+}
+
 void VideoFilter::disconnectVideoSource()
 {
 	if(!m_source)
@@ -69,15 +97,23 @@ void VideoFilter::frameAvailable()
 			return;
 		if(f->isValid())
 		{
-			QMutexLocker lock(&m_frameAccessMutex);
-			m_frame = f;
-			
 			if(m_isThreaded)
 			{
-				m_frameDirty = true;
+				QMutexLocker lock(&m_pendingMutex);
+				
+				// If the job is still busy with the last frame, it will pick this one up when it's done - older frames just get dropped
+				m_pendingFrame = f;
+				if(!m_jobQueued)
+				{
+					m_jobQueued = true;
+					threadPool()->start(new VideoFilterJob(this));
+				}
 			}
 			else
 			{
+				QMutexLocker lock(&m_frameAccessMutex);
+				m_frame = f;
+				
 				if(m_processTimer.isActive())
 					m_processTimer.stop();
 				m_processTimer.start();
@@ -86,6 +122,30 @@ void VideoFilter::frameAvailable()
 	}
 }
 
+void VideoFilter::processPendingFrames()
+{
+	forever
+	{
+		VideoFramePtr frame;
+		{
+			QMutexLocker lock(&m_pendingMutex);
+			if(!m_pendingFrame || !m_isThreaded)
+			{
+				m_jobQueued = false;
+				m_jobFinished.wakeAll();
+				return;
+			}
+			
+			frame = m_pendingFrame;
+			m_pendingFrame.clear();
+		}
+		
+		QMutexLocker lock(&m_frameAccessMutex);
+		m_frame = frame;
+		processFrame();
+	}
+}
+
 void VideoFilter::processFrame()
 {
 	enqueue(m_frame);
@@ -93,39 +153,46 @@ void VideoFilter::processFrame()
 
 void VideoFilter::setIsThreaded(bool flag)
 {
-	m_isThreaded = flag;
-	if(flag)
+	if(m_isThreaded == flag)
+		return;
+	
+	if(!flag)
 	{
-		start();
+		// Let the pool job finish the frame it is on, it'll see m_isThreaded and stop there
+		QMutexLocker lock(&m_pendingMutex);
+		m_isThreaded = false;
+		m_pendingFrame.clear();
+		while(m_jobQueued)
+			m_jobFinished.wait(&m_pendingMutex);
 	}
 	else
 	{
-		m_killed = true;
-		quit();
-		wait();
+		m_isThreaded = true;
 	}
+	
+	if(m_source)
+		connectVideoSource();
 }
 
-void VideoFilter::run()
+bool VideoFilter::ownsFrame()
 {
-	while(!m_killed)
-	{
- 		if(m_frameDirty)
- 		{
- 			m_frameAccessMutex.lock();
-			processFrame();
-			m_frameDirty = false;
-			m_frameAccessMutex.unlock();
-		}
-		msleep(1000/m_threadFps);
-	}
+	return m_source && m_source->consumerCount() <= 1;
 }
 
 QImage VideoFilter::frameImage()
 {
 	if(!m_frame)
 		return QImage();
-	return m_frame->toImage();
+	
+	// Raw frames are only copied out of their buffer if somebody else might be reading the same frame,
+	// or if the buffer isn't the frame's to keep (e.g. a shared memory slot)
+	QImage image = m_frame->toImage(!ownsFrame() || !m_frame->ownsPointer());
+	
+	QList<QImage::Format> formats = acceptedFormats();
+	if(!formats.isEmpty() && !image.isNull() && !formats.contains(image.format()))
+		image = image.convertToFormat(formats.first());
+	
+	return image;
 // 	//qDebug() << "VideoSender::frameReady: Downscaling video for transmission to "<<m_transmitSize;
 // 	// To scale the video frame, first we must convert it to a QImage if its not already an image.
 // 	// If we're lucky, it already is. Otherwise, we have to jump thru hoops to convert the byte 
@@ -167,6 +234,28 @@ QImage VideoFilter::frameImage()
 	
 }
 
+void VideoFilter::enqueueImage(const QImage& image)
+{
+	if(!m_frame)
+		return;
+	
+	// If we're the only consumer of an upstream stage, nobody else holds this frame - just swap the image in.
+	// Frames from other sources may still be referenced by the source itself, and a frame that was uploaded
+	// to a texture would carry a stale textureId, so those get a new frame.
+	if(ownsFrame() &&
+	   qobject_cast<VideoFilter*>(m_source) &&
+	   !m_frame->isRaw() &&
+	   !m_frame->hasTextureId())
+	{
+		m_frame->setImage(image);
+		enqueue(m_frame);
+	}
+	else
+	{
+		enqueue(new VideoFrame(image, m_frame->holdTime(), m_frame->captureTime()));
+	}
+}
+
 void VideoFilter::setFpsLimit(int limit)
 {
 	m_fpsLimit = limit;
@@ -7,6 +7,16 @@
 #include "../livemix/VideoSource.h"
 #include "../livemix/VideoFrame.h"
 
+/// \class VideoFilter
+/// A stage in a video filter graph - consumes frames from a VideoSource (which may itself be a VideoFilter),
+/// processes them in processFrame() and enqueue()s the result for its own consumers.
+///
+/// Stages declare the image formats they can work on with acceptedFormats(), so frameImage() only converts when it has to.
+/// When a stage is the only consumer of its source, frameImage() wraps raw frames without copying them and enqueueImage()
+/// hands the result on in the incoming VideoFrame instead of allocating a new one.
+///
+/// Threaded stages run on a thread pool shared by all filters. Frames are handed over as they arrive (no polling),
+/// and if a stage falls behind, only the latest frame is processed.
 class VideoFilter : public VideoSource,
 		    public VideoConsumer
 {
@@ -29,28 +39,54 @@ protected slots:
 
 protected:
 	// If filter is threaded, when new frameAvailable() is called,
-	// it will set m_frameDirty=true and let the run() thread handle it.
+	// it will queue a job on threadPool() (unless one is already queued) which processes the latest frame.
 	// If filter is NOT threaded, frameAvailable() will start m_processTimer,
 	// which will call processFrame() with 0ms timeout to prevent recursion.
+	// A threaded filter must call setIsThreaded(false) in its own destructor, so no job is left running processFrame()
+	// once the derived part of it is gone.
 	void setIsThreaded(bool);
 	bool isThreaded() { return m_isThreaded; }
-	virtual void run();
 	
+	/// Image formats processFrame() can work on directly. frameImage() converts anything else to the first format listed.
+	/// An empty list (the default) takes images in whatever format they come.
+	virtual QList<QImage::Format> acceptedFormats() { return QList<QImage::Format>(); }
+	
+	/// Returns m_frame as a QImage in one of acceptedFormats().
+	/// Note: If ownsFrame(), raw frames are wrapped instead of copied, so the image is only valid as long as m_frame is - copy() it to keep it.
 	QImage frameImage();
 	
+	/// Enqueues \a image as the output of this stage for the current m_frame, keeping its hold time and capture time
+	void enqueueImage(const QImage& image);
+	
+	/// True if this stage is the only consumer of its source, so nothing else will look at m_frame
+	bool ownsFrame();
+	
+	/// Pool shared by all threaded filters
+	static QThreadPool *threadPool();
+	
 protected:	
 	VideoFramePtr m_frame;
 	
 	QTimer m_processTimer;
 	QMutex m_frameAccessMutex;
-	bool m_frameDirty;
-	int m_threadFps;
 	int m_fpsLimit;
 
-private:	
+private:
+	friend class VideoFilterJob;
+	
+	void connectVideoSource();
+	// Runs on threadPool() - processes m_pendingFrame until no new frame arrived while processing
+	void processPendingFrames();
+	
 	bool m_isThreaded;
 	
-
+	// Latest frame not yet picked up by the pool job
+	VideoFramePtr m_pendingFrame;
+	QMutex m_pendingMutex;
+	QWaitCondition m_jobFinished;
+	bool m_jobQueued;
+	
+	static QThreadPool *m_threadPool;
 };
 
 #endif
@@ -0,0 +1,46 @@
+#include "VideoScaleFilter.h"
+
+VideoScaleFilter::VideoScaleFilter(const QSize& targetSize, QObject *parent)
+	: VideoFilter(parent)
+	, m_targetSize(targetSize)
+	, m_transformationMode(Qt::SmoothTransformation)
+{
+	setIsThreaded(true);
+}
+
+VideoScaleFilter::~VideoScaleFilter()
+{
+	// Make sure the pool isn't still in processFrame() when our members go away
+	setIsThreaded(false);
+}
+
+void VideoScaleFilter::setTargetSize(const QSize& size)
+{
+	QMutexLocker lock(&m_frameAccessMutex);
+	m_targetSize = size;
+}
+
+void VideoScaleFilter::setTransformationMode(Qt::TransformationMode mode)
+{
+	QMutexLocker lock(&m_frameAccessMutex);
+	m_transformationMode = mode;
+}
+
+void VideoScaleFilter::processFrame()
+{
+	if(!m_frame)
+		return;
+	
+	if(!m_targetSize.isValid() ||
+	   m_frame->size() == m_targetSize)
+	{
+		enqueue(m_frame);
+		return;
+	}
+	
+	QImage image = frameImage();
+	if(image.isNull())
+		return;
+	
+	enqueueImage(image.scaled(m_targetSize, Qt::IgnoreAspectRatio, m_transformationMode));
+}
@@ -0,0 +1,31 @@
+#ifndef VideoScaleFilter_H
+#define VideoScaleFilter_H
+
+#include <QtGui>
+#include "VideoFilter.h"
+
+/// \class VideoScaleFilter
+/// Scales frames from its source to targetSize(). Runs on the VideoFilter thread pool, so several
+/// scalers fed from the same source work in parallel. Frames already at targetSize() are passed on as-is.
+class VideoScaleFilter : public VideoFilter
+{
+	Q_OBJECT
+public:
+	VideoScaleFilter(const QSize& targetSize = QSize(), QObject *parent=0);
+	~VideoScaleFilter();
+	
+	QSize targetSize() { return m_targetSize; }
+	Qt::TransformationMode transformationMode() { return m_transformationMode; }
+	
+public slots:
+	void setTargetSize(const QSize&);
+	void setTransformationMode(Qt::TransformationMode);
+	
+protected:
+	virtual void processFrame();
+	
+	QSize m_targetSize;
+	Qt::TransformationMode m_transformationMode;
+};
+
+#endif
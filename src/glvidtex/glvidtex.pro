@@ -11,10 +11,14 @@ HEADERS       = GLWidget.h \
 		../livemix/VideoFrame.h \
 		../livemix/CameraThread.h \
 		GLDrawable.h \
+		GLScheduler.h \
+		GLProfiler.h \
 		GLVideoDrawable.h \
 		../ImageFilters.h \
 		RichTextRenderer.h \
 		VideoSender.h \
+		SceneCapture.h \
+		GLSceneRenderer.h \
 		VideoReceiver.h \
 		GLImageDrawable.h \
 		GLVideoLoopDrawable.h \
@@ -35,6 +39,10 @@ HEADERS       = GLWidget.h \
 		VideoConsumer.h \
 		VideoFilter.h \
 		HistogramFilter.h \ 
+		ImageStats.h \
+		FrameAccumulator.h \
+		FrameAccumFilter.h \
+		VideoScaleFilter.h \
 		StaticVideoSource.h \
 		VideoDifferenceFilter.h \
 		#FaceDetectFilter.h \
@@ -43,6 +51,7 @@ HEADERS       = GLWidget.h \
 		GLSpinnerDrawable.h \
 		QtGetOpt.h \
 		../livemix/DVizSharedMemoryThread.h \
+		../livemix/SharedMemoryRing.h \
 		SharedMemorySender.h \
 		GLSceneTypeNewsFeed.h \
 		GLSceneTypeRandomImage.h \
@@ -59,10 +68,14 @@ SOURCES       = GLWidget.cpp \
 		../livemix/VideoFrame.cpp \
 		../livemix/CameraThread.cpp \
 		GLDrawable.cpp \
+		GLScheduler.cpp \
+		GLProfiler.cpp \
 		GLVideoDrawable.cpp \
 		../ImageFilters.cpp \
 		RichTextRenderer.cpp \
 		VideoSender.cpp \
+		SceneCapture.cpp \
+		GLSceneRenderer.cpp \
 		VideoReceiver.cpp \
 		GLImageDrawable.cpp \
 		GLVideoLoopDrawable.cpp \
@@ -84,6 +97,10 @@ SOURCES       = GLWidget.cpp \
 		VideoConsumer.cpp \
 		VideoFilter.cpp \
 		HistogramFilter.cpp \
+		ImageStats.cpp \
+		FrameAccumulator.cpp \
+		FrameAccumFilter.cpp \
+		VideoScaleFilter.cpp \
 		StaticVideoSource.cpp \
 		VideoDifferenceFilter.cpp \
 		#FaceDetectFilter.cpp \
@@ -91,6 +108,7 @@ SOURCES       = GLWidget.cpp \
 		QtGetOpt.cpp  \
 		GLSpinnerDrawable.cpp \
 		../livemix/DVizSharedMemoryThread.cpp \
+		../livemix/SharedMemoryRing.cpp \
 		SharedMemorySender.cpp \
 		GLSceneTypeCurrentWeather.cpp \
 		GLSceneTypeNewsFeed.cpp \
@@ -229,6 +247,17 @@ shadowtest: {
 		#ShadowTestWindow.cpp
 }
 
+# 'schedulertest' compile target - checks GLScheduler corner cases, exits non-zero on failure
+schedulertest: {
+	TARGET = schedulertest
+	HEADERS += SchedulerTest.h
+	SOURCES += schedulertest-main.cpp
+	
+	win32 {
+		CONFIG += console
+	}
+}
+
 glvidtex: {
 	TARGET = glvidtex
 }
@@ -245,6 +274,16 @@ encoder: {
 		streamenc-main.cpp
 }
 
+# 'glrender' compile target - renders scenes in a GLD file to images without a window, for thumbnails and timing scenes
+render: {
+	TARGET = glrender
+	SOURCES += render-main.cpp
+	
+	win32 {
+		CONFIG += console
+	}
+}
+
 # 'glplayercmd' compile target - Player 'remote control' from the command line
 playercmd: {
 	TARGET = glplayercmd
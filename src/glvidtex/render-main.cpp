@@ -0,0 +1,103 @@
+#include <QApplication>
+
+#include "GLDrawables.h"
+#include "GLSceneGroup.h"
+#include "GLSceneRenderer.h"
+#include "MetaObjectUtil.h"
+
+#include "QtGetOpt.h"
+
+// Renders every scene in a GLD file to a PNG without opening a window - for thumbnails,
+// and with --frames, to time how long each scene takes to render.
+int main(int argc, char *argv[])
+{
+	QApplication app(argc, argv);
+
+	GetOpt opts(argc, argv);
+
+	bool verbose = false;
+	opts.addSwitch("verbose", &verbose);
+
+	QString sizeString;
+	opts.addOptionalOption('s',"size", &sizeString, "320x240");
+
+	QString outPrefix;
+	opts.addOptionalOption('o',"out", &outPrefix, "");
+
+	QString framesString;
+	opts.addOptionalOption('n',"frames", &framesString, "1");
+
+	QString fileName;
+	opts.addArgument("file", &fileName);
+
+	if (!opts.parse())
+	{
+			fprintf(stderr,"Usage: %s [--verbose] [-s|--size WxH] [-o|--out prefix] [-n|--frames N] file.gld\n - Renders each scene in file.gld to <prefix><group>-<scene>.png at WxH (default 320x240)\n - With N > 1, renders each scene N times and prints the average render time\n", qPrintable(opts.appName()));
+			return 1;
+	}
+
+	qApp->setApplicationName("GLRender");
+	qApp->setOrganizationName("Josiah Bryan");
+	qApp->setOrganizationDomain("mybryanlife.com");
+
+	MetaObjectUtil_Register(GLImageDrawable);
+	MetaObjectUtil_Register(GLTextDrawable);
+	MetaObjectUtil_Register(GLVideoFileDrawable);
+	MetaObjectUtil_Register(GLVideoInputDrawable);
+	MetaObjectUtil_Register(GLVideoLoopDrawable);
+	MetaObjectUtil_Register(GLVideoReceiverDrawable);
+
+	QStringList sizeParts = sizeString.split("x");
+	QSize frameSize = sizeParts.size() == 2 ? QSize(sizeParts[0].toInt(), sizeParts[1].toInt()) : QSize();
+	if(frameSize.isEmpty())
+		frameSize = QSize(320,240);
+
+	int frames = framesString.toInt();
+	if(frames < 1)
+		frames = 1;
+
+	GLSceneGroupCollection collection;
+	if(!collection.readFile(fileName))
+	{
+		fprintf(stderr,"Unable to read %s\n", qPrintable(fileName));
+		return 1;
+	}
+
+	GLSceneRenderer renderer;
+	renderer.setFrameSize(frameSize);
+	if(collection.canvasSize().isValid())
+		renderer.setCanvasSize(collection.canvasSize());
+
+	foreach(GLSceneGroup *group, collection.groupList())
+	{
+		foreach(GLScene *scene, group->sceneList())
+		{
+			renderer.setScene(scene);
+
+			// Let images load, text lay out, etc before the first frame
+			app.processEvents();
+
+			QImage image;
+			int totalTime = 0;
+			for(int i=0; i<frames; i++)
+			{
+				renderer.invalidate();
+				image = renderer.renderImage();
+				totalTime += renderer.lastRenderTime();
+				app.processEvents();
+			}
+
+			QString file = QString("%1%2-%3.png").arg(outPrefix).arg(group->groupId()).arg(scene->sceneId());
+			image.save(file);
+
+			if(verbose || frames > 1)
+				printf("%s: %s / %s: %.02f ms/frame\n", qPrintable(file),
+					qPrintable(group->groupName()), qPrintable(scene->sceneName()),
+					((double)totalTime) / frames);
+		}
+	}
+
+	renderer.setScene(0);
+
+	return 0;
+}
@@ -0,0 +1,15 @@
+#include <QCoreApplication>
+#include <QTimer>
+
+#include "SchedulerTest.h"
+
+// Runs the GLScheduler checks in SchedulerTest, returns the number of checks that failed
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	SchedulerTest test;
+	QTimer::singleShot(0, &test, SLOT(start()));
+
+	return app.exec();
+}
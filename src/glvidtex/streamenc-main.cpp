@@ -2,16 +2,37 @@
 
 #include "StreamEncoderProcess.h"
 
+#include "QtGetOpt.h"
+
 int main(int argc, char *argv[])
 {
 
 	QApplication app(argc, argv);
 	
+	// construct class from command line arguments
+	GetOpt opts(argc, argv);
+
+	bool verbose = false;
+	opts.addSwitch("verbose", &verbose);
+
+	QString configFile;
+	opts.addOptionalOption('c',"config", &configFile, "streamenc.ini");
+
+	// do the parsing and check for errors
+	if (!opts.parse())
+	{
+			fprintf(stderr,"Usage: %s [--verbose] [-c|--config configfile]\n - If no config file specified, it defaults to 'streamenc.ini'\n", qPrintable(opts.appName()));
+			return 1;
+	}
+
+	if(configFile.isEmpty())
+			configFile = "streamenc.ini";
+	
 	qApp->setApplicationName("GLStreamEncoder");
 	qApp->setOrganizationName("Josiah Bryan");
 	qApp->setOrganizationDomain("mybryanlife.com");
 	
-	StreamEncoderProcess proc;// = new StreamEncoderProcess();
+	StreamEncoderProcess proc(configFile, verbose);// = new StreamEncoderProcess();
 	//Q_UNUSED(proc);
 	
 	//QTimer::singleShot(15000, &app, SLOT(quit())); 
@@ -358,8 +358,10 @@ SlideGroup * GroupPlayerSlideGroup::loadGroupMember(GroupMember mem)
 	if(mem.source == GroupPlayerSlideGroup::ExternalDocument)
 	{
 		Document * doc = new Document(mem.externalDoc);
-		group = doc->groupById(mem.groupId)->clone();
-		if(!group)
+		group = doc->groupById(mem.groupId);
+		if(group)
+			group = group->clone();
+		else
 		{
 			qDebug() << "GroupPlayerSlideGroup::loadGroupMember(): Unable to find group#"<<mem.groupId<<"in external document"<<mem.externalDoc;
 		}
@@ -304,8 +304,22 @@ void ControlServer::screenLoadGroup(QTcpSocket *socket, const QStringList &path,
 	if(nextPathElement == "icon")
 	{
 		QVariant icon;
+		QString etag;
 		if(slide)
 		{
+			// The icon only changes when what's on the slide does, so tablets can revalidate
+			// instead of downloading every icon again each time the group page loads
+			Slide *master = group->masterSlide();
+			etag = QString("\"%1-%2\"")
+				.arg(slide->contentHash(), 16, 16, QChar('0'))
+				.arg(master ? master->contentHash() : 0, 16, 16, QChar('0'));
+			
+			if(requestHeader().value("if-none-match") == etag)
+			{
+				Http_Send_Response(socket,"HTTP/1.0 304 Not Modified") << "";
+				return;
+			}
+			
 			// If the slide group was just loaded to live for the first time
 			// this session, the icons could come back gray if left in 
 			// queued icon gen mode. Therefore, turn that mode off for now.
@@ -326,6 +340,8 @@ void ControlServer::screenLoadGroup(QTcpSocket *socket, const QStringList &path,
 		{
 			QHttpResponseHeader header(QString("HTTP/1.0 200 OK"));
 			header.setValue("content-type", "image/png");
+			if(!etag.isEmpty())
+				header.setValue("etag", etag);
 			respond(socket,header);
 			
 			QPixmap iconPixmap = icon.value<QPixmap>();
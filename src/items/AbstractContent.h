@@ -36,6 +36,10 @@ class AbstractContent : public AbstractDisposeable
 		virtual void syncFromModelItem(AbstractVisualItem*);
 		virtual AbstractVisualItem * syncToModelItem(AbstractVisualItem *model); //defaults to m_modelItem
 		
+		// Points this delegate at another model item that looks exactly the same (same AbstractItem::contentHash())
+		// without syncing anything from it - see MyGraphicsScene::setSlide()
+		void setIdenticalModelItem(AbstractVisualItem *model) { setModelItem(model); }
+		
 		virtual bool isDataLoadComplete() { return true; }
 		static void warmVisualCache(AbstractVisualItem*) {}
 		
@@ -1260,7 +1260,9 @@ void BackgroundContent::setVideoFile(const QString &name)
 			if(DEBUG_BACKGROUNDCONTENT)
 				qDebug() << "BackgroundContent::setVideoFile(): Using FFMPEG";
 
-			QVideoProvider * p = QVideoProvider::providerForFile(name);
+			// Usually already opened (and paused on its first frame) by SlideGroupViewer::initVideoProviders(),
+			// otherwise don't hold up the transition while it opens
+			QVideoProvider * p = QVideoProvider::providerForFile(name, true);
 			if(p)
 			{
 
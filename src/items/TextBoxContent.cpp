@@ -26,7 +26,6 @@
 #include <QPixmapCache>
 #include "ImageFilters.h"
 
-#include "3rdparty/md5/qtmd5.h"
 
 #define DEBUG_LAYOUT 0
 
@@ -413,35 +412,26 @@ QString TextBoxContent::cacheKey(AbstractVisualItem *abstract_model)
 	
 	if(key.isEmpty() || (uint)keyRev != (uint)model->revision())
 	{
-		QByteArray array;
-		QDataStream list(&array, QIODevice::WriteOnly);
+		// Only the properties that change the rendered text, so text boxes with the same text and style
+		// share a render no matter where they are. The model keeps these hashes up to date as it changes,
+		// so this doesn't re-serialize anything.
+		quint64 hash = model->propertyHash("text");
 		
-		list << model->text();
+		if(model->outlineEnabled())
+			hash ^= model->propertyHash("outlinePen");
 		
-		if(model && model->outlineEnabled())
-		{
-			QPen p = model->outlinePen();
-			
-			list << (int)p.color().rgba();
-			list << p.miterLimit();
-			list << p.widthF();
-			list << (int)p.style();
-			list << (int)p.capStyle();
-			list << (int)p.joinStyle();
-		}
-		
-		list << model->shadowBlurRadius();
-		list << (int)model->shadowBrush().color().rgba();
+		hash ^= model->propertyHash("shadowBlurRadius");
+		hash ^= model->propertyHash("shadowBrush");
 		
-		list << model->shadowOffsetX();
-		list << model->shadowOffsetY();
+		hash ^= model->propertyHash("shadowOffsetX");
+		hash ^= model->propertyHash("shadowOffsetY");
 		
-		list << (int)model->fillType();
-		list << (int)model->fillBrush().color().rgba();
+		hash ^= model->propertyHash("fillType");
+		hash ^= model->propertyHash("fillBrush");
 		
-		list << (int)model->zoomEffectEnabled();
+		hash ^= model->propertyHash("zoomEffectEnabled");
 		
-		QString md5key = MD5::md5sum(array);
+		QString hashKey = QString("%1").arg(hash, 16, 16, QChar('0'));
 		
 		QDir path(QString("%1/%2").arg(AppSettings::cachePath()).arg(TEXT_RENDER_CACHE_DIR));
 		if(!path.exists())
@@ -453,7 +443,7 @@ QString TextBoxContent::cacheKey(AbstractVisualItem *abstract_model)
 		key = QString("%1/%2/%3-%4x%5")
 			.arg(AppSettings::cachePath())
 			.arg(TEXT_RENDER_CACHE_DIR)
-			.arg(md5key)
+			.arg(hashKey)
 			.arg(renderSize.width())
 			.arg(renderSize.height());
 		
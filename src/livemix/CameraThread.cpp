@@ -229,6 +229,7 @@ CameraThread::CameraThread(const QString& camera, QObject *parent)
 	m_frame = NULL;
 
 	m_rawFrames = false;
+	m_yuvOutput = false;
 
 	setIsBuffered(false);
 }
@@ -870,8 +871,28 @@ void CameraThread::enableRawFrames(bool enable)
 
 }
 
+void CameraThread::acceptedFormatsChanged()
+{
+	#ifdef ENABLE_DECKLINK_CAPTURE
+	if(m_cameraFile.startsWith("bmd:"))
+	{
+		m_yuvOutput = consumersAccept(QVideoFrame::Format_UYVY);
+		return;
+	}
+	#endif
+	
+	// SimpleV4L2 gives us RGB32 to begin with, this only matters for frames from LibAV
+	m_yuvOutput = consumersAccept(QVideoFrame::Format_YUV420P);
+}
+
 VideoFormat CameraThread::videoFormat()
 {
+	#ifdef ENABLE_DECKLINK_CAPTURE
+	if(m_cameraFile.startsWith("bmd:"))
+		return m_yuvOutput ?
+			VideoFormat(VideoFrame::BUFFER_POINTER, QVideoFrame::Format_UYVY) :
+			VideoFormat(VideoFrame::BUFFER_IMAGE,   QVideoFrame::Format_ARGB32);
+	#endif
 
 	return VideoFormat(
 		m_rawFrames ?
@@ -1070,17 +1091,18 @@ void CameraThread::readFrame()
 				if(frame_finished)
 				{
 
-// 					if(m_rawFrames)
-// 					{
-//  						//qDebug() << "Decode Time: "<<capTime.msecsTo(QTime::currentTime())<<" ms";
-// 						VideoFrame *frame = new VideoFrame(1000/m_fps,capTime);
-// 						frame->setPointerData(m_av_frame->data, m_av_frame->linesize);
-// 						frame->setPixelFormat(QVideoFrame::Format_YUV420P);
-// 						frame->setSize(QSize(m_video_codec_context->width, m_video_codec_context->height));
-// 						//qDebug() << "CameraThread::enqueue call: raw LibAV YUV420P frame";
-// 						enqueue(frame);
-// 					}
-// 					else
+					// Consumers can all take YUV420P, don't bother converting. (Deinterlacing is only done in RGB.)
+					if(m_yuvOutput && !m_deinterlace &&
+					   m_video_codec_context->pix_fmt == PIX_FMT_YUV420P &&
+					   m_video_codec_context->width  % 2 == 0 &&
+					   m_video_codec_context->height % 2 == 0)
+					{
+						VideoFrame *frame = new VideoFrame(1000/m_fps,capTime);
+						frame->setYuv420PData(m_av_frame->data, m_av_frame->linesize, QSize(m_video_codec_context->width, m_video_codec_context->height));
+						//qDebug() << "CameraThread::enqueue call: raw LibAV YUV420P frame";
+						enqueue(frame);
+					}
+					else
 					{
 						// Convert the image from its native format to RGB, then copy the image data to a QImage
 						if(m_sws_context == NULL)
@@ -1451,6 +1473,16 @@ HRESULT BMDCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame* vid
 			
 			int vWidth = videoFrame->GetWidth();
 			int vHeight = videoFrame->GetHeight();
+			
+			if(m_api->yuvOutput())
+			{
+				// Every consumer can draw UYVY, so pass the card's frame on as is - half the bytes of RGB32 and no conversion
+				videoFrame->GetBytes(&frameBytes);
+				m_api->rawDataAvailable((uchar*)frameBytes, videoFrame->GetRowBytes() * vHeight, QSize(vWidth, vHeight), capTime);
+				
+				m_frameCount++;
+				return S_OK;
+			}
 
 			if(m_swsContext == NULL ||
 			   m_swsInitSize.width()  != vWidth ||
@@ -59,6 +59,10 @@ public:
 	
 	bool rawFramesEnabled() { return m_rawFrames; }
 	
+	/// True if every consumer accepts the device's native YUV format (UYVY for Blackmagic cards, YUV420P from LibAV),
+	/// so frames are passed on without converting them to RGB. See VideoSource::setAcceptedFormats()
+	bool yuvOutput() { return m_yuvOutput; }
+	
 	virtual VideoFormat videoFormat();
 	
 	const QString & inputName() { return m_cameraFile; }
@@ -92,6 +96,9 @@ protected slots:
 	
 protected:
 	friend class BMDCaptureDelegate;
+	// VideoSource::
+	virtual void acceptedFormatsChanged();
+	
 	void rawDataAvailable(uchar *bytes, int size, QSize pxSize, QTime captureTime = QTime());
 	void imageDataAvailable(QImage img, QTime captureTime = QTime());
 	
@@ -152,6 +159,7 @@ private:
 	static QMutex threadCacheMutex;
 	
 	bool m_rawFrames;
+	bool m_yuvOutput;
 	
 	QFile m_videoDev;
 	QByteArray m_frameData;
@@ -10,9 +10,6 @@
 
 #include "DVizSharedMemoryThread.h"
 
-// For defenition of FRAME_*
-#include "../glvidtex/SharedMemorySender.h"
-
 #ifndef Q_OS_WIN
 #define V4L_OUTPUT "/dev/video2"
 #endif
@@ -115,8 +112,8 @@ DVizSharedMemoryThread::DVizSharedMemoryThread(const QString& key, QObject *pare
 		}
 		else
 		{
-			start_pipe(m_v4lOutputDev, FRAME_WIDTH, FRAME_HEIGHT);
-			qDebug() << "DVizSharedMemoryThread: Opened V4L output to filenum "<<m_v4lOutputDev<<", size:"<<FRAME_WIDTH<<"x"<<FRAME_HEIGHT;
+			// start_pipe() is called in readFrame() once we know the frame size
+			qDebug() << "DVizSharedMemoryThread: Opened V4L output to filenum "<<m_v4lOutputDev;
 		}
 	}
 	//#else
@@ -129,7 +126,7 @@ void DVizSharedMemoryThread::destroySource()
 	qDebug() << "DVizSharedMemoryThread::destroySource(): "<<this;
 	QMutexLocker lock(&threadCacheMutex);
 	m_threadMap.remove(m_key);
-	m_sharedMemory.detach();
+	m_ring.detach();
 
 	VideoSource::destroySource();
 }
@@ -182,49 +179,57 @@ void DVizSharedMemoryThread::run()
 		//yieldCurrentThread();
 	}
 
-	m_sharedMemory.detach();
+	m_ring.detach();
 }
 
 void DVizSharedMemoryThread::readFrame()
 {
-	if(!m_sharedMemory.isAttached())
-	{
-		m_sharedMemory.setKey(m_key);
-
-		if(m_sharedMemory.isAttached())
-			m_sharedMemory.detach();
-
-		m_sharedMemory.attach(QSharedMemory::ReadWrite);
-	}
+	if(!m_ring.isAttached() &&
+	   !m_ring.attach(m_key))
+		return; // writer not up yet
 
 
 	m_readTime.restart();
 
-	if(!m_sharedMemory.isAttached())
-		m_sharedMemory.attach(QSharedMemory::ReadWrite);
-	else
-	{
-		QImage image(FRAME_WIDTH,
-				FRAME_HEIGHT,
-				FRAME_FORMAT);
-
-		uchar *to = image.scanLine(0);
+	// Lock-free read of the newest frame - returns a null frame if nothing new was published since the last read,
+	// or if the writer lapped us while copying. Either way, we never hold up the writer.
+	VideoFramePtr frame = m_ring.readFrame(true);
+	if(!frame)
+		return;
 
-		m_sharedMemory.lock();
-		const uchar *from = (uchar*)m_sharedMemory.data();
-		memcpy(to, from, qMin(m_sharedMemory.size(), image.byteCount()));
-		QTime time = QTime::currentTime();
-		//qDebug() << "DVizSharedMemoryThread::run: capture time:"<<time.second() * 1000 + time.msec(); //ShMem size: "<<m_sharedMemory.size()<<", image size:"<<image.byteCount();
+	QTime time = QTime::currentTime();
+	//qDebug() << "DVizSharedMemoryThread::run: capture time:"<<time.second() * 1000 + time.msec(); //ShMem size: "<<m_sharedMemory.size()<<", image size:"<<image.byteCount();
+	if(!frame->captureTime().isValid())
+		frame->setCaptureTime(time);
+	frame->setHoldTime(1000/m_fps);
 
-		m_sharedMemory.unlock();
+	// GLVideoDrawable doesn't handle premultiplied alpha, so convert those (e.g. frames from SharedMemoryImageWriter) to a plain ARGB32 image
+	if(frame->pixelFormat() == QVideoFrame::Format_ARGB32_Premultiplied)
+	{
+		QImage image = frame->toImage(false).convertToFormat(QImage::Format_ARGB32);
+		VideoFrame *imageFrame = new VideoFrame(image, frame->holdTime(), frame->captureTime());
+		frame = VideoFramePtr(imageFrame);
+	}
 
-		//image.save("/mnt/phc/Video/tests/frame.jpg");
+	//frame->toImage(false).save("/mnt/phc/Video/tests/frame.jpg");
 
-		#ifdef V4L_OUTPUT
+	#ifdef V4L_OUTPUT
+	if(m_v4lOutputDev >= 0)
+	{
+		QImage outImg = frame->toImage(false);
+		if(!outImg.isNull())
 		{
-			QImage outImg = image;
+			if(m_v4lOutputSize != outImg.size())
+			{
+				m_v4lOutputSize = outImg.size();
+				start_pipe(m_v4lOutputDev, m_v4lOutputSize.width(), m_v4lOutputSize.height());
+				qDebug() << "DVizSharedMemoryThread::readFrame(): V4L output size now: "<<m_v4lOutputSize;
+			}
+
 			if(outImg.format() != V4L_QIMAGE_FORMAT)
 				outImg = outImg.convertToFormat(V4L_QIMAGE_FORMAT);
+			else
+				outImg = outImg.copy(); // dont swap bytes in the frame we're about to enqueue
 
 			if(V4L_NATIVE_FORMAT == VIDEO_PALETTE_RGB24 &&
 			   V4L_QIMAGE_FORMAT == QImage::Format_RGB888)
@@ -248,15 +253,12 @@ void DVizSharedMemoryThread::readFrame()
 				//qDebug() << "DVizSharedMemoryThread::readFrame(): Wrote "<<outImg.byteCount()<<" bytes to "<<V4L_OUTPUT;
 			}
 		}
-		#endif
+	}
+	#endif
 
-		//enqueue(new VideoFrame(image.convertToFormat(QImage::Format_RGB555),1000/m_fps));
-		VideoFrame *frame = new VideoFrame(image,1000/m_fps);
-		frame->setCaptureTime(time);
-		enqueue(frame);
+	enqueue(frame);
 
-		emit frameReady();
-	}
+	emit frameReady();
 
 
 	m_frameCount ++;
@@ -4,9 +4,9 @@
 #include <QImage>
 #include <QTimer>
 #include <QMutex>
-#include <QSharedMemory>
 
 #include "VideoSource.h"
+#include "SharedMemoryRing.h"
 
 class DVizSharedMemoryThread : public VideoSource
 {
@@ -38,7 +38,7 @@ protected:
 private:
 	int m_fps;
 	QString m_key;
-	QSharedMemory m_sharedMemory;
+	SharedMemoryRingReader m_ring;
 	
 	int m_timeAccum;
 	int m_frameCount;
@@ -47,6 +47,8 @@ private:
 	QTimer m_readTimer;
 	
 	int m_v4lOutputDev;
+	// Size the V4L output pipe was last configured for - frame size comes from the ring now, so it can change
+	QSize m_v4lOutputSize;
 	
 	static QMutex threadCacheMutex;
 };
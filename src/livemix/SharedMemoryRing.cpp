@@ -0,0 +1,372 @@
+#include "SharedMemoryRing.h"
+
+#include <QDebug>
+
+using namespace SharedMemoryRing;
+
+// QBasicAtomicInt has no plain acquire-load/release-store in Qt 4, so use the read-modify-write
+// variants to get the barriers. These work on the segment because QBasicAtomicInt is a POD.
+static inline int ringLoad(QBasicAtomicInt &value)
+{
+	return value.fetchAndAddOrdered(0);
+}
+
+static inline void ringStore(QBasicAtomicInt &value, int newValue)
+{
+	value.fetchAndStoreOrdered(newValue);
+}
+
+static inline int captureTimeToMsecs(const QTime& time)
+{
+	return time.isValid() ? QTime(0,0).msecsTo(time) : -1;
+}
+
+/* SharedMemoryRingWriter */
+
+SharedMemoryRingWriter::SharedMemoryRingWriter()
+	: m_header(0)
+	, m_frameNumber(0)
+	, m_writeActive(false)
+{
+}
+
+SharedMemoryRingWriter::~SharedMemoryRingWriter()
+{
+	detach();
+}
+
+bool SharedMemoryRingWriter::create(const QString& key, const QSize& maxFrameSize, int slotCount)
+{
+	detach();
+
+	m_maxFrameSize = maxFrameSize;
+
+	int slotBytes = maxFrameSize.width() * maxFrameSize.height() * 4;
+	int segmentBytes = segmentSize(slotCount, slotBytes);
+
+	m_sharedMemory.setKey(key);
+
+	if(m_sharedMemory.attach(QSharedMemory::ReadWrite))
+	{
+		// Segment left over from a previous writer (or kept alive by a reader) - reuse it if it's big enough
+		if(m_sharedMemory.size() < segmentBytes)
+		{
+			qDebug() << "SharedMemoryRingWriter::create("<<key<<"): Existing segment is too small ("<<m_sharedMemory.size()<<"bytes, need"<<segmentBytes<<") - detach all readers and try again.";
+			m_sharedMemory.detach();
+			return false;
+		}
+	}
+	else
+	if(!m_sharedMemory.create(segmentBytes, QSharedMemory::ReadWrite))
+	{
+		qDebug() << "SharedMemoryRingWriter::create("<<key<<"): Error:"<<m_sharedMemory.errorString();
+		return false;
+	}
+
+	// The only time we lock - readers check the magic before trusting the header, so they
+	// won't try to read while we're setting it up.
+	m_sharedMemory.lock();
+
+	uchar *data = (uchar*)m_sharedMemory.data();
+	memset(data, 0, m_sharedMemory.size());
+
+	m_header = (Header*)data;
+	m_header->version   = SHMEM_RING_VERSION;
+	m_header->slotCount = slotCount;
+	m_header->slotBytes = slotBytes;
+	ringStore(m_header->latestFrame, -1);
+	for(int i=0; i<slotCount; i++)
+		ringStore(slot(i)->sequence, 0);
+
+	m_header->magic = SHMEM_RING_MAGIC;
+
+	m_sharedMemory.unlock();
+
+	m_frameNumber = 0;
+	m_writeActive = false;
+
+	//qDebug() << "SharedMemoryRingWriter::create("<<key<<"): Created ring with"<<slotCount<<"slots of"<<slotBytes<<"bytes each";
+	return true;
+}
+
+void SharedMemoryRingWriter::detach()
+{
+	m_header = 0;
+	m_writeActive = false;
+	if(m_sharedMemory.isAttached())
+		m_sharedMemory.detach();
+}
+
+Slot *SharedMemoryRingWriter::slot(int idx)
+{
+	uchar *base = (uchar*)m_header + headerSize();
+	return (Slot*)(base + idx * (slotHeaderSize() + m_header->slotBytes));
+}
+
+uchar *SharedMemoryRingWriter::slotData(int idx)
+{
+	return (uchar*)slot(idx) + slotHeaderSize();
+}
+
+uchar *SharedMemoryRingWriter::beginWrite(int byteCount, const QSize& size, int bytesPerLine,
+					  QVideoFrame::PixelFormat format, const QTime& captureTime, int holdTime)
+{
+	if(!m_header)
+		return 0;
+
+	if(m_writeActive)
+		commitWrite();
+
+	if(byteCount > (int)m_header->slotBytes)
+	{
+		qDebug() << "SharedMemoryRingWriter::beginWrite(): Frame of"<<byteCount<<"bytes does not fit in slot of"<<m_header->slotBytes<<"bytes, dropped.";
+		return 0;
+	}
+
+	int idx = m_frameNumber % m_header->slotCount;
+	Slot *s = slot(idx);
+
+	// Odd sequence tells readers the slot is being written
+	ringStore(s->sequence, m_frameNumber * 2 + 1);
+
+	s->width        = size.width();
+	s->height       = size.height();
+	s->bytesPerLine = bytesPerLine;
+	s->pixelFormat  = (qint32)format;
+	s->byteCount    = byteCount;
+	s->captureTime  = captureTimeToMsecs(captureTime);
+	s->holdTime     = holdTime;
+
+	m_writeActive = true;
+
+	return slotData(idx);
+}
+
+void SharedMemoryRingWriter::commitWrite()
+{
+	if(!m_header || !m_writeActive)
+		return;
+
+	int idx = m_frameNumber % m_header->slotCount;
+
+	ringStore(slot(idx)->sequence, m_frameNumber * 2);
+	ringStore(m_header->latestFrame, m_frameNumber);
+
+	m_frameNumber ++;
+	m_writeActive = false;
+}
+
+bool SharedMemoryRingWriter::writeData(const uchar *data, int byteCount, const QSize& size, int bytesPerLine,
+				       QVideoFrame::PixelFormat format, const QTime& captureTime, int holdTime)
+{
+	uchar *to = beginWrite(byteCount, size, bytesPerLine, format, captureTime, holdTime);
+	if(!to)
+		return false;
+
+	memcpy(to, data, byteCount);
+
+	commitWrite();
+	return true;
+}
+
+bool SharedMemoryRingWriter::writeImage(const QImage& image, const QTime& captureTime, int holdTime)
+{
+	if(!m_header || image.isNull())
+		return false;
+
+	QImage localImage = image;
+
+	// Stick to 32bit formats so rows are always tightly packed - VideoFrame doesn't carry a stride
+	if(localImage.format() != QImage::Format_ARGB32 &&
+	   localImage.format() != QImage::Format_RGB32 &&
+	   localImage.format() != QImage::Format_ARGB32_Premultiplied)
+		localImage = localImage.convertToFormat(QImage::Format_ARGB32);
+
+	if(localImage.byteCount() > (int)m_header->slotBytes)
+		localImage = localImage.scaled(m_maxFrameSize, Qt::KeepAspectRatio, Qt::FastTransformation);
+
+	const QImage &constRef = localImage; // avoid detach in bits()
+	return writeData(constRef.bits(),
+			 constRef.byteCount(),
+			 constRef.size(),
+			 constRef.bytesPerLine(),
+			 QVideoFrame::pixelFormatFromImageFormat(constRef.format()),
+			 captureTime,
+			 holdTime);
+}
+
+bool SharedMemoryRingWriter::writeFrame(VideoFramePtr frame)
+{
+	if(!frame || !frame->isValid())
+		return false;
+
+	if(!frame->isRaw())
+		return writeImage(frame->image(), frame->captureTime(), frame->holdTime());
+
+	// Raw frames (including YUV) go in untouched if they fit - readers get the same pixel format the source produced
+	if(frame->pointerLength() <= slotBytes())
+	{
+		int height = frame->size().height();
+		return writeData(frame->pointer(),
+				 frame->pointerLength(),
+				 frame->size(),
+				 height > 0 ? frame->pointerLength() / height : 0,
+				 frame->pixelFormat(),
+				 frame->captureTime(),
+				 frame->holdTime());
+	}
+
+	// Too big - only thing we can do is scale it, which means it has to be an image format
+	QImage image = frame->toImage(false);
+	if(image.isNull())
+		return false;
+
+	return writeImage(image, frame->captureTime(), frame->holdTime());
+}
+
+/* SharedMemoryRingReader */
+
+SharedMemoryRingReader::SharedMemoryRingReader()
+	: m_header(0)
+	, m_lastFrame(-1)
+	, m_lastSequence(-1)
+	, m_lastSlot(-1)
+	, m_tornFrames(0)
+	, m_droppedFrames(0)
+{
+}
+
+SharedMemoryRingReader::~SharedMemoryRingReader()
+{
+	detach();
+}
+
+bool SharedMemoryRingReader::attach(const QString& key)
+{
+	detach();
+
+	m_sharedMemory.setKey(key);
+
+	// ReadWrite because the atomic loads are implemented as read-modify-write ops
+	if(!m_sharedMemory.attach(QSharedMemory::ReadWrite))
+		return false;
+
+	Header *header = (Header*)m_sharedMemory.data();
+	if(m_sharedMemory.size() < headerSize() ||
+	   header->magic   != SHMEM_RING_MAGIC ||
+	   header->version != SHMEM_RING_VERSION ||
+	   m_sharedMemory.size() < segmentSize(header->slotCount, header->slotBytes))
+	{
+		// Either the writer hasn't finished setting up the segment, or it's an older writer
+		// that just dumps pixels into the segment - try again later.
+		m_sharedMemory.detach();
+		return false;
+	}
+
+	m_header = header;
+	m_lastFrame = -1;
+	m_lastSequence = -1;
+	m_lastSlot = -1;
+
+	return true;
+}
+
+void SharedMemoryRingReader::detach()
+{
+	m_header = 0;
+	if(m_sharedMemory.isAttached())
+		m_sharedMemory.detach();
+}
+
+Slot *SharedMemoryRingReader::slot(int idx)
+{
+	uchar *base = (uchar*)m_header + headerSize();
+	return (Slot*)(base + idx * (slotHeaderSize() + m_header->slotBytes));
+}
+
+uchar *SharedMemoryRingReader::slotData(int idx)
+{
+	return (uchar*)slot(idx) + slotHeaderSize();
+}
+
+bool SharedMemoryRingReader::hasNewFrame()
+{
+	if(!m_header)
+		return false;
+	int latest = ringLoad(m_header->latestFrame);
+	return latest >= 0 && latest != m_lastFrame;
+}
+
+VideoFramePtr SharedMemoryRingReader::readFrame(bool copy)
+{
+	if(!m_header)
+		return VideoFramePtr();
+
+	int latest = ringLoad(m_header->latestFrame);
+	if(latest < 0 || latest == m_lastFrame)
+		return VideoFramePtr();
+
+	// Writer restarted (frame numbers went backwards) - just resync
+	if(latest < m_lastFrame)
+		m_lastFrame = -1;
+
+	if(m_lastFrame >= 0 && latest - m_lastFrame > 1)
+		m_droppedFrames += latest - m_lastFrame - 1;
+
+	int idx = latest % m_header->slotCount;
+	Slot *s = slot(idx);
+
+	int sequence = ringLoad(s->sequence);
+	if(sequence != latest * 2)
+	{
+		// Odd means the writer is in the slot right now, anything else means it's already been reused
+		m_tornFrames ++;
+		return VideoFramePtr();
+	}
+
+	QSize size(s->width, s->height);
+	int byteCount = s->byteCount;
+	QVideoFrame::PixelFormat format = (QVideoFrame::PixelFormat)s->pixelFormat;
+	int captureTime = s->captureTime;
+	int holdTime = s->holdTime;
+
+	if(byteCount <= 0 || byteCount > (int)m_header->slotBytes)
+	{
+		m_tornFrames ++;
+		return VideoFramePtr();
+	}
+
+	VideoFrame *frame = new VideoFrame(holdTime, captureTime < 0 ? QTime() : QTime(0,0).addMSecs(captureTime));
+	frame->setPixelFormat(format);
+	frame->setSize(size);
+
+	if(copy)
+	{
+		memcpy(frame->allocPointer(byteCount), slotData(idx), byteCount);
+
+		// If the writer got into the slot while we were copying, what we have is garbage
+		if(ringLoad(s->sequence) != sequence)
+		{
+			delete frame;
+			m_tornFrames ++;
+			return VideoFramePtr();
+		}
+	}
+	else
+	{
+		frame->setPointer(slotData(idx), byteCount, false);
+	}
+
+	m_lastFrame    = latest;
+	m_lastSequence = sequence;
+	m_lastSlot     = idx;
+
+	return VideoFramePtr(frame);
+}
+
+bool SharedMemoryRingReader::isFrameIntact()
+{
+	if(!m_header || m_lastSlot < 0)
+		return false;
+	return ringLoad(slot(m_lastSlot)->sequence) == m_lastSequence;
+}
@@ -0,0 +1,174 @@
+#ifndef SharedMemoryRing_H
+#define SharedMemoryRing_H
+
+#include <QSharedMemory>
+#include <QImage>
+#include <QTime>
+#include <QAtomicInt>
+
+#include "VideoFrame.h"
+
+/// Default maximum frame size a SharedMemoryRingWriter allocates slots for.
+/// Frames smaller than this are written at their native size, larger frames are scaled down to fit.
+#define SHMEM_RING_MAX_WIDTH  1920
+#define SHMEM_RING_MAX_HEIGHT 1080
+#define SHMEM_RING_SLOTS      3
+
+/// Bumped whenever the layout of SharedMemoryRing::Header or SharedMemoryRing::Slot changes
+#define SHMEM_RING_MAGIC   0x44565a52 // 'DVZR'
+#define SHMEM_RING_VERSION 1
+
+/// \namespace SharedMemoryRing
+/// Layout of a multi-slot video ring in a QSharedMemory segment, shared between one writer and any number of readers.
+///
+/// The segment starts with a Header, followed by \em slotCount slots, each being a Slot
+/// header followed by \em slotBytes of pixel data.
+///
+/// The QSharedMemory lock is only used while creating the segment - after that, frames are exchanged lock-free:
+/// - The writer writes frame \em N into slot N % slotCount. It marks the slot busy by setting the slot sequence to an odd number,
+///   copies the frame, then sets the slot sequence to 2*N (even) and finally publishes N in the header's \em latestFrame.
+/// - Readers read \em latestFrame, then the slot sequence, copy (or wrap) the pixels, and re-read the slot sequence. If the
+///   sequence was odd or changed during the copy, the writer lapped the reader and the frame is discarded.
+/// With three or more slots, the writer never touches the slot holding the most recently published frame, so
+/// readers only lose a frame if they take longer than two frame intervals to consume one. Readers never block the writer.
+namespace SharedMemoryRing
+{
+	struct Header
+	{
+		quint32 magic;
+		quint32 version;
+		quint32 slotCount;
+		quint32 slotBytes;
+		/// Number of the most recently published frame, or -1 if nothing written yet
+		QBasicAtomicInt latestFrame;
+	};
+
+	struct Slot
+	{
+		/// Odd while the writer is filling the slot, 2*frameNumber when complete
+		QBasicAtomicInt sequence;
+		quint32 width;
+		quint32 height;
+		quint32 bytesPerLine;
+		/// A QVideoFrame::PixelFormat
+		qint32  pixelFormat;
+		/// Number of valid bytes following this header (<= Header::slotBytes)
+		quint32 byteCount;
+		/// VideoFrame::captureTime() of the frame, as msecs since midnight, -1 if not set
+		qint32  captureTime;
+		/// Advisory VideoFrame::holdTime()
+		qint32  holdTime;
+	};
+
+	/// Slot headers are padded so pixel data stays 16-byte aligned for SIMD consumers
+	inline int slotHeaderSize() { return (sizeof(Slot) + 15) & ~15; }
+	inline int headerSize()     { return (sizeof(Header) + 15) & ~15; }
+	inline int segmentSize(int slotCount, int slotBytes)
+		{ return headerSize() + slotCount * (slotHeaderSize() + slotBytes); }
+};
+
+/// \class SharedMemoryRingWriter
+/// Publishes frames into a SharedMemoryRing. See SharedMemoryRing for the protocol.
+class SharedMemoryRingWriter
+{
+public:
+	SharedMemoryRingWriter();
+	~SharedMemoryRingWriter();
+
+	/// Creates (or re-attaches to) the segment for \a key with room for frames up to \a maxFrameSize at 32 bits per pixel.
+	/// Returns false and prints the error if the segment could not be created.
+	bool create(const QString& key,
+		    const QSize& maxFrameSize = QSize(SHMEM_RING_MAX_WIDTH, SHMEM_RING_MAX_HEIGHT),
+		    int slotCount = SHMEM_RING_SLOTS);
+	void detach();
+
+	bool isAttached() { return m_header != 0; }
+	QString errorString() { return m_sharedMemory.errorString(); }
+
+	/// Largest number of bytes a single frame can use
+	int slotBytes() { return m_header ? m_header->slotBytes : 0; }
+	/// Largest frame that fits in a slot at 32 bits per pixel, see create()
+	QSize maxFrameSize() { return m_maxFrameSize; }
+
+	/// Publishes \a image, scaling it down (keeping aspect ratio) if it doesn't fit in a slot.
+	bool writeImage(const QImage& image, const QTime& captureTime = QTime(), int holdTime = -1);
+
+	/// Publishes \a frame. Raw frames are copied as-is (including YUV formats), QImage frames via writeImage().
+	bool writeFrame(VideoFramePtr frame);
+
+	/// Publishes \a byteCount bytes of pixel data. Returns false if it doesn't fit in a slot.
+	bool writeData(const uchar *data, int byteCount, const QSize& size, int bytesPerLine,
+		       QVideoFrame::PixelFormat format, const QTime& captureTime = QTime(), int holdTime = -1);
+
+	/// Zero-copy write: marks the next slot busy, fills in its header and returns a pointer to its pixel data
+	/// for the caller to write \a byteCount bytes into (e.g. by wrapping it in a QImage and painting.)
+	/// Call commitWrite() when done. Returns NULL if the frame doesn't fit in a slot.
+	uchar *beginWrite(int byteCount, const QSize& size, int bytesPerLine,
+			  QVideoFrame::PixelFormat format, const QTime& captureTime = QTime(), int holdTime = -1);
+	/// Publishes the slot returned by beginWrite()
+	void commitWrite();
+
+	/// Number of frames published since create()
+	int frameCount() { return m_frameNumber; }
+
+private:
+	SharedMemoryRing::Slot *slot(int idx);
+	uchar *slotData(int idx);
+
+	QSharedMemory m_sharedMemory;
+	SharedMemoryRing::Header *m_header;
+	QSize m_maxFrameSize;
+	int m_frameNumber;
+	bool m_writeActive;
+};
+
+/// \class SharedMemoryRingReader
+/// Consumes frames from a SharedMemoryRing created by a SharedMemoryRingWriter. Never blocks the writer.
+class SharedMemoryRingReader
+{
+public:
+	SharedMemoryRingReader();
+	~SharedMemoryRingReader();
+
+	/// Attaches to the ring at \a key. Returns false if no writer has created it yet, or if it's not a compatible ring.
+	bool attach(const QString& key);
+	void detach();
+
+	bool isAttached() { return m_header != 0; }
+
+	/// Returns true if the writer has published a frame newer than the last one returned by readFrame()
+	bool hasNewFrame();
+
+	/// Returns the latest published frame, or a null VideoFramePtr if there is no new frame or if the writer overwrote
+	/// the slot while we were reading it.
+	///
+	/// If \a copy is true (the default), the pixels are copied into memory owned by the frame, and the frame can be kept as long as needed.
+	/// If \a copy is false, the frame wraps the slot in shared memory directly without copying. The data is only guaranteed
+	/// until the writer laps the ring - call isFrameIntact() after consuming the frame and discard whatever was computed if it returns false.
+	/// Zero-copy frames must not outlive this reader.
+	VideoFramePtr readFrame(bool copy=true);
+
+	/// Returns true if the slot for the frame last returned by readFrame() still holds that frame
+	bool isFrameIntact();
+
+	/// Number of frames discarded because the writer lapped us mid-read
+	int tornFrameCount() { return m_tornFrames; }
+	/// Number of frames published by the writer that we never read
+	int droppedFrameCount() { return m_droppedFrames; }
+
+private:
+	SharedMemoryRing::Slot *slot(int idx);
+	uchar *slotData(int idx);
+
+	QSharedMemory m_sharedMemory;
+	SharedMemoryRing::Header *m_header;
+
+	int m_lastFrame;
+	int m_lastSequence;
+	int m_lastSlot;
+
+	int m_tornFrames;
+	int m_droppedFrames;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "VideoFrame.h"
 
+#include <string.h>
+
 VideoFrame::VideoFrame()
 {
 	m_holdTime = -1; 
@@ -8,6 +10,7 @@ VideoFrame::VideoFrame()
 	m_bufferType = BUFFER_INVALID;
 	m_pointer = 0;
 	m_pointerLength = 0;
+	m_ownsPointer = true;
 	m_debugPtr = false;
 	m_hasTextureId = false;
 	#ifdef DEBUG_VIDEOFRAME_POINTERS
@@ -22,6 +25,7 @@ VideoFrame::VideoFrame(int holdTime, const QTime &captureTime)
 	, m_bufferType(BUFFER_INVALID)
 	, m_pointer(0)
 	, m_pointerLength(0)
+	, m_ownsPointer(true)
 	, m_debugPtr(false)
 	, m_hasTextureId(false)
 {
@@ -39,6 +43,7 @@ VideoFrame::VideoFrame(const QImage &frame, int holdTime, const QTime &captureTi
 	, m_image(frame)
 	, m_pointer(0)
 	, m_pointerLength(0)
+	, m_ownsPointer(true)
 	, m_debugPtr(false)
 	, m_hasTextureId(false)
 {
@@ -57,6 +62,7 @@ VideoFrame::VideoFrame(VideoFrame *other)
 	, m_image(other->m_image)
 	, m_pointer(other->m_pointer)
 	, m_pointerLength(other->m_pointerLength)
+	, m_ownsPointer(other->m_ownsPointer)
 	, m_debugPtr(false)
 	, m_hasTextureId(other->m_hasTextureId)
 	, m_textureId(other->m_textureId)
@@ -73,7 +79,7 @@ VideoFrame::~VideoFrame()
 	#ifdef DEBUG_VIDEOFRAME_POINTERS
 	qDebug() << "VideoFrame::~VideoFrame(): "<<this;
 	#endif
-	if(m_pointer)
+	if(m_pointer && m_ownsPointer)
 	{
 		//#ifdef DEBUG_VIDEOFRAME_POINTERS
 		if(m_debugPtr)
@@ -94,10 +100,39 @@ uchar *VideoFrame::allocPointer(int bytes)
 	if(m_debugPtr)
 		qDebug() << "VideoFrame::allocPointer(): "<<this<<" allocated m_pointer:"<<m_pointer<<", bytes:"<<bytes;
 	m_pointerLength = bytes;
+	m_ownsPointer = true;
 	m_bufferType = BUFFER_POINTER;
 	return m_pointer;
 }
 
+static void copyPlane(uchar *dst, int width, const uchar *src, int srcStride, int rows)
+{
+	if(width == srcStride)
+	{
+		memcpy(dst, src, width * rows);
+		return;
+	}
+	
+	for(int y=0; y<rows; y++)
+		memcpy(dst + y * width, src + y * srcStride, width);
+}
+
+void VideoFrame::setYuv420PData(uchar *const planes[], const int strides[], const QSize& size)
+{
+	const int w = size.width();
+	const int h = size.height();
+	const int ySize  = w * h;
+	const int uvSize = ySize / 4;
+	
+	uchar *pointer = allocPointer(ySize + uvSize * 2);
+	copyPlane(pointer,                  w,   planes[0], strides[0], h);
+	copyPlane(pointer + ySize,          w/2, planes[1], strides[1], h/2);
+	copyPlane(pointer + ySize + uvSize, w/2, planes[2], strides[2], h/2);
+	
+	setPixelFormat(QVideoFrame::Format_YUV420P);
+	setSize(size);
+}
+
 bool VideoFrame::isEmpty() { return m_bufferType == BUFFER_INVALID; }
 bool VideoFrame::isValid() { return m_bufferType != BUFFER_INVALID && (m_bufferType == BUFFER_IMAGE ? !m_image.isNull() : m_pointer != NULL); }
 
@@ -181,11 +216,12 @@ void VideoFrame::setRect(QRect rect)
 	setSize(rect.size());
 }
 
-void VideoFrame::setPointer(uchar *dat, int len)
+void VideoFrame::setPointer(uchar *dat, int len, bool takeOwnership)
 {
 	m_bufferType = BUFFER_POINTER;
 	m_pointer = dat;
 	m_pointerLength = len;
+	m_ownsPointer = takeOwnership;
 }
 
 void VideoFrame::setTextureId(GLuint id)
@@ -111,10 +111,16 @@ QVideoFrame::Format_RGB555	6	The frame is stored using a 16-bit RGB format (5-5-
 	uchar *pointer() { return m_pointer; }
 	/// Returns the given pointer length in bytes set either by setPointer() or allocPointer()
 	int pointerLength() { return m_pointerLength; }
-	/// Give a pointer to a block of memory to this VideoFrame. Note that VideoFrame takes ownership of the pointer and will call free() on the pointer when the VideoFrame is deleted.
-	void setPointer(uchar *pointer, int length);
+	/// Give a pointer to a block of memory to this VideoFrame. Note that VideoFrame takes ownership of the pointer and will call free() on the pointer when the VideoFrame is deleted,
+	/// unless \a takeOwnership is false - in which case the caller must guarantee the memory outlives the frame (e.g. a slot in a SharedMemoryRing.)
+	void setPointer(uchar *pointer, int length, bool takeOwnership=true);
+	/// Returns false if the pointer() was given with setPointer(..., false) and will not be freed by this frame
+	bool ownsPointer() { return m_ownsPointer; }
 	/// Allocate a pointer of the given number of \a bytes - sets bufferType() and pointerLength() accordingly.
 	uchar *allocPointer(int bytes);
+	/// Copies a planar YUV420P image (such as an AVFrame's data/linesize) into a new pointer(), with the Y, U and V planes back to back
+	/// and no line padding - the layout GLVideoDrawable expects. Sets bufferType(), pixelFormat() and size(). Width and height must be even.
+	void setYuv420PData(uchar *const planes[], const int strides[], const QSize& size);
 	
 	/// Returns the size in pixels of the video frame.
 	QSize size() { return m_size; }
@@ -166,6 +172,8 @@ protected:
 	/// If bufferTYpe is POINTER, then, of course, data is expected to be in this pointer
 	uchar *m_pointer;
 	int m_pointerLength;
+	/// If false, m_pointer is not free()'d in the destructor
+	bool m_ownsPointer;
 	
 	/// Regardless of the buffer type, these members are expecte to contain the size and rect of the image, can be set both with setSize(), below
 	QSize m_size;
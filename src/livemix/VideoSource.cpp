@@ -62,6 +62,7 @@ void VideoSource::registerConsumer(QObject *consumer)
 	m_consumerList.append(consumer);
 	connect(consumer, SIGNAL(destroyed()), this, SLOT(consumerDestroyed()));
 	consumerRegistered(consumer);
+	acceptedFormatsChanged();
 	//qDebug() << "VideoSource::registerConsumer(): "<<this<<": consumer list:"<<m_consumerList.size(); //m_refCount:"<<m_refCount;
 }
 
@@ -157,8 +158,10 @@ void VideoSource::release(QObject *consumer)
 		return;
 		
 	m_consumerList.removeAll(consumer);
+	m_acceptedFormats.remove(consumer);
 	
 	consumerReleased(consumer);
+	acceptedFormatsChanged();
 	//m_refCount --;
 	//qDebug() << "VideoSource::release(): "<<this<<": consumer list:"<<m_consumerList.size(); //m_refCount:"<<m_refCount;
 	//if(m_refCount <= 0)
@@ -167,6 +170,41 @@ void VideoSource::release(QObject *consumer)
 		destroySource();
 }
 
+void VideoSource::setAcceptedFormats(QObject *consumer, const QList<QVideoFrame::PixelFormat>& formats)
+{
+	if(m_acceptedFormats.contains(consumer) &&
+	   m_acceptedFormats.value(consumer) == formats)
+		return;
+	
+	m_acceptedFormats[consumer] = formats;
+	
+	if(m_consumerList.contains(consumer))
+		acceptedFormatsChanged();
+}
+
+bool VideoSource::consumersAccept(QVideoFrame::PixelFormat format)
+{
+	if(m_consumerList.isEmpty())
+		return false;
+	
+	foreach(QObject *consumer, m_consumerList)
+	{
+		if(m_acceptedFormats.contains(consumer))
+		{
+			if(!m_acceptedFormats.value(consumer).contains(format))
+				return false;
+		}
+		else
+		if(format != QVideoFrame::Format_RGB32 &&
+		   format != QVideoFrame::Format_ARGB32)
+		{
+			return false;
+		}
+	}
+	
+	return true;
+}
+
 void VideoSource::setAutoDestroy(bool flag)
 {
 	m_autoDestroy = flag;
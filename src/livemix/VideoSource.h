@@ -6,6 +6,7 @@
 #include <QQueue>
 #include <QPointer>
 #include <QMutex>
+#include <QHash>
 
 #include "VideoFrame.h"
 
@@ -45,6 +46,14 @@ public:
 
 	virtual void registerConsumer(QObject *consumer);
 	virtual void release(QObject *consumer=0);
+	int consumerCount() { return m_consumerList.size(); }
+	
+	/// Tells the source which pixel formats \a consumer can take. Call before registerConsumer() so the
+	/// source doesn't switch formats twice. Consumers that never call this are assumed to only take RGB32/ARGB32.
+	void setAcceptedFormats(QObject *consumer, const QList<QVideoFrame::PixelFormat>& formats);
+	/// Returns true if every registered consumer accepts \a format - sources use this to decide whether
+	/// they can pass frames on in their native (decoder/capture) format instead of converting them to RGB.
+	bool consumersAccept(QVideoFrame::PixelFormat format);
 
 	virtual VideoFramePtr frame();
 	
@@ -67,6 +76,8 @@ protected:
 	virtual void consumerRegistered(QObject*) {}
 	// subclass hook 
 	virtual void consumerReleased(QObject*) {}
+	// subclass hook - consumers (or the formats they accept) changed, see consumersAccept()
+	virtual void acceptedFormatsChanged() {}
 	
 	virtual void run();
 	virtual void enqueue(VideoFrame*);
@@ -81,6 +92,7 @@ protected:
 	//QQueue<VideoFrame> m_frameQueue;
 	VideoFrameQueue m_frameQueue;
 	QList<QObject*> m_consumerList;
+	QHash<QObject*, QList<QVideoFrame::PixelFormat> > m_acceptedFormats;
 	bool m_isBuffered;
 	VideoFramePtr m_singleFrame;
 	QMutex m_queueMutex;
@@ -3,6 +3,7 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QStringList>
+#include <QFileInfo>
 #include <QDebug>
 
 #include "VideoThread.h"
@@ -12,46 +13,161 @@ extern "C" {
 #include "libavdevice/avdevice.h"
 }
 
-#define MAX_SKIPS_TILL_RESET 30
-
 int Round(double value)
 {
 	return (int)(value + 0.5f);
 }
 
+QMap<QString,VideoThread*> VideoThread::m_threadMap;
+QMutex VideoThread::threadCacheMutex;
+
 VideoThread::VideoThread(QObject *parent)
 	: VideoSource(parent)
+	, m_readTimer(0)
+	, m_sws_context(NULL)
+	, m_start_pts(0)
+	, m_video_clock(0)
 	, m_inited(false)
 	, m_videoFile()
-	, m_nextDelay(1000/30)
-	, m_frameConsumed(true)
-	, m_frameLockCount(0)
-	, m_frameSmoothCount(0)
-	, m_frameSmoothAccum(0)
-	, m_startPaused(false)
+	, m_duration(0)
+	, m_fpms(0)
+	, m_frame_rate(0)
+	, m_frameDuration(1000/30)
+	, m_status(NotRunning)
+	, m_yuvOutput(false)
+	, m_clockBase(0)
+	, m_seekPending(false)
+	, m_seekTarget(0)
+	, m_seekFlags(0)
+	, m_formatChanged(false)
+	, m_formatResumeAt(-1)
+	, m_presentFirst(true)
+	, m_droppedFrames(0)
+	, m_skipUntil(0)
+	, m_loopOffset(0)
+	, m_lastPts(-1)
+	, m_gopCacheBytes(0)
+	, m_gopCaching(false)
+	, m_gopCacheDone(false)
+	, m_gopCacheComplete(false)
+	, m_gopEndPts(0)
+	, m_replayIndex(-1)
 {
 	m_time_base_rational.num = 1;
 	m_time_base_rational.den = AV_TIME_BASE;
-	m_previous_pts_delay = 40e-3;
-	m_skipFrameCount = 0;
-	m_frameTimer = 0; //(double)av_gettime() / 1000000.0;
-		
-	m_total_runtime = 0;
 	
-	m_sws_context = NULL;
+	// Lives in our parent's thread, not in run() - frames are released to consumers from there
+	m_readTimer = new QTimer(this);
+	m_readTimer->setSingleShot(true);
+	connect(m_readTimer, SIGNAL(timeout()), this, SLOT(presentFrame()));
+	
+	m_run_time.start();
 	
-	m_run_time.restart();
+	// presentFrame() already paces the frames, and with threadForFile() several drawables share us - a
+	// buffered queue would hand each frame to whichever consumer happened to ask for it first
+	setIsBuffered(false);
 	
 	// primer...
 	enqueue(new VideoFrame(QImage("../glvidtex/dot.gif"),1000/30));
-// 	m_frame = NULL;
+}
+
+VideoThread *VideoThread::threadForFile(const QString& file, const QString& clock)
+{
+	QFileInfo info(file);
+	if(!info.exists())
+		return 0;
+	
+	QString key = QString("%1|%2").arg(clock).arg(info.canonicalFilePath());
+	
+	QMutexLocker lock(&threadCacheMutex);
+	
+	if(m_threadMap.contains(key))
+	{
+		//qDebug() << "VideoThread::threadForFile(): "<<file<<": [CACHE HIT]";
+		return m_threadMap[key];
+	}
+	
+	//qDebug() << "VideoThread::threadForFile(): "<<file<<": [CACHE MISS]";
+	VideoThread *thread = new VideoThread();
+	thread->m_cacheKey = key;
+	thread->setVideo(file);
+	thread->start(true);
+	
+	m_threadMap[key] = thread;
+	
+	return thread;
+}
+
+VideoThread *VideoThread::detachConsumer(QObject *consumer)
+{
+	if(!m_consumerList.contains(consumer) ||
+	    m_consumerList.toSet().size() < 2)
+		return this;
+	
+	//qDebug() << "VideoThread::detachConsumer(): "<<consumer<<" splitting off from "<<m_videoFile;
+	
+	// Not in m_threadMap - nobody else should join a thread that's about to go its own way
+	VideoThread *thread = new VideoThread();
+	thread->setVideo(m_videoFile);
+	// The clock keeps counting across loops, seek to where that is in the file
+	qint64 pos = clockTime();
+	if(m_duration > 0)
+		pos %= (qint64)(m_duration * 1000);
+	thread->seek((int)pos);
+	thread->start(true);
+	
+	if(m_playingConsumers.contains(consumer))
+	{
+		thread->setConsumerPlaying(consumer, true);
+		setConsumerPlaying(consumer, false);
+	}
+	
+	return thread;
+}
 
+void VideoThread::setConsumerPlaying(QObject *consumer, bool flag)
+{
+	if(flag)
+		m_playingConsumers.insert(consumer);
+	else
+		m_playingConsumers.remove(consumer);
+	
+	if(!m_playingConsumers.isEmpty())
+		play();
+	else
+	if(m_status == Running)
+		pause();
+}
+
+void VideoThread::consumerReleased(QObject *consumer)
+{
+	// Don't keep playing on behalf of a consumer that's gone, but leave it alone if play() was called directly
+	if(m_playingConsumers.remove(consumer) &&
+	   m_playingConsumers.isEmpty())
+		pause();
+}
+
+void VideoThread::destroySource()
+{
+	if(!m_cacheKey.isEmpty())
+	{
+		QMutexLocker lock(&threadCacheMutex);
+		if(m_threadMap.value(m_cacheKey) == this)
+			m_threadMap.remove(m_cacheKey);
+	}
+	
+	VideoSource::destroySource();
 }
 
 void VideoThread::start(bool paused)
 {
-	m_startPaused = paused;
 	VideoSource::start();
+	
+	// Nothing is decoded yet, but presentFrame() just waits for the queue to fill
+	if(paused)
+		m_readTimer->start(0);
+	else
+		play();
 }
 
 void VideoThread::setVideo(const QString& name)
@@ -61,13 +177,38 @@ void VideoThread::setVideo(const QString& name)
 
 VideoFormat VideoThread::videoFormat()
 {
-	//return VideoFormat(VideoFrame::BUFFER_IMAGE, QVideoFrame::Format_RGB565);
-	return VideoFormat(VideoFrame::BUFFER_IMAGE, QVideoFrame::Format_ARGB32);
-	//return VideoFormat(VideoFrame::BUFFER_POINTER, QVideoFrame::Format_ARGB32);
-	//return VideoFormat(VideoFrame::BUFFER_BYTEARRAY, QVideoFrame::Format_YUV420P);
+	QSize size = m_frame_size.isValid() ? m_frame_size : QSize(640,480);
 	
+	// See convertFrame() - odd sizes don't split evenly into YUV420P planes
+	if(m_yuvOutput && size.width() % 2 == 0 && size.height() % 2 == 0)
+		return VideoFormat(VideoFrame::BUFFER_POINTER, QVideoFrame::Format_YUV420P, size);
 	
-	// Size defaults to 640,480
+	return VideoFormat(VideoFrame::BUFFER_IMAGE, QVideoFrame::Format_ARGB32, size);
+}
+
+void VideoThread::acceptedFormatsChanged()
+{
+	setYuvOutput(consumersAccept(QVideoFrame::Format_YUV420P));
+}
+
+void VideoThread::setYuvOutput(bool flag)
+{
+	if(m_yuvOutput == flag)
+		return;
+	
+	QMutexLocker lock(&m_decodeMutex);
+	m_yuvOutput = flag;
+	
+	// Queued and cached frames are in the old format. Rather than skip ahead past them, the worker
+	// decodes them again from the first one we haven't shown yet.
+	m_formatChanged = true;
+	if(m_formatResumeAt < 0 && !m_decodeQueue.isEmpty())
+		m_formatResumeAt = m_decodeQueue.head().presentAt;
+	m_decodeQueue.clear();
+	m_queueNotFull.wakeAll();
+	lock.unlock();
+	
+	m_readTimer->start(0);
 }
 
 int VideoThread::initVideo()
@@ -153,26 +294,6 @@ int VideoThread::initVideo()
 	// Allocate video frame
 	m_av_frame = avcodec_alloc_frame();
 
-	// Allocate an AVFrame structure
-	m_av_rgb_frame =avcodec_alloc_frame();
-	if(m_av_rgb_frame == NULL)
-	{
-		qDebug() << "[ERROR] VideoThread::load(): avcodec_alloc_frame() failed.";
-		return false;
-	}
-
-	// Determine required buffer size and allocate buffer
-	//int num_bytes = avpicture_get_size(PIX_FMT_RGB565, m_video_codec_context->width, m_video_codec_context->height);
-	int num_bytes = avpicture_get_size(PIX_FMT_RGB32, m_video_codec_context->width, m_video_codec_context->height);
-
-	m_buffer = (uint8_t *)av_malloc(num_bytes * sizeof(uint8_t));
-
-	// Assign appropriate parts of buffer to image planes in pFrameRGB
-	// Note that pFrameRGB is an AVFrame, but AVFrame is a superset of AVPicture
-	//avpicture_fill((AVPicture *)m_av_rgb_frame, m_buffer, PIX_FMT_RGB565,
-	avpicture_fill((AVPicture *)m_av_rgb_frame, m_buffer, PIX_FMT_RGB32,
-					m_video_codec_context->width, m_video_codec_context->height);
-
 	if(m_audio_stream != -1)
 	{
 		m_audio_codec_context = m_av_format_context->streams[m_audio_stream]->codec;
@@ -187,12 +308,10 @@ int VideoThread::initVideo()
 	}
 
 	m_timebase = m_av_format_context->streams[m_video_stream]->time_base;
-
-	m_readTimer = new QTimer();
-	//connect(m_readTimer, SIGNAL(timeout()), this, SLOT(readFrame()));
-	int ts = 1000/30; //int(m_timebase.den);
-	//qDebug() << "VideoThread::initVideo: setting interval to "<<ts<<", den:"<<m_timebase.den<<", num:"<<m_timebase.num;
-	m_readTimer->setInterval(ts);
+	
+	// Some containers (MPEG-PS, TS) don't start at 0
+	int64_t start_time = m_av_format_context->streams[m_video_stream]->start_time;
+	m_start_pts = start_time != (int64_t)AV_NOPTS_VALUE ? start_time : 0;
 	
 	calculateVideoProperties();
 
@@ -202,22 +321,102 @@ int VideoThread::initVideo()
 
 void VideoThread::run()
 {
-	
-	m_killed = false;
+	// m_killed starts out false (see VideoSource) - don't reset it here, the destructor or destroySource()
+	// may already have set it before this thread got to run
 	initVideo();
 	
-	//m_readTimer->start();
-	if(!m_startPaused)
-		play();
+	if(!m_inited)
+	{
+		// Nothing will ever show up in the queue, so presentFrame() can stop waiting for it
+		QMutexLocker lock(&m_decodeMutex);
+		m_presentFirst = false;
+		return;
+	}
+	
+	// Decoding from the start of the file - keep the first GOP around for when we loop
+	m_gopCaching = true;
 	
-	//exec();
 	while(!m_killed)
 	{
-// 		qDebug() << "VideoThread::run() mark4";
-		if(m_status == Running)
-			readFrame();
-		//qDebug() << "VideoThread::run() mark5: "<<m_frameQueue.size();
-		msleep(qMax(m_nextDelay,10));
+		m_decodeMutex.lock();
+		while(!m_killed && !m_seekPending && !m_formatChanged &&
+		      m_decodeQueue.size() >= VIDEOTHREAD_MAX_QUEUE)
+			m_queueNotFull.wait(&m_decodeMutex, 100);
+		
+		bool seekPending   = m_seekPending;
+		qint64 seekTarget  = m_seekTarget;
+		int seekFlags      = m_seekFlags;
+		bool formatChanged = m_formatChanged;
+		qint64 resumeAt    = m_formatResumeAt;
+		m_seekPending   = false;
+		m_formatChanged = false;
+		m_formatResumeAt = -1;
+		m_decodeMutex.unlock();
+		
+		if(m_killed)
+			break;
+		
+		if(formatChanged)
+		{
+			m_gopCache.clear();
+			m_gopCacheBytes = 0;
+			m_gopCaching = false;
+			m_gopCacheDone = false;
+			m_gopCacheComplete = false;
+			
+			if(!seekPending)
+			{
+				// The decoder is past the frames that were dropped from the queue (and maybe past the cached
+				// frames we were replaying), go back for them. If the queue had already wrapped around the end of
+				// the file, this pass starts over from the top - the clock just waits for it.
+				if(resumeAt >= 0)
+					seekDecoder(qMax((qint64)0, resumeAt - m_loopOffset));
+				else
+				if(m_replayIndex >= 0)
+					seekDecoder(m_lastPts + m_frameDuration);
+			}
+			m_replayIndex = -1;
+		}
+		
+		if(seekPending)
+		{
+			//qDebug() << "VideoThread::run(): Seeking to "<<seekTarget<<"ms";
+			m_loopOffset = 0;
+			m_replayIndex = -1;
+			m_lastPts = -1;
+			
+			if(seekTarget == 0 && m_gopCacheDone)
+			{
+				// Start of the file is already decoded
+				m_replayIndex = 0;
+				if(!m_gopCacheComplete)
+					seekDecoder(m_gopEndPts, seekFlags);
+			}
+			else
+			{
+				seekDecoder(seekTarget, seekFlags);
+				
+				if(!m_gopCacheDone)
+				{
+					m_gopCache.clear();
+					m_gopCacheBytes = 0;
+					m_gopCaching = seekTarget == 0;
+				}
+			}
+			continue;
+		}
+		
+		VideoThreadFrame next;
+		if(!nextFrame(&next))
+			continue;
+		
+		QMutexLocker lock(&m_decodeMutex);
+		
+		// Decoded for a position (or format) that was changed while we were decoding it
+		if(m_seekPending || m_formatChanged)
+			continue;
+		
+		m_decodeQueue.enqueue(next);
 	}
 }
 
@@ -225,7 +424,11 @@ void VideoThread::run()
 VideoThread::~VideoThread()
 {
 // 	qDebug() << "VideoThread::~VideoThread(): Deleting!";
+	m_decodeMutex.lock();
 	m_killed = true;
+	m_queueNotFull.wakeAll();
+	m_decodeMutex.unlock();
+	
 	quit();
 	wait();
 
@@ -236,12 +439,6 @@ VideoThread::~VideoThread()
 		sws_freeContext(m_sws_context);
 		m_sws_context = NULL;
 	}
-
-// 	if(m_frame != NULL)
-// 	{
-// 		delete m_frame;
-// 		m_frame = 0;
-// 	}
 }
 
 
@@ -256,6 +453,8 @@ void VideoThread::calculateVideoProperties()
 	//printf("m_fpms = %.02f, frame_rate=%d\n",m_fpms,m_video->m_frame_rate);
 	//qDebug() << "m_frame_rate:"<<m_frame_rate<<", m_fpms:"<<m_fpms;
 
+	m_frameDuration = m_frame_rate > 0 ? Round(1000. / m_frame_rate) : 1000/30;
+
 	//duration
 	m_duration = (m_av_format_context->duration / AV_TIME_BASE);
 
@@ -266,13 +465,11 @@ void VideoThread::calculateVideoProperties()
 
 void VideoThread::freeResources()
 {
-	// Free the RGB image
-	av_free(m_buffer);
-	av_free(m_av_rgb_frame);
-
+	if(!m_inited)
+		return;
+	
 	// Free the YUV frame
 	//av_free(m_av_frame);
-	//mutex.unlock();
 
 	// Close the codec
 	avcodec_close(m_video_codec_context);
@@ -281,95 +478,81 @@ void VideoThread::freeResources()
 	av_close_input_file(m_av_format_context);
 }
 
-void VideoThread::seek(int ms, int flags)
+qint64 VideoThread::clockTime()
 {
-	//qDebug() << "VideoThread::seek()";
-// 	QMutexLocker locker(&mutex);
-	m_total_runtime = ms;
-	m_run_time.start();
-	m_frameTimer = ms;
-	
-
-	double seconds = (double)ms / 1000.0f;
-
-	int64_t seek_target = (int64_t)(seconds * AV_TIME_BASE);
-
-	seek_target = av_rescale_q(seek_target, m_time_base_rational,
-		m_av_format_context->streams[m_video_stream]->time_base);
+	return m_clockBase + (m_status == Running ? m_run_time.elapsed() : 0);
+}
 
-	av_seek_frame(m_av_format_context, m_video_stream, seek_target, flags);
+void VideoThread::setClock(qint64 ms)
+{
+	m_clockBase = ms;
+	m_run_time.start();
+}
 
-	avcodec_flush_buffers(m_video_codec_context);
+void VideoThread::seek(int ms, int flags)
+{
+	//qDebug() << "VideoThread::seek(): "<<ms;
+	QMutexLocker lock(&m_decodeMutex);
+	m_seekPending = true;
+	m_seekTarget = ms;
+	m_seekFlags = flags;
+	
+	// Anything still queued is from before the seek
+	m_decodeQueue.clear();
+	m_presentFirst = true;
+	setClock(ms);
+	
+	m_queueNotFull.wakeAll();
+	lock.unlock();
+	
+	// Show the target frame as soon as it's decoded, even when paused
+	m_readTimer->start(0);
 }
 
 void VideoThread::restart()
 {
-// if(!m_video->m_video_loaded)
-// 		return;
-	//qDebug() << "VideoThread::restart()";
-	
-	seek(0, AVSEEK_FLAG_BACKWARD);
+	seek(0);
 }
 
 void VideoThread::play()
 {
-	if(!m_inited)
-	{
-		//qDebug() << "VideoThread::play(): not inited";
+	if(m_status == Running)
 		return;
-	}
-		
+	
+	// Clock picks up where pause() left it
 	m_status = Running;
+	m_run_time.start();
+	m_readTimer->start(0);
 	
-	if(m_readTimer && m_readTimer->isActive())
-	{
-		//qDebug() << "VideoThread::play(): timer active";
- 		m_total_runtime += m_run_time.restart();
- 	}
-	else
-	{
-		if(m_readTimer)
-			m_readTimer->start();
-		m_run_time.start();
-		//qDebug() << "VideoThread::play(): starting timer";
-	}
-	//m_readTimer->start();
-	//m_video_decoder->decode(); // start decoding again
 	emit movieStateChanged(QMovie::Running);
 }
 
 void VideoThread::pause()
 {
 	//qDebug() << "VideoThread::pause()";
+	if(m_status == Running)
+		m_clockBase = clockTime();
 	m_status = Paused;
-	m_total_runtime += m_run_time.elapsed();
-	//qDebug() << "QVideo::pause(): m_total_runtime:"<<m_total_runtime;
 	
-	//emit startDecode();
-	if(m_inited)
+	// Still have to show the frame from a pending seek
+	if(!m_presentFirst)
 		m_readTimer->stop();
+	
 	emit movieStateChanged(QMovie::Paused);
 }
 
 void VideoThread::stop()
 {
 	//qDebug() << "VideoThread::stop()";
-	seek(0, AVSEEK_FLAG_BACKWARD);
-	
 	m_status = NotRunning;
-	m_readTimer->stop();
-	
-	// Since there is no stop() or pause(), we dont need to touch m_run_time right now - it will be reset in play()
-	m_total_runtime = 0;
+	seek(0);
 
 	emit movieStateChanged(QMovie::NotRunning);
-	
 }
 
 void VideoThread::setStatus(Status s)
 {
 	//qDebug() << "VideoThread::setStatus(): "<<s;
-	m_status = s;
 	if(s == NotRunning)
 		stop();
 	else
@@ -380,313 +563,304 @@ void VideoThread::setStatus(Status s)
 		play();
 }
 
+void VideoThread::presentFrame()
+{
+	VideoFramePtr frame;
+	int nextDelay = 10;
+	
+	m_decodeMutex.lock();
+	
+	// QTime wraps at midnight, fold the elapsed time into the base every now and then
+	if(m_status == Running && m_run_time.elapsed() > 60 * 60 * 1000)
+		setClock(clockTime());
+	
+	if(!m_decodeQueue.isEmpty())
+	{
+		if(m_presentFirst)
+		{
+			// First frame after a seek (or while paused) - show it now and run the clock from there
+			VideoThreadFrame next = m_decodeQueue.dequeue();
+			frame = next.frame;
+			setClock(next.presentAt);
+			m_presentFirst = false;
+		}
+		else
+		if(m_status == Running)
+		{
+			qint64 now = clockTime();
+			
+			// Show the most recent frame that's due, drop any that are older
+			while(!m_decodeQueue.isEmpty() &&
+			       m_decodeQueue.head().presentAt <= now)
+			{
+				if(frame)
+					m_droppedFrames ++;
+				
+				VideoThreadFrame next = m_decodeQueue.dequeue();
+				frame = next.frame;
+				
+				if(now - next.presentAt > VIDEOTHREAD_RESYNC_MS)
+				{
+					// Decoder fell way behind (or we didn't get called for a while) - dropping frames won't catch up
+					//qDebug() << "VideoThread::presentFrame(): "<<(now - next.presentAt)<<"ms late, resyncing clock";
+					setClock(next.presentAt);
+					break;
+				}
+			}
+		}
+		
+		if(frame)
+			m_queueNotFull.wakeAll();
+		
+		if(!m_decodeQueue.isEmpty())
+			nextDelay = (int)qBound((qint64)1, m_decodeQueue.head().presentAt - clockTime(), (qint64)100);
+	}
+	
+	bool keepPolling = m_status == Running || m_presentFirst;
+	m_decodeMutex.unlock();
+	
+	if(frame)
+		enqueue(frame);
+	
+	if(keepPolling)
+		m_readTimer->start(nextDelay);
+}
 
-void VideoThread::readFrame()
+bool VideoThread::nextFrame(VideoThreadFrame *out)
 {
-// 	qDebug() << "VideoThread::readFrame(): start of function";
-	if(!m_inited)
+	if(m_replayIndex >= 0)
 	{
-// 		qDebug() << "VideoThread::readFrame(): not inited";
-		//emit frameReady(m_nextDelay);
-		return;
+		if(m_replayIndex < m_gopCache.size())
+		{
+			const VideoThreadFrame& cached = m_gopCache[m_replayIndex ++];
+			*out = VideoThreadFrame(cached.frame, cached.presentAt + m_loopOffset);
+			m_lastPts = cached.presentAt;
+			return true;
+		}
+		
+		m_replayIndex = -1;
+		
+		// Whole file is cached, loop again without going near the decoder
+		if(m_gopCacheComplete)
+		{
+			loopRestart();
+			return false;
+		}
 	}
 	
+	if(decodeFrame(out))
+	{
+		out->presentAt += m_loopOffset;
+		return true;
+	}
 	
+	if(!m_killed)
+		loopRestart();
 	
+	return false;
+}
+
+bool VideoThread::decodeFrame(VideoThreadFrame *out)
+{
 	AVPacket pkt1, *packet = &pkt1;
-	double pts;
 	
-// 	qDebug() << "VideoThread::readFrame(): killed: "<<m_killed;
-
-	int frame_finished = 0;
-	while(!frame_finished && !m_killed)
+	while(!m_killed)
 	{
-		if(av_read_frame(m_av_format_context, packet) >= 0)
+		if(av_read_frame(m_av_format_context, packet) < 0)
+			return false;
+		
+		if(packet->stream_index != m_video_stream)
 		{
-			// Is this a packet from the video stream?
-			if(packet->stream_index == m_video_stream)
+			// Audio isn't played (yet)
+			av_free_packet(packet);
+			continue;
+		}
+		
+		// With B-frames, frames come out of the decoder in presentation order, not in the order their packets
+		// went in. reordered_opaque is carried through the decoder with the frame, so we get the frame's own pts.
+		m_video_codec_context->reordered_opaque = packet->pts;
+		
+		int frame_finished = 0;
+		avcodec_decode_video(m_video_codec_context, m_av_frame, &frame_finished, packet->data, packet->size);
+		
+		int64_t framePts = m_av_frame->reordered_opaque;
+		if(framePts == (int64_t)AV_NOPTS_VALUE)
+			framePts = packet->dts;
+		
+		double pts = framePts != (int64_t)AV_NOPTS_VALUE ? (double)(framePts - m_start_pts) : 0;
+		pts *= av_q2d(m_timebase);
+		
+		av_free_packet(packet);
+		
+		if(!frame_finished)
+			continue;
+		
+		// This block from the synchronize_video(VideoState *is, AVFrame *src_frame, double pts) : double
+		// function given at: http://dranger.com/ffmpeg/tutorial05.html
+		{
+			if(pts != 0)
 			{
-				//global_video_pkt_pts = packet->pts;
-
-				avcodec_decode_video(m_video_codec_context, m_av_frame, &frame_finished, packet->data, packet->size);
-
-				if(packet->dts == AV_NOPTS_VALUE &&
-						  m_av_frame->opaque &&
-				  *(uint64_t*)m_av_frame->opaque != AV_NOPTS_VALUE)
-				{
-					pts = *(uint64_t *)m_av_frame->opaque;
-				}
-				else if(packet->dts != AV_NOPTS_VALUE)
-				{
-					pts = packet->dts;
-				}
-				else
-				{
-					pts = 0;
-				}
-
-				pts *= av_q2d(m_timebase);
-
-				// Did we get a video frame?
-				if(frame_finished)
-				{
-					
-					// Convert the image from its native format to RGB, then copy the image data to a QImage
-					if(m_sws_context == NULL)
-					{
-						//mutex.lock();
-						m_sws_context = sws_getContext(
-							m_video_codec_context->width, m_video_codec_context->height,
-							m_video_codec_context->pix_fmt,
-							m_video_codec_context->width, m_video_codec_context->height,
-							//PIX_FMT_RGB32,SWS_BICUBIC,
-							//PIX_FMT_RGB565, SWS_FAST_BILINEAR,
-							PIX_FMT_RGB32, SWS_FAST_BILINEAR,
-							//PIX_FMT_YUV420P, SWS_FAST_BILINEAR,
-							NULL, NULL, NULL); //SWS_PRINT_INFO
-						//mutex.unlock();
-						//printf("decode(): created m_sws_context\n");
-					}
-					//printf("decode(): got frame\n");
-
-					sws_scale(m_sws_context,
-						  m_av_frame->data,
-						  m_av_frame->linesize, 0,
-						  m_video_codec_context->height,
-						  m_av_rgb_frame->data,
-						  m_av_rgb_frame->linesize);
-
-					//m_bufferMutex.lock();
-// 					qDebug() << "VideoThread: void*:"<<(void*)m_av_rgb_frame->data[0];
-					QImage frame = QImage(m_av_rgb_frame->data[0],
-								m_video_codec_context->width,
-								m_video_codec_context->height,
-								//QImage::Format_RGB16);
-								QImage::Format_ARGB32);
-					//m_bufferMutex.unlock();
-					
-					av_free_packet(packet);
-
-					// This block from the synchronize_video(VideoState *is, AVFrame *src_frame, double pts) : double
-					// function given at: http://dranger.com/ffmpeg/tutorial05.html
-					{
-						// update the frame pts
-						double frame_delay;
-
-						if(pts != 0)
-						{
-							/* if we have pts, set video clock to it */
-							m_video_clock = pts;
-						} else {
-							/* if we aren't given a pts, set it to the clock */
-							pts = m_video_clock;
-						}
-						/* update the video clock */
-						frame_delay = av_q2d(m_timebase);
-						/* if we are repeating a frame, adjust clock accordingly */
-						frame_delay += m_av_frame->repeat_pict * (frame_delay * 0.5);
-						m_video_clock += frame_delay;
-						//qDebug() << "Frame Dealy: "<<frame_delay<<", avq2d:"<<av_q2d(m_timebase)<<", repeat:"<<(m_av_frame->repeat_pict * (frame_delay * 0.5))<<", vidclock: "<<m_video_clock; 
-					}
-
-
-					//QFFMpegVideoFrame video_frame;
-					//video_frame.frame = m_frame;
-					//video_frame.pts = pts;
-					//video_frame.previous_pts = m_previous_pts;
-
-					//m_current_frame = video_frame;
-
-					//emit newFrame(video_frame);
-					//qDebug() << "emit newImage(), frameSize:"<<frame.size();
-					//emit newImage(frame);
-					
-					
-					//calculate the pts delay
-					double pts_delay = pts - m_previous_pts;
-					if((pts_delay < 0.0) || (pts_delay > 1.0))
-						pts_delay = m_previous_pts_delay;
-			
-					m_previous_pts_delay = pts_delay;
-					
-					/* update delay to sync to audio */
-			// 		double ref_clock = get_audio_clock(is);
-			// 		double diff = vp->pts - ref_clock;
-			
-					
-			
-					//calculate the global delay
-					//int global_delay = (m_current_frame.pts * 1000) - m_run_time.elapsed();
-					//m_run_time.elapsed() / 1000; //
-					//double curTime = (double)(av_gettime() / 1000000.0);
-					double curTime = ((double)m_run_time.elapsed() + m_total_runtime) / 1000.0;
-					m_frameTimer += pts_delay;
-					if(m_frameTimer > curTime+.5)
-						m_frameTimer = curTime;
-					if(m_frameTimer < curTime-1.)
-						m_frameTimer = curTime;
-					double actual_delay = m_frameTimer - curTime;
-					//qDebug() << "VideoThread::readFrame(): frame timer: "<<m_frameTimer<<", curTime:"<<curTime<<", \t actual_delay:"<<((int)(actual_delay*1000))<<", pts_delay:"<<((int)(pts_delay*1000))<<", m_run_time:"<<m_run_time.elapsed()<<", m_total_runtime:"<<m_total_runtime;
-					if(actual_delay < 0.010)
-					{
-						// This should just skip this frame
-			// 			qDebug() << "Skipping this frame, skips:"<<m_skipFrameCount;
-			// 			if(status() == Running)
-			// 				m_play_timer = startTimer(0);
-			// 			return;
-						
-						actual_delay = 0.0;
-						
-						m_skipFrameCount ++;
-						
-						if(m_skipFrameCount > MAX_SKIPS_TILL_RESET)
-						{
-							m_skipFrameCount = 0;
-							m_frameTimer = curTime - pts_delay;
-			// 				qDebug() << "Reset frame timer";
-						}
-					}
-					
-					int frameDelay = (int)(actual_delay * 1000 + 0.5);
-					
-					// The count/accum pair is designed to average out sharp
-					// jumps in frameDelay to make the resulting output appear
-					// smoother
-					m_frameSmoothCount ++;
-					m_frameSmoothAccum += frameDelay;
-					
-					//frameDelay = m_frameSmoothAccum / m_frameSmoothCount;
-					
-					// Reset the averaging every 15 sec (approx)
-					if( m_frameSmoothCount % 100 == 0)
-					{
-						m_frameSmoothCount = 0;
-						m_frameSmoothAccum = 0;
-						//qDebug() << "VideoThread::readFrame(): frame smoother reset";
-					}
-					
-					// Arbitrary min/max delays - equals about a max fps of 66fps (15 ms) and a min fps of 9fps (111ms)
-					if(frameDelay < 15)
-						frameDelay = 15;
-					if(frameDelay > 111)
-						frameDelay = 111;
-					//qDebug() << "VideoThread::readFrame(): frameDelay:"<<frameDelay;
-					
-// 					if(m_frameConsumed || (!m_frameConsumed && ++m_frameLockCount > 10))
-// 					{
-// 						m_frameLockCount = 0;
-// 						m_frameConsumed = false;
-
-						//m_time = QTime::currentTime(); 
-						//QTimer::singleShot(frameDelay, this, SLOT(releaseCurrentFrame()));
-						//emit frameReady((int)(pts_delay*1000));
-						
-						//enqueue(VideoFrame(m_frame,frameDelay));
-						
-						enqueue(new VideoFrame(frame.convertToFormat(QImage::Format_ARGB32),pts_delay*1000));
-						
-// 						VideoFrame vidframe;
-// 						vidframe.isRaw = true;
-// 						vidframe.bufferType = VideoFrame::BUFFER_BYTEARRAY;
-// 						const uchar *bits = frame.bits();
-// 						vidframe.byteArray.append((const char*)bits, frame.byteCount());
-// 						vidframe.holdTime = pts_delay*1000;
-// 						vidframe.setSize(frame.size());
-// 						enqueue(vidframe);
-						
-// 						VideoFrame vid(pts_delay*1000);
-// 						QImage rgb32img = frame.convertToFormat(QImage::Format_ARGB32);
-// 						vid.isRaw = true;
-// 						vid.bufferType = VideoFrame::BUFFER_BYTEARRAY;
-// 						vid.pixelFormat = QVideoFrame::Format_ARGB32;
-// 						vid.setSize(m_frame_size);
-// 						vid.byteArray.resize(rgb32img.byteCount());
-// 						const uchar * bits = rgb32img.bits();
-// 						vid.byteArray.append((const char*)bits, rgb32img.byteCount());
-// 						enqueue(vid);
-						
-						//enqueue(VideoFrame(frame,pts_delay*1000));
-// 						VideoFrame vid(pts_delay*1000);
-// 						vid.isRaw = true;
-// 						vid.bufferType = VideoFrame::BUFFER_BYTEARRAY;
-// 						vid.pixelFormat = QVideoFrame::Format_YUV420P;
-// 						//vid.setPointerData(m_av_rgb_frame->data, m_av_rgb_frame->linesize);
-// 						vid.setSize(m_frame_size);
-// 						int frame0 = m_frame_size.width() * m_frame_size.height();
-// 						int frame1 = m_frame_size.width()/2 * m_frame_size.height()/2;
-// 						int frame2 = m_frame_size.width()/2 * m_frame_size.height()/2;
-// 						int maxSize = frame0 + frame1 + frame2;
-// 						qDebug() << "frame0:"<<frame0<<", frame1:"<<frame1+frame0<<", frame2:"<<frame2+frame1+frame0<<m_frame_size;
-// 						vid.byteArray.resize(maxSize);
-// 						vid.byteArray.append((const char*)m_av_frame->data[0], frame0);
-// 						vid.byteArray.append((const char*)m_av_frame->data[1], frame1);
-// 						vid.byteArray.append((const char*)m_av_frame->data[2], frame2);
-// 						
-// 						enqueue(vid);
-						
-						
-						
-						//emit frameReady();
-					//}
-						
-					m_nextDelay = frameDelay; //frameDelay * .5;
-					//QTimer::singleShot(0, this, SLOT(updateTimer()));
-					//updateTimer();
-					
-					m_previous_pts = pts;
-				}
-
+				/* if we have pts, set video clock to it */
+				m_video_clock = pts;
+			} else {
+				/* if we aren't given a pts, set it to the clock */
+				pts = m_video_clock;
 			}
-			else if(packet->stream_index == m_audio_stream)
+			/* update the video clock */
+			double frame_delay = m_frameDuration / 1000.;
+			/* if we are repeating a frame, adjust clock accordingly */
+			frame_delay += m_av_frame->repeat_pict * (frame_delay * 0.5);
+			m_video_clock += frame_delay;
+		}
+		
+		qint64 ptsMs = (qint64)(pts * 1000. + 0.5);
+		
+		// Decoding forward to a seek target - don't even convert frames before it
+		if(ptsMs + m_frameDuration <= m_skipUntil)
+			continue;
+		
+		bool keyFrame = m_av_frame->key_frame;
+		VideoFramePtr frame = convertFrame();
+		
+		*out = VideoThreadFrame(frame, ptsMs);
+		m_lastPts = ptsMs;
+		
+		if(m_gopCaching)
+		{
+			if(!m_gopCache.isEmpty() &&
+			   (keyFrame || m_gopCacheBytes + frame->byteSize() > VIDEOTHREAD_GOP_CACHE_BYTES))
 			{
-// 				mutex.lock();
-				//decode audio packet, store in queue
-				av_free_packet(packet);
-// 				mutex.unlock();
-
+				// Cache ends at the next keyframe, which is where loopRestart() can seek to
+				m_gopCaching = false;
+				m_gopCacheDone = true;
+				m_gopEndPts = ptsMs;
+				//qDebug() << "VideoThread::decodeFrame(): Cached"<<m_gopCache.size()<<"frames, up to"<<m_gopEndPts<<"ms";
 			}
 			else
 			{
-// 				mutex.lock();
-				av_free_packet(packet);
-// 				mutex.unlock();
-
+				m_gopCache << *out;
+				m_gopCacheBytes += frame->byteSize();
 			}
 		}
+		
+		return true;
+	}
+	
+	return false;
+}
+
+VideoFramePtr VideoThread::convertFrame()
+{
+	const int w = m_video_codec_context->width;
+	const int h = m_video_codec_context->height;
+	const PixelFormat srcFormat = m_video_codec_context->pix_fmt;
+	
+	// setYuvOutput() flips this from the GUI thread
+	m_decodeMutex.lock();
+	const bool yuvOutput = m_yuvOutput;
+	m_decodeMutex.unlock();
+	
+	if(yuvOutput && w % 2 == 0 && h % 2 == 0)
+	{
+		VideoFrame *frame = new VideoFrame(m_frameDuration, QTime::currentTime());
+		
+		if(srcFormat == PIX_FMT_YUV420P)
+		{
+			// Already what we want, just strip the decoder's line padding
+			frame->setYuv420PData(m_av_frame->data, m_av_frame->linesize, QSize(w,h));
+		}
 		else
 		{
-			//emit reachedEnd();
-			//qDebug() << "reachedEnd()";
-			restart();
+			// Planes back to back, which is the layout GLVideoDrawable expects for YUV420P
+			const int ySize  = w * h;
+			const int uvSize = ySize / 4;
+			uchar *pointer = frame->allocPointer(ySize + uvSize * 2);
+			frame->setPixelFormat(QVideoFrame::Format_YUV420P);
+			frame->setSize(QSize(w,h));
+			
+			uint8_t *dst[4] = { pointer, pointer + ySize, pointer + ySize + uvSize, 0 };
+			int dstStride[4] = { w, w/2, w/2, 0 };
+			
+			m_sws_context = sws_getCachedContext(m_sws_context,
+				w, h, srcFormat,
+				w, h, PIX_FMT_YUV420P,
+				SWS_FAST_BILINEAR, NULL, NULL, NULL);
 			
+			sws_scale(m_sws_context, m_av_frame->data, m_av_frame->linesize, 0, h, dst, dstStride);
 		}
+		
+		return VideoFramePtr(frame);
 	}
-	//qDebug() << "VideoThread::readFrame(): end of function";
+	
+	// Scale right into the image the frame keeps, instead of into a shared buffer which then has to be copied
+	QImage image(w, h, QImage::Format_ARGB32);
+	uint8_t *dst[4] = { image.bits(), 0, 0, 0 };
+	int dstStride[4] = { image.bytesPerLine(), 0, 0, 0 };
+	
+	m_sws_context = sws_getCachedContext(m_sws_context,
+		w, h, srcFormat,
+		w, h, PIX_FMT_RGB32,
+		SWS_FAST_BILINEAR, NULL, NULL, NULL);
+	
+	sws_scale(m_sws_context, m_av_frame->data, m_av_frame->linesize, 0, h, dst, dstStride);
+	
+	return VideoFramePtr(new VideoFrame(image, m_frameDuration, QTime::currentTime()));
 }
 
-/*
-QImage VideoThread::frame()
+void VideoThread::seekDecoder(qint64 ms, int flags)
 {
-	qDebug() << "VideoThread::frame()";
-	QImage ref;
-	m_bufferMutex.lock();
-	ref = m_frame.copy();
-	m_bufferMutex.unlock();
-	m_frameConsumed = true;
-	return ref;
-	//return m_frame;
-}*/
+	// Always land on the keyframe before the target and decode forward from there
+	int64_t seek_target = av_rescale(ms, m_timebase.den, (int64_t)m_timebase.num * 1000) + m_start_pts;
+	
+	av_seek_frame(m_av_format_context, m_video_stream, seek_target, flags | AVSEEK_FLAG_BACKWARD);
+	avcodec_flush_buffers(m_video_codec_context);
+	
+	m_skipUntil = ms;
+	m_video_clock = ms / 1000.;
+}
 
-void VideoThread::releaseCurrentFrame()
+void VideoThread::loopRestart()
 {
-	//emit frameReady(1000/30);
+	//qDebug() << "VideoThread::loopRestart(): Reached end, last pts:"<<m_lastPts;
+	if(m_lastPts < 0)
+	{
+		// Didn't get a single frame out of the file this time around, don't spin
+		msleep(100);
+	}
+	else
+	{
+		// Next pass through the file continues the presentation clock from where this one ended
+		m_loopOffset += m_lastPts + m_frameDuration;
+	}
+	m_lastPts = -1;
+	
+	if(m_gopCaching)
+	{
+		// Reached the end while still caching - the entire file is in memory
+		m_gopCaching = false;
+		m_gopCacheDone = !m_gopCache.isEmpty();
+		m_gopCacheComplete = m_gopCacheDone;
+	}
+	
+	if(m_gopCacheDone)
+	{
+		// Replay the cached frames while the decoder picks up after them
+		m_replayIndex = 0;
+		if(!m_gopCacheComplete)
+			seekDecoder(m_gopEndPts);
+	}
+	else
+	{
+		seekDecoder(0);
+		m_gopCache.clear();
+		m_gopCacheBytes = 0;
+		m_gopCaching = true;
+	}
 }
 
-void VideoThread::updateTimer()
+void VideoThread::releaseCurrentFrame()
 {
-	int delay = qMax(m_nextDelay,10);
-	m_readTimer->setInterval(delay);
-	//qDebug() << "VideoThread::updateTimer(): delay:"<<delay;
+	//emit frameReady(1000/30);
 }
 
-// 
+//
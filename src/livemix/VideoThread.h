@@ -25,10 +25,57 @@ extern "C" {
 #include <QTime>
 #include <QMovie>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+#include <QMap>
+#include <QSet>
 
 #include "VideoSource.h"
 
+/// Number of decoded frames VideoThread keeps ready ahead of the presentation clock
+#define VIDEOTHREAD_MAX_QUEUE 8
+
+/// Upper bound on the memory used to cache the first GOP of a file for instant loop restarts
+#define VIDEOTHREAD_GOP_CACHE_BYTES (48 * 1024 * 1024)
+
+/// If the next frame is this late (in ms), the presentation clock is moved to the frame instead of dropping frames to catch up
+#define VIDEOTHREAD_RESYNC_MS 500
+
+/// A decoded frame waiting in VideoThread's decode-ahead queue (or GOP cache)
+class VideoThreadFrame
+{
+public:
+	VideoThreadFrame(VideoFramePtr f = VideoFramePtr(), qint64 at = 0)
+		: frame(f)
+		, presentAt(at)
+		{}
+	
+	VideoFramePtr frame;
+	/// Time on the presentation clock (ms) at which the frame is due. For cached GOP frames, the frame's PTS.
+	qint64 presentAt;
+};
+
 class VideoWidget;
+/// \class VideoThread
+/// Plays a video file with libavcodec.
+///
+/// The thread itself (run()) is a decode-ahead worker: it keeps up to VIDEOTHREAD_MAX_QUEUE decoded frames
+/// ready, so a slow frame (e.g. a big keyframe) doesn't stall playback. Frames are released to consumers
+/// from the thread VideoThread lives in by presentFrame(), according to a presentation clock driven by the
+/// frames' PTS - late frames are dropped, not delayed.
+///
+/// Frames are ARGB32 QImages unless every consumer accepts YUV420P (see VideoSource::setAcceptedFormats()), in which
+/// case they are passed on as raw planar YUV420P frames and the colorspace conversion is left to the GPU.
+///
+/// seek() is frame-accurate: the decoder seeks to the keyframe before the target and decodes forward to it.
+///
+/// The first GOP of the file is kept decoded in memory, so when the file loops the first frames are available
+/// immediately while the demuxer seeks past them. Short clips that fit in VIDEOTHREAD_GOP_CACHE_BYTES
+/// entirely are only decoded once.
+///
+/// Drawables that show the same file should use threadForFile() instead of creating their own VideoThread, so the
+/// file is decoded once no matter how many outputs or scenes show it.
 class VideoThread: public VideoSource
 {
 	Q_OBJECT
@@ -36,6 +83,18 @@ class VideoThread: public VideoSource
 public:
 	VideoThread(QObject *parent=0);
 	~VideoThread();
+	
+	/// Returns the (started, paused) VideoThread playing \a file on the timeline named \a clock, creating it if needed.
+	/// Consumers asking for the same file and clock share one thread, which is destroyed when its last
+	/// consumer calls release(). Use detachConsumer() before seeking a shared thread.
+	static VideoThread *threadForFile(const QString& file, const QString& clock = QString());
+	
+	/// For a consumer about to seek on its own: if other consumers share this thread, returns a new thread for the
+	/// same file at the same position, which \a consumer should switch to. Returns this thread if \a consumer is its only consumer.
+	VideoThread *detachConsumer(QObject *consumer);
+	
+	/// Plays while at least one consumer wants it to, so one drawable going off air doesn't pause the file on every other output
+	void setConsumerPlaying(QObject *consumer, bool flag);
 
 	void setVideo(const QString&);
 
@@ -45,22 +104,31 @@ public:
 	void registerConsumer(VideoWidget */*consumer*/) {}
 	void release(VideoWidget */*consumer*/=0) {}
 	
-	//QImage frame();
 	virtual VideoFormat videoFormat();
 	
 	QString videoFile() { return m_videoFile; }
 	
 	double duration() { return m_duration; }
 	
+	/// If true, video is delivered as raw YUV420P frames instead of being converted to ARGB32.
+	/// Set automatically from the formats the consumers accept.
+	bool yuvOutput() { return m_yuvOutput; }
+	void setYuvOutput(bool flag);
+	
+	/// Current position of the presentation clock in milliseconds
+	qint64 clockTime();
+	
+	/// Number of decoded frames dropped because they were late
+	int droppedFrames() { return m_droppedFrames; }
+	
 	virtual void start(bool startPaused=false);
 	
 signals:
-	//void newImage(QImage,QTime);
-	//void frameReady(int frameHoldTime);
 	void movieStateChanged(QMovie::MovieState);
 
 public slots:
-	void seek(int ms, int flags);
+	/// Seeks to \a ms. \a flags are passed on to av_seek_frame(), which always seeks backward to the preceding keyframe
+	void seek(int ms, int flags=0);
 	void restart();
 	void play();
 	void pause();
@@ -68,21 +136,44 @@ public slots:
 	void setStatus(Status);
 
 protected slots:
-	void readFrame();
+	/// Releases the frame due on the presentation clock and schedules itself for the next one
+	void presentFrame();
  	void releaseCurrentFrame();
- 	void updateTimer();
 
 protected:
 	void run();
+	
+	// VideoSource::
+	virtual void acceptedFormatsChanged();
+	virtual void consumerReleased(QObject*);
+	virtual void destroySource();
 
 	void freeResources();
 	int initVideo();
 
-
 	void calculateVideoProperties();
 	
+	/// Worker: returns the next frame to queue - from the GOP cache or the decoder
+	bool nextFrame(VideoThreadFrame*);
+	/// Worker: decodes packets until a frame comes out. Returns false at the end of the file.
+	bool decodeFrame(VideoThreadFrame*);
+	/// Worker: wraps the decoded m_av_frame in a VideoFrame
+	VideoFramePtr convertFrame();
+	/// Worker: seeks the demuxer to the keyframe before \a ms and arranges for frames before \a ms to be skipped
+	void seekDecoder(qint64 ms, int flags=0);
+	/// Worker: handles the end of the file
+	void loopRestart();
+	
+	/// Moves the presentation clock so that it reads \a ms right now
+	void setClock(qint64 ms);
 	
 private:
+	static QMap<QString,VideoThread*> m_threadMap;
+	static QMutex threadCacheMutex;
+	/// Key in m_threadMap, empty for threads not created by threadForFile()
+	QString m_cacheKey;
+	QSet<QObject*> m_playingConsumers;
+	
 	QTimer *m_readTimer;
 
 	AVFormatContext * m_av_format_context;
@@ -91,34 +182,14 @@ private:
 	AVCodec * m_video_codec;
 	AVCodec * m_audio_codec;
 	AVFrame * m_av_frame;
-	AVFrame * m_av_rgb_frame;
 	SwsContext * m_sws_context;
 	AVRational m_time_base_rational;
-	uint8_t * m_buffer;
 	int m_video_stream;
 	int m_audio_stream;
 
-	//QVideoBuffer * m_video_buffer;
-	//QVideoBuffer * m_audio_buffer;
-
-	QImage m_frame;
-
-// 	SDL_AudioSpec wanted_spec;
-// 	SDL_AudioSpec spec;
-
-	//QVideo * m_video;
-	//QFFMpegVideoFrame m_current_frame;
-
 	AVRational m_timebase;
-
-	quint64 m_start_timestamp;
-	bool m_initial_decode;
-
-	double m_previous_pts;
-
-	int m_decode_timer;
-
-	bool m_killed;
+	/// Start time of the video stream in m_timebase units, subtracted from every PTS so the first frame is at 0ms
+	int64_t m_start_pts;
 
 	double m_video_clock; ///<pts of last decoded frame / predicted pts of next decoded frame
 
@@ -126,30 +197,54 @@ private:
 
 	QString m_videoFile;
 	
-	double m_previous_pts_delay;
 	QSize m_frame_size;
 	double m_duration;
 	double m_fpms;
 	double m_frame_rate;
-
-	QTime m_run_time;
-	int m_total_runtime;
+	/// Nominal frame duration in ms
+	int m_frameDuration;
 	
 	Status m_status;
+	bool m_yuvOutput;
+	
+	/// Presentation clock: m_clockBase + time elapsed on m_run_time while running
+	QTime m_run_time;
+	qint64 m_clockBase;
 	
-	double m_frameTimer;
-	int m_skipFrameCount;
-	QTime m_time;
+	/// Guards the decode queue and the seek/format requests passed to the worker
+	QMutex m_decodeMutex;
+	QWaitCondition m_queueNotFull;
+	QQueue<VideoThreadFrame> m_decodeQueue;
 	
-	QMutex m_bufferMutex;
-	int m_nextDelay;
-	bool m_frameConsumed;
-	int m_frameLockCount;
+	bool m_seekPending;
+	qint64 m_seekTarget;
+	int m_seekFlags;
+	bool m_formatChanged;
+	/// presentAt of the next frame that was queued when the format changed - the worker decodes again from there. -1 if none
+	qint64 m_formatResumeAt;
+	/// Show the next frame out of the queue right away and restart the clock from it (after a seek or while paused)
+	bool m_presentFirst;
+	int m_droppedFrames;
 	
-	int m_frameSmoothCount;
-	int m_frameSmoothAccum;
+	// Worker state, only touched by run()
+	/// Decoded frames before this PTS (ms) are thrown away - used by seekDecoder()
+	qint64 m_skipUntil;
+	/// Added to frame PTS to get presentAt - grows by the length of the file on every loop
+	qint64 m_loopOffset;
+	qint64 m_lastPts;
 	
-	bool m_startPaused;
+	QList<VideoThreadFrame> m_gopCache;
+	int m_gopCacheBytes;
+	/// True while decoding from the start of the file and adding frames to m_gopCache
+	bool m_gopCaching;
+	/// True once m_gopCache holds the start of the file up to m_gopEndPts
+	bool m_gopCacheDone;
+	/// True if m_gopCache holds the whole file
+	bool m_gopCacheComplete;
+	/// PTS of the first frame after the cached ones
+	qint64 m_gopEndPts;
+	/// Index of the next cached frame to queue while replaying the GOP cache after a loop, -1 if not replaying
+	int m_replayIndex;
 };
 
 
@@ -37,9 +37,12 @@ HEADERS += CameraThread.h \
 	MdiMjpegWidget.h \
 #	MdiPreviewWidget.h \
 	DVizSharedMemoryThread.h \
+	SharedMemoryRing.h \
 	MdiDVizWidget.h \
 	../glvidtex/GLWidget.h \
 	../glvidtex/GLDrawable.h \
+	../glvidtex/GLScheduler.h \
+	../glvidtex/GLProfiler.h \
 	../glvidtex/GLVideoDrawable.h \
 	../glvidtex/StaticVideoSource.h \
 	../glvidtex/TextVideoSource.h \
@@ -76,9 +79,12 @@ SOURCES += main.cpp \
 	MdiMjpegWidget.cpp \
 #	MdiPreviewWidget.cpp \
 	DVizSharedMemoryThread.cpp \
+	SharedMemoryRing.cpp \
 	MdiDVizWidget.cpp \
 	../glvidtex/GLWidget.cpp \
 	../glvidtex/GLDrawable.cpp \
+	../glvidtex/GLScheduler.cpp \
+	../glvidtex/GLProfiler.cpp \
 	../glvidtex/GLVideoDrawable.cpp \
 	../glvidtex/StaticVideoSource.cpp \
 	../glvidtex/TextVideoSource.cpp \
@@ -11,6 +11,31 @@
 #include "OutputViewItem.h"
 #include "ItemFactory.h"
 
+QHash<const QMetaObject*, QVariantList> AbstractItem::m_classDefaults;
+QMutex AbstractItem::m_cloneMutex;
+
+// 64 bit FNV-1a, finished with MurmurHash3's fmix64 so that values differing
+// by a single bit don't end up with hashes that only differ in a few bits
+static quint64 AbstractItem_hashBytes(const QByteArray& bytes)
+{
+	quint64 hash = Q_UINT64_C(14695981039346656037);
+	const char *data = bytes.constData();
+	int size = bytes.size();
+	for(int i=0; i<size; i++)
+	{
+		hash ^= (uchar)data[i];
+		hash *= Q_UINT64_C(1099511628211);
+	}
+	
+	hash ^= hash >> 33;
+	hash *= Q_UINT64_C(0xff51afd7ed558ccd);
+	hash ^= hash >> 33;
+	hash *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+	hash ^= hash >> 33;
+	
+	return hash;
+}
+
 // Translated from a perl function I wrote to do basically
 // the same thing for an ERP project a few years back.
 QString AbstractItem::guessTitle(QString field)
@@ -52,6 +77,9 @@ AbstractItem::AbstractItem() :
 	  m_isBeingLoaded(false)
 	, m_isChanged(false)
 	, m_revision(0)
+	, m_clonePropertiesValid(false)
+	, m_contentHash(0)
+	, m_contentHashValid(false)
 {}
 
 ITEM_PROPSET(AbstractItem, ItemId,   quint32, itemId);
@@ -59,6 +87,25 @@ ITEM_PROPSET(AbstractItem, ItemName, QString, itemName);
 
 void AbstractItem::setChanged(QString name, QVariant value, QVariant oldValue)
 {
+	// Even while loading - the values cloneTo() would copy aren't the same anymore
+	m_clonePropertiesValid = false;
+	
+	// Swap the old hash of just this property for the new one
+	if(m_contentHashValid)
+	{
+		int idx = metaObject()->indexOfProperty(qPrintable(name));
+		if(idx < 0)
+		{
+			m_contentHashValid = false;
+		}
+		else
+		{
+			quint64 hash = hashProperty(idx);
+			m_contentHash ^= m_propertyHashes[idx] ^ hash;
+			m_propertyHashes[idx] = hash;
+		}
+	}
+	
 	if(!isBeingLoaded())
 	{
 		if(value != oldValue)
@@ -90,20 +137,48 @@ AbstractItem * AbstractItem::cloneTo(AbstractItem *item) const
 	// properties, just assume all inherited objects delcare the relevant
 	// properties using Q_PROPERTY macro
 	const QMetaObject *metaobject = metaObject();
-	int count = metaobject->propertyCount();
-	for (int i=0; i<count; ++i)
+	if(item->metaObject() == metaobject)
 	{
-		QMetaProperty metaproperty = metaobject->property(i);
-		const char *name = metaproperty.name();
-		QVariant value = property(name);
-// 		qDebug() << "AbstractItem::clone():"<<itemName()<<": prop:"<<name<<", value:"<<value;
-		item->setProperty(name,value);
+		// Only write the properties that differ from the defaults the new item already has.
+		// Since QString, QImage, QPen, etc are implicitly shared, the clone references the same
+		// data as this item until one of its own setters writes over it - so cloning a template
+		// for every slide of a song doesn't copy the template's text, images, etc for each slide.
+		ClonePropertyList props = cloneProperties(item);
+		foreach(CloneProperty prop, props)
+		{
+// 			qDebug() << "AbstractItem::clone():"<<itemName()<<": prop:"<<metaobject->property(prop.first).name()<<", value:"<<prop.second;
+			metaobject->property(prop.first).write(item, prop.second);
+		}
+		
+		// Same content, same hash - itemId and itemName aren't part of it
+		if(m_contentHashValid)
+		{
+			item->m_propertyHashes   = m_propertyHashes;
+			item->m_contentHash      = m_contentHash;
+			item->m_contentHashValid = true;
+		}
+	}
+	else
+	{
+		// Subclass didn't override clone(), so item isn't the same class - copy everything by name
+		int count = metaobject->propertyCount();
+		for (int i=0; i<count; ++i)
+		{
+			QMetaProperty metaproperty = metaobject->property(i);
+			const char *name = metaproperty.name();
+			QVariant value = property(name);
+// 			qDebug() << "AbstractItem::clone():"<<itemName()<<": prop:"<<name<<", value:"<<value;
+			item->setProperty(name,value);
+		}
 	}
 
 	item->setItemId(ItemFactory::nextId());
 	//newItem->setItemName(QString("NewItem%1").arg(bg->itemId()));
 	QString name = item->itemName();
-	static QRegExp rxEndingDigits("(\\d+)$");
+	// Copied since items are also cloned off the GUI thread (see SongTextToSlidesJob) and
+	// QRegExp keeps its match state in the instance
+	static const QRegExp rxEndingDigitsStatic("(\\d+)$");
+	QRegExp rxEndingDigits = rxEndingDigitsStatic;
 	name.replace(rxEndingDigits,QString::number(item->itemId()));
 	item->setItemName(name);
 	
@@ -114,6 +189,50 @@ AbstractItem * AbstractItem::cloneTo(AbstractItem *item) const
 	return item;
 }
 
+AbstractItem::ClonePropertyList AbstractItem::cloneProperties(const AbstractItem *freshItem) const
+{
+	QMutexLocker lock(&m_cloneMutex);
+	
+	if(m_clonePropertiesValid)
+		return m_cloneProperties;
+	
+	const QMetaObject *metaobject = metaObject();
+	int count = metaobject->propertyCount();
+	
+	// Item constructors only set fixed defaults, so the first fresh item of a class
+	// seen here stands for all of them
+	if(!m_classDefaults.contains(metaobject))
+	{
+		QVariantList defaults;
+		for (int i=0; i<count; ++i)
+			defaults << metaobject->property(i).read(freshItem);
+		m_classDefaults.insert(metaobject, defaults);
+	}
+	
+	const QVariantList defaults = m_classDefaults.value(metaobject);
+	
+	m_cloneProperties.clear();
+	for (int i=0; i<count; ++i)
+	{
+		QMetaProperty metaproperty = metaobject->property(i);
+		
+		// cloneTo() assigns a new itemId anyway
+		if(!metaproperty.isWritable() ||
+		   strcmp(metaproperty.name(),"itemId") == 0)
+			continue;
+		
+		// Types QVariant can't compare never test equal, so they're always copied
+		QVariant value = metaproperty.read(this);
+		if(value != defaults.at(i))
+			m_cloneProperties << CloneProperty(i, value);
+	}
+	
+	//qDebug() << "AbstractItem::cloneProperties():"<<itemName()<<": "<<m_cloneProperties.size()<<"of"<<count<<"properties differ from defaults";
+	
+	m_clonePropertiesValid = true;
+	return m_cloneProperties;
+}
+
 QByteArray AbstractItem::toByteArray() const
 {
 	QByteArray array;
@@ -316,35 +435,80 @@ void AbstractItem::loadVariantMap(QVariantMap &map)
 
 quint32 AbstractItem::valueKey()
 {
-	m_valueKeyTmp.clear();
-	QDataStream b(&m_valueKeyTmp, QIODevice::WriteOnly);
+	quint64 hash = contentHash();
+	return (quint32)(hash ^ (hash >> 32));
+}
+
+quint64 AbstractItem::hashProperty(int index) const
+{
+	QMetaProperty metaproperty = metaObject()->property(index);
+	const char *name = metaproperty.name();
+	
+	// Identity, not content
+	if(strcmp(name,"objectName") == 0 ||
+	   strcmp(name,"itemId") == 0 ||
+	   strcmp(name,"itemName") == 0)
+		return 0;
+	
+	QByteArray bytes;
+	QDataStream stream(&bytes, QIODevice::WriteOnly);
+	
+	// Include the name so equal values in different properties don't cancel out in contentHash()
+	stream << QByteArray(name);
+	
+	QVariant value = metaproperty.read(this);
+	if(value.type() == QVariant::Image)
+	{
+		// Hash the pixels, not a PNG-compressed copy (which is what QDataStream would give us)
+		QImage image = value.value<QImage>();
+		stream << image.size() << (int)image.format();
+		stream.writeRawData((const char*)image.bits(), image.byteCount());
+	}
+	else
+	if(value.isValid() && value.type() < QVariant::UserType)
+	{
+		stream << value;
+	}
+	else
+	{
+		stream << value.toString();
+	}
 	
+	return AbstractItem_hashBytes(bytes);
+}
+
+void AbstractItem::updateContentHash() const
+{
 	const QMetaObject *metaobject = metaObject();
 	int count = metaobject->propertyCount();
+	
+	m_propertyHashes.resize(count);
+	m_contentHash = 0;
 	for (int i=0; i<count; ++i)
 	{
-		QMetaProperty metaproperty = metaobject->property(i);
-		const char *name = metaproperty.name();
-		if(strcmp(name,"objectName") != 0 &&
-			strcmp(name,"itemId") != 0 &&
-			strcmp(name,"itemName") != 0)
-		{
-			QVariant value = property(name);
-			b << name;
-			b << value.toString();
-		}
+		m_propertyHashes[i] = hashProperty(i);
+		m_contentHash ^= m_propertyHashes[i];
 	}
 	
-	quint32 val = 0;
-	const char *data = m_valueKeyTmp.constData();
-	for(int i=0;i<m_valueKeyTmp.size();i++)
-	{
-		val += data[i];
-	}
-	//qDebug() << "Item:"<<itemName()<<": int:"<<val<<" (size:"<<m_valueKeyTmp.size()<<")";
+	m_contentHashValid = true;
+}
+
+quint64 AbstractItem::contentHash() const
+{
+	if(!m_contentHashValid)
+		updateContentHash();
+	return m_contentHash;
+}
+
+quint64 AbstractItem::propertyHash(const char *name) const
+{
+	int idx = metaObject()->indexOfProperty(name);
+	if(idx < 0)
+		return 0;
 	
-	//return m_valueKeyTmp.constData();
-	return val;
+	if(!m_contentHashValid)
+		updateContentHash();
+	return m_propertyHashes[idx];
 }
 
 bool AbstractItem::fromXml(QDomElement & pe)
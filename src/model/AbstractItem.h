@@ -7,6 +7,10 @@
 #include <QPen>
 #include <QBrush>
 #include <QList>
+#include <QPair>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
 
 #define ITEM_PROPSET(className,setterName,typeName,memberName) \
 	void className::set##setterName(typeName newValue) { \
@@ -67,8 +71,18 @@ public:
 	// If any property of this model changes, the valueKey() should change,
 	// but the valueKey() should NOT change across program instances
 	// or file instances if the properties are EXACTLY the same
+	// - Now just contentHash() folded to 32 bits, use contentHash() instead
 	virtual quint32 valueKey();
 	
+	// 64 bit hash of every property except itemId and itemName, so two items that look the same
+	// hash the same - across program instances as well. Computed in full on the first call, then
+	// updated one property at a time by setChanged(), so it's cheap enough to use as a cache key.
+	quint64 contentHash() const;
+	
+	// Hash of a single property (name and value) as folded into contentHash() - for caches that
+	// only depend on some of the properties. Returns 0 for unknown properties.
+	quint64 propertyHash(const char *name) const;
+	
 	// ++ every time setChanged() is called, starts at zero for every object
 	quint32 revision() { return m_revision; }
 	
@@ -86,6 +100,17 @@ protected:
 	void loadVariantMap(QVariantMap &);
 
 private:
+	// (property index, value) pairs that cloneTo() writes into the new item
+	typedef QPair<int,QVariant> CloneProperty;
+	typedef QList<CloneProperty> ClonePropertyList;
+	
+	// Properties of this item which differ from a freshly-constructed item of the same class,
+	// built on the first clone and reused until setChanged() is called again
+	ClonePropertyList cloneProperties(const AbstractItem *freshItem) const;
+	
+	// Hashes property \a index of this item from scratch
+	quint64 hashProperty(int index) const;
+	void updateContentHash() const;
 
 	// Fields
 	qint32		m_itemClass;
@@ -100,7 +125,16 @@ private:
 	
 	quint32 	m_revision; // ++ every time setChanged() is called, starts at zero for every object
 	
-	QByteArray 	m_valueKeyTmp; // used to create the valueKey()
+	mutable QVector<quint64> m_propertyHashes; // by property index, xor'ed together for m_contentHash
+	mutable quint64	m_contentHash;
+	mutable bool	m_contentHashValid;
+	
+	mutable ClonePropertyList m_cloneProperties;
+	mutable bool	m_clonePropertiesValid;
+	
+	// Property values of a freshly-constructed item, by class - see cloneProperties()
+	static QHash<const QMetaObject*, QVariantList> m_classDefaults;
+	static QMutex m_cloneMutex;
 
 };
 
@@ -1,5 +1,7 @@
 #include "Document.h"
 #include "SlideGroup.h"
+#include "Slide.h"
+#include "DocumentJournal.h"
 
 #include <assert.h>
 
@@ -30,13 +32,16 @@
 
 #include <QProgressDialog>
 #include <QApplication>
+#include <QThreadPool>
 
 #include <QMutex>
 #include <QMutexLocker>
 QMutex document_saveMutex;
 
-Document::Document(const QString & s) : m_docTitle(""), m_filename(""), m_aspectRatio(4/3)
+Document::Document(const QString & s) : m_docTitle(""), m_filename(""), m_aspectRatio(4/3), m_loadJobCount(0), m_nextLoadIndex(0), m_journal(0), m_recoveryPending(false)
 {
+	m_journal = new DocumentJournal(this);
+	
 	double ar = AppSettings::liveAspectRatio();
 	if(ar > -1)
 		m_aspectRatio = ar;
@@ -48,6 +53,8 @@ Document::Document(const QString & s) : m_docTitle(""), m_filename(""), m_aspect
 
 Document::~Document() 
 {
+	// The jobs still running would have nobody to hand their groups to
+	waitForLoad();
 	qDeleteAll(m_groups);
 }
 
@@ -65,6 +72,17 @@ SlideGroup * Document::groupById(int id)
 	foreach(SlideGroup *group, m_groups)
 		if(group && group->groupId() == id)
 			return group;
+	
+	// Callers (templates, group players, etc) look groups up right after loading - if it's not
+	// here yet it may still be on its way, so finish loading before giving up on it
+	if(isLoading() && QThread::currentThread() == thread())
+	{
+		waitForLoad();
+		foreach(SlideGroup *group, m_groups)
+			if(group && group->groupId() == id)
+				return group;
+	}
+	
 	return 0;
 }
 
@@ -84,6 +102,7 @@ void Document::addGroup(SlideGroup *g)
 		g->setGroupNumber(m_groups.size());
 	emit slideGroupChanged(g, "add", 0, "", 0, "", "", QVariant());
 	connect(g,SIGNAL(slideChanged(Slide *, QString, AbstractItem *, QString, QString, QVariant)),this,SLOT(slideChanged(Slide *, QString, AbstractItem *, QString, QString, QVariant)));
+	connect(g,SIGNAL(slideItemChangedUnbatched(Slide *, AbstractItem *, QString, QString, QVariant, QVariant)),m_journal,SLOT(slideItemChanged(Slide *, AbstractItem *, QString, QString, QVariant, QVariant)));
 
 }
 
@@ -91,6 +110,7 @@ void Document::removeGroup(SlideGroup *g)
 {
 	assert(g != NULL);
 	disconnect(g,0,this,0);
+	disconnect(g,0,m_journal,0);
 	m_groups.removeAll(g);
 	emit slideGroupChanged(g, "remove", 0, "", 0, "", "", QVariant());
 
@@ -104,12 +124,80 @@ void Document::slideChanged(Slide *slide, QString slideOperation, AbstractItem *
 }
 
 void Document::setDocTitle(QString s)  { m_docTitle = s; }
-void Document::setFilename(QString s)  { m_filename = s; }
+void Document::setFilename(QString s)
+{
+	m_filename = s;
+	armJournal();
+}
+
+void Document::armJournal()
+{
+	// Until the user decides what to do with the last session's recovery file, recording would overwrite it
+	m_journal->setRecoveryFile(m_recoveryPending ? QString() : recoveryFileFor(m_filename));
+}
+
+QString Document::recoveryFileFor(const QString & filename)
+{
+	return filename.isEmpty() ? QString() : QString("%1.recovery").arg(filename);
+}
+
+bool Document::hasRecoveryFile()
+{
+	return m_recoveryPending && QFile(recoveryFile()).exists();
+}
+
+int Document::applyRecoveryFile()
+{
+	if(!hasRecoveryFile())
+		return -1;
+	
+	// The changes may well be to groups that are still loading
+	waitForLoad();
+	
+	// Move it out of the journal's way - once armed, the journal starts recoveryFile() over, and
+	// the changes replayed below are recorded into it again
+	QString pending = QString("%1.pending").arg(recoveryFile());
+	QFile::remove(pending);
+	if(!QFile::rename(recoveryFile(), pending))
+	{
+		qDebug() << "Document::applyRecoveryFile(): Unable to move"<<recoveryFile()<<"to"<<pending;
+		return -1;
+	}
+	
+	m_recoveryPending = false;
+	armJournal();
+	
+	int applied = m_journal->replay(pending);
+	
+	// Left in place if it couldn't be read, so nothing is lost
+	if(applied >= 0)
+		QFile::remove(pending);
+	
+	return applied;
+}
+
+void Document::discardRecoveryFile()
+{
+	if(!m_recoveryPending)
+		return;
+	
+	QFile::remove(recoveryFile());
+	m_recoveryPending = false;
+	armJournal();
+}
 
 void Document::load(const QString & s)
 {
+	waitForLoad();
+	
 	m_filename = s;
 	
+	// Loading isn't a change - the journal starts recording once the file is loaded
+	m_journal->setRecoveryFile(QString());
+	
+	// Left over from a session that never saved its last changes - see applyRecoveryFile()
+	m_recoveryPending = QFile(recoveryFileFor(m_filename)).exists();
+	
 	// Load the file
 	QFile file(m_filename);
 	if (!file.open(QIODevice::ReadOnly)) 
@@ -151,6 +239,7 @@ void Document::load(const QString & s)
 		QDomElement root = doc.documentElement(); // The root node
 		
 		fromXml(root);
+		armJournal();
 		return;
 	}
 	else
@@ -172,26 +261,76 @@ void Document::load(const QString & s)
 
 
 		QVariantList items = map["groups"].toList();
-
-		progress.setMaximum(items.size());
-		progress.setLabelText("Processing data...");
-		QApplication::processEvents();
 		
-		int count = 0;
-		foreach(QVariant var, items)
+		// Decode the groups in parallel. The pool picks up jobs in the order they're started, so the first
+		// groups in the file (the start of the service) are decoded first, and groupLoadJobDone() adds them
+		// to the document in file order as they come in.
+		m_loadJobCount = items.size();
+		m_nextLoadIndex = 0;
+		for(int i=0; i<items.size(); i++)
 		{
-			progress.setValue(count ++);
-			QApplication::processEvents();
+			DocumentGroupLoadJob *job = new DocumentGroupLoadJob(thread(), i, items[i].toByteArray());
+			connect(job, SIGNAL(done()), this, SLOT(groupLoadJobDone()));
+			m_loadPool.start(job);
+		}
+		
+		// Only wait for the first few, so there's something to work with right away -
+		// the rest show up in the DocumentListModel like any other added group
+		int first = qMin(DOCUMENT_LOAD_WAIT_GROUPS, m_loadJobCount);
 
-			QByteArray ba = var.toByteArray();
-			SlideGroup * group = SlideGroup::fromByteArray(ba,this);
-			qDebug() << "Load Group: nbr:"<<group->groupNumber()<<", name:"<<group->assumedName();
-			addGroup(group);
+		progress.setMaximum(first);
+		progress.setLabelText("Processing data...");
+		while(m_nextLoadIndex < first)
+		{
+			progress.setValue(m_nextLoadIndex);
+			QApplication::processEvents(QEventLoop::WaitForMoreEvents);
 		}
 	}
 	
 	file.close();
 	
+	armJournal();
+}
+
+void Document::groupLoadJobDone()
+{
+	DocumentGroupLoadJob *job = dynamic_cast<DocumentGroupLoadJob*>(sender());
+	if(!job)
+		return;
+	
+	m_loadedJobs.insert(job->index(), job);
+	
+	while(m_loadedJobs.contains(m_nextLoadIndex))
+	{
+		DocumentGroupLoadJob *next = m_loadedJobs.take(m_nextLoadIndex);
+		m_nextLoadIndex ++;
+		
+		QVariantMap map = next->takeMap();
+		SlideGroup * group = SlideGroup::groupFromVariantMap(map,this);
+		if(group)
+		{
+			qDebug() << "Load Group: nbr:"<<group->groupNumber()<<", name:"<<group->assumedName();
+			addGroup(group);
+		}
+		else
+		{
+			// No group to take the slides built for it
+			foreach(QVariant var, map["SlideGroup.LoadedSlides"].toList())
+				delete var.value<QObject*>();
+		}
+		
+		next->deleteLater();
+	}
+}
+
+void Document::waitForLoad()
+{
+	while(isLoading())
+	{
+		// Once the pool is done, all that's left is delivering the done() signals
+		m_loadPool.waitForDone();
+		QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+	}
 }
 
 bool Document::fromXml(QDomElement & pe)
@@ -244,8 +383,12 @@ bool Document::fromXml(QDomElement & pe)
 		addGroup(g);
 		
 		//qDebug("Document::fromXml: Converting group from xml...");
-		// restore the item, and delete it if something goes wrong
-		if (!g->fromXml(element)) 
+		// restore the item, and delete it if something goes wrong.
+		// The group is already connected to us, so batch its slides into one notification each
+		g->beginChangeBatch();
+		bool loaded = g->fromXml(element);
+		g->commitChangeBatch();
+		if (!loaded) 
 		{
 			qDebug("Document::fromXml: group fromXml failed, removing");
  			removeGroup(g);
@@ -266,6 +409,17 @@ bool Document::fromXml(QDomElement & pe)
 
 void Document::save(const QString & filename)
 {
+	if(isLoading())
+	{
+		// The groups not loaded yet would be missing from the file
+		if(QThread::currentThread() != thread())
+		{
+			qDebug() << "Document::save(): Still loading"<<m_filename<<", not saving from a background thread";
+			return;
+		}
+		waitForLoad();
+	}
+	
 	QMutexLocker lock(&document_saveMutex);
 	
 	QString tmp = filename;
@@ -273,6 +427,11 @@ void Document::save(const QString & filename)
 		tmp = m_filename;
 	else
 		m_filename = tmp;
+	
+	armJournal();
+	
+	// Changes made while writing may or may not make it into the file, so the checkpoint only drops what came before
+	int journalSequence = m_journal->sequence();
 		
 	QFile file(tmp);
 
@@ -375,6 +534,8 @@ void Document::save(const QString & filename)
 	
 	file.close();
 	
+	m_journal->checkpoint(journalSequence);
+	
 	//qDebug() << "Document::save: Done writing "<<tmp;
 }
 
@@ -392,3 +553,58 @@ void Document::toXml(QDomElement & pe) const
 		g->toXml(element);	
 	}
 }
+
+DocumentGroupLoadJob::DocumentGroupLoadJob(QThread *resultThread, int index, const QByteArray& data)
+	: QObject()
+	, m_resultThread(resultThread)
+	, m_index(index)
+	, m_data(data)
+{
+	// Deleted by Document::groupLoadJobDone() once the group is created
+	setAutoDelete(false);
+}
+
+DocumentGroupLoadJob::~DocumentGroupLoadJob()
+{
+	qDeleteAll(m_slides);
+	m_slides.clear();
+}
+
+QVariantMap DocumentGroupLoadJob::takeMap()
+{
+	QVariantMap map = m_map;
+	m_map.clear();
+	m_slides.clear();
+	return map;
+}
+
+void DocumentGroupLoadJob::run()
+{
+	QDataStream stream(&m_data, QIODevice::ReadOnly);
+	stream >> m_map;
+	m_data.clear();
+	
+	// Only the base class is sure to load its slides from map["slides"] in SlideGroup::loadSlides()
+	if(m_map["SlideGroup.ClassName"].toString() == "SlideGroup")
+	{
+		QVariantList loaded;
+		foreach(QVariant var, m_map["slides"].toList())
+		{
+			QByteArray ba = var.toByteArray();
+			Slide * slide = Slide::createFromByteArray(ba);
+			
+			slide->moveToThread(m_resultThread);
+			foreach(AbstractItem *item, slide->itemList())
+				item->moveToThread(m_resultThread);
+			
+			m_slides << slide;
+			loaded << QVariant::fromValue((QObject*)slide);
+		}
+		
+		m_map["SlideGroup.LoadedSlides"] = loaded;
+		m_map.remove("slides");
+	}
+	
+	//qDebug() << "DocumentGroupLoadJob::run(): Decoded group"<<m_index<<", slides:"<<m_slides.size();
+	emit done();
+}
@@ -4,7 +4,16 @@
 #include "model/SlideGroup.h"
 
 #include <QList>
+#include <QMap>
 #include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+
+class DocumentGroupLoadJob;
+class DocumentJournal;
+
+// Number of groups Document::load() waits for before returning, the rest are added as they finish loading
+#define DOCUMENT_LOAD_WAIT_GROUPS 3
 
 
 class Document : public QObject
@@ -28,14 +37,34 @@ public:
 	QList<SlideGroup *> groupList();
 	int numGroups() { return m_groups.size(); }
 	SlideGroup * at(int sortedIdx);
+	// Waits for load() to finish if the group isn't loaded (yet)
 	SlideGroup * groupById(int groupId);
 	
 	void removeGroup(SlideGroup *);
 	
 	void load(const QString & filename);
 	void save(const QString & filename = "");
+	
+	// True while load() is still adding groups in the background
+	bool isLoading() { return m_nextLoadIndex < m_loadJobCount; }
+	// Blocks until all groups are loaded. GUI thread only - save() calls it so it never writes half a document.
+	void waitForLoad();
 
 
+	// Changes made since the last save, see DocumentJournal
+	DocumentJournal * journal() { return m_journal; }
+	
+	// Where the journal keeps the changes made to \a filename since it was last saved
+	static QString recoveryFileFor(const QString & filename);
+	QString recoveryFile() { return recoveryFileFor(m_filename); }
+	// True if the last session with this file ended with changes that never made it into the file.
+	// The journal doesn't record anything until applyRecoveryFile() or discardRecoveryFile() is called,
+	// so the file is safe from autosaves (and new changes) until then.
+	bool hasRecoveryFile();
+	// Applies the changes in recoveryFile(), returns the number applied or -1 if they couldn't be read
+	int applyRecoveryFile();
+	void discardRecoveryFile();
+
 	bool fromXml(QDomElement & parentElement);
 	void toXml(QDomElement & parentElement) const;
 	
@@ -49,6 +78,7 @@ signals:
 
 private slots:
 	void slideChanged(Slide *slide, QString slideOperation, AbstractItem *item, QString operation, QString fieldName, QVariant value);
+	void groupLoadJobDone();
 
 private:
 	QList<SlideGroup *> m_groups;
@@ -56,6 +86,52 @@ private:
 	QString m_docTitle;
 	QString m_filename;
 	double m_aspectRatio;
+	
+	// Groups are added in document order, so jobs that finish early wait here for the ones before them
+	int m_loadJobCount;
+	int m_nextLoadIndex;
+	QMap<int,DocumentGroupLoadJob*> m_loadedJobs;
+	// Our own pool, so waitForLoad() doesn't wait on everyone else's jobs in the global pool as well
+	QThreadPool m_loadPool;
+	
+	// Points the journal at recoveryFile(), unless the last session's recovery file is still pending
+	void armJournal();
+	
+	DocumentJournal * m_journal;
+	bool m_recoveryPending;
+};
+
+/// \class DocumentGroupLoadJob
+/// Decodes one group of a file for Document::load() on the document's own thread pool. Plain SlideGroups have
+/// their slides built here as well (and moved to \a resultThread.) Creating the group itself is left to
+/// SlideGroup::groupFromVariantMap() on the GUI thread, since the other group types use timers, the song
+/// database, web pages, etc. Slides not taken with takeMap() are deleted with the job.
+class DocumentGroupLoadJob : public QObject, public QRunnable
+{
+	Q_OBJECT
+public:
+	DocumentGroupLoadJob(QThread *resultThread, int index, const QByteArray& data);
+	~DocumentGroupLoadJob();
+	
+	// QRunnable::
+	void run();
+	
+	/// Position of the group in the file
+	int index() { return m_index; }
+	
+	/// The decoded group, with map["SlideGroup.LoadedSlides"] set if its slides were built
+	QVariantMap takeMap();
+
+signals:
+	void done();
+
+private:
+	QThread *m_resultThread;
+	int m_index;
+	QByteArray m_data;
+	
+	QVariantMap m_map;
+	QList<Slide*> m_slides;
 };
 
 #include <QThread>
@@ -0,0 +1,413 @@
+#include "DocumentJournal.h"
+#include "Document.h"
+#include "SlideGroup.h"
+#include "Slide.h"
+#include "AbstractItem.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QDebug>
+
+// Recovery file layout: magic and version, then records - a quint8 record type followed by
+//	FIELD: qint16 field index, QString name
+//	DELTA: qint32 group id, qint32 slide id, quint32 item id, qint16 field index, QVariant value
+// Old values aren't written, replay() only ever goes forward.
+#define DOCUMENTJOURNAL_MAGIC   0x444A524E // "DJRN"
+#define DOCUMENTJOURNAL_VERSION 1
+#define DOCUMENTJOURNAL_FIELD_RECORD 1
+#define DOCUMENTJOURNAL_DELTA_RECORD 2
+
+QStringList DocumentJournal::m_fieldNames;
+QHash<QString,qint16> DocumentJournal::m_fieldIndexes;
+QMutex DocumentJournal::m_fieldMutex;
+
+DocumentJournal::DocumentJournal(Document *doc)
+	: QObject(doc)
+	, m_doc(doc)
+	, m_firstSequence(0)
+	, m_flushedCount(0)
+	, m_flushedFieldCount(0)
+	, m_fileStarted(false)
+{
+	m_flushTimer.setSingleShot(true);
+	m_flushTimer.setInterval(DOCUMENTJOURNAL_FLUSH_DELAY);
+	connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+	connect(m_doc, SIGNAL(slideGroupChanged(SlideGroup *, QString, Slide *, QString, AbstractItem *, QString, QString, QVariant)), this, SLOT(slideGroupChanged(SlideGroup *, QString, Slide *, QString, AbstractItem *, QString, QString, QVariant)));
+}
+
+DocumentJournal::~DocumentJournal()
+{
+	m_flushTimer.stop();
+}
+
+void DocumentJournal::setRecoveryFile(const QString& file)
+{
+	QMutexLocker lock(&m_mutex);
+	if(m_recoveryFile == file)
+		return;
+
+	// Anything already written goes to the new file on the next flush
+	if(m_fileStarted)
+		QFile::remove(m_recoveryFile);
+
+	m_recoveryFile = file;
+	m_fileStarted = false;
+	m_flushedCount = 0;
+	m_flushedFieldCount = 0;
+
+	if(m_recoveryFile.isEmpty())
+	{
+		m_firstSequence += m_deltas.size();
+		m_deltas.clear();
+	}
+}
+
+int DocumentJournal::sequence()
+{
+	QMutexLocker lock(&m_mutex);
+	return m_firstSequence + m_deltas.size();
+}
+
+int DocumentJournal::deltaCount()
+{
+	QMutexLocker lock(&m_mutex);
+	return m_deltas.size();
+}
+
+void DocumentJournal::checkpoint(int sequence)
+{
+	QMutexLocker lock(&m_mutex);
+
+	// Only ever remove a file we wrote ourselves
+	bool ownsFile = m_fileStarted;
+
+	int count = qBound(0, sequence - m_firstSequence, m_deltas.size());
+	m_deltas = m_deltas.mid(count);
+	m_firstSequence += count;
+
+	//qDebug() << "DocumentJournal::checkpoint(): Dropped"<<count<<"deltas, "<<m_deltas.size()<<"left";
+
+	// The file only ever gets appended to, so start it over with what wasn't saved
+	m_fileStarted = false;
+	m_flushedCount = 0;
+	m_flushedFieldCount = 0;
+
+	if(m_deltas.isEmpty())
+	{
+		if(ownsFile)
+			QFile::remove(m_recoveryFile);
+	}
+	else
+	{
+		writeDeltas();
+	}
+}
+
+qint16 DocumentJournal::fieldIndex(const QString& name)
+{
+	QMutexLocker lock(&m_fieldMutex);
+	if(!m_fieldIndexes.contains(name))
+	{
+		m_fieldIndexes.insert(name, (qint16)m_fieldNames.size());
+		m_fieldNames << name;
+	}
+	return m_fieldIndexes.value(name);
+}
+
+QString DocumentJournal::fieldName(qint16 field)
+{
+	QMutexLocker lock(&m_fieldMutex);
+	return field >= 0 && field < m_fieldNames.size() ? m_fieldNames.at(field) : QString();
+}
+
+DocumentJournalDelta DocumentJournal::delta(SlideGroup *group, Slide *slide, AbstractItem *item, const QString& fieldName, const QVariant& value, const QVariant& oldValue)
+{
+	DocumentJournalDelta delta;
+	delta.groupId  = group ? group->groupId() : 0;
+	delta.slideId  = slide ? slide->slideId() : 0;
+	delta.itemId   = item  ? item->itemId()   : 0;
+	delta.field    = fieldIndex(fieldName);
+	delta.value    = value;
+	delta.oldValue = oldValue;
+	return delta;
+}
+
+void DocumentJournal::record(const DocumentJournalDelta& delta)
+{
+	QMutexLocker lock(&m_mutex);
+	if(m_recoveryFile.isEmpty())
+		return;
+
+	m_deltas << delta;
+	lock.unlock();
+
+	if(!m_flushTimer.isActive())
+		m_flushTimer.start();
+}
+
+void DocumentJournal::slideItemChanged(Slide *slide, AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant oldValue)
+{
+	SlideGroup *group = dynamic_cast<SlideGroup*>(sender());
+	if(!group || !slide || m_recoveryFile.isEmpty())
+		return;
+
+	if(operation == "change")
+	{
+		if(fieldName.isEmpty() || value == oldValue)
+			return;
+		record(delta(group, slide, item, fieldName, value, oldValue));
+	}
+	else
+	if(operation == "add")
+	{
+		if(item)
+			record(delta(group, slide, item, DOCUMENTJOURNAL_ADD_ITEM, item->toByteArray(), QVariant()));
+	}
+	else
+	if(operation == "remove")
+	{
+		if(item)
+			record(delta(group, slide, item, DOCUMENTJOURNAL_REMOVE_ITEM, QVariant(), item->toByteArray()));
+	}
+}
+
+void DocumentJournal::slideGroupChanged(SlideGroup *group, QString groupOperation, Slide *slide, QString slideOperation, AbstractItem *, QString, QString, QVariant)
+{
+	if(groupOperation != "change" || !group || !slide || m_recoveryFile.isEmpty())
+		return;
+
+	// Songs, presentations and the like build their own slides (on load, when the text or aspect ratio
+	// changes...) - those adds and removes aren't edits, and replaying them would duplicate the slides
+	if(group->metaObject() != &SlideGroup::staticMetaObject)
+		return;
+
+	if(slideOperation == "add")
+		record(delta(group, slide, 0, DOCUMENTJOURNAL_ADD_SLIDE, slide->toByteArray(), QVariant()));
+	else
+	if(slideOperation == "remove")
+		record(delta(group, slide, 0, DOCUMENTJOURNAL_REMOVE_SLIDE, QVariant(), slide->toByteArray()));
+}
+
+void DocumentJournal::flush()
+{
+	QMutexLocker lock(&m_mutex);
+	if(m_flushedCount < m_deltas.size())
+		writeDeltas();
+}
+
+bool DocumentJournal::writeDeltas()
+{
+	if(m_recoveryFile.isEmpty())
+		return false;
+
+	QFile file(m_recoveryFile);
+
+	// Removed out from under us (e.g. Document::discardRecoveryFile()) - start over, the header is gone too
+	if(m_fileStarted && !file.exists())
+	{
+		m_fileStarted = false;
+		m_flushedCount = 0;
+		m_flushedFieldCount = 0;
+	}
+
+	QIODevice::OpenMode mode = QIODevice::WriteOnly;
+	mode |= m_fileStarted ? QIODevice::Append : QIODevice::Truncate;
+	if(!file.open(mode))
+	{
+		qDebug() << "DocumentJournal::writeDeltas(): Unable to open"<<m_recoveryFile<<"for writing";
+		return false;
+	}
+
+	QDataStream stream(&file);
+	if(!m_fileStarted)
+		stream << (quint32)DOCUMENTJOURNAL_MAGIC << (qint32)DOCUMENTJOURNAL_VERSION;
+
+	QStringList names;
+	{
+		QMutexLocker lock(&m_fieldMutex);
+		names = m_fieldNames;
+	}
+
+	for(int i=m_flushedFieldCount; i<names.size(); i++)
+		stream << (quint8)DOCUMENTJOURNAL_FIELD_RECORD << (qint16)i << names[i];
+
+	for(int i=m_flushedCount; i<m_deltas.size(); i++)
+	{
+		const DocumentJournalDelta &delta = m_deltas[i];
+		stream << (quint8)DOCUMENTJOURNAL_DELTA_RECORD
+		       << (qint32)delta.groupId
+		       << (qint32)delta.slideId
+		       << delta.itemId
+		       << delta.field
+		       << delta.value;
+	}
+
+	//qDebug() << "DocumentJournal::writeDeltas(): Wrote"<<(m_deltas.size() - m_flushedCount)<<"deltas to"<<m_recoveryFile;
+
+	m_flushedFieldCount = names.size();
+	m_flushedCount = m_deltas.size();
+	m_fileStarted = true;
+
+	return true;
+}
+
+bool DocumentJournal::apply(SlideGroup *group, const DocumentJournalDelta& delta, bool undo)
+{
+	if(!group || !delta.isValid())
+		return false;
+
+	QString field = fieldName(delta.field);
+	QVariant value = undo ? delta.oldValue : delta.value;
+
+	Slide *slide = group->slideById(delta.slideId);
+
+	bool isSlideDelta = field == DOCUMENTJOURNAL_ADD_SLIDE || field == DOCUMENTJOURNAL_REMOVE_SLIDE;
+	if(isSlideDelta)
+	{
+		// Redoing an add or undoing a remove
+		if((field == DOCUMENTJOURNAL_ADD_SLIDE) != undo)
+		{
+			QByteArray array = value.toByteArray();
+			if(slide || array.isEmpty())
+				return false;
+
+			slide = new Slide();
+			slide->fromByteArray(array);
+			group->addSlide(slide);
+		}
+		else
+		{
+			if(!slide)
+				return false;
+
+			group->removeSlide(slide);
+			slide->deleteLater();
+		}
+		return true;
+	}
+
+	if(!slide)
+		return false;
+
+	AbstractItem *item = 0;
+	if(delta.itemId)
+	{
+		foreach(AbstractItem *x, slide->itemList())
+		{
+			if(x->itemId() == delta.itemId)
+			{
+				item = x;
+				break;
+			}
+		}
+	}
+
+	bool isItemDelta = field == DOCUMENTJOURNAL_ADD_ITEM || field == DOCUMENTJOURNAL_REMOVE_ITEM;
+	if(isItemDelta)
+	{
+		if((field == DOCUMENTJOURNAL_ADD_ITEM) != undo)
+		{
+			QByteArray array = value.toByteArray();
+			if(item || array.isEmpty())
+				return false;
+
+			item = AbstractItem::fromByteArray(array);
+			if(!item)
+				return false;
+
+			slide->addItem(item);
+		}
+		else
+		{
+			if(!item)
+				return false;
+
+			slide->removeItem(item);
+			item->deleteLater();
+		}
+		return true;
+	}
+
+	if(delta.itemId && !item)
+		return false;
+
+	QObject *object = item ? (QObject*)item : (QObject*)slide;
+	return object->setProperty(qPrintable(field), value);
+}
+
+int DocumentJournal::replay(const QString& fileName)
+{
+	QFile file(fileName);
+	if(!file.open(QIODevice::ReadOnly))
+		return -1;
+
+	QDataStream stream(&file);
+
+	quint32 magic = 0;
+	qint32 version = 0;
+	stream >> magic >> version;
+	if(stream.status() != QDataStream::Ok || magic != DOCUMENTJOURNAL_MAGIC || version > DOCUMENTJOURNAL_VERSION)
+	{
+		qDebug() << "DocumentJournal::replay(): "<<fileName<<"is not a recovery file";
+		return -1;
+	}
+
+	// Read it all before applying anything - applying records new deltas, which get flushed to the recovery file
+	QHash<qint16,QString> names;
+	QList<DocumentJournalDelta> deltas;
+	while(!stream.atEnd())
+	{
+		quint8 type = 0;
+		stream >> type;
+
+		if(type == DOCUMENTJOURNAL_FIELD_RECORD)
+		{
+			qint16 idx;
+			QString name;
+			stream >> idx >> name;
+			if(stream.status() == QDataStream::Ok)
+				names[idx] = name;
+		}
+		else
+		if(type == DOCUMENTJOURNAL_DELTA_RECORD)
+		{
+			qint32 groupId, slideId;
+			DocumentJournalDelta delta;
+			stream >> groupId >> slideId >> delta.itemId >> delta.field >> delta.value;
+
+			// A crash in the middle of a flush leaves the last record cut short
+			if(stream.status() != QDataStream::Ok)
+				break;
+
+			// The file's field numbers are only good for the file
+			QString name = names.value(delta.field);
+			if(name.isEmpty())
+				continue;
+
+			delta.groupId = groupId;
+			delta.slideId = slideId;
+			delta.field   = fieldIndex(name);
+			deltas << delta;
+		}
+		else
+		{
+			qDebug() << "DocumentJournal::replay(): Unknown record type"<<type<<"in"<<fileName<<", stopping";
+			break;
+		}
+
+		if(stream.status() != QDataStream::Ok)
+			break;
+	}
+
+	file.close();
+
+	int applied = 0;
+	foreach(DocumentJournalDelta delta, deltas)
+		if(apply(m_doc->groupById(delta.groupId), delta))
+			applied ++;
+
+	qDebug() << "DocumentJournal::replay(): Applied"<<applied<<"of"<<deltas.size()<<"changes from"<<fileName;
+	return applied;
+}
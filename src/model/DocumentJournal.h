@@ -0,0 +1,121 @@
+#ifndef DOCUMENTJOURNAL_H
+#define DOCUMENTJOURNAL_H
+
+#include <QObject>
+#include <QVariant>
+#include <QList>
+#include <QHash>
+#include <QStringList>
+#include <QMutex>
+#include <QTimer>
+
+class Document;
+class SlideGroup;
+class Slide;
+class AbstractItem;
+
+// How long (ms) DocumentJournal collects deltas before appending them to the recovery file
+#define DOCUMENTJOURNAL_FLUSH_DELAY 2000
+
+// Pseudo field names for structural changes - the value of an add (and the old value of a remove) is the
+// object's toByteArray(). Properties can't start with '_', so these never collide with a real property.
+#define DOCUMENTJOURNAL_ADD_ITEM     "_journal_addItem"
+#define DOCUMENTJOURNAL_REMOVE_ITEM  "_journal_removeItem"
+#define DOCUMENTJOURNAL_ADD_SLIDE    "_journal_addSlide"
+#define DOCUMENTJOURNAL_REMOVE_SLIDE "_journal_removeSlide"
+
+/// \class DocumentJournalDelta
+/// One change to a slide or an item on it. Holds ids instead of pointers, so it can outlive the item
+/// and be written to disk. itemId is 0 for properties of the slide itself. field indexes
+/// DocumentJournal::fieldName(), so a delta doesn't carry a copy of the property name around.
+class DocumentJournalDelta
+{
+public:
+	DocumentJournalDelta() : groupId(0), slideId(0), itemId(0), field(-1) {}
+
+	bool isValid() const { return field >= 0; }
+
+	int groupId;
+	int slideId;
+	quint32 itemId;
+	qint16 field;
+	QVariant value;
+	QVariant oldValue;
+};
+
+/// \class DocumentJournal
+/// Log of every change made to the slides of a Document since it was last saved, fed by
+/// SlideGroup::slideItemChangedUnbatched(). Deltas are appended to recoveryFile() shortly after they're made,
+/// and Document::save() checkpoints the journal, which drops the deltas that made it into the saved file
+/// (and the recovery file with them.) After a crash, replay() applies the recovery file to the last saved copy.
+///
+/// apply() is also used by SlideEditorWindow for undo/redo, so an undo command only has to hold a delta.
+class DocumentJournal : public QObject
+{
+	Q_OBJECT
+public:
+	DocumentJournal(Document *doc);
+	~DocumentJournal();
+
+	/// Nothing is recorded until the document has a file to recover to
+	QString recoveryFile() { return m_recoveryFile; }
+	void setRecoveryFile(const QString&);
+
+	/// Sequence number of the next delta recorded - Document::save() takes this before it
+	/// starts writing and hands it to checkpoint() once the file is written
+	int sequence();
+
+	/// Drops every delta recorded before \a sequence and rewrites the recovery file with what's left
+	/// (or removes it, if nothing is left and the file is one this journal wrote.) Safe to call from DocumentSaveThread.
+	void checkpoint(int sequence);
+
+	/// Deltas recorded since the last checkpoint()
+	int deltaCount();
+
+	/// Builds a delta for a change to \a item (or \a slide itself if item is 0)
+	static DocumentJournalDelta delta(SlideGroup *group, Slide *slide, AbstractItem *item, const QString& fieldName, const QVariant& value, const QVariant& oldValue);
+
+	static QString fieldName(qint16 field);
+
+	/// Applies \a delta to \a group - the old value if \a undo is true. Returns false if the
+	/// slide or item can't be found (e.g. it's been deleted since.)
+	static bool apply(SlideGroup *group, const DocumentJournalDelta& delta, bool undo = false);
+
+	/// Applies the deltas in \a file to the document, returns the number applied or -1 if \a file can't be read
+	int replay(const QString& file);
+
+public slots:
+	/// Appends the deltas not written yet to recoveryFile()
+	void flush();
+
+private slots:
+	void slideItemChanged(Slide *slide, AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant oldValue);
+	void slideGroupChanged(SlideGroup *g, QString groupOperation, Slide *slide, QString slideOperation, AbstractItem *, QString, QString, QVariant);
+
+private:
+	static qint16 fieldIndex(const QString&);
+	void record(const DocumentJournalDelta&);
+	// Expects m_mutex to be locked
+	bool writeDeltas();
+
+	Document *m_doc;
+	QString m_recoveryFile;
+
+	QMutex m_mutex;
+	QList<DocumentJournalDelta> m_deltas;
+	// Sequence number of m_deltas.first()
+	int m_firstSequence;
+	// m_deltas already in the recovery file, and field names already in it
+	int m_flushedCount;
+	int m_flushedFieldCount;
+	// False until the first write since setRecoveryFile() or checkpoint(), which truncates the file
+	bool m_fileStarted;
+
+	QTimer m_flushTimer;
+
+	static QStringList m_fieldNames;
+	static QHash<QString,qint16> m_fieldIndexes;
+	static QMutex m_fieldMutex;
+};
+
+#endif
@@ -12,7 +12,13 @@ Q_GLOBAL_STATIC(ItemFactory, d)
 #define FRAME_HEART 0x0002
 #define FRAME_NOFRAME 0x0003*/
 
-quint32 ItemFactory::nextId() { return d()->m_idCounter ++; }
+quint32 ItemFactory::nextId()
+{
+	// Slides for songs are built on worker threads as well as the GUI thread
+	ItemFactory *factory = d();
+	QMutexLocker lock(&factory->m_idMutex);
+	return factory->m_idCounter ++;
+}
 
 
 // STATICS
@@ -22,6 +22,7 @@ public:
 
 private:
 	quint32 m_idCounter;
+	QMutex m_idMutex;
 	
 public:
 	ItemFactory();
@@ -26,6 +26,24 @@ Slide::Slide()
 	m_slideId = s.value(ID_COUNTER_KEY,0).toInt() + 1;
 	s.setValue(ID_COUNTER_KEY,m_slideId);
 	
+	init();
+}
+
+Slide::Slide(bool useIdCounter)
+{
+	m_slideId = 0;
+	if(useIdCounter)
+	{
+		QSettings s;
+		m_slideId = s.value(ID_COUNTER_KEY,0).toInt() + 1;
+		s.setValue(ID_COUNTER_KEY,m_slideId);
+	}
+	
+	init();
+}
+
+void Slide::init()
+{
 	m_slideNumber = 0;
 	m_autoChangeTime = 0;
 	m_inheritFadeSettings = true;
@@ -99,39 +117,47 @@ void Slide::setPrimarySlideId(int x)
 
 Slide * Slide::clone() const
 {
-	Slide * newSlide = new Slide();
-	
-	// So we dont have to engineer our own method of tracking
-	// properties, just assume all inherited objects delcare the relevant
-	// properties using Q_PROPERTY macro
-	const QMetaObject *metaobject = metaObject();
-	int count = metaobject->propertyCount();
-	for (int i=0; i<count; ++i) 
-	{
-		QMetaProperty metaproperty = metaobject->property(i);
-		const char *name = metaproperty.name();
-		QVariant value = property(name);
-		newSlide->setProperty(name,value);
-	}
+	// Constructing a Slide normally writes the id counter to QSettings (a disk write, each time),
+	// which adds up quickly when cloning a template for every slide of a song
+	Slide * newSlide = new Slide(false);
 	
-	foreach (AbstractItem * content, newSlide->m_items) 
-		newSlide->removeItem(content);
+	// The new slide has no connections yet, so just copy the members directly
+	// instead of going through each setter (and its slideItemChanged() signal)
+	newSlide->setObjectName(objectName());
+	newSlide->m_slideNumber		= m_slideNumber;
+	newSlide->m_slideName		= m_slideName;
+	newSlide->m_autoChangeTime	= m_autoChangeTime;
+	newSlide->m_inheritFadeSettings	= m_inheritFadeSettings;
+	newSlide->m_crossFadeSpeed	= m_crossFadeSpeed;
+	newSlide->m_crossFadeQuality	= m_crossFadeQuality;
+	newSlide->m_primarySlideId	= m_primarySlideId;
 	
+	// Item clones share their property data with our items until written - see AbstractItem::cloneTo()
 	foreach(AbstractItem *oldItem, m_items)
 		newSlide->addItem(oldItem->clone());
 	
-	// Set the slideId *after copying the properties
-	// because slideId is a Q_PROPERTY, therefore,
-	// if we set the slideId before copying properties,
-	// the above copy loop would just overrite any
-	// ID we set here. Therefore, set the ID after
-	// copying the properties.
 	newSlide->setSlideId(ItemFactory::nextId());
 	
 	return newSlide;
 }
 
 
+quint64 Slide::contentHash() const
+{
+	// Each item keeps its own hash current, so this is just a sum - a sum rather than xor so two
+	// identical items don't cancel each other out. Mixed again first since item hashes are xors themselves.
+	quint64 hash = 0;
+	foreach(AbstractItem *item, m_items)
+	{
+		quint64 itemHash = item->contentHash();
+		itemHash ^= itemHash >> 33;
+		itemHash *= Q_UINT64_C(0xff51afd7ed558ccd);
+		itemHash ^= itemHash >> 33;
+		hash += itemHash;
+	}
+	return hash;
+}
+
 AbstractItem * Slide::background()
 {
 	foreach(AbstractItem *x, m_items)
@@ -359,6 +385,13 @@ QByteArray Slide::toByteArray() const
 	return array; 
 }
 
+Slide * Slide::createFromByteArray(QByteArray &array)
+{
+	Slide * slide = new Slide(false);
+	slide->fromByteArray(array);
+	return slide;
+}
+
 void Slide::fromByteArray(QByteArray &array)
 {
 	QDataStream stream(&array, QIODevice::ReadOnly);
@@ -37,6 +37,9 @@ public:
         
         virtual QByteArray toByteArray() const;
 	virtual void fromByteArray(QByteArray &);
+	// Creates a slide from toByteArray() data. Unlike new Slide() + fromByteArray(), it skips the id counter
+	// in QSettings (the id comes from the data), so it's cheap and safe to call from worker threads.
+	static Slide * createFromByteArray(QByteArray &);
 	
 	ITEM_PROPDEF(SlideId,		int,	slideId);
 	ITEM_PROPDEF(SlideNumber,	int,	slideNumber);
@@ -60,6 +63,11 @@ public:
 	
 	// Changes if any of the items have changed, persists across runs
 	quint32 revision() { return m_revision; }
+	
+	// Hash of what the slide looks like - combines AbstractItem::contentHash() of each item,
+	// so it's the same for two slides with the same items, even across runs. Slide properties
+	// (name, number, timing) aren't included.
+	quint64 contentHash() const;
 
 signals:
 	// Operation = "Add", "Remove", "Change"
@@ -69,6 +77,10 @@ private slots:
 	void itemChanged(QString fieldName, QVariant value, QVariant);
 	
 private:
+	// Used by clone() - skips the id counter in QSettings, clone() assigns a new slideId itself
+	Slide(bool useIdCounter);
+	void init();
+	
 	void loadByteArray(QByteArray &);
 	
 	QList<AbstractItem *> m_items;
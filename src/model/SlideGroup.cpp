@@ -35,6 +35,7 @@ SlideGroup::SlideGroup() :
 	, m_crossFadeQuality(15)
 	, m_masterSlide(0)
 	, m_filename("")
+	, m_changeBatchDepth(0)
 {
 	QSettings s;
 	m_groupId = s.value(ID_COUNTER_KEY,0).toInt() + 1;
@@ -98,7 +99,10 @@ void SlideGroup::addSlide(Slide *slide)
 	connect(slide,SIGNAL(slideItemChanged(AbstractItem *, QString, QString, QVariant, QVariant)),this,SLOT(slideItemChanged(AbstractItem *, QString, QString, QVariant, QVariant)));
 
 	//qDebug("SlideGroup:: slide ADDED");
-	emit slideChanged(slide, "add", 0, "", "", QVariant());
+	if(m_changeBatchDepth > 0)
+		m_batchAddedSlides << slide;
+	else
+		emit slideChanged(slide, "add", 0, "", "", QVariant());
 }
 
 void SlideGroup::removeSlide(Slide *slide)
@@ -108,19 +112,97 @@ void SlideGroup::removeSlide(Slide *slide)
 	m_slides.removeAll(slide);
 	sortSlides();
 	//qDebug("SlideGroup:: slide REMOVED");
+	if(m_changeBatchDepth > 0)
+	{
+		m_batchChanges.remove(slide);
+		m_batchChangedSlides.removeAll(slide);
+
+		// Nobody has been told about it yet, so nobody needs to hear it's gone
+		if(m_batchAddedSlides.removeAll(slide) > 0)
+			return;
+	}
 	emit slideChanged(slide, "remove", 0, "", "", QVariant());
 
 }
 
-void SlideGroup::slideItemChanged(AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant /*oldValue*/)
+void SlideGroup::slideItemChanged(AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant oldValue)
 {
 	Slide * slide = dynamic_cast<Slide *>(sender());
 	if(fieldName == "slideNumber")
 		sortSlides();
+	emit slideItemChangedUnbatched(slide, item, operation, fieldName, value, oldValue);
 	//qDebug("SlideGroup:: slide item changed");
+	if(m_changeBatchDepth > 0)
+	{
+		if(!m_batchChanges.contains(slide))
+			m_batchChangedSlides << slide;
+
+		PendingSlideChange &change = m_batchChanges[slide];
+		change.item      = item;
+		change.operation = operation;
+		change.fieldName = fieldName;
+		change.value     = value;
+		change.count ++;
+		return;
+	}
 	emit slideChanged(slide, "change", item, operation, fieldName, value);
 }
 
+void SlideGroup::beginChangeBatch()
+{
+	m_changeBatchDepth ++;
+}
+
+void SlideGroup::commitChangeBatch()
+{
+	if(m_changeBatchDepth <= 0)
+	{
+		qDebug() << "SlideGroup::commitChangeBatch(): No change batch active, ignoring";
+		return;
+	}
+
+	if(--m_changeBatchDepth > 0)
+		return;
+
+	// Take the pending lists first - receivers may well start a batch (or change slides) of their own
+	QList<Slide*> added = m_batchAddedSlides;
+	QList<Slide*> changed = m_batchChangedSlides;
+	QHash<Slide*,PendingSlideChange> changes = m_batchChanges;
+	m_batchAddedSlides.clear();
+	m_batchChangedSlides.clear();
+	m_batchChanges.clear();
+
+	//qDebug() << "SlideGroup::commitChangeBatch(): "<<assumedName()<<": "<<added.size()<<"added,"<<changed.size()<<"changed";
+
+	// Subclasses remove slides without going thru removeSlide(), so only trust what's still in the group
+	foreach(Slide *slide, added)
+		if(m_slides.contains(slide))
+			emit slideChanged(slide, "add", 0, "", "", QVariant());
+
+	foreach(Slide *slide, changed)
+	{
+		// An add already tells receivers to take a fresh look at the whole slide
+		if(added.contains(slide) || !m_slides.contains(slide))
+			continue;
+
+		PendingSlideChange change = changes.value(slide);
+
+		// The item may have been removed and deleted since - stand in with any item still on the slide
+		AbstractItem *item = change.item;
+		if(!item)
+		{
+			QList<AbstractItem*> items = slide->itemList();
+			item = items.isEmpty() ? 0 : items.first();
+		}
+
+		// More than one change coalesced - an empty field name means "anything may have changed"
+		if(change.count > 1 || !change.item)
+			emit slideChanged(slide, "change", item, "change", "", QVariant());
+		else
+			emit slideChanged(slide, "change", item, change.operation, change.fieldName, change.value);
+	}
+}
+
 void SlideGroup::setGroupNumber(int x)	   { m_groupNumber = x; }
 void SlideGroup::setGroupId(int x)	   { m_groupId = x; }// qDebug() << "SlideGroup::setGroupId:"<<x<<" for "<<assumedName(); }
 void SlideGroup::setGroupType(int t)	   { m_groupType = t; }
@@ -333,6 +415,12 @@ SlideGroup * SlideGroup::fromByteArray(QByteArray &array, Document *context)
 	stream >> map;
 	
 	//qDebug() << "SlideGroup::fromByteArray(): "<<map;
+	return groupFromVariantMap(map, context);
+}
+
+/* static */
+SlideGroup * SlideGroup::groupFromVariantMap(QVariantMap &map, Document *context)
+{
 	if(map.isEmpty())
 	{
 		qDebug() << "Error: SlideGroup::fromByteArray(): Map is empty, not loading group.";
@@ -392,7 +480,9 @@ SlideGroup * SlideGroup::fromByteArray(QByteArray &array, Document *context)
 	
 	group->setDocument(context);
 	
+	group->beginChangeBatch();
 	group->fromVariantMap(map);
+	group->commitChangeBatch();
 	
 	return group;
 	
@@ -478,6 +568,16 @@ void SlideGroup::loadSlides(QVariantMap &map)
 	qDeleteAll(m_slides);
 	m_slides.clear();
 
+	// Already built off the GUI thread by DocumentGroupLoadJob
+	QVariantList loaded = map["SlideGroup.LoadedSlides"].toList();
+	if(!loaded.isEmpty())
+	{
+		foreach(QVariant var, loaded)
+			if(Slide *slide = qobject_cast<Slide*>(var.value<QObject*>()))
+				addSlide(slide);
+		return;
+	}
+
 	QVariantList items = map["slides"].toList();
 	foreach(QVariant var, items)
 	{
@@ -535,6 +635,9 @@ void SlideGroup::changeBackground(AbstractVisualItem::FillType fillType, QVarian
 	else
 		slides = slideList();
 	
+	// Three property sets per slide - receivers only need to hear about each slide once
+	SlideGroupChangeBatch batch(this);
+	
 	foreach(Slide * slide, slides)
 	{
 		AbstractVisualItem * bg = dynamic_cast<AbstractVisualItem*>(slide->background());
@@ -601,6 +704,7 @@ void SlideGroup::load(const QString & s)
 	
 	QDomElement root = doc.documentElement(); // The root node
 	
+	SlideGroupChangeBatch batch(this);
 	fromXml(root);
 }
 
@@ -2,6 +2,7 @@
 #define SLIDEGROUP_H
 
 #include <QList>
+#include <QPointer>
 class Slide;
 class QFileInfo;
 class Document;
@@ -76,12 +77,24 @@ public:
 
 	void removeSlide(Slide *);
 
+	/// Starts a change batch: until the matching commitChangeBatch(), changes to items in this group's slides
+	/// are coalesced per slide and "add" notifications are held back, then slideChanged() is emitted once per
+	/// added slide and once per changed slide at commit. "remove" is still emitted right away, since callers
+	/// usually delete the slide right after removing it. Batches nest - only the outermost commit emits.
+	/// See also SlideGroupChangeBatch, below.
+	void beginChangeBatch();
+	void commitChangeBatch();
+	bool isChangeBatchActive() { return m_changeBatchDepth > 0; }
+
 	virtual bool fromXml(QDomElement & parentElement);
 	virtual void toXml(QDomElement & parentElement) const;
 	
 	virtual QByteArray toByteArray() const;
 	//virtual void fromByteArray(QByteArray &);
 	static SlideGroup * fromByteArray(QByteArray &, Document *context = 0);
+	// The second half of fromByteArray(): creates the class named in the decoded map and loads it.
+	// map["SlideGroup.LoadedSlides"] may hold Slides already built from map["slides"] (as QObject*'s) - see DocumentGroupLoadJob
+	static SlideGroup * groupFromVariantMap(QVariantMap &, Document *context = 0);
 	
 	SlideGroup * clone();
 
@@ -112,6 +125,10 @@ public:
 signals:
 	// Operation = "Add", "Remove", "Change"
 	void slideChanged(Slide *slide, QString slideOperation, AbstractItem *item, QString operation, QString fieldName, QVariant value);
+	
+	// Every add, remove and change of an item on one of the slides, as it happens - with the old value, and
+	// never held back by a change batch. For DocumentJournal, most everything else should use slideChanged().
+	void slideItemChangedUnbatched(Slide *slide, AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant oldValue);
 
 private slots:
 	void slideItemChanged(AbstractItem *item, QString operation, QString fieldName, QVariant value, QVariant old);
@@ -156,6 +173,38 @@ protected:
 	QHash<int, SlideGroup*> m_altGroupForOutput;
 
 	QStringListHash m_userEventActions;
+
+private:
+	// The last change seen on a slide during a change batch, and how many were coalesced into it
+	class PendingSlideChange
+	{
+	public:
+		PendingSlideChange() : count(0) {}
+		QPointer<AbstractItem> item;
+		QString operation;
+		QString fieldName;
+		QVariant value;
+		int count;
+	};
+
+	int m_changeBatchDepth;
+	QList<Slide*> m_batchAddedSlides;
+	QList<Slide*> m_batchChangedSlides;
+	QHash<Slide*,PendingSlideChange> m_batchChanges;
+};
+
+/// \class SlideGroupChangeBatch
+/// Holds a change batch open on a group for the lifetime of the object, so the batch is committed even if
+/// loading throws, e.g.
+///	SlideGroupChangeBatch batch(group);
+class SlideGroupChangeBatch
+{
+public:
+	SlideGroupChangeBatch(SlideGroup *group) : m_group(group) { if(m_group) m_group->beginChangeBatch(); }
+	~SlideGroupChangeBatch() { if(m_group) m_group->commitChangeBatch(); }
+
+private:
+	SlideGroup *m_group;
 };
 
 Q_DECLARE_METATYPE(SlideGroup*);
@@ -11,6 +11,7 @@
 #include <QAbstractTextDocumentLayout>
 
 QCache<QString,double> TextItem::static_autoTextSizeCache;
+QMutex TextItem::static_autoTextSizeMutex;
 
 TextItem::TextItem() : AbstractVisualItem() 
 {
@@ -111,9 +112,13 @@ int TextItem::fitToSize(const QSize& size, int minimumFontSize, int maximumFontS
 	qreal boxHeight = -1;
 		
 	double ptSize = -1;
+	static_autoTextSizeMutex.lock();
 	if(static_autoTextSizeCache.contains(sizeKey))
-	{
 		ptSize = *(static_autoTextSizeCache[sizeKey]);
+	static_autoTextSizeMutex.unlock();
+	
+	if(ptSize > -1)
+	{
 		
 		//qDebug()<<"TextItem::fitToSize(): size search: CACHE HIT: loaded size:"<<ptSize;
 		
@@ -262,6 +267,7 @@ int TextItem::fitToSize(const QSize& size, int minimumFontSize, int maximumFontS
 		// We are using a QCache instead of a plain QMap, so that requires a pointer value 
 		// Using QCache because the key for the cache could potentially become quite large if there are large amounts of HTML
 		// and I dont want to just keep accumlating html in the cache infinitely
+		QMutexLocker lock(&static_autoTextSizeMutex);
 		static_autoTextSizeCache.insert(sizeKey, new double(lastGoodSize),1);
 	}
 	
@@ -3,6 +3,7 @@
 
 #include "AbstractVisualItem.h"
 #include <QCache>
+#include <QMutex>
 
 class TextItem : public AbstractVisualItem
 {
@@ -82,6 +83,8 @@ private:
 	Qt::Alignment m_yTextAlign;
 	
 	static QCache<QString,double> static_autoTextSizeCache;
+	// fitToSize() is also called from SongTextToSlidesJob on worker threads
+	static QMutex static_autoTextSizeMutex;
 
 	
 
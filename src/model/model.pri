@@ -11,6 +11,7 @@ HEADERS +=  \
         BoxItem.h \
         SlideGroup.h \
         Document.h \
+        DocumentJournal.h \
         Output.h \
         SlideGroupFactory.h \
         BackgroundItem.h \
@@ -30,6 +31,7 @@ SOURCES += \
         BoxItem.cpp \
         SlideGroup.cpp \
         Document.cpp \
+        DocumentJournal.cpp \
         Output.cpp \
         SlideGroupFactory.cpp \
         BackgroundItem.cpp \
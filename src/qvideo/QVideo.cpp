@@ -107,16 +107,33 @@ bool QVideo::load(const QString & filename)
 {
 	if(!m_video_decoder)
 		return true;
-	//qDebug() << "QVideo::load:"<<filename<<", entering lock...";
-	QMutexLocker locker(&qvideo_mutex);
-	//qDebug() << "QVideo::load:"<<filename<<", got lock.";
 	
-	bool flag = m_video_decoder->load(filename);
+	bool flag = open(filename);
+	if(flag)
+		finishLoad();
 	
 	//qDebug() << "QVideo::load:"<<filename<<", done loading, flag:"<<flag;
 	return flag;
 }
 
+bool QVideo::open(const QString & filename)
+{
+	if(!m_video_decoder)
+		return true;
+	//qDebug() << "QVideo::open:"<<filename<<", entering lock...";
+	QMutexLocker locker(&qvideo_mutex);
+	//qDebug() << "QVideo::open:"<<filename<<", got lock.";
+	
+	return m_video_decoder->open(filename);
+}
+
+void QVideo::finishLoad()
+{
+	// Not under qvideo_mutex - that would just wait on whatever is being opened in the background
+	if(m_video_decoder)
+		m_video_decoder->finishLoad();
+}
+
 double QVideo::videoClock()
 {
 	return m_video_decoder ? m_video_decoder->videoClock() : 0;
@@ -44,6 +44,12 @@ public:
 
 	bool load(const QString & filename);
 	void unload();
+	
+	// load() split for loading in the background: open() probes the file and opens the codecs
+	// (safe to call from another thread, nothing else may touch the QVideo until it returns),
+	// finishLoad() decodes the first frame on the thread the QVideo lives in
+	bool open(const QString & filename);
+	void finishLoad();
 
 	enum AdvanceMode { RealTime, Manual };
 
@@ -107,6 +107,15 @@ QVideoDecoder::~QVideoDecoder()
 }
 
 bool QVideoDecoder::load(const QString & filename)
+{
+	if(!open(filename))
+		return false;
+	
+	finishLoad();
+	return true;
+}
+
+bool QVideoDecoder::open(const QString & filename)
 {
 	//if(!QFile::exists(filename))
 	//	return false;
@@ -142,7 +151,7 @@ bool QVideoDecoder::load(const QString & filename)
 			 if( !inFmt )
 			 {
 				   qDebug() << "[ERROR] QVideoDecoder::load(): Unable to find input format:"<<list[0];
-				   return -1;
+				   return false;
 			 }
 
 
@@ -272,13 +281,16 @@ bool QVideoDecoder::load(const QString & filename)
 
 	calculateVideoProperties();
 
+	return true;
+}
+
+void QVideoDecoder::finishLoad()
+{
 	m_initial_decode = true;
 
 	decode();
 
 	m_video->m_video_loaded = true;
-
-	return true;
 }
 
 
@@ -36,6 +36,11 @@ public:
 
 	bool load(const QString & filename);
 	void unload();
+	
+	// load() in two steps: open() does the slow probing (no signals, so it can run on any thread),
+	// finishLoad() decodes the first frame and must be called from the thread the decoder lives in
+	bool open(const QString & filename);
+	void finishLoad();
 
 	void run();
 	void startDecoding();
@@ -83,7 +83,7 @@ QMap<QString,QVideoProvider*> QVideoProvider::m_fileProviderMap;
 
 // return a provider for the file, creating one if doesnt exist
 // inc's refCount
-QVideoProvider * QVideoProvider::providerForFile(const QString & file)
+QVideoProvider * QVideoProvider::providerForFile(const QString & file, bool loadInBackground)
 {
 	QFileInfo inf(file);
 	QString can = file.startsWith("http://") ? file : inf.canonicalFilePath();
@@ -106,7 +106,7 @@ QVideoProvider * QVideoProvider::providerForFile(const QString & file)
 	{
 		if(DEBUG_QVIDEOPROVIDER)
 			qDebug() << "[REF +] QVideoProvider::providerForFile(): - Creating new provider for file:"<<file;
-		QVideoProvider *v = new QVideoProvider(can);
+		QVideoProvider *v = new QVideoProvider(can, loadInBackground);
 		m_fileProviderMap[can] = v;
 		v->m_refCount=1;
 		//v->play();
@@ -249,13 +249,16 @@ void QVideoIconGenerator::newPixmap(const QPixmap & pixmap)
 }
 
 	
-QVideoProvider::QVideoProvider(const QString &f) :
+QVideoProvider::QVideoProvider(const QString &f, bool loadInBackground) :
 	QObject(),
+	m_loadThread(0),
 	m_canonicalFilePath(f),
 	m_video(new QVideo(this)),
 	m_refCount(0),
 	m_isValid(true),
 	m_playCount(0),
+	m_pendingSeekMs(-1),
+	m_pendingSeekFlags(0),
 	m_streamStarted(false),
 	m_mjpeg(0)
 {
@@ -271,6 +274,14 @@ QVideoProvider::QVideoProvider(const QString &f) :
 		connect(m_mjpeg, SIGNAL(newImage(QImage)), this, SLOT(newImage(QImage)));
 	}
 	else
+	if(loadInBackground)
+	{
+		// m_video belongs to the thread until loadThreadFinished()
+		m_loadThread = new QVideoProviderLoadThread(m_video, f);
+		connect(m_loadThread, SIGNAL(finished()), this, SLOT(loadThreadFinished()));
+		m_loadThread->start(QThread::LowPriority);
+	}
+	else
 	{
 		if(!m_video->load(f))
 		{
@@ -279,17 +290,57 @@ QVideoProvider::QVideoProvider(const QString &f) :
 			m_isValid = false;
 		}
 		if(m_isValid)
-		{
-			connect(m_video, SIGNAL(newPixmap(QPixmap)), this, SLOT(newPixmap(QPixmap)));
-			m_video->setAdvanceMode(QVideo::Manual);
-			m_video->setLooped(true);
-			//m_video->play();
-		}
+			setupVideo();
 	}
 }
 
+void QVideoProvider::setupVideo()
+{
+	connect(m_video, SIGNAL(newPixmap(QPixmap)), this, SLOT(newPixmap(QPixmap)));
+	m_video->setAdvanceMode(QVideo::Manual);
+	m_video->setLooped(true);
+	//m_video->play();
+}
+
+void QVideoProvider::loadThreadFinished()
+{
+	bool opened = m_loadThread->isOpened();
+	m_loadThread->deleteLater();
+	m_loadThread = 0;
+	
+	if(!opened)
+	{
+		if(DEBUG_QVIDEOPROVIDER)
+			qDebug() << "QVideoProvider: ERROR: Unable to load video"<<m_canonicalFilePath;
+		m_isValid = false;
+		return;
+	}
+	
+	// Decodes the first frame - quick compared to opening the file
+	m_video->finishLoad();
+	setupVideo();
+	
+	if(m_pendingSeekMs >= 0)
+	{
+		m_video->seek(m_pendingSeekMs, m_pendingSeekFlags);
+		m_pendingSeekMs = -1;
+	}
+	
+	// Someone called play() while we were loading
+	if(m_playCount > 0)
+		m_video->play();
+}
+
 QVideoProvider::~QVideoProvider()
 {
+	if(m_loadThread)
+	{
+		disconnect(m_loadThread, 0, this, 0);
+		m_loadThread->wait();
+		delete m_loadThread;
+		m_loadThread = 0;
+	}
+	
 	disconnect(m_video,0,this,0);
 	m_video->stop();
 	m_video->deleteLater();
@@ -386,7 +437,9 @@ void QVideoProvider::stop()
 
 void QVideoProvider::play()
 {
-	m_video->play();
+	// Otherwise, loadThreadFinished() starts it
+	if(!m_loadThread)
+		m_video->play();
 	m_playCount ++;
 	if(DEBUG_QVIDEOPROVIDER || DEBUG_QVIDEOPROVIDER_PLAY)
 		qDebug() << "[PLAY +] "<<this<<" QVideoProvider::play(): "<<m_canonicalFilePath<<" m_playCount:"<<m_playCount;
@@ -416,6 +469,13 @@ void QVideoProvider::seekTo(int ms, int flags)
 {
 	if(!m_video)
 		return;
+	// Only the last seek matters - loadThreadFinished() applies it
+	if(m_loadThread)
+	{
+		m_pendingSeekMs = ms;
+		m_pendingSeekFlags = flags;
+		return;
+	}
 	m_video->seek(ms,flags);
 }
 
@@ -426,7 +486,7 @@ double QVideoProvider::videoClock()
 
 int QVideoProvider::duration()
 {	
-	return m_video ? m_video->duration() : 0;
+	return m_video && !m_loadThread ? m_video->duration() : 0;
 }
 
 bool QVideoProvider::stopAllowed()
@@ -451,3 +511,16 @@ bool QVideoProvider::stopAllowed()
 	qDebug() << "QVideoProvider::stopAllowed(): "<<m_canonicalFilePath<<" Allowing media stop";
 	return true;
 }
+
+QVideoProviderLoadThread::QVideoProviderLoadThread(QVideo *video, const QString& file)
+	: QThread()
+	, m_video(video)
+	, m_file(file)
+	, m_opened(false)
+{}
+
+void QVideoProviderLoadThread::run()
+{
+	m_opened = m_video->open(m_file);
+	//qDebug() << "QVideoProviderLoadThread::run(): "<<m_file<<": opened:"<<m_opened;
+}
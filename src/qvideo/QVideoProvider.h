@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QMap>
 #include <QPixmap>
+#include <QThread>
 class QVideo;
 
 
@@ -102,13 +103,33 @@ public:
 };
 #endif
 
+// Opens the file for a QVideoProvider off the GUI thread - see QVideoProvider::providerForFile()
+class QVideoProviderLoadThread : public QThread
+{
+	Q_OBJECT
+public:
+	QVideoProviderLoadThread(QVideo*, const QString& file);
+	void run();
+	
+	bool isOpened() { return m_opened; }
+private:
+	QVideo * m_video;
+	QString m_file;
+	bool m_opened;
+};
+
 class QVideoProvider : public QObject
 {
 	Q_OBJECT
 public:
 	// return a provider for the file, creating one if doesnt exist
 	// inc's refCount
-	static QVideoProvider * providerForFile(const QString &);
+	// If loadInBackground is true and a new provider is created, the file is probed and opened on a
+	// QVideoProviderLoadThread instead of blocking the caller. play() can be called right away, the
+	// video just starts once it's loaded (isLoading() is false again.) seekTo() is held until then too,
+	// but duration() is 0 while loading. An existing provider is
+	// returned as-is, already loaded (or still loading), which is how warmed-up videos get handed over.
+	static QVideoProvider * providerForFile(const QString &, bool loadInBackground = false);
 	
 	// de-inc refcount. If refcount<=0, delete provider
 	static void releaseProvider(QVideoProvider*);
@@ -144,6 +165,8 @@ public:
 	
 	bool isValid() { return m_isValid; }
 	
+	bool isLoading() { return m_loadThread != 0; }
+	
 	QPixmap pixmap() { return m_lastPixmap; }
 	
 	QString canonicalFilePath() { return m_canonicalFilePath; }
@@ -177,8 +200,15 @@ private slots:
 	void newPixmap(const QPixmap & pixmap);
 	void newImage(QImage);
 	
+	void loadThreadFinished();
+	
 private:
-	QVideoProvider(const QString &);
+	QVideoProvider(const QString &, bool loadInBackground);
+	
+	// connects to m_video once it's loaded
+	void setupVideo();
+	
+	QVideoProviderLoadThread * m_loadThread;
 	
 	QString m_canonicalFilePath;
 	
@@ -190,6 +220,10 @@ private:
 	
 	int m_playCount;
 	
+	// seekTo() made while m_loadThread is running, applied by loadThreadFinished(). -1 if none
+	int m_pendingSeekMs;
+	int m_pendingSeekFlags;
+	
 	bool m_streamStarted;
 	
 	QList<QObject*> m_receivers;
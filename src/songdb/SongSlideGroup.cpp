@@ -13,6 +13,9 @@
 #include <QTextBlock>
 #include <QTextOption>
 #include <QTextEdit>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QCache>
 
 #define DEBUG_TEXTOSLIDES 0
 
@@ -46,6 +49,9 @@ void SongSlideGroup::setSyncToDatabase(bool flag)
 
 void SongSlideGroup::hitTextToSlides()
 {
+	// Whatever a running job builds is for the old text now
+	m_textJob = 0;
+	
 	if(m_textRegenTimer.isActive())
 		m_textRegenTimer.stop();
 	m_textRegenTimer.start();
@@ -89,6 +95,8 @@ void SongSlideGroup::removeAllSlides()
 
 	//qDeleteAll(m_slides);
 	m_slides.clear();
+	
+	m_textJob = 0;
 }
 
 void SongSlideGroup::aspectRatioChanged(double newAr)
@@ -186,37 +194,11 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 	if(DEBUG_TEXTOSLIDES)
 		qDebug() << "SongSlideGroup::textToSlides(): "<<(song() ? song()->title() : " (no song) ")<<": Start of text to slides";
 	
-	static QString slideHeader = "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0//EN\" \"http://www.w3.org/TR/REC-html40/strict.dtd\">"
-				     "<html>"
-				     "<head><meta name=\"qrichtext\" content=\"1\" />"
-				     "<style type=\"text/css\">p, li { white-space: pre-wrap; }</style>"
-				     "</head>"
-				     "<body style=\"font-family:'Sans Serif'; font-size:9pt; font-weight:400; font-style:normal;\">";
-	static QString linePrefix  = "<p align=\"center\" style=\"margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\">"
-				     "<span style=\" font-family:'Sans-Serif'; font-size:32pt; font-weight:800;\">";
-	static QString lineSuffix =  "</span>"
-				     "</p>";
-	static QString slideFooter = "</body></html>";
-	
 	QString text = rearrange(m_text, m_arrangement);
 	QStringList list = text.split("\n\n");
 	
 	//qDebug() << "SongSlideGroup::textToSlides(): "<<(song() ? song()->title() : " (no song) ")<<": Using text: "<<list; 
 
-	// Outline pen for the text
-	QPen pen = QPen(Qt::black,1.5);
-	pen.setJoinStyle(Qt::MiterJoin);
-
-	// Used for centering and font size search
-	QTextDocument doc;
-
-	QRegExp excludeLineRegExp(
-        		//filter == Standard ? "^\\s*(Verse|Chorus|Tag|Bridge|End(ing)?|Intro(duction)|B:|R:|C:|T:|G:)?)(\\s*\\(.*\\))?\\s*$" :
-        		filter == Standard  ? tr("^\\s*(%1|B:|R:|C:|T:|G:|\\[|\\|)(\\s+\\d+)?(\\s*\\(.*\\))?\\s*.*$").arg(SongSlideGroup::songTagRegexpList()) :
-        		filter == AllowRear ? tr("^\\s*(%1)(\\s+\\d+)?(\\s*\\(.*\\))?\\s*.*$").arg(SongSlideGroup::songTagRegexpList()) :
-        		"",
-        	Qt::CaseInsensitive);
-
 	if(!slideTemplates() || !slideTemplates()->numSlides())
 	{
 		if(m_slideTemplates)
@@ -224,9 +206,6 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 		m_slideTemplates = createDefaultTemplates();
 	}
 	
-        if(DEBUG_TEXTOSLIDES)
-        	qDebug() << "SongSlideGroup::textToSlides(): filter int:"<<filter<<", using exclusion pattern:"<<excludeLineRegExp.pattern();
-
 	SlideGroup * templates = slideTemplates();
 	
 	if(song())
@@ -263,37 +242,232 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			qDebug() << "SongSlideGroup::textToSlides(): "<<song()->title()<<": Done with alt templates";
 	}
 	
+	// Serializing the templates is the only part of building the slides that has to read the template group,
+	// so do it here - and only once for each state of the templates, since a setlist often shares one template
+	static QCache<quint64, QList<QByteArray> > templateBytesCache(SONGSLIDEGROUP_TEMPLATE_CACHE_SIZE);
+	
+	quint64 hash = templateHash(templates);
+	QList<QByteArray> templateBytes;
+	if(QList<QByteArray> *cached = templateBytesCache.object(hash))
+	{
+		templateBytes = *cached;
+	}
+	else
+	{
+		foreach(Slide *slide, templates->slideList())
+			templateBytes << slide->toByteArray();
+		templateBytesCache.insert(hash, new QList<QByteArray>(templateBytes));
+	}
+	
+	QRectF screenRect = AppSettings::adjustToTitlesafe(MainWindow::mw() ? MainWindow::mw()->standardSceneRect() : FALLBACK_SCREEN_RECT);
+	
 	if(DEBUG_TEXTOSLIDES)
-		qDebug() << "SongSlideGroup::textToSlides(): slides:"<<list;
+		qDebug() << "SongSlideGroup::textToSlides(): slides:"<<list<<", template hash:"<<hash;
+	
+	// A job still running for older text is left to finish - textToSlidesDone() throws away its slides
+	SongTextToSlidesJob *job = new SongTextToSlidesJob(thread(), list, filter, screenRect, hash, templateBytes);
+	connect(job, SIGNAL(done()), this, SLOT(textToSlidesDone()));
+	connect(job, SIGNAL(done()), job, SLOT(deleteLater()));
+	m_textJob = job;
+	
+	QThreadPool::globalInstance()->start(job);
+}
+
+void SongSlideGroup::textToSlidesDone()
+{
+	SongTextToSlidesJob *job = dynamic_cast<SongTextToSlidesJob*>(sender());
+	if(!job || job != m_textJob)
+	{
+		if(DEBUG_TEXTOSLIDES)
+			qDebug() << "SongSlideGroup::textToSlidesDone(): "<<(song() ? song()->title() : " (no song) ")<<": Stale job, discarding slides";
+		return;
+	}
+	
+	m_textJob = 0;
+	
+	QList<Slide*> slides = job->takeSlides();
+	QList<TextBoxItem*> textBoxes = job->textBoxes();
+	
+	// Receivers hear about the new slides once they're all in the group
+	SlideGroupChangeBatch batch(this);
+	
+	for(int slideNbr = 0; slideNbr < slides.size(); slideNbr++)
+	{
+		Slide *slide = slides[slideNbr];
+		TextBoxItem *text = textBoxes[slideNbr];
+		
+		// these two dynamic properties are used in the SongFoldbackTextFilter to 
+		// reference back to this slide group, extract original text, and mutate
+		// it for the foldback display
+		QVariant slideGroupVar;
+		slideGroupVar.setValue(this);
+		text->setProperty("SongSlideGroup",  slideGroupVar);
+		text->setProperty("SongSlideNumber", slideNbr);
+		
+		addSlide(slide);
+		
+		// Delay warming the visual cache to increase UI responsiveness when quickly adding songs
+		int rv = (rand() % 500) - (500/2); // get a random number +/- 250ms
+		int delay = (slideNbr+1) * 5000 + rv; // add a random +/- 250ms to stagger hits to the warming method
+		if(DEBUG_TEXTOSLIDES)
+			qDebug() << "SongSlideGroup::textToSlidesDone(): "<<(song() ? song()->title() : " (no song) ")<<": slideNbr:"<<slideNbr<<": delaying "<<delay<<"ms before warmVisualCache()";
+		QTimer::singleShot(delay, text, SLOT(warmVisualCache()));
+	}
+	
+	if(DEBUG_TEXTOSLIDES)
+		qDebug() << "SongSlideGroup::textToSlidesDone():"<<(song() ? song()->title() : " (no song) ")<<": End of text to slides, numSlides():"<<numSlides();
+}
+
+/* static */
+quint64 SongSlideGroup::templateHash(SlideGroup *templates)
+{
+	// Item content is already hashed by the items themselves - just add in the slide
+	// properties that get cloned into the song slides, and the order of the slides
+	quint64 hash = 14695981039346656037ULL;
+	foreach(Slide *slide, templates->slideList())
+	{
+		QString props = QString("%1:%2:%3:%4:%5:%6")
+			.arg(slide->slideNumber())
+			.arg(slide->slideName())
+			.arg(slide->autoChangeTime())
+			.arg(slide->inheritFadeSettings())
+			.arg(slide->crossFadeSpeed())
+			.arg(slide->crossFadeQuality());
+		
+		hash = (hash ^ slide->contentHash()) * 1099511628211ULL;
+		hash = (hash ^ qHash(props)) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Template slides deserialized by SongTextToSlidesJob, owned by the cache below
+class SongTextToSlidesTemplates
+{
+public:
+	~SongTextToSlidesTemplates() { qDeleteAll(slides); }
+	
+	QList<Slide*> slides;
+};
+
+// Per-thread state for SongTextToSlidesJob - QRegExp isn't safe to share between threads,
+// and the template slides are cloned for every slide built
+class SongTextToSlidesCache
+{
+public:
+	SongTextToSlidesCache() : templates(SONGSLIDEGROUP_TEMPLATE_CACHE_SIZE) {}
+	
+	QHash<int, QRegExp> excludeLineRegExps;
+	QCache<quint64, SongTextToSlidesTemplates> templates;
+};
+
+static QThreadStorage<SongTextToSlidesCache*> SongTextToSlidesJob_cache;
+
+SongTextToSlidesJob::SongTextToSlidesJob(QThread *resultThread, const QStringList& passages, int filter, const QRectF& screenRect, quint64 templateHash, const QList<QByteArray>& templateSlides)
+	: QObject()
+	, QRunnable()
+	, m_resultThread(resultThread)
+	, m_passages(passages)
+	, m_filter(filter)
+	, m_screenRect(screenRect)
+	, m_templateHash(templateHash)
+	, m_templateSlides(templateSlides)
+{
+	// Deleted with deleteLater() once the group has its slides, not by the thread pool
+	setAutoDelete(false);
+}
+
+SongTextToSlidesJob::~SongTextToSlidesJob()
+{
+	qDeleteAll(m_slides);
+	m_slides.clear();
+}
+
+QList<Slide*> SongTextToSlidesJob::takeSlides()
+{
+	QList<Slide*> slides = m_slides;
+	m_slides.clear();
+	return slides;
+}
+
+void SongTextToSlidesJob::run()
+{
+	static QString slideHeader = "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0//EN\" \"http://www.w3.org/TR/REC-html40/strict.dtd\">"
+				     "<html>"
+				     "<head><meta name=\"qrichtext\" content=\"1\" />"
+				     "<style type=\"text/css\">p, li { white-space: pre-wrap; }</style>"
+				     "</head>"
+				     "<body style=\"font-family:'Sans Serif'; font-size:9pt; font-weight:400; font-style:normal;\">";
+	static QString linePrefix  = "<p align=\"center\" style=\"margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\">"
+				     "<span style=\" font-family:'Sans-Serif'; font-size:32pt; font-weight:800;\">";
+	static QString lineSuffix =  "</span>"
+				     "</p>";
+	static QString slideFooter = "</body></html>";
+	
+	if(!SongTextToSlidesJob_cache.hasLocalData())
+		SongTextToSlidesJob_cache.setLocalData(new SongTextToSlidesCache());
+	SongTextToSlidesCache *cache = SongTextToSlidesJob_cache.localData();
+	
+	SongSlideGroup::SongTextFilter filter = (SongSlideGroup::SongTextFilter)m_filter;
+	
+	if(!cache->excludeLineRegExps.contains(filter))
+	{
+		cache->excludeLineRegExps[filter] = QRegExp(
+			//filter == Standard ? "^\\s*(Verse|Chorus|Tag|Bridge|End(ing)?|Intro(duction)|B:|R:|C:|T:|G:)?)(\\s*\\(.*\\))?\\s*$" :
+			filter == SongSlideGroup::Standard  ? SongSlideGroup::tr("^\\s*(%1|B:|R:|C:|T:|G:|\\[|\\|)(\\s+\\d+)?(\\s*\\(.*\\))?\\s*.*$").arg(SongSlideGroup::songTagRegexpList()) :
+			filter == SongSlideGroup::AllowRear ? SongSlideGroup::tr("^\\s*(%1)(\\s+\\d+)?(\\s*\\(.*\\))?\\s*.*$").arg(SongSlideGroup::songTagRegexpList()) :
+			"",
+			Qt::CaseInsensitive);
+	}
+	QRegExp excludeLineRegExp = cache->excludeLineRegExps.value(filter);
+	
+	if(DEBUG_TEXTOSLIDES)
+		qDebug() << "SongTextToSlidesJob::run(): filter int:"<<filter<<", using exclusion pattern:"<<excludeLineRegExp.pattern();
+	
+	SongTextToSlidesTemplates *templates = cache->templates.object(m_templateHash);
+	if(!templates)
+	{
+		if(DEBUG_TEXTOSLIDES)
+			qDebug() << "SongTextToSlidesJob::run(): Template cache miss for hash"<<m_templateHash<<", loading"<<m_templateSlides.size()<<"slides";
+		
+		templates = new SongTextToSlidesTemplates();
+		foreach(QByteArray bytes, m_templateSlides)
+			templates->slides << Slide::createFromByteArray(bytes);
+		cache->templates.insert(m_templateHash, templates);
+	}
+	
+	QList<Slide*> templateSlides = templates->slides;
+	if(templateSlides.isEmpty())
+	{
+		qDebug() << "SongTextToSlidesJob::run(): No template slides, not building any slides";
+		emit done();
+		return;
+	}
+	
+	// Outline pen for the text
+	QPen pen = QPen(Qt::black,1.5);
+	pen.setJoinStyle(Qt::MiterJoin);
+	
 	int slideNbr = 0;
-	foreach(QString passage, list)
+	foreach(QString passage, m_passages)
 	{
 		Slide *slide = 0;
 		TextBoxItem *text = 0;
 		bool textboxFromTemplate = false;
 
 		if(DEBUG_TEXTOSLIDES)
-			qDebug() << "SongSlideGroup::textToSlides(): Processing Slide # "<<slideNbr;
+			qDebug() << "SongTextToSlidesJob::run(): Processing Slide # "<<slideNbr;
 
-// 		if(DEBUG_TEXTOSLIDES)
-// 			qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Have templates, processing.";
-
-		slide = templates->at(0)->clone();
+		slide = templateSlides.at(0)->clone();
 		if(DEBUG_TEXTOSLIDES)
 		{
-			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Cloned slide 0 (master)";
+			qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": Cloned slide 0 (master)";
 			AbstractItemList list = slide->itemList();
 			foreach(AbstractItem *item, list)
-			{
-				if(DEBUG_TEXTOSLIDES)
-					qDebug() << "SongSlideGroup::textToSlides(): \t Master Debug:"<<item->itemName();
-			}
+				qDebug() << "SongTextToSlidesJob::run(): \t Master Debug:"<<item->itemName();
 		}
-			
 
 		// If more than one slide, assum first slide is master slide and following slides are keyed to verses
-		if(templates->numSlides() > 1 && slideNbr+1 < templates->numSlides())
+		if(templateSlides.size() > 1 && slideNbr+1 < templateSlides.size())
 		{
 			// Since we've cloned a master slide and have another slide to clone, calc the max Z on the
 			// master and rebase everything on secondary slide starting at the maxZ of the master slide
@@ -311,17 +485,14 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 					masterBg = bgTmp;
 			}
 			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": masterZValue:"<<masterZValue;
+				qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": masterZValue:"<<masterZValue;
 
 
 			// Add items from the song slide to our master slide.
 			// Don't clone the song slide since we've already cloned
 			// the master slide - instead, we'll clone the items in
 			// this slide, below.
-			Slide *songSlide = templates->at(slideNbr+1);
-
-			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Cloned passage slide for #"<<slideNbr;
+			Slide *songSlide = templateSlides.at(slideNbr+1);
 
 			bool secondaryBg = false;	
 			QList<AbstractItem *> items = songSlide->itemList();
@@ -351,7 +522,7 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 				{
 					newVisual->setZValue(newVisual->zValue() + masterZValue);
 					if(DEBUG_TEXTOSLIDES)
-						qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": rebased" << newVisual->itemName() << "to new Z" << newVisual->zValue();
+						qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": rebased" << newVisual->itemName() << "to new Z" << newVisual->zValue();
 				}
 
 				slide->addItem(newItem);
@@ -361,7 +532,7 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			if(secondaryBg && masterBg)
 			{
 				if(DEBUG_TEXTOSLIDES)
-					qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Found secondaryBg on slide"<<slideNbr<<", removing masterBg";
+					qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": Found secondaryBg on slide"<<slideNbr<<", removing masterBg";
 				slide->removeItem(masterBg);
 			}
 		}
@@ -373,15 +544,12 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 
 		foreach(AbstractItem * item, items)
 		{
-			AbstractVisualItem * newVisual = dynamic_cast<AbstractVisualItem*>(item);
-			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": item list: "<<newVisual->itemName();
 			if(!text && item->itemClass() == TextBoxItem::ItemClass)
 			{
 				text = dynamic_cast<TextBoxItem*>(item);
 				textboxFromTemplate = true;
 				if(DEBUG_TEXTOSLIDES)
-					qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Found textbox from template, name:"<<text->itemName();
+					qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": Found textbox from template, name:"<<text->itemName();
 			}
 		}
 
@@ -394,26 +562,12 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			text->setItemName(QString("TextBox%1").arg(text->itemId()));
 
 			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": No textbox in template, adding new box.";
-		}
-
-
-		BackgroundItem * bg = dynamic_cast<BackgroundItem*>(slide->background());
-		if(bg)
-		{
-			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Loaded background "<<bg->itemName()<<" in final slide";
-		}
-		else
-		{
-			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": No background in final slide!.";
+				qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": No textbox in template, adding new box.";
 		}
-	
 
 		// Run a basic algorithim to find the max font size to fit inside this text rectangle (textRect)
 		QString htmlStr;
-		QRectF screenRect = AppSettings::adjustToTitlesafe(MainWindow::mw() ? MainWindow::mw()->standardSceneRect() : FALLBACK_SCREEN_RECT);
+		QRectF screenRect = m_screenRect;
 		QRectF textRect = screenRect;
 		int currentMinTextSize = 32;
 		if(textboxFromTemplate)
@@ -426,7 +580,7 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			QStringList filtered;
 			QStringList lines = passage.split("\n");
 			foreach(QString line, lines)
-				if(filter == AllowAll || !line.contains(excludeLineRegExp))
+				if(filter == SongSlideGroup::AllowAll || !line.contains(excludeLineRegExp))
 					filtered << line;
 					
 			QString filteredPassage = filtered.join("\n");
@@ -470,7 +624,7 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			html << slideHeader;
 			foreach(QString line, lines)
 			{
-				if(filter == AllowAll || !line.contains(excludeLineRegExp))
+				if(filter == SongSlideGroup::AllowAll || !line.contains(excludeLineRegExp))
 				{
 					html << linePrefix;
 					html << line;
@@ -481,67 +635,16 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			
 		 	htmlStr = html.join("");
 		}
-// 
-// 		int ptSize = 32;	// starting pt size (must match pt size in static html above)
-// 		int sizeInc = 4;	// how big of a jump to add to the ptSize each iteration
-// 		int maxPtSize = 72;
-// 
-// 		int count = 0;		// current loop iteration
-// 		int maxCount = 50; 	// max iterations of the search loop (allows font to get up to 232pt)
-// 		bool done = false;
-// 
-// 		int lastGoodSize = ptSize;
-// 		QString lastGoodHtml = htmlStr;
-// 
-// 		// for centering
-// 		qreal boxHeight = -1;
-// 
-// 		while(!done && count++ < maxCount)
-// 		{
-// 			QString htmlCopy = htmlStr;
-// 			htmlCopy = htmlCopy.replace("size:32pt",QString("size:%1pt").arg(ptSize));
-// 			doc.setHtml(htmlCopy);
-// 			doc.setTextWidth(textRect.width());
-// 
-// 			QSizeF sz = doc.size();
-// 
-// 			if(sz.height() < textRect.height() &&
-// 			   ptSize < maxPtSize)
-// 			{
-// 				lastGoodSize = ptSize;
-// 				lastGoodHtml = htmlCopy;
-// 				boxHeight = sz.height();
-// 
-// 				//qDebug() << "size search: "<<ptSize<<"pt was good, trying higher";
-// 				ptSize += sizeInc;
-// 
-// 			}
-// 			else
-// 			{
-// 				if(DEBUG_TEXTOSLIDES)
-// 					qDebug() << "SongSlideGroup::textToSlides(): size search: last good ptsize:"<<lastGoodSize<<", stopping search";
-// 				done = true;
-// 			}
-// 		}
-// 
-// 		htmlStr = lastGoodHtml;
+
 		text->setText(htmlStr);
 		qreal boxHeight = text->fitToSize(textRect.size().toSize(), currentMinTextSize, 72);
-		//qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": firtToSize boxHeight:"<<boxHeight<<", given size:"<<textRect.size().toSize();
+		//qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": firtToSize boxHeight:"<<boxHeight<<", given size:"<<textRect.size().toSize();
 		
-		// these two dynamic properties are used in the SongFoldbackTextFilter to 
-		// reference back to this slide group, extract original text, and mutate
-		// it for the foldback display
-		QVariant slideGroupVar;
-		slideGroupVar.setValue(this);
-		text->setProperty("SongSlideGroup",  slideGroupVar);
-		text->setProperty("SongSlideNumber", slideNbr);
-			
 		// Finalize setup
 		// magic number 
 		int heightDifference = abs(screenRect.height() - textRect.height());
 		if(DEBUG_TEXTOSLIDES)
-			qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": textRect.height():"<<textRect.height()<<"screenRect.height():"<<screenRect.height()<<", heightDifference:"<<heightDifference;
+			qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": textRect.height():"<<textRect.height()<<"screenRect.height():"<<screenRect.height()<<", heightDifference:"<<heightDifference;
 		
 		// Arbitrary magic number to force centering for small amounts of differences.
 		// We test the difference here because don't want to force-center the textbox if it came from the template
@@ -554,7 +657,7 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			if(boxHeight > -1)
 			{
 				qreal y = textRect.height()/2 - boxHeight/2;
-				//qDebug() << "SongSlideGroup::textToSlides(): centering: boxHeight:"<<boxHeight<<", textRect height:"<<textRect.height()<<", centered Y:"<<y;
+				//qDebug() << "SongTextToSlidesJob::run(): centering: boxHeight:"<<boxHeight<<", textRect height:"<<textRect.height()<<", centered Y:"<<y;
 				textRect = QRectF(screenRect.x(),y + screenRect.y(),textRect.width(),boxHeight);
 			}
 
@@ -571,29 +674,29 @@ void SongSlideGroup::textToSlides(SongTextFilter filter)
 			}
 
 			if(DEBUG_TEXTOSLIDES)
-				qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": Textbox was not in template (or almost centered), finalized setup at 0x0, rect:"<<textRect;
+				qDebug() << "SongTextToSlidesJob::run(): slideNbr:"<<slideNbr<<": Textbox was not in template (or almost centered), finalized setup at 0x0, rect:"<<textRect;
 		}
 		
-		//qDebug() << "SongSlideGroup::textToSlides(): slideNbr:"<<slideNbr<<": textboxFromTemplate:"<<textboxFromTemplate<<", boxHeight:"<<boxHeight;
-
 		slide->setSlideNumber(slideNbr++);
 		
-		addSlide(slide);
+		// The group (and the timers that warm the text cache) live on the GUI thread
+		slide->moveToThread(m_resultThread);
+		foreach(AbstractItem *item, slide->itemList())
+			item->moveToThread(m_resultThread);
+		if(text->thread() != m_resultThread)
+			text->moveToThread(m_resultThread);
 		
-		// Delay warming the visual cache to increase UI responsiveness when quickly adding songs
-		int rv = (rand() % 500) - (500/2); // get a random number +/- 250ms
-		int delay = slideNbr * 5000 + rv; // add a random +/- 250ms to stagger hits to the warming method
-		if(DEBUG_TEXTOSLIDES)
-			qDebug() << "SongSlideGroup::textToSlides(): "<<(song() ? song()->title() : " (no song) ")<<": slideNbr:"<<slideNbr<<": delaying "<<delay<<"ms before warmVisualCache()";
-		QTimer::singleShot(delay, text, SLOT(warmVisualCache()));
+		m_slides << slide;
+		m_textBoxes << text;
 		
 		if(DEBUG_TEXTOSLIDES)
-			qDebug() << "SongSlideGroup::textToSlides(): Added passage:"<<passage;
-		//qDebug() << "SongSlideGroup::textToSlides(): Added slide#:"<<slide->slideNumber()<<", numSlides():"<<numSlides();
+			qDebug() << "SongTextToSlidesJob::run(): Built passage:"<<passage;
 	}
 	
 	if(DEBUG_TEXTOSLIDES)
-		qDebug() << "SongSlideGroup::textToSlides():"<<(song() ? song()->title() : " (no song) ")<<": End of text to slides, numSlides():"<<numSlides();
+		qDebug() << "SongTextToSlidesJob::run(): Done, built"<<m_slides.size()<<"slides";
+	
+	emit done();
 }
 
 /* public */
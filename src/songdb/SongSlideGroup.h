@@ -4,6 +4,16 @@
 #include "model/SlideGroup.h"
 #include "SongRecord.h"
 
+#include <QRunnable>
+#include <QPointer>
+#include <QRectF>
+
+class TextBoxItem;
+class SongTextToSlidesJob;
+
+/// Number of template states kept serialized by SongSlideGroup, and deserialized by each SongTextToSlidesJob thread
+#define SONGSLIDEGROUP_TEMPLATE_CACHE_SIZE 8
+
 /// \brief: SongSlideGroup represents a single song in the document.
 /// SongSlideGroup provides the translation of the text of the lyrics
 /// into a collection of slides with appros text boxes, etc.
@@ -14,6 +24,9 @@
 /// method. The first slide in the slideTemplates() SlideGroup is used
 /// as a master slide and subsequent slides correspond to passages in
 /// the lyrics.
+///
+/// The slides themselves are built by a SongTextToSlidesJob on QThreadPool::globalInstance(),
+/// so they show up in the group shortly after the text, arrangement or templates change.
 class SongSlideGroup : public SlideGroup
 {
 private:
@@ -76,9 +89,17 @@ protected slots:
 	void textToSlides(SongTextFilter filter = Standard);
 	void aspectRatioChanged(double x);
 
+private slots:
+	void textToSlidesDone();
+
 private:
+	friend class SongTextToSlidesJob;
+	
 	void hitTextToSlides();
 	
+	// Identifies the current state of the template slides for SongTextToSlidesJob's caches
+	static quint64 templateHash(SlideGroup *templates);
+	
 	SongRecord * m_song;
 	QString m_text;
 	bool m_isTextDiffFromDb;
@@ -90,9 +111,49 @@ private:
 	
 	double m_lastAspectRatio;
 	QTimer m_textRegenTimer;
+	
+	// The job whose slides we're waiting on - results from any other job are stale
+	QPointer<SongTextToSlidesJob> m_textJob;
 
 
 };
 Q_DECLARE_METATYPE(SongSlideGroup*);
 
+/// \class SongTextToSlidesJob
+/// Builds the slides for one run of SongSlideGroup::textToSlides() on a worker thread. Everything the
+/// job needs is copied in up front (the template slides as serialized bytes), so it never touches the
+/// group, its song or the template group. Each worker thread keeps its own cache of compiled filter
+/// regexps and deserialized template slides, keyed by SongSlideGroup::templateHash().
+///
+/// When done, the slides are moved to \a resultThread and done() is emitted. Slides not taken with
+/// takeSlides() are deleted with the job.
+class SongTextToSlidesJob : public QObject, public QRunnable
+{
+	Q_OBJECT
+public:
+	SongTextToSlidesJob(QThread *resultThread, const QStringList& passages, int filter, const QRectF& screenRect, quint64 templateHash, const QList<QByteArray>& templateSlides);
+	~SongTextToSlidesJob();
+	
+	// QRunnable::
+	void run();
+	
+	QList<Slide*> takeSlides();
+	/// The lyrics textbox of each slide from takeSlides(), in the same order
+	QList<TextBoxItem*> textBoxes() { return m_textBoxes; }
+
+signals:
+	void done();
+
+private:
+	QThread *m_resultThread;
+	QStringList m_passages;
+	int m_filter;
+	QRectF m_screenRect;
+	quint64 m_templateHash;
+	QList<QByteArray> m_templateSlides;
+	
+	QList<Slide*> m_slides;
+	QList<TextBoxItem*> m_textBoxes;
+};
+
 #endif